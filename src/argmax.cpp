@@ -1,81 +1,168 @@
 #include "argmax.h"
 
-#include <chrono>
-#include <iostream>
+#include <stdexcept>
 #include <vector>
 
-using namespace chrono;
+#include "managed_eval.h"
 
-void ArgmaxEvaluator::argmax(Ciphertext &x, Ciphertext &res, int len) {
-  // TODO: Assert len is << N, and a power of 2
+int ArgmaxEvaluator::level(const Ciphertext &x) const {
+  return static_cast<int>(ckks->context->get_context_data(x.parms_id())->chain_index());
+}
 
-  Ciphertext tmp, a, b, sign, a_plus_b, a_minus_b, a_minus_b_sgn;
-  Plaintext one, half;
+ArgmaxEvaluator::Plan ArgmaxEvaluator::plan(int len, int level, int boot_level) const {
+  Plan p;
+  p.round_depth = CKKSEvaluator::sgn_table(round_alpha, round_eps).depth + 1;
+  p.final_depth = CKKSEvaluator::sgn_table(sgn_alpha, sgn_eps).depth;
+  if (boot_level < max(p.round_depth, p.final_depth)) {
+    throw invalid_argument("a bootstrapped ciphertext cannot afford one argmax round");
+  }
 
-  int log_step = log2(len);
+  // Bootstrapping as late as possible is optimal, since every bootstrap restores
+  // the same level no matter how many levels were still left
+  int rounds = static_cast<int>(log2(len));
+  for (int i = 0; i <= rounds; i++) {
+    int depth = i < rounds ? p.round_depth : p.final_depth;
+    bool boot = level < depth;
+    if (boot) {
+      level = boot_level;
+      p.bootstraps++;
+    }
+    p.bootstrap_before.push_back(boot);
+    level -= depth;
+  }
+  return p;
+}
 
-  // Transform x = [a_0, ..., a_n, 0, ..., 0] to [a_0, ..., a_n, a_0, ..., a_n, 0, ..., 0]
-  ckks->evaluator->rotate_vector(x, -len, *ckks->galois_keys, tmp);
-  ckks->evaluator->add_inplace(x, tmp);
+vector<int> ArgmaxEvaluator::rotation_steps(int len) {
+  vector<int> steps{-len};
+  for (int i = 1; i < len; i *= 2) {
+    steps.push_back(i);
+  }
+  return steps;
+}
 
-  a = x;
-  for (int i = 0; i < log_step; ++i) {
-    ckks->evaluator->rotate_vector(a, pow(2, i), *ckks->galois_keys, b);
+// Transforms x = [a_0, ..., a_n, 0, ..., 0] to [a_0, ..., a_n, a_0, ..., a_n, 0, ..., 0]
+void ArgmaxEvaluator::duplicate(const Ciphertext &x, Ciphertext &x_dup, int len) {
+  ckks->evaluator->rotate_vector(x, -len, *ckks->galois_keys, x_dup);
+  ckks->evaluator->add_inplace(x_dup, x);
+}
 
-    ckks->evaluator->add(a, b, a_plus_b);
-    ckks->evaluator->sub(a, b, a_minus_b);
-    sign = ckks->sgn_eval(a_minus_b, 2, 2);
+void ArgmaxEvaluator::max_round(Ciphertext &a, int i) {
+  ManagedEvaluator managed(*ckks);
+  Ciphertext b, a_minus_b, sign;
+  ckks->evaluator->rotate_vector(a, pow(2, i), *ckks->galois_keys, b);
+
+  ckks->evaluator->sub(a, b, a_minus_b);
+  ckks->evaluator->add_inplace(a, b);
+  ckks->sgn_eval(a_minus_b, CKKSEvaluator::sgn_table(round_alpha, round_eps), sign);
+
+  // a = max(a, b) = (a - b) * sgn(a - b) / 2 + (a + b) / 2, where the halving of
+  // a + b rides on the scale lift into the pending product instead of a level
+  ManagedCiphertext max_ab(std::move(a_minus_b)), a_plus_b(std::move(a));
+  managed.multiply_inplace(max_ab, ManagedCiphertext(std::move(sign)));
+  managed.multiply_const_inplace(a_plus_b, 0.5);
+  managed.add_inplace(max_ab, a_plus_b);
+  managed.resolve(max_ab);
+  a = std::move(max_ab.ct);
+}
+
+void ArgmaxEvaluator::compare_max(Ciphertext &x_dup, Ciphertext &a, Ciphertext &res) {
+  ManagedEvaluator managed(*ckks);
+  ManagedCiphertext diff(std::move(x_dup));
+  managed.sub_inplace(diff, ManagedCiphertext(std::move(a)));
+  managed.resolve(diff);
+  res = std::move(diff.ct);
+
+  ckks->sgn_eval_inplace(res, CKKSEvaluator::sgn_table(sgn_alpha, sgn_eps), 1.0);
+
+  ckks->evaluator->add_const_inplace(res, 1.0);
+}
 
-    // (a - b) * sgn(a - b) / 2
-    ckks->evaluator->mod_switch_to_inplace(a_minus_b, sign.parms_id());
-    ckks->evaluator->multiply(a_minus_b, sign, a_minus_b_sgn);
-    ckks->evaluator->relinearize_inplace(a_minus_b_sgn, *ckks->relin_keys);
-    ckks->evaluator->rescale_to_next_inplace(a_minus_b_sgn);
+void ArgmaxEvaluator::argmax(const Ciphertext &x, Ciphertext &res, int len) {
+  // TODO: Assert len is << N, and a power of 2
+
+  int round_depth = CKKSEvaluator::sgn_table(round_alpha, round_eps).depth + 1;
+  int final_depth = CKKSEvaluator::sgn_table(sgn_alpha, sgn_eps).depth;
+  Ciphertext x_dup, a;
 
-    // (a + b) / 2
-    ckks->encoder->encode(0.5, a_plus_b.parms_id(), a_plus_b.scale(), half);
-    ckks->evaluator->multiply_plain_inplace(a_plus_b, half);
-    ckks->evaluator->rescale_to_next_inplace(a_plus_b);
+  int log_step = log2(len);
 
-    // a = max(a, b)
-    a_plus_b.scale() = a_minus_b_sgn.scale();
-    ckks->evaluator->mod_switch_to_inplace(a_plus_b, a_minus_b_sgn.parms_id());
-    ckks->evaluator->add(a_plus_b, a_minus_b_sgn, a);
+  duplicate(x, x_dup, len);
+
+  // Bootstraps follow the rule plan() models: only before a step the remaining
+  // levels cannot pay for
+  a = x_dup;
+  for (int i = 0; i < log_step; ++i) {
+    if (level(a) < round_depth) {
+      bootstrap(a);
+    }
+    max_round(a, i);
+  }
 
+  if (level(a) < final_depth) {
     bootstrap(a);
   }
+  compare_max(x_dup, a, res);
+}
 
-  x.scale() = a.scale();
-  ckks->evaluator->mod_switch_to_inplace(x, a.parms_id());
-  ckks->evaluator->sub(x, a, res);
+// The rounds run in lockstep over the batch, so the ciphertexts that run out of
+// levels before a round are refreshed together; their slots are real, so the
+// refresh packs them two per bootstrap with bootstrap_real_many
+void ArgmaxEvaluator::argmax(const vector<Ciphertext> &x, vector<Ciphertext> &res, int len, ThreadPool &pool) {
+  int round_depth = CKKSEvaluator::sgn_table(round_alpha, round_eps).depth + 1;
+  int final_depth = CKKSEvaluator::sgn_table(sgn_alpha, sgn_eps).depth;
+  size_t count = x.size();
+  vector<Ciphertext> x_dup(count), a(count);
 
-  res = ckks->sgn_eval(res, 2, 2, 1.0);
+  int log_step = log2(len);
+
+  pool.parallel_for(count, [&](size_t k) {
+    duplicate(x[k], x_dup[k], len);
+    a[k] = x_dup[k];
+  });
 
-  ckks->encoder->encode(1.0, res.parms_id(), res.scale(), one);
-  ckks->evaluator->add_plain_inplace(res, one);
+  for (int i = 0; i < log_step; ++i) {
+    bootstrap(a, round_depth, pool);
+    pool.parallel_for(count, [&](size_t k) { max_round(a[k], i); });
+  }
+
+  bootstrap(a, final_depth, pool);
+  res.resize(count);
+  pool.parallel_for(count, [&](size_t k) { compare_max(x_dup[k], a[k], res[k]); });
 }
 
+// bootstrap_3 raises the modulus from the lowest level
 void ArgmaxEvaluator::bootstrap(Ciphertext &x) {
-  cout << "Bootstrapping started" << endl;
-
   if (x.coeff_modulus_size() > 1) {
-    cout << "Ciphertext is not at lowest level, remaining level(s): " + to_string(x.coeff_modulus_size()) << endl;
-    cout << "Mod switching to the lowest level..." << endl;
-
-    while (x.coeff_modulus_size() > 1) {
-      ckks->evaluator->mod_switch_to_next_inplace(x);
-    }
+    ckks->evaluator->mod_switch_to_inplace(x, ckks->context->last_parms_id());
   }
 
   Ciphertext x_0 = x;
   bootstrapper->set_final_scale(x.scale());
-  cout << "Bootstrapping..." << endl;
-
-  auto start = system_clock::now();
-
   bootstrapper->bootstrap_3(x, x_0);
+}
+
+void ArgmaxEvaluator::bootstrap(vector<Ciphertext> &x, int depth, ThreadPool &pool) {
+  vector<size_t> low;
+  for (size_t k = 0; k < x.size(); k++) {
+    if (level(x[k]) < depth) {
+      low.push_back(k);
+    }
+  }
+  if (low.empty()) {
+    return;
+  }
 
-  duration<double> sec = system_clock::now() - start;
-  cout << "Bootstrapping took: " << sec.count() << "s" << endl;
-  cout << "New ciphertext depth: " << x.coeff_modulus_size() << endl;
+  vector<Ciphertext> batch(low.size());
+  for (size_t j = 0; j < low.size(); j++) {
+    batch[j] = std::move(x[low[j]]);
+    if (batch[j].coeff_modulus_size() > 1) {
+      ckks->evaluator->mod_switch_to_inplace(batch[j], ckks->context->last_parms_id());
+    }
+  }
+  bootstrapper->set_final_scale(batch[0].scale());
+  bootstrapper->bootstrap_real_many(batch, pool);
+  for (size_t j = 0; j < low.size(); j++) {
+    x[low[j]] = std::move(batch[j]);
+  }
 }
@@ -2,8 +2,11 @@
 
 #include <seal/seal.h>
 
+#include <vector>
+
 #include "Bootstrapper.h"
 #include "ckks_evaluator.h"
+#include "thread_pool.h"
 
 using namespace std;
 using namespace seal;
@@ -12,15 +15,47 @@ class ArgmaxEvaluator {
  private:
   Bootstrapper *bootstrapper = nullptr;
 
+  int level(const Ciphertext &x) const;
+
+  // The steps of argmax: duplicating x, tournament round i on a, and the final
+  // comparison of x_dup against the maximum a
+  void duplicate(const Ciphertext &x, Ciphertext &x_dup, int len);
+  void max_round(Ciphertext &a, int i);
+  void compare_max(Ciphertext &x_dup, Ciphertext &a, Ciphertext &res);
+
+  // Bootstraps the ciphertexts of x with fewer than depth levels left
+  void bootstrap(vector<Ciphertext> &x, int depth, ThreadPool &pool);
+
  public:
   CKKSEvaluator *ckks = nullptr;
+  // Precision of the tournament comparisons, for entries that differ by at least
+  // round_eps, and of the final comparison of every entry against the maximum
+  double round_alpha = 16, round_eps = 1.0 / 32;
+  double sgn_alpha = 20, sgn_eps = 1.0 / 64;
+
+  // Where argmax bootstraps, for an input at level and bootstraps restoring
+  // boot_level. bootstrap_before has one entry per round and a last one for the
+  // final comparison. Whenever boot_level covers k rounds, k rounds share a bootstrap.
+  struct Plan {
+    int round_depth = 0;
+    int final_depth = 0;
+    vector<bool> bootstrap_before;
+    int bootstraps = 0;
+  };
 
   ArgmaxEvaluator(CKKSEvaluator &ckks, Bootstrapper &bootstrapper) {
     this->ckks = &ckks;
     this->bootstrapper = &bootstrapper;
   }
 
-  void argmax(Ciphertext &x, Ciphertext &res, int len);
+  Plan plan(int len, int level, int boot_level) const;
+
+  void argmax(const Ciphertext &x, Ciphertext &res, int len);
+  // Evaluates each ciphertext of x on the pool, bootstrapping the batch together; res may be x
+  void argmax(const vector<Ciphertext> &x, vector<Ciphertext> &res, int len, ThreadPool &pool = ThreadPool::shared());
 
   void bootstrap(Ciphertext &x);
+
+  // The Galois steps argmax rotates by; the bootstraps take theirs from the Bootstrapper
+  static vector<int> rotation_steps(int len);
 };
@@ -4,6 +4,7 @@
 #include <chrono>
 #include <iostream>
 #include <random>
+#include <string>
 
 #include "Bootstrapper.h"
 #include "ckks_evaluator.h"
@@ -29,7 +30,38 @@ double recover_vefore(double before, long boundary_K) {
   return scaled - round(scaled);
 }
 
-int main() {
+/*
+  Bootstraps one ciphertext with bootstrap_3. Given level budgets for the planned
+  transforms,
+
+    ./bootstrapping --cts-levels 2 --stc-levels 2
+
+  it bootstraps the same ciphertext with bootstrap_planned as well, reports how
+  far the two results lie apart, and fails if the planned one is markedly less
+  precise.
+*/
+int main(int argc, char **argv) {
+  long cts_levels = 0, stc_levels = 0;
+  for (int i = 1; i < argc; i += 2) {
+    string flag = argv[i];
+    if (i + 1 == argc) {
+      flag = "";
+    }
+    if (flag == "--cts-levels") {
+      cts_levels = stol(argv[i + 1]);
+    } else if (flag == "--stc-levels") {
+      stc_levels = stol(argv[i + 1]);
+    } else {
+      cerr << "usage: bootstrapping [--cts-levels n --stc-levels n]" << endl;
+      return 1;
+    }
+  }
+  if ((cts_levels > 0) != (stc_levels > 0)) {
+    cerr << "--cts-levels and --stc-levels go together" << endl;
+    return 1;
+  }
+  bool planned = cts_levels > 0;
+
   long boundary_K = 25;
   long deg = 59;
   long scale_factor = 2;
@@ -50,6 +82,10 @@ int main() {
   // Calculation required
   int remaining_level = 16;
   int boot_level = 14;  // >= subsum 1 + coefftoslot 2 + ModReduction 9 + slottocoeff 2
+  if (planned) {
+    // The planned transforms may spend more levels than the three each of bootstrap_3
+    boot_level += max(0L, cts_levels + stc_levels - 6);
+  }
   int total_level = remaining_level + boot_level;
 
   vector<int> coeff_bit_vec;
@@ -107,23 +143,31 @@ int main() {
       relin_keys,
       gal_keys);
 
+  bootstrapper.cts_levels = cts_levels;
+  bootstrapper.stc_levels = stc_levels;
+
   cout << "Generating Optimal Minimax Polynomials..." << endl;
   bootstrapper.prepare_mod_polynomial();
 
   cout << "Adding Bootstrapping Keys..." << endl;
   vector<int> gal_steps_vector;
-  gal_steps_vector.push_back(0);
-  for (int i = 0; i < logN - 1; i++) {
-    gal_steps_vector.push_back((1 << i));
-  }
+  bootstrapper.addLeftRotKeys_Subsum_to_vector(gal_steps_vector);
   bootstrapper.addLeftRotKeys_Linear_to_vector_3(gal_steps_vector);
+  if (planned) {
+    bootstrapper.addLeftRotKeys_Linear_to_vector_planned(gal_steps_vector);
+  }
 
-  keygen.create_galois_keys(gal_steps_vector, gal_keys);
+  GaloisKeyPlanner planner(context);
+  planner.add_steps(gal_steps_vector);
+  planner.create(keygen, gal_keys);
 
   bootstrapper.slot_vec.push_back(logn);
 
   cout << "Generating Linear Transformation Coefficients..." << endl;
   bootstrapper.generate_LT_coefficient_3();
+  if (planned) {
+    bootstrapper.generate_LT_coefficient_planned();
+  }
 
   double tot_err = 0, mean_err;
   size_t iterations = 1;
@@ -153,7 +197,7 @@ int main() {
     evaluator.mod_switch_to_next_inplace(cipher);
   }
 
-  Ciphertext rtn;
+  Ciphertext rtn, planned_cipher = cipher;
 
   decryptor.decrypt(cipher, plain);
   encoder.decode(plain, before);
@@ -176,5 +220,36 @@ int main() {
   mean_err /= sparse_slots;
   cout << "Mean absolute error: " << mean_err << endl;
 
+  if (planned) {
+    Ciphertext planned_rtn;
+    start = system_clock::now();
+    bootstrapper.bootstrap_planned(planned_rtn, planned_cipher);
+    sec = system_clock::now() - start;
+    cout << "Planned bootstrapping time : " << sec.count() << "s" << endl;
+    cout << "Planned return cipher level: " << planned_rtn.coeff_modulus_size() << endl;
+
+    vector<double> planned_after;
+    decryptor.decrypt(planned_rtn, plain);
+    encoder.decode(plain, planned_after);
+
+    double planned_err = 0, max_err = 0, planned_max_err = 0, max_diff = 0;
+    for (long i = 0; i < sparse_slots; i++) {
+      planned_err += abs(before[i] - planned_after[i]);
+      max_err = max(max_err, abs(before[i] - after[i]));
+      planned_max_err = max(planned_max_err, abs(before[i] - planned_after[i]));
+      max_diff = max(max_diff, abs(after[i] - planned_after[i]));
+    }
+    planned_err /= sparse_slots;
+    cout << "Planned mean absolute error: " << planned_err << endl;
+    cout << "Max difference from bootstrap_3: " << max_diff << endl;
+
+    // The plan may trade a little precision for levels, but not whole bits
+    if (planned_max_err > 4 * max_err) {
+      cout << "Planned bootstrapping is less precise than bootstrap_3: max error " << planned_max_err << " against "
+           << max_err << endl;
+      return 1;
+    }
+  }
+
   return 0;
 }
@@ -1,5 +1,15 @@
 #include "Bootstrapper.h"
 
+namespace {
+// Seconds since start, which is moved to now
+double lap(chrono::steady_clock::time_point &start) {
+  auto now = chrono::steady_clock::now();
+  double seconds = chrono::duration<double>(now - start).count();
+  start = now;
+  return seconds;
+}
+}  // namespace
+
 Bootstrapper::Bootstrapper(
     long _loge,
     long _logn,
@@ -23,6 +33,10 @@ Bootstrapper::Bootstrapper(
   Nh = 1 << logNh;
   mod_reducer =
       new ModularReducer(boundary_K, (double)loge, sin_cos_deg, scale_factor, inverse_deg, context, encoder, encryptor, evaluator, relin_keys, decryptor);
+
+  if (!evaluator.plaintext_cache()) {
+    evaluator.set_plaintext_cache(make_shared<PlaintextCache>());
+  }
 }
 
 void Bootstrapper::addLeftRotKeys_Linear_to_vector(vector<int> &gal_steps_vector) {
@@ -183,6 +197,49 @@ void Bootstrapper::addLeftRotKeys_Linear_to_vector_3(vector<int> &gal_steps_vect
     }
   }
 }
+void Bootstrapper::addLeftRotKeys_Linear_to_vector_planned(vector<int> &gal_steps_vector) {
+  auto add_step = [&](int step) {
+    step = (Nh + step) % Nh;
+    if (step != 0 && find(gal_steps_vector.begin(), gal_steps_vector.end(), step) == gal_steps_vector.end()) {
+      gal_steps_vector.push_back(step);
+    }
+  };
+
+  for (bool inverse : {true, false}) {
+    for (const auto &stage : plan_linear_transform(logn, inverse ? cts_levels : stc_levels, inverse)) {
+      if (stage.rotated) {
+        int gs = giantstep(stage.totlen + 1);
+        int giantlast = floor((stage.totlen + 0.0) / (gs + 0.0));
+        for (int i = 1; i < gs; i++)
+          add_step(i * stage.basicstep);
+        for (int i = 1; i <= giantlast; i++)
+          add_step(i * gs * stage.basicstep);
+      } else {
+        int gs = giantstep(2 * stage.totlen + 1);
+        int basicstart = -stage.totlen + gs * floor((stage.totlen + 0.0) / (gs + 0.0));
+        int giantfirst = -floor((stage.totlen + 0.0) / (gs + 0.0));
+        int giantlast = floor((2 * stage.totlen + 0.0) / (gs + 0.0)) + giantfirst;
+        for (int i = basicstart; i < basicstart + gs; i++)
+          add_step(i * stage.basicstep);
+        for (int i = giantfirst; i <= giantlast; i++)
+          add_step(i * gs * stage.basicstep);
+      }
+    }
+  }
+}
+
+void Bootstrapper::addLeftRotKeys_Subsum_to_vector(vector<int> &gal_steps_vector) {
+  vector<int> steps{0};
+  for (const auto &group : subsum_groups()) {
+    steps.insert(steps.end(), group.begin(), group.end());
+  }
+  for (int step : steps) {
+    if (find(gal_steps_vector.begin(), gal_steps_vector.end(), step) == gal_steps_vector.end()) {
+      gal_steps_vector.push_back(step);
+    }
+  }
+}
+
 void Bootstrapper::addLeftRotKeys_Linear_to_vector_3_other_slots(vector<int> &gal_steps_vector, long other_logn) {
   int div_part1 = floor(logn / 3.0);
   int div_part2 = floor((logn - div_part1) / 2.0);
@@ -392,6 +449,20 @@ void Bootstrapper::addBootKeys_3(GaloisKeys &gal_keys) {
     throw("LT coefficients were not generated for this logn");
 }
 
+void Bootstrapper::addBootKeys_planned(GaloisKeys &gal_keys, size_t max_keys) {
+  vector<int> gal_steps_vector;
+  addLeftRotKeys_Subsum_to_vector(gal_steps_vector);
+  addLeftRotKeys_Linear_to_vector_planned(gal_steps_vector);
+
+  GaloisKeyPlanner planner(context);
+  planner.max_keys = max_keys;
+  planner.add_steps(gal_steps_vector);
+  planner.create(keygen, gal_keys, *stage_pool);
+
+  slot_vec.push_back(logn);
+  change_logn(logn);
+}
+
 void Bootstrapper::addBootKeys_3_other_slots(GaloisKeys &gal_keys, vector<long> &other_logn_vec) {
   vector<int> gal_steps_vector;
   gal_steps_vector.push_back(0);
@@ -505,7 +576,13 @@ void Bootstrapper::addBootKeys_one_depth_more_depth(GaloisKeys &gal_keys) {
   keygen.create_galois_keys(gal_steps_vector, gal_keys);
 }
 
+// The first switch to a slot count builds its LTs, in the layouts generated so
+// far or in that of generate_LT_coefficient_3 if none, and the Galois keys they
+// and the subsum lack. Short vectors then bootstrap with LTs of their own length.
+// A single slot has no LTs, so it only needs the subsum keys.
 void Bootstrapper::change_logn(long new_logn) {
+  if (new_logn < 0 || new_logn > logNh)
+    throw invalid_argument("logn must lie between 0 and logNh!");
   logn = new_logn;
   n = (1 << logn);
   slot_index = -1;
@@ -515,242 +592,278 @@ void Bootstrapper::change_logn(long new_logn) {
       break;
     }
   }
-  if (slot_index == -1)
-    throw("LT coefficients were not generated for this logn");
+  if (slot_index != -1)
+    return;
+
+  if (logn == 0) {
+    vector<int> gal_steps_vector;
+    addLeftRotKeys_Subsum_to_vector(gal_steps_vector);
+    GaloisKeyPlanner planner(context);
+    planner.add_steps(gal_steps_vector);
+    planner.create(keygen, gal_keys, *stage_pool);
+    return;
+  }
+
+  bool planned = !fftstages.empty();
+  bool layout_3 = !fftcoeff1.empty() || !planned;
+  slot_vec.push_back(logn);
+  slot_index = slot_vec.size() - 1;
+
+  orig_coeffvec.resize(slot_vec.size());
+  orig_invcoeffvec.resize(slot_vec.size());
+  genorigcoeff(slot_index);
+  if (layout_3) {
+    for (auto *table : {&fftcoeff1, &fftcoeff2, &fftcoeff3, &invfftcoeff1, &invfftcoeff2, &invfftcoeff3})
+      table->resize(slot_vec.size());
+    genfftcoeff_3(slot_index);
+    geninvfftcoeff_3(slot_index);
+  }
+  if (planned) {
+    fftstages.resize(slot_vec.size());
+    invfftstages.resize(slot_vec.size());
+    generate_LT_coefficient_planned(slot_index);
+  }
+  release_origcoeff();
+
+  vector<int> gal_steps_vector;
+  addLeftRotKeys_Subsum_to_vector(gal_steps_vector);
+  if (layout_3)
+    addLeftRotKeys_Linear_to_vector_3(gal_steps_vector);
+  if (planned)
+    addLeftRotKeys_Linear_to_vector_planned(gal_steps_vector);
+  GaloisKeyPlanner planner(context);
+  planner.add_steps(gal_steps_vector);
+  planner.create(keygen, gal_keys, *stage_pool);
+}
+
+DiagonalStore::DiagonalStore(const vector<vector<complex<double>>> &diags) {
+  len = diags.empty() ? 0 : diags[0].size();
+  if (len & (len - 1))
+    throw invalid_argument("Diagonals must have a power-of-two length!");
+  offsets.reserve(diags.size());
+  periods.reserve(diags.size());
+  for (const auto &diag : diags) {
+    if (diag.size() != len)
+      throw invalid_argument("Diagonals must share one length!");
+
+    // Halve the period while its two halves agree
+    size_t period = len;
+    while (period > 1 && equal(diag.begin(), diag.begin() + period / 2, diag.begin() + period / 2))
+      period /= 2;
+    offsets.push_back(data.size());
+    periods.push_back(period);
+    data.insert(data.end(), diag.begin(), diag.begin() + period);
+  }
+  data.shrink_to_fit();
+}
+
+void DiagonalStore::rotation(size_t i, int logslot, int Nh, int shiftcount, vector<complex<double>> &rtnvec) const {
+  // Both are powers of two, so slot k reads the period at (k + shiftcount)
+  // modulo the shorter one
+  size_t mask = min(periods[i], size_t(1) << logslot) - 1;
+  const complex<double> *diag = data.data() + offsets[i];
+  rtnvec.resize(Nh);
+  for (int k = 0; k < Nh; k++)
+    rtnvec[k] = diag[(k + shiftcount) & mask];
+}
+
+void DiagonalStore::save(ostream &stream) const {
+  uint64_t header[3] = {len, offsets.size(), data.size()};
+  stream.write(reinterpret_cast<const char *>(header), sizeof(header));
+  for (size_t period : periods) {
+    uint64_t p = period;
+    stream.write(reinterpret_cast<const char *>(&p), sizeof(p));
+  }
+  stream.write(reinterpret_cast<const char *>(data.data()), data.size() * sizeof(complex<double>));
+}
+
+void DiagonalStore::load(istream &stream) {
+  uint64_t header[3];
+  stream.read(reinterpret_cast<char *>(header), sizeof(header));
+  len = header[0];
+  periods.resize(header[1]);
+  offsets.resize(header[1]);
+  size_t total = 0;
+  for (size_t i = 0; i < periods.size(); i++) {
+    uint64_t p;
+    stream.read(reinterpret_cast<char *>(&p), sizeof(p));
+    periods[i] = p;
+    offsets[i] = total;
+    total += p;
+  }
+  if (!stream || total != header[2])
+    throw invalid_argument("Corrupt diagonal store!");
+  data.resize(total);
+  stream.read(reinterpret_cast<char *>(data.data()), total * sizeof(complex<double>));
+  if (!stream)
+    throw invalid_argument("Corrupt diagonal store!");
 }
 
 void Bootstrapper::genorigcoeff() {
   orig_coeffvec.resize(slot_vec.size());
   orig_invcoeffvec.resize(slot_vec.size());
-  for (int u = 0; u < slot_vec.size(); u++) {
-    long new_logn = slot_vec[u];
-    long new_n = (1 << new_logn);
-    double theta_0 = M_PI / (2 * new_n);
-    double current_theta;
-    complex<double> current_zeta;
-    int current_power;
-    int blocklen = 1;
-    int blockcount = new_n;
-
-    orig_coeffvec[u].resize(new_logn);
-
-    for (int i = 0; i < new_logn; i++) {
-      orig_coeffvec[u][i].resize(3);
-      for (int j = 0; j < 3; j++) {
-        orig_coeffvec[u][i][j].resize(new_n);
-      }
-    }
+  for (size_t u = 0; u < slot_vec.size(); u++)
+    genorigcoeff(u);
+}
 
-    for (int i = 0; i < new_logn; i++) {
-      blocklen = blocklen << 1;
-      blockcount = blockcount >> 1;
-      current_theta = theta_0 * (1 << (new_logn - 1 - i));
-      current_power = 1;
-      current_zeta = polar(1.0, current_theta * current_power);
-      for (int j = 0; j < blocklen / 2; j++) {
-        for (int k = 0; k < blockcount; k++) {
-          orig_coeffvec[u][i][1][k * blocklen + j] = 1;
-          orig_coeffvec[u][i][1][k * blocklen + j + blocklen / 2] = -current_zeta;
+void Bootstrapper::genorigcoeff(int u) {
+  long new_logn = slot_vec[u];
+  long new_n = (1 << new_logn);
+  double theta_0 = M_PI / (2 * new_n);
+  double current_theta;
+  complex<double> current_zeta;
+  int current_power;
+  int blocklen = 1;
+  int blockcount = new_n;
 
-          orig_coeffvec[u][i][0][k * blocklen + j] = 0;                 // index 2 -> 0
-          orig_coeffvec[u][i][0][k * blocklen + j + blocklen / 2] = 1;  // index 2 -> 0
+  orig_coeffvec[u].resize(new_logn);
 
-          orig_coeffvec[u][i][2][k * blocklen + j] = current_zeta;      // index 0 -> 2
-          orig_coeffvec[u][i][2][k * blocklen + j + blocklen / 2] = 0;  // index 0 -> 2
-        }
-        current_power = (5 * current_power) % (1 << (i + 3));
-        current_zeta = polar(1.0, current_theta * current_power);
-      }
+  for (int i = 0; i < new_logn; i++) {
+    orig_coeffvec[u][i].resize(3);
+    for (int j = 0; j < 3; j++) {
+      orig_coeffvec[u][i][j].resize(new_n);
     }
+  }
 
-    theta_0 = -M_PI / (2 * new_n);
-    blocklen = new_n;
-    blockcount = 1;
+  for (int i = 0; i < new_logn; i++) {
+    blocklen = blocklen << 1;
+    blockcount = blockcount >> 1;
+    current_theta = theta_0 * (1 << (new_logn - 1 - i));
+    current_power = 1;
+    current_zeta = polar(1.0, current_theta * current_power);
+    for (int j = 0; j < blocklen / 2; j++) {
+      for (int k = 0; k < blockcount; k++) {
+        orig_coeffvec[u][i][1][k * blocklen + j] = 1;
+        orig_coeffvec[u][i][1][k * blocklen + j + blocklen / 2] = -current_zeta;
 
-    orig_invcoeffvec.clear();
-    orig_invcoeffvec[u].resize(new_logn);
+        orig_coeffvec[u][i][0][k * blocklen + j] = 0;                 // index 2 -> 0
+        orig_coeffvec[u][i][0][k * blocklen + j + blocklen / 2] = 1;  // index 2 -> 0
 
-    for (int i = 0; i < new_logn; i++) {
-      orig_invcoeffvec[u][i].resize(3);
-      for (int j = 0; j < 3; j++) {
-        orig_invcoeffvec[u][i][j].resize(new_n);
+        orig_coeffvec[u][i][2][k * blocklen + j] = current_zeta;      // index 0 -> 2
+        orig_coeffvec[u][i][2][k * blocklen + j + blocklen / 2] = 0;  // index 0 -> 2
       }
+      current_power = (5 * current_power) % (1 << (i + 3));
+      current_zeta = polar(1.0, current_theta * current_power);
     }
+  }
 
-    for (int i = 0; i < new_logn; i++) {
-      current_theta = theta_0 * (1 << i);
-      current_power = 1;
-      current_zeta = polar(1.0, current_theta * current_power);
-      for (int j = 0; j < blocklen / 2; j++) {
-        for (int k = 0; k < blockcount; k++) {
-          orig_invcoeffvec[u][i][1][k * blocklen + j] = 0.5;
-          orig_invcoeffvec[u][i][1][k * blocklen + j + blocklen / 2] = -0.5 * current_zeta;
+  theta_0 = -M_PI / (2 * new_n);
+  blocklen = new_n;
+  blockcount = 1;
 
-          orig_invcoeffvec[u][i][0][k * blocklen + j] = 0;
-          orig_invcoeffvec[u][i][0][k * blocklen + j + blocklen / 2] = 0.5 * current_zeta;
+  orig_invcoeffvec[u].resize(new_logn);
 
-          orig_invcoeffvec[u][i][2][k * blocklen + j] = 0.5;
-          orig_invcoeffvec[u][i][2][k * blocklen + j + blocklen / 2] = 0;
-        }
-        current_power = (5 * current_power) % (1 << ((new_logn - 1 - i) + 3));
-        current_zeta = polar(1.0, current_theta * current_power);
-      }
-      blocklen = blocklen >> 1;
-      blockcount = blockcount << 1;
+  for (int i = 0; i < new_logn; i++) {
+    orig_invcoeffvec[u][i].resize(3);
+    for (int j = 0; j < 3; j++) {
+      orig_invcoeffvec[u][i][j].resize(new_n);
     }
   }
-}
 
-void Bootstrapper::genfftcoeff_one_depth() {
-  fftcoeff1.resize(slot_vec.size());
-  vector<complex<double>> tmpvec;
-  vector<int> tmpcount;
-  int totlen1, all_case_count, pos, current_pos, ind, ind_res, curr_logn, curr_n;
+  for (int i = 0; i < new_logn; i++) {
+    current_theta = theta_0 * (1 << i);
+    current_power = 1;
+    current_zeta = polar(1.0, current_theta * current_power);
+    for (int j = 0; j < blocklen / 2; j++) {
+      for (int k = 0; k < blockcount; k++) {
+        orig_invcoeffvec[u][i][1][k * blocklen + j] = 0.5;
+        orig_invcoeffvec[u][i][1][k * blocklen + j + blocklen / 2] = -0.5 * current_zeta;
 
-  for (int u = 0; u < slot_vec.size(); u++) {
-    curr_logn = slot_vec[u];
-    curr_n = (1 << curr_logn);
+        orig_invcoeffvec[u][i][0][k * blocklen + j] = 0;
+        orig_invcoeffvec[u][i][0][k * blocklen + j + blocklen / 2] = 0.5 * current_zeta;
 
-    totlen1 = (1 << curr_logn) - 1;
-    fftcoeff1[u].resize(2 * totlen1 + 1);
+        orig_invcoeffvec[u][i][2][k * blocklen + j] = 0.5;
+        orig_invcoeffvec[u][i][2][k * blocklen + j + blocklen / 2] = 0;
+      }
+      current_power = (5 * current_power) % (1 << ((new_logn - 1 - i) + 3));
+      current_zeta = polar(1.0, current_theta * current_power);
+    }
+    blocklen = blocklen >> 1;
+    blockcount = blockcount << 1;
+  }
+}
 
-    for (int i = 0; i < 2 * totlen1 + 1; i++)
-      fftcoeff1[u][i].resize(curr_n, 0);
+// The butterfly levels are only needed while merging them into diagonals
+void Bootstrapper::release_origcoeff() {
+  orig_coeffvec.clear();
+  orig_invcoeffvec.clear();
+}
 
-    tmpvec.clear();
-    tmpvec.resize(curr_n);
+// Merges butterfly levels [first, first + depth) of orig_coeffvec[u], or of
+// orig_invcoeffvec[u] if inverse, into the diagonals of one BSGS transform. The
+// diagonal rotating by pos * basicstep lands at pos + totlen, or at pos modulo
+// totlen + 1 if rotated, where the rotations wrap around the n slots. Diagonals
+// hold len entries, of which the first n are set here.
+void Bootstrapper::merge_fft_levels(
+    vector<vector<complex<double>>> &coeff, int u, int first, int depth, bool inverse, bool rotated, int len) {
+  int curr_logn = slot_vec[u];
+  int curr_n = (1 << curr_logn);
+  int totlen = (1 << depth) - 1;
+  int basicstep = inverse ? (1 << (curr_logn - first - depth)) : (1 << first);
+  const auto &levels = inverse ? orig_invcoeffvec[u] : orig_coeffvec[u];
 
-    tmpcount.clear();
-    tmpcount.resize(curr_logn);
+  coeff.assign(rotated ? totlen + 1 : 2 * totlen + 1, vector<complex<double>>(len, 0));
+  vector<complex<double>> tmpvec(curr_n);
+  vector<int> tmpcount(depth);
+  int all_case_count = pow(3, depth);
+  int ind, ind_res, pos, current_pos;
 
-    all_case_count = pow(3, curr_logn);
+  for (int j = 0; j < all_case_count; j++) {
+    ind = j;
+    pos = 0;
+    for (int p = 0; p < depth; p++) {
+      ind_res = ind % 3;
+      pos += (ind_res - 1) * (1 << (inverse ? depth - 1 - p : p));
+      tmpcount[p] = ind_res;
+      ind = (ind - ind_res) / 3;
+    }
 
-    for (int j = 0; j < all_case_count; j++) {
-      ind = j;
-      pos = 0;
-      for (int p = 0; p < curr_logn; p++) {
-        ind_res = ind % 3;
-        pos += (ind_res - 1) * (1 << p);
-        tmpcount[p] = ind_res;
-        ind = (ind - ind_res) / 3;
-      }
+    current_pos = pos;
+    for (int k = 0; k < curr_n; k++) {
+      tmpvec[k] = 1.0;
+    }
 
-      current_pos = pos;
+    for (int p = 0; p < depth; p++) {
+      current_pos = current_pos - (tmpcount[p] - 1) * (1 << (inverse ? depth - 1 - p : p));
       for (int k = 0; k < curr_n; k++) {
-        tmpvec[k] = 1.0;
-      }
-
-      for (int p = 0; p < curr_logn; p++) {
-        current_pos = current_pos - (tmpcount[p] - 1) * (1 << p);
-        for (int k = 0; k < curr_n; k++) {
-          tmpvec[k] = tmpvec[k] * orig_coeffvec[u][p][tmpcount[p]][((k + current_pos + curr_n) % curr_n)];
-        }
+        tmpvec[k] = tmpvec[k] * levels[first + p][tmpcount[p]][((k + basicstep * (curr_n + current_pos)) % curr_n)];
       }
+    }
 
-      for (int k = 0; k < curr_n; k++) {
-        fftcoeff1[u][pos + totlen1][k] += tmpvec[k];
-      }
+    auto &diag = coeff[rotated ? (pos + totlen + 1) % (totlen + 1) : pos + totlen];
+    for (int k = 0; k < curr_n; k++) {
+      diag[k] += tmpvec[k];
     }
   }
 }
 
-void Bootstrapper::genfftcoeff_full_one_depth() {
+void Bootstrapper::genfftcoeff_one_depth() {
   fftcoeff1.resize(slot_vec.size());
-  vector<complex<double>> tmpvec;
-  vector<int> tmpcount;
-  int totlen1, all_case_count, pos, current_pos, ind, ind_res, curr_logn, curr_n;
   for (int u = 0; u < slot_vec.size(); u++) {
-    curr_logn = slot_vec[u];
-    curr_n = (1 << curr_logn);
-    totlen1 = (1 << curr_logn) - 1;
-
-    fftcoeff1[u].resize(totlen1 + 1);
-
-    for (int i = 0; i < totlen1 + 1; i++)
-      fftcoeff1[u][i].resize(curr_n, 0);
-
-    tmpvec.clear();
-    tmpvec.resize(curr_n);
-
-    tmpcount.clear();
-    tmpcount.resize(curr_logn);
-    all_case_count = pow(3, curr_logn);
-
-    for (int j = 0; j < all_case_count; j++) {
-      ind = j;
-      pos = 0;
-      for (int p = 0; p < curr_logn; p++) {
-        ind_res = ind % 3;
-        pos += (ind_res - 1) * (1 << p);
-        tmpcount[p] = ind_res;
-        ind = (ind - ind_res) / 3;
-      }
-
-      current_pos = pos;
-      for (int k = 0; k < curr_n; k++) {
-        tmpvec[k] = 1.0;
-      }
-
-      for (int p = 0; p < curr_logn; p++) {
-        current_pos = current_pos - (tmpcount[p] - 1) * (1 << p);
-        for (int k = 0; k < curr_n; k++) {
-          tmpvec[k] = tmpvec[k] * orig_coeffvec[u][p][tmpcount[p]][((k + (curr_n + current_pos)) % curr_n)];
-        }
-      }
+    long curr_logn = slot_vec[u];
+    vector<vector<complex<double>>> coeff1;
+    merge_fft_levels(coeff1, u, 0, curr_logn, false, false, 1 << curr_logn);
+    fftcoeff1[u] = DiagonalStore(coeff1);
+  }
+}
 
-      for (int k = 0; k < curr_n; k++) {
-        fftcoeff1[u][(pos + totlen1 + 1) % (totlen1 + 1)][k] += tmpvec[k];
-      }
-    }
+void Bootstrapper::genfftcoeff_full_one_depth() {
+  fftcoeff1.resize(slot_vec.size());
+  for (size_t u = 0; u < slot_vec.size(); u++) {
+    long curr_logn = slot_vec[u];
+    vector<vector<complex<double>>> coeff1;
+    merge_fft_levels(coeff1, u, 0, curr_logn, false, true, 1 << curr_logn);
+    fftcoeff1[u] = DiagonalStore(coeff1);
   }
 }
+
 void Bootstrapper::geninvfftcoeff_one_depth() {
   invfftcoeff1.resize(slot_vec.size());
-  vector<complex<double>> tmpvec;
-  vector<int> tmpcount;
-  int totlen1, all_case_count, pos, current_pos, ind, ind_res, curr_logn, curr_n;
   for (int u = 0; u < slot_vec.size(); u++) {
-    curr_logn = slot_vec[u];
-    curr_n = (1 << curr_logn);
-    totlen1 = (1 << curr_logn) - 1;
-
-    invfftcoeff1[u].resize(totlen1 + 1);
-
-    for (int i = 0; i < totlen1 + 1; i++)
-      invfftcoeff1[u][i].resize(curr_n, 0);
-
-    tmpvec.clear();
-    tmpvec.resize(curr_n);
-
-    tmpcount.clear();
-    tmpcount.resize(curr_logn);
-    all_case_count = pow(3, curr_logn);
-
-    for (int j = 0; j < all_case_count; j++) {
-      ind = j;
-      pos = 0;
-      for (int p = 0; p < curr_logn; p++) {
-        ind_res = ind % 3;
-        pos += (ind_res - 1) * (1 << (curr_logn - 1 - p));
-        tmpcount[p] = ind_res;
-        ind = (ind - ind_res) / 3;
-      }
-      current_pos = pos;
-      for (int k = 0; k < curr_n; k++) {
-        tmpvec[k] = 1.0;
-      }
-
-      for (int p = 0; p < curr_logn; p++) {
-        current_pos = current_pos - (tmpcount[p] - 1) * (1 << (curr_logn - 1 - p));
-        for (int k = 0; k < curr_n; k++) {
-          tmpvec[k] = tmpvec[k] * orig_invcoeffvec[u][p][tmpcount[p]][((k + (curr_n + current_pos)) % curr_n)];
-        }
-      }
-
-      for (int k = 0; k < curr_n; k++) {
-        invfftcoeff1[u][(pos + totlen1 + 1) % (totlen1 + 1)][k] += tmpvec[k];
-      }
-    }
+    long curr_logn = slot_vec[u];
+    vector<vector<complex<double>>> coeff1;
+    merge_fft_levels(coeff1, u, 0, curr_logn, true, true, 1 << curr_logn);
+    invfftcoeff1[u] = DiagonalStore(coeff1);
   }
 }
 
@@ -761,1198 +874,182 @@ void Bootstrapper::generate_LT_coefficient_one_depth() {
   else
     genfftcoeff_one_depth();
   geninvfftcoeff_one_depth();
+  release_origcoeff();
 }
 
 void Bootstrapper::genfftcoeff() {
   fftcoeff1.resize(slot_vec.size());
   fftcoeff2.resize(slot_vec.size());
-  vector<complex<double>> tmpvec;
-  vector<int> tmpcount;
-  int totlen1, totlen2, split_point, basicstep, all_case_count, pos, current_pos, ind, ind_res, curr_logn, curr_n;
   for (int u = 0; u < slot_vec.size(); u++) {
-    curr_logn = slot_vec[u];
-    curr_n = (1 << curr_logn);
-    split_point = floor(curr_logn / 2.0);
-    totlen1 = (1 << split_point) - 1;
-    totlen2 = (1 << (curr_logn - split_point)) - 1;
-
-    fftcoeff1[u].resize(2 * totlen1 + 1);
-    fftcoeff2[u].resize(2 * totlen2 + 1);
-
-    for (int i = 0; i < 2 * totlen1 + 1; i++)
-      fftcoeff1[u][i].resize(2 * curr_n, 0);
-    for (int i = 0; i < 2 * totlen2 + 1; i++)
-      fftcoeff2[u][i].resize(2 * curr_n, 0);
-
-    tmpvec.clear();
-    tmpvec.resize(curr_n);
-
-    tmpcount.clear();
-    tmpcount.resize(split_point);
-    all_case_count = pow(3, split_point);
-
-    for (int j = 0; j < all_case_count; j++) {
-      ind = j;
-      pos = 0;
-      for (int p = 0; p < split_point; p++) {
-        ind_res = ind % 3;
-        pos += (ind_res - 1) * (1 << p);
-        tmpcount[p] = ind_res;
-        ind = (ind - ind_res) / 3;
-      }
-
-      current_pos = pos;
-      for (int k = 0; k < curr_n; k++) {
-        tmpvec[k] = 1.0;
-      }
-
-      for (int p = 0; p < split_point; p++) {
-        current_pos = current_pos - (tmpcount[p] - 1) * (1 << p);
-        for (int k = 0; k < curr_n; k++) {
-          tmpvec[k] = tmpvec[k] * orig_coeffvec[u][p][tmpcount[p]][((k + current_pos + curr_n) % curr_n)];
-        }
-      }
+    int curr_logn = slot_vec[u];
+    int curr_n = (1 << curr_logn);
+    int split_point = floor(curr_logn / 2.0);
 
-      for (int k = 0; k < curr_n; k++) {
-        fftcoeff1[u][pos + totlen1][k] += tmpvec[k];
-      }
-    }
+    vector<vector<complex<double>>> coeff1, coeff2;
+    merge_fft_levels(coeff1, u, 0, split_point, false, false, 2 * curr_n);
+    merge_fft_levels(coeff2, u, split_point, curr_logn - split_point, false, false, 2 * curr_n);
 
-    for (int i = 0; i < 2 * totlen1 + 1; i++) {
+    for (auto &diag : coeff1) {
       for (int j = 0; j < curr_n; j++)
-        fftcoeff1[u][i][j + curr_n] = fftcoeff1[u][i][j];
-    }
-
-    basicstep = (1 << split_point);
-    tmpcount.clear();
-    tmpcount.resize(curr_logn - split_point);
-    all_case_count = pow(3, curr_logn - split_point);
-
-    for (int j = 0; j < all_case_count; j++) {
-      ind = j;
-      pos = 0;
-      for (int p = 0; p < curr_logn - split_point; p++) {
-        ind_res = ind % 3;
-        pos += (ind_res - 1) * (1 << p);
-        tmpcount[p] = ind_res;
-        ind = (ind - ind_res) / 3;
-      }
-
-      current_pos = pos;
-      for (int k = 0; k < curr_n; k++) {
-        tmpvec[k] = 1.0;
-      }
-
-      for (int p = 0; p < curr_logn - split_point; p++) {
-        current_pos = current_pos - (tmpcount[p] - 1) * (1 << p);
-        for (int k = 0; k < curr_n; k++) {
-          tmpvec[k] = tmpvec[k] * orig_coeffvec[u][p + split_point][tmpcount[p]][((k + basicstep * (curr_n + current_pos)) % curr_n)];
-        }
-      }
-
-      for (int k = 0; k < curr_n; k++) {
-        fftcoeff2[u][pos + totlen2][k] += tmpvec[k];
-      }
+        diag[j + curr_n] = diag[j];
     }
-
-    for (int i = 0; i < 2 * totlen2 + 1; i++) {
+    for (auto &diag : coeff2) {
       for (int j = 0; j < curr_n; j++)
-        fftcoeff2[u][i][j + curr_n] = complex<double>(0, 1) * fftcoeff2[u][i][j];
+        diag[j + curr_n] = complex<double>(0, 1) * diag[j];
     }
+    fftcoeff1[u] = DiagonalStore(coeff1);
+    fftcoeff2[u] = DiagonalStore(coeff2);
   }
 }
 
 void Bootstrapper::genfftcoeff_full() {
   fftcoeff1.resize(slot_vec.size());
   fftcoeff2.resize(slot_vec.size());
-  vector<complex<double>> tmpvec;
-  vector<int> tmpcount;
-  int totlen1, totlen2, split_point, basicstep, all_case_count, pos, current_pos, ind, ind_res, curr_logn, curr_n;
   for (int u = 0; u < slot_vec.size(); u++) {
-    curr_logn = slot_vec[u];
-    curr_n = (1 << curr_logn);
-    split_point = floor(curr_logn / 2.0);
-    totlen1 = (1 << split_point) - 1;
-    totlen2 = (1 << (curr_logn - split_point)) - 1;
-
-    fftcoeff1[u].resize(2 * totlen1 + 1);
-    fftcoeff2[u].resize(totlen2 + 1);
-
-    for (int i = 0; i < 2 * totlen1 + 1; i++)
-      fftcoeff1[u][i].resize(curr_n, 0);
-    for (int i = 0; i < totlen2 + 1; i++)
-      fftcoeff2[u][i].resize(curr_n, 0);
-
-    tmpvec.clear();
-    tmpvec.resize(curr_n);
-
-    tmpcount.clear();
-    tmpcount.resize(split_point);
-    all_case_count = pow(3, split_point);
-
-    for (int j = 0; j < all_case_count; j++) {
-      ind = j;
-      pos = 0;
-      for (int p = 0; p < split_point; p++) {
-        ind_res = ind % 3;
-        pos += (ind_res - 1) * (1 << p);
-        tmpcount[p] = ind_res;
-        ind = (ind - ind_res) / 3;
-      }
-
-      current_pos = pos;
-      for (int k = 0; k < curr_n; k++) {
-        tmpvec[k] = 1.0;
-      }
-
-      for (int p = 0; p < split_point; p++) {
-        current_pos = current_pos - (tmpcount[p] - 1) * (1 << p);
-        for (int k = 0; k < curr_n; k++) {
-          tmpvec[k] = tmpvec[k] * orig_coeffvec[u][p][tmpcount[p]][((k + current_pos + curr_n) % curr_n)];
-        }
-      }
+    int curr_logn = slot_vec[u];
+    int curr_n = (1 << curr_logn);
+    int split_point = floor(curr_logn / 2.0);
 
-      for (int k = 0; k < curr_n; k++) {
-        fftcoeff1[u][pos + totlen1][k] += tmpvec[k];
-      }
-    }
-
-    basicstep = (1 << split_point);
-    tmpcount.clear();
-    tmpcount.resize(curr_logn - split_point);
-    all_case_count = pow(3, curr_logn - split_point);
-
-    for (int j = 0; j < all_case_count; j++) {
-      ind = j;
-      pos = 0;
-      for (int p = 0; p < curr_logn - split_point; p++) {
-        ind_res = ind % 3;
-        pos += (ind_res - 1) * (1 << p);
-        tmpcount[p] = ind_res;
-        ind = (ind - ind_res) / 3;
-      }
-
-      current_pos = pos;
-      for (int k = 0; k < curr_n; k++) {
-        tmpvec[k] = 1.0;
-      }
-
-      for (int p = 0; p < curr_logn - split_point; p++) {
-        current_pos = current_pos - (tmpcount[p] - 1) * (1 << p);
-        for (int k = 0; k < curr_n; k++) {
-          tmpvec[k] = tmpvec[k] * orig_coeffvec[u][p + split_point][tmpcount[p]][((k + basicstep * (curr_n + current_pos)) % curr_n)];
-        }
-      }
-
-      for (int k = 0; k < curr_n; k++) {
-        fftcoeff2[u][(pos + totlen2 + 1) % (totlen2 + 1)][k] += tmpvec[k];
-      }
-    }
+    vector<vector<complex<double>>> coeff1, coeff2;
+    merge_fft_levels(coeff1, u, 0, split_point, false, false, curr_n);
+    merge_fft_levels(coeff2, u, split_point, curr_logn - split_point, false, true, curr_n);
+    fftcoeff1[u] = DiagonalStore(coeff1);
+    fftcoeff2[u] = DiagonalStore(coeff2);
   }
 }
 
 void Bootstrapper::geninvfftcoeff() {
   invfftcoeff1.resize(slot_vec.size());
   invfftcoeff2.resize(slot_vec.size());
-  vector<complex<double>> tmpvec;
-  vector<int> tmpcount;
-  int totlen1, totlen2, split_point, basicstep, all_case_count, pos, current_pos, ind, ind_res, curr_logn, curr_n;
   for (int u = 0; u < slot_vec.size(); u++) {
-    curr_logn = slot_vec[u];
-    curr_n = (1 << curr_logn);
-    split_point = ceil(curr_logn / 2.0);
-    totlen1 = (1 << split_point) - 1;
-    totlen2 = (1 << (curr_logn - split_point)) - 1;
-
-    invfftcoeff1[u].resize(totlen1 + 1);
-    invfftcoeff2[u].resize(2 * totlen2 + 1);
-
-    for (int i = 0; i < totlen1 + 1; i++)
-      invfftcoeff1[u][i].resize(curr_n, 0);
-    for (int i = 0; i < 2 * totlen2 + 1; i++)
-      invfftcoeff2[u][i].resize(2 * curr_n, 0);
-
-    tmpvec.clear();
-    tmpvec.resize(curr_n);
-
-    tmpcount.clear();
-    tmpcount.resize(split_point);
-    all_case_count = pow(3, split_point);
-    basicstep = (1 << (curr_logn - split_point));
-
-    for (int j = 0; j < all_case_count; j++) {
-      ind = j;
-      pos = 0;
-      for (int p = 0; p < split_point; p++) {
-        ind_res = ind % 3;
-        pos += (ind_res - 1) * (1 << (split_point - 1 - p));
-        tmpcount[p] = ind_res;
-        ind = (ind - ind_res) / 3;
-      }
-      current_pos = pos;
-      for (int k = 0; k < curr_n; k++) {
-        tmpvec[k] = 1.0;
-      }
-
-      for (int p = 0; p < split_point; p++) {
-        current_pos = current_pos - (tmpcount[p] - 1) * (1 << (split_point - 1 - p));
-        for (int k = 0; k < curr_n; k++) {
-          tmpvec[k] = tmpvec[k] * orig_invcoeffvec[u][p][tmpcount[p]][((k + basicstep * (curr_n + current_pos)) % curr_n)];
-        }
-      }
-
-      for (int k = 0; k < curr_n; k++) {
-        invfftcoeff1[u][(pos + totlen1 + 1) % (totlen1 + 1)][k] += tmpvec[k];
-      }
-    }
-    tmpcount.clear();
-    tmpcount.resize(curr_logn - split_point);
-    all_case_count = pow(3, curr_logn - split_point);
-    for (int j = 0; j < all_case_count; j++) {
-      ind = j;
-      pos = 0;
-      for (int p = 0; p < curr_logn - split_point; p++) {
-        ind_res = ind % 3;
-        pos += (ind_res - 1) * (1 << (curr_logn - split_point - 1 - p));
-        tmpcount[p] = ind_res;
-        ind = (ind - ind_res) / 3;
-      }
-      current_pos = pos;
-      for (int k = 0; k < curr_n; k++) {
-        tmpvec[k] = 1.0;
-      }
-      for (int p = 0; p < curr_logn - split_point; p++) {
-        current_pos = current_pos - (tmpcount[p] - 1) * (1 << (curr_logn - split_point - 1 - p));
-        for (int k = 0; k < curr_n; k++) {
-          tmpvec[k] = tmpvec[k] * orig_invcoeffvec[u][p + split_point][tmpcount[p]][((k + current_pos + curr_n) % curr_n)];
-        }
-      }
+    int curr_logn = slot_vec[u];
+    int curr_n = (1 << curr_logn);
+    int split_point = ceil(curr_logn / 2.0);
 
-      for (int k = 0; k < curr_n; k++) {
-        invfftcoeff2[u][pos + totlen2][k] += tmpvec[k];
-      }
-    }
+    vector<vector<complex<double>>> coeff1, coeff2;
+    merge_fft_levels(coeff1, u, 0, split_point, true, true, curr_n);
+    merge_fft_levels(coeff2, u, split_point, curr_logn - split_point, true, false, 2 * curr_n);
 
-    for (int i = 0; i < totlen1 + 1; i++) {
+    for (auto &diag : coeff1) {
       for (int j = 0; j < curr_n; j++)
-        invfftcoeff1[u][i][j] *= 1.0 / (boundary_K * (1 << (logNh - curr_logn)));
+        diag[j] *= 1.0 / (boundary_K * (1 << (logNh - curr_logn)));
     }
-
-    for (int i = 0; i < 2 * totlen2 + 1; i++) {
+    for (auto &diag : coeff2) {
       for (int j = 0; j < curr_n; j++) {
-        invfftcoeff2[u][i][j] *= 0.5;
-        invfftcoeff2[u][i][j + curr_n] = complex<double>(0, -1) * invfftcoeff2[u][i][j];
+        diag[j] *= 0.5;
+        diag[j + curr_n] = complex<double>(0, -1) * diag[j];
       }
     }
+    invfftcoeff1[u] = DiagonalStore(coeff1);
+    invfftcoeff2[u] = DiagonalStore(coeff2);
   }
 }
 
 void Bootstrapper::geninvfftcoeff_full() {
   invfftcoeff1.resize(slot_vec.size());
   invfftcoeff2.resize(slot_vec.size());
-  vector<complex<double>> tmpvec;
-  vector<int> tmpcount;
-  int totlen1, totlen2, split_point, basicstep, all_case_count, pos, current_pos, ind, ind_res, curr_logn, curr_n;
   for (int u = 0; u < slot_vec.size(); u++) {
-    curr_logn = slot_vec[u];
-    curr_n = (1 << curr_logn);
-    split_point = ceil(curr_logn / 2.0);
-    totlen1 = (1 << split_point) - 1;
-    totlen2 = (1 << (curr_logn - split_point)) - 1;
-
-    invfftcoeff1.resize(totlen1 + 1);
-    invfftcoeff2.resize(2 * totlen2 + 1);
-
-    for (int i = 0; i < totlen1 + 1; i++)
-      invfftcoeff1[u][i].resize(curr_n, 0);
-    for (int i = 0; i < 2 * totlen2 + 1; i++)
-      invfftcoeff2[u][i].resize(curr_n, 0);
-
-    tmpvec.clear();
-    tmpvec.resize(curr_n);
-
-    tmpcount.clear();
-    tmpcount.resize(split_point);
-    all_case_count = pow(3, split_point);
-    basicstep = (1 << (curr_logn - split_point));
-
-    for (int j = 0; j < all_case_count; j++) {
-      ind = j;
-      pos = 0;
-      for (int p = 0; p < split_point; p++) {
-        ind_res = ind % 3;
-        pos += (ind_res - 1) * (1 << (split_point - 1 - p));
-        tmpcount[p] = ind_res;
-        ind = (ind - ind_res) / 3;
-      }
-      current_pos = pos;
-      for (int k = 0; k < curr_n; k++) {
-        tmpvec[k] = 1.0;
-      }
-
-      for (int p = 0; p < split_point; p++) {
-        current_pos = current_pos - (tmpcount[p] - 1) * (1 << (split_point - 1 - p));
-        for (int k = 0; k < curr_n; k++) {
-          tmpvec[k] = tmpvec[k] * orig_invcoeffvec[u][p][tmpcount[p]][((k + basicstep * (curr_n + current_pos)) % curr_n)];
-        }
-      }
+    int curr_logn = slot_vec[u];
+    int curr_n = (1 << curr_logn);
+    int split_point = ceil(curr_logn / 2.0);
 
-      for (int k = 0; k < curr_n; k++) {
-        invfftcoeff1[u][(pos + totlen1 + 1) % (totlen1 + 1)][k] += tmpvec[k];
-      }
-    }
-    tmpcount.clear();
-    tmpcount.resize(logn - split_point);
-    all_case_count = pow(3, curr_logn - split_point);
-    for (int j = 0; j < all_case_count; j++) {
-      ind = j;
-      pos = 0;
-      for (int p = 0; p < curr_logn - split_point; p++) {
-        ind_res = ind % 3;
-        pos += (ind_res - 1) * (1 << (curr_logn - split_point - 1 - p));
-        tmpcount[p] = ind_res;
-        ind = (ind - ind_res) / 3;
-      }
-      current_pos = pos;
-      for (int k = 0; k < curr_n; k++) {
-        tmpvec[k] = 1.0;
-      }
-      for (int p = 0; p < curr_logn - split_point; p++) {
-        current_pos = current_pos - (tmpcount[p] - 1) * (1 << (curr_logn - split_point - 1 - p));
-        for (int k = 0; k < curr_n; k++) {
-          tmpvec[k] = tmpvec[k] * orig_invcoeffvec[u][p + split_point][tmpcount[p]][((k + current_pos + curr_n) % curr_n)];
-        }
-      }
+    vector<vector<complex<double>>> coeff1, coeff2;
+    merge_fft_levels(coeff1, u, 0, split_point, true, true, curr_n);
+    merge_fft_levels(coeff2, u, split_point, curr_logn - split_point, true, false, curr_n);
 
-      for (int k = 0; k < curr_n; k++) {
-        invfftcoeff2[u][pos + totlen2][k] += tmpvec[k];
-      }
-    }
-
-    for (int i = 0; i < totlen1 + 1; i++) {
+    for (auto &diag : coeff1) {
       for (int j = 0; j < curr_n; j++)
-        invfftcoeff1[u][i][j] *= 1.0 / boundary_K;
+        diag[j] *= 1.0 / boundary_K;
     }
-
-    for (int i = 0; i < 2 * totlen2 + 1; i++) {
+    for (auto &diag : coeff2) {
       for (int j = 0; j < curr_n; j++)
-        invfftcoeff2[u][i][j] *= 0.5;
+        diag[j] *= 0.5;
     }
+    invfftcoeff1[u] = DiagonalStore(coeff1);
+    invfftcoeff2[u] = DiagonalStore(coeff2);
   }
 }
 
-void Bootstrapper::genfftcoeff_3() {  // not yet
+void Bootstrapper::genfftcoeff_3() {
   fftcoeff1.resize(slot_vec.size());
   fftcoeff2.resize(slot_vec.size());
   fftcoeff3.resize(slot_vec.size());
-  vector<complex<double>> tmpvec;
-  vector<int> tmpcount;
-  int div_part1, div_part2, div_part3;
-  int totlen1, totlen2, totlen3;
-  int basicstep1, basicstep2, basicstep3;
-  int all_case_count, pos, current_pos, ind, ind_res;
-  int curr_logn, curr_n;
-
-  for (int u = 0; u < slot_vec.size(); u++) {
-    curr_logn = slot_vec[u];
-    curr_n = (1 << curr_logn);
-    if (curr_logn == logNh) {
-      div_part3 = floor(curr_logn / 3.0);
-      div_part2 = floor((curr_logn - div_part3) / 2.0);
-      div_part1 = curr_logn - div_part3 - div_part2;
-
-      totlen1 = (1 << div_part1) - 1;
-      totlen2 = (1 << div_part2) - 1;
-      totlen3 = (1 << div_part3) - 1;
-
-      basicstep1 = 1;
-      basicstep2 = (1 << div_part1);
-      basicstep3 = (1 << (div_part1 + div_part2));
-
-      fftcoeff1[u].resize(2 * totlen1 + 1);
-      fftcoeff2[u].resize(2 * totlen2 + 1);
-      fftcoeff3[u].resize(totlen3 + 1);
-
-      for (int i = 0; i < 2 * totlen1 + 1; i++)
-        fftcoeff1[u][i].resize(curr_n, 0);
-      for (int i = 0; i < 2 * totlen2 + 1; i++)
-        fftcoeff2[u][i].resize(curr_n, 0);
-      for (int i = 0; i < totlen3 + 1; i++)
-        fftcoeff3[u][i].resize(curr_n, 0);
-
-      tmpvec.clear();
-      tmpvec.resize(curr_n);
-
-      tmpcount.clear();
-      tmpcount.resize(div_part1);
-      all_case_count = pow(3, div_part1);
-
-      for (int j = 0; j < all_case_count; j++) {
-        ind = j;
-        pos = 0;
-        for (int p = 0; p < div_part1; p++) {
-          ind_res = ind % 3;
-          pos += (ind_res - 1) * (1 << p);
-          tmpcount[p] = ind_res;
-          ind = (ind - ind_res) / 3;
-        }
-
-        current_pos = pos;
-        for (int k = 0; k < curr_n; k++) {
-          tmpvec[k] = 1.0;
-        }
-
-        for (int p = 0; p < div_part1; p++) {
-          current_pos = current_pos - (tmpcount[p] - 1) * (1 << p);
-          for (int k = 0; k < curr_n; k++) {
-            tmpvec[k] = tmpvec[k] * orig_coeffvec[u][p][tmpcount[p]][((k + basicstep1 * (curr_n + current_pos)) % curr_n)];
-          }
-        }
-
-        for (int k = 0; k < curr_n; k++) {
-          fftcoeff1[u][pos + totlen1][k] += tmpvec[k];
-        }
-      }
-
-      tmpcount.clear();
-      tmpcount.resize(div_part2);
-      all_case_count = pow(3, div_part2);
-
-      for (int j = 0; j < all_case_count; j++) {
-        ind = j;
-        pos = 0;
-        for (int p = 0; p < div_part2; p++) {
-          ind_res = ind % 3;
-          pos += (ind_res - 1) * (1 << p);
-          tmpcount[p] = ind_res;
-          ind = (ind - ind_res) / 3;
-        }
-
-        current_pos = pos;
-        for (int k = 0; k < curr_n; k++) {
-          tmpvec[k] = 1.0;
-        }
-
-        for (int p = 0; p < div_part2; p++) {
-          current_pos = current_pos - (tmpcount[p] - 1) * (1 << p);
-          for (int k = 0; k < curr_n; k++) {
-            tmpvec[k] = tmpvec[k] * orig_coeffvec[u][p + div_part1][tmpcount[p]][((k + basicstep2 * (curr_n + current_pos)) % curr_n)];
-          }
-        }
-
-        for (int k = 0; k < curr_n; k++) {
-          fftcoeff2[u][pos + totlen2][k] += tmpvec[k];
-        }
-      }
-
-      tmpcount.clear();
-      tmpcount.resize(div_part3);
-      all_case_count = pow(3, div_part3);
-
-      for (int j = 0; j < all_case_count; j++) {
-        ind = j;
-        pos = 0;
-        for (int p = 0; p < div_part3; p++) {
-          ind_res = ind % 3;
-          pos += (ind_res - 1) * (1 << p);
-          tmpcount[p] = ind_res;
-          ind = (ind - ind_res) / 3;
-        }
-
-        current_pos = pos;
-        for (int k = 0; k < curr_n; k++) {
-          tmpvec[k] = 1.0;
-        }
-
-        for (int p = 0; p < div_part3; p++) {
-          current_pos = current_pos - (tmpcount[p] - 1) * (1 << p);
-          for (int k = 0; k < curr_n; k++) {
-            tmpvec[k] = tmpvec[k] * orig_coeffvec[u][p + div_part1 + div_part2][tmpcount[p]][((k + basicstep3 * (curr_n + current_pos)) % curr_n)];
-          }
-        }
-
-        for (int k = 0; k < curr_n; k++) {
-          fftcoeff3[u][(pos + totlen3 + 1) % (totlen3 + 1)][k] += tmpvec[k];
-        }
-      }
-
-    }
-
-    else {
-      div_part3 = floor(curr_logn / 3.0);
-      div_part2 = floor((curr_logn - div_part3) / 2.0);
-      div_part1 = curr_logn - div_part3 - div_part2;
-
-      totlen1 = (1 << div_part1) - 1;
-      totlen2 = (1 << div_part2) - 1;
-      totlen3 = (1 << div_part3) - 1;
-
-      basicstep1 = 1;
-      basicstep2 = (1 << div_part1);
-      basicstep3 = (1 << (div_part1 + div_part2));
-
-      fftcoeff1[u].resize(2 * totlen1 + 1);
-      fftcoeff2[u].resize(2 * totlen2 + 1);
-      fftcoeff3[u].resize(2 * totlen3 + 1);
-
-      for (int i = 0; i < 2 * totlen1 + 1; i++)
-        fftcoeff1[u][i].resize(2 * curr_n, 0);
-      for (int i = 0; i < 2 * totlen2 + 1; i++)
-        fftcoeff2[u][i].resize(2 * curr_n, 0);
-      for (int i = 0; i < 2 * totlen3 + 1; i++)
-        fftcoeff3[u][i].resize(2 * curr_n, 0);
-
-      tmpvec.clear();
-      tmpvec.resize(curr_n);
-
-      tmpcount.clear();
-      tmpcount.resize(div_part1);
-      all_case_count = pow(3, div_part1);
-
-      for (int j = 0; j < all_case_count; j++) {
-        ind = j;
-        pos = 0;
-        for (int p = 0; p < div_part1; p++) {
-          ind_res = ind % 3;
-          pos += (ind_res - 1) * (1 << p);
-          tmpcount[p] = ind_res;
-          ind = (ind - ind_res) / 3;
-        }
-
-        current_pos = pos;
-        for (int k = 0; k < curr_n; k++) {
-          tmpvec[k] = 1.0;
-        }
-
-        for (int p = 0; p < div_part1; p++) {
-          current_pos = current_pos - (tmpcount[p] - 1) * (1 << p);
-          for (int k = 0; k < curr_n; k++) {
-            tmpvec[k] = tmpvec[k] * orig_coeffvec[u][p][tmpcount[p]][((k + basicstep1 * (curr_n + current_pos)) % curr_n)];
-          }
-        }
-
-        for (int k = 0; k < curr_n; k++) {
-          fftcoeff1[u][pos + totlen1][k] += tmpvec[k];
-        }
-      }
-
-      for (int i = 0; i < 2 * totlen1 + 1; i++) {
-        for (int j = 0; j < curr_n; j++)
-          fftcoeff1[u][i][j + curr_n] = fftcoeff1[u][i][j];
-      }
-
-      tmpcount.clear();
-      tmpcount.resize(div_part2);
-      all_case_count = pow(3, div_part2);
-
-      for (int j = 0; j < all_case_count; j++) {
-        ind = j;
-        pos = 0;
-        for (int p = 0; p < div_part2; p++) {
-          ind_res = ind % 3;
-          pos += (ind_res - 1) * (1 << p);
-          tmpcount[p] = ind_res;
-          ind = (ind - ind_res) / 3;
-        }
-
-        current_pos = pos;
-        for (int k = 0; k < curr_n; k++) {
-          tmpvec[k] = 1.0;
-        }
-
-        for (int p = 0; p < div_part2; p++) {
-          current_pos = current_pos - (tmpcount[p] - 1) * (1 << p);
-          for (int k = 0; k < curr_n; k++) {
-            tmpvec[k] = tmpvec[k] * orig_coeffvec[u][p + div_part1][tmpcount[p]][((k + basicstep2 * (curr_n + current_pos)) % curr_n)];
-          }
-        }
-
-        for (int k = 0; k < curr_n; k++) {
-          fftcoeff2[u][pos + totlen2][k] += tmpvec[k];
-        }
-      }
-
-      for (int i = 0; i < 2 * totlen2 + 1; i++) {
-        for (int j = 0; j < curr_n; j++)
-          fftcoeff2[u][i][j + curr_n] = fftcoeff2[u][i][j];
-      }
-
-      tmpcount.clear();
-      tmpcount.resize(div_part3);
-      all_case_count = pow(3, div_part3);
-
-      for (int j = 0; j < all_case_count; j++) {
-        ind = j;
-        pos = 0;
-        for (int p = 0; p < div_part3; p++) {
-          ind_res = ind % 3;
-          pos += (ind_res - 1) * (1 << p);
-          tmpcount[p] = ind_res;
-          ind = (ind - ind_res) / 3;
-        }
+  for (size_t u = 0; u < slot_vec.size(); u++)
+    genfftcoeff_3(u);
+}
 
-        current_pos = pos;
-        for (int k = 0; k < curr_n; k++) {
-          tmpvec[k] = 1.0;
-        }
+void Bootstrapper::genfftcoeff_3(int u) {
+  vector<vector<complex<double>>> coeff1, coeff2, coeff3;
+  int curr_logn = slot_vec[u];
+  int curr_n = (1 << curr_logn);
+  int div_part3 = floor(curr_logn / 3.0);
+  int div_part2 = floor((curr_logn - div_part3) / 2.0);
+  int div_part1 = curr_logn - div_part3 - div_part2;
 
-        for (int p = 0; p < div_part3; p++) {
-          current_pos = current_pos - (tmpcount[p] - 1) * (1 << p);
-          for (int k = 0; k < curr_n; k++) {
-            tmpvec[k] = tmpvec[k] * orig_coeffvec[u][p + div_part1 + div_part2][tmpcount[p]][((k + basicstep3 * (curr_n + current_pos)) % curr_n)];
-          }
-        }
+  if (curr_logn == logNh) {
+    merge_fft_levels(coeff1, u, 0, div_part1, false, false, curr_n);
+    merge_fft_levels(coeff2, u, div_part1, div_part2, false, false, curr_n);
+    merge_fft_levels(coeff3, u, div_part1 + div_part2, div_part3, false, true, curr_n);
+  }
 
-        for (int k = 0; k < curr_n; k++) {
-          fftcoeff3[u][pos + totlen3][k] += tmpvec[k];
-        }
-      }
+  else {
+    merge_fft_levels(coeff1, u, 0, div_part1, false, false, 2 * curr_n);
+    merge_fft_levels(coeff2, u, div_part1, div_part2, false, false, 2 * curr_n);
+    merge_fft_levels(coeff3, u, div_part1 + div_part2, div_part3, false, false, 2 * curr_n);
 
-      for (int i = 0; i < 2 * totlen3 + 1; i++) {
+    for (auto *coeff : {&coeff1, &coeff2}) {
+      for (auto &diag : *coeff) {
         for (int j = 0; j < curr_n; j++)
-          fftcoeff3[u][i][j + curr_n] = complex<double>(0, 1) * fftcoeff3[u][i][j];
+          diag[j + curr_n] = diag[j];
       }
     }
+    for (auto &diag : coeff3) {
+      for (int j = 0; j < curr_n; j++)
+        diag[j + curr_n] = complex<double>(0, 1) * diag[j];
+    }
   }
+  fftcoeff1[u] = DiagonalStore(coeff1);
+  fftcoeff2[u] = DiagonalStore(coeff2);
+  fftcoeff3[u] = DiagonalStore(coeff3);
 }
 
-// void Bootstrapper::genfftcoeff_full_3() {
-// fftcoeff1.resize(slot_vec.size());
-// fftcoeff2.resize(slot_vec.size());
-// fftcoeff3.resize(slot_vec.size());
-// vector<complex<double>> tmpvec;
-// vector<int> tmpcount;
-// int div_part1, div_part2, div_part3;
-// int totlen1, totlen2, totlen3;
-// int basicstep1, basicstep2, basicstep3;
-// int all_case_count, pos, current_pos, ind, ind_res;
-// int curr_logn, curr_n;
-
-// for(int u = 0; u < slot_vec.size(); u++) {
-// curr_logn = slot_vec[u];
-// curr_n = (1 << curr_logn);
-// div_part3 = floor(curr_logn / 3.0);
-// div_part2 = floor((curr_logn - div_part3) / 2.0);
-// div_part1 = curr_logn - div_part3 - div_part2;
-
-// totlen1 = (1 << div_part1) - 1;
-// totlen2 = (1 << div_part2) - 1;
-// totlen3 = (1 << div_part3) - 1;
-
-// basicstep1 = 1;
-// basicstep2 = (1 << div_part1);
-// basicstep3 = (1 << (div_part1 + div_part2));
-
-// fftcoeff1[u].resize(2*totlen1 + 1);
-// fftcoeff2[u].resize(2*totlen2 + 1);
-// fftcoeff3[u].resize(totlen3 + 1);
-
-// for(int i = 0; i < 2*totlen1 + 1; i++) fftcoeff1[u][i].resize(curr_n, 0);
-// for(int i = 0; i < 2*totlen2 + 1; i++) fftcoeff2[u][i].resize(curr_n, 0);
-// for(int i = 0; i < totlen3 + 1; i++) fftcoeff3[u][i].resize(curr_n, 0);
-
-// tmpvec.clear();
-// tmpvec.resize(curr_n);
-
-// tmpcount.clear();
-// tmpcount.resize(div_part1);
-// all_case_count = pow(3, div_part1);
-
-// for(int j = 0; j < all_case_count; j++) {
-// ind = j;
-// pos = 0;
-// for(int p = 0; p < div_part1; p++) {
-// ind_res = ind % 3;
-// pos += (ind_res - 1) * (1 << p);
-// tmpcount[p] = ind_res;
-// ind = (ind - ind_res) / 3;
-//}
-
-// current_pos = pos;
-// for(int k = 0; k < curr_n; k++) {
-// tmpvec[k] = 1.0;
-//}
-
-// for(int p = 0; p < div_part1; p++) {
-// current_pos = current_pos - (tmpcount[p] - 1) * (1 << p);
-// for(int k = 0; k < curr_n; k++) {
-// tmpvec[k] = tmpvec[k] * orig_coeffvec[u][p][tmpcount[p]][((k + basicstep1 * (curr_n + current_pos)) % curr_n)];
-//}
-//}
-
-// for(int k = 0; k < curr_n; k++) {
-// fftcoeff1[u][pos + totlen1][k] += tmpvec[k];
-//}
-//}
-
-// tmpcount.clear();
-// tmpcount.resize(div_part2);
-// all_case_count = pow(3, div_part2);
-
-// for(int j = 0; j < all_case_count; j++) {
-// ind = j;
-// pos = 0;
-// for(int p = 0; p < div_part2; p++) {
-// ind_res = ind % 3;
-// pos += (ind_res - 1) * (1 << p);
-// tmpcount[p] = ind_res;
-// ind = (ind - ind_res) / 3;
-//}
-
-// current_pos = pos;
-// for(int k = 0; k < curr_n; k++) {
-// tmpvec[k] = 1.0;
-//}
-
-// for(int p = 0; p < div_part2; p++) {
-// current_pos = current_pos - (tmpcount[p] - 1) * (1 << p);
-// for(int k = 0; k < curr_n; k++) {
-// tmpvec[k] = tmpvec[k] * orig_coeffvec[u][p + div_part1][tmpcount[p]][((k + basicstep2 * (curr_n + current_pos)) % curr_n)];
-//}
-//}
-
-// for(int k = 0; k < curr_n; k++) {
-// fftcoeff2[u][pos + totlen2][k] += tmpvec[k];
-//}
-//}
-
-// tmpcount.clear();
-// tmpcount.resize(div_part3);
-// all_case_count = pow(3, div_part3);
-
-// for(int j = 0; j < all_case_count; j++) {
-// ind = j;
-// pos = 0;
-// for(int p = 0; p < div_part3; p++) {
-// ind_res = ind % 3;
-// pos += (ind_res - 1) * (1 << p);
-// tmpcount[p] = ind_res;
-// ind = (ind - ind_res) / 3;
-//}
-
-// current_pos = pos;
-// for(int k = 0; k < curr_n; k++) {
-// tmpvec[k] = 1.0;
-//}
-
-// for(int p = 0; p < div_part3; p++) {
-// current_pos = current_pos - (tmpcount[p] - 1) * (1 << p);
-// for(int k = 0; k < curr_n; k++) {
-// tmpvec[k] = tmpvec[k] * orig_coeffvec[u][p + div_part1 + div_part2][tmpcount[p]][((k + basicstep3 * (curr_n + current_pos)) % curr_n)];
-//}
-//}
-
-// for(int k = 0; k < curr_n; k++) {
-// fftcoeff3[u][(pos + totlen3 + 1) % (totlen3 + 1)][k] += tmpvec[k];
-//}
-//}
-//}
-//}
-
-void Bootstrapper::geninvfftcoeff_3() {  // not yet
+void Bootstrapper::geninvfftcoeff_3() {
   invfftcoeff1.resize(slot_vec.size());
   invfftcoeff2.resize(slot_vec.size());
   invfftcoeff3.resize(slot_vec.size());
-  vector<complex<double>> tmpvec;
-  vector<int> tmpcount;
-  int div_part1, div_part2, div_part3;
-  int totlen1, totlen2, totlen3;
-  int basicstep1, basicstep2, basicstep3;
-  int all_case_count, pos, current_pos, ind, ind_res;
-  int curr_logn, curr_n;
-
-  for (int u = 0; u < slot_vec.size(); u++) {
-    curr_logn = slot_vec[u];
-    curr_n = (1 << curr_logn);
-    if (curr_logn == logNh) {
-      div_part1 = floor(curr_logn / 3.0);
-      div_part2 = floor((curr_logn - div_part1) / 2.0);
-      div_part3 = curr_logn - div_part1 - div_part2;
-
-      totlen1 = (1 << div_part1) - 1;
-      totlen2 = (1 << div_part2) - 1;
-      totlen3 = (1 << div_part3) - 1;
-
-      basicstep1 = (1 << (curr_logn - div_part1));
-      basicstep2 = (1 << (curr_logn - div_part1 - div_part2));
-      basicstep3 = 1;
-
-      invfftcoeff1[u].resize(totlen1 + 1);
-      invfftcoeff2[u].resize(2 * totlen2 + 1);
-      invfftcoeff3[u].resize(2 * totlen3 + 1);
-
-      for (int i = 0; i < totlen1 + 1; i++)
-        invfftcoeff1[u][i].resize(curr_n, 0);
-      for (int i = 0; i < 2 * totlen2 + 1; i++)
-        invfftcoeff2[u][i].resize(curr_n, 0);
-      for (int i = 0; i < 2 * totlen3 + 1; i++)
-        invfftcoeff3[u][i].resize(curr_n, 0);
-
-      tmpvec.clear();
-      tmpvec.resize(curr_n);
-
-      tmpcount.clear();
-      tmpcount.resize(div_part1);
-      all_case_count = pow(3, div_part1);
-
-      for (int j = 0; j < all_case_count; j++) {
-        ind = j;
-        pos = 0;
-        for (int p = 0; p < div_part1; p++) {
-          ind_res = ind % 3;
-          pos += (ind_res - 1) * (1 << (div_part1 - 1 - p));
-          tmpcount[p] = ind_res;
-          ind = (ind - ind_res) / 3;
-        }
-        current_pos = pos;
-        for (int k = 0; k < curr_n; k++) {
-          tmpvec[k] = 1.0;
-        }
-
-        for (int p = 0; p < div_part1; p++) {
-          current_pos = current_pos - (tmpcount[p] - 1) * (1 << (div_part1 - 1 - p));
-          for (int k = 0; k < curr_n; k++) {
-            tmpvec[k] = tmpvec[k] * orig_invcoeffvec[u][p][tmpcount[p]][((k + basicstep1 * (curr_n + current_pos)) % curr_n)];
-          }
-        }
-
-        for (int k = 0; k < curr_n; k++) {
-          invfftcoeff1[u][(pos + totlen1 + 1) % (totlen1 + 1)][k] += tmpvec[k];
-        }
-      }
-
-      tmpcount.clear();
-      tmpcount.resize(div_part2);
-      all_case_count = pow(3, div_part2);
-      for (int j = 0; j < all_case_count; j++) {
-        ind = j;
-        pos = 0;
-        for (int p = 0; p < div_part2; p++) {
-          ind_res = ind % 3;
-          pos += (ind_res - 1) * (1 << (div_part2 - 1 - p));
-          tmpcount[p] = ind_res;
-          ind = (ind - ind_res) / 3;
-        }
-        current_pos = pos;
-        for (int k = 0; k < curr_n; k++) {
-          tmpvec[k] = 1.0;
-        }
-        for (int p = 0; p < div_part2; p++) {
-          current_pos = current_pos - (tmpcount[p] - 1) * (1 << (div_part2 - 1 - p));
-          for (int k = 0; k < curr_n; k++) {
-            tmpvec[k] = tmpvec[k] * orig_invcoeffvec[u][p + div_part1][tmpcount[p]][((k + basicstep2 * (curr_n + current_pos)) % curr_n)];
-          }
-        }
-
-        for (int k = 0; k < curr_n; k++) {
-          invfftcoeff2[u][pos + totlen2][k] += tmpvec[k];
-        }
-      }
-
-      tmpcount.clear();
-      tmpcount.resize(div_part3);
-      all_case_count = pow(3, div_part3);
-      for (int j = 0; j < all_case_count; j++) {
-        ind = j;
-        pos = 0;
-        for (int p = 0; p < div_part3; p++) {
-          ind_res = ind % 3;
-          pos += (ind_res - 1) * (1 << (div_part3 - 1 - p));
-          tmpcount[p] = ind_res;
-          ind = (ind - ind_res) / 3;
-        }
-        current_pos = pos;
-        for (int k = 0; k < curr_n; k++) {
-          tmpvec[k] = 1.0;
-        }
-        for (int p = 0; p < div_part3; p++) {
-          current_pos = current_pos - (tmpcount[p] - 1) * (1 << (div_part3 - 1 - p));
-          for (int k = 0; k < curr_n; k++) {
-            tmpvec[k] =
-                tmpvec[k] * orig_invcoeffvec[u][p + div_part1 + div_part2][tmpcount[p]][((k + basicstep3 * (curr_n + current_pos)) % curr_n)];
-          }
-        }
-
-        for (int k = 0; k < curr_n; k++) {
-          invfftcoeff3[u][pos + totlen3][k] += tmpvec[k];
-        }
-      }
-
-      for (int i = 0; i < totlen1 + 1; i++) {
-        for (int j = 0; j < curr_n; j++)
-          invfftcoeff1[u][i][j] *= 1.0 / boundary_K;
-      }
-
-      for (int i = 0; i < 2 * totlen3 + 1; i++) {
-        for (int j = 0; j < curr_n; j++)
-          invfftcoeff3[u][i][j] *= 0.5;
-      }
-
-    }
-
-    else {
-      div_part1 = floor(curr_logn / 3.0);
-      div_part2 = floor((curr_logn - div_part1) / 2.0);
-      div_part3 = curr_logn - div_part1 - div_part2;
-
-      totlen1 = (1 << div_part1) - 1;
-      totlen2 = (1 << div_part2) - 1;
-      totlen3 = (1 << div_part3) - 1;
-
-      basicstep1 = (1 << (curr_logn - div_part1));
-      basicstep2 = (1 << (curr_logn - div_part1 - div_part2));
-      basicstep3 = 1;
-
-      invfftcoeff1[u].resize(totlen1 + 1);
-      invfftcoeff2[u].resize(2 * totlen2 + 1);
-      invfftcoeff3[u].resize(2 * totlen3 + 1);
-
-      for (int i = 0; i < totlen1 + 1; i++)
-        invfftcoeff1[u][i].resize(curr_n, 0);
-      for (int i = 0; i < 2 * totlen2 + 1; i++)
-        invfftcoeff2[u][i].resize(curr_n, 0);
-      for (int i = 0; i < 2 * totlen3 + 1; i++)
-        invfftcoeff3[u][i].resize(2 * curr_n, 0);
-
-      tmpvec.clear();
-      tmpvec.resize(curr_n);
-
-      tmpcount.clear();
-      tmpcount.resize(div_part1);
-      all_case_count = pow(3, div_part1);
-
-      for (int j = 0; j < all_case_count; j++) {
-        ind = j;
-        pos = 0;
-        for (int p = 0; p < div_part1; p++) {
-          ind_res = ind % 3;
-          pos += (ind_res - 1) * (1 << (div_part1 - 1 - p));
-          tmpcount[p] = ind_res;
-          ind = (ind - ind_res) / 3;
-        }
-        current_pos = pos;
-        for (int k = 0; k < curr_n; k++) {
-          tmpvec[k] = 1.0;
-        }
-
-        for (int p = 0; p < div_part1; p++) {
-          current_pos = current_pos - (tmpcount[p] - 1) * (1 << (div_part1 - 1 - p));
-          for (int k = 0; k < curr_n; k++) {
-            tmpvec[k] = tmpvec[k] * orig_invcoeffvec[u][p][tmpcount[p]][((k + basicstep1 * (curr_n + current_pos)) % curr_n)];
-          }
-        }
-
-        for (int k = 0; k < curr_n; k++) {
-          invfftcoeff1[u][(pos + totlen1 + 1) % (totlen1 + 1)][k] += tmpvec[k];
-        }
-      }
+  for (size_t u = 0; u < slot_vec.size(); u++)
+    geninvfftcoeff_3(u);
+}
 
-      tmpcount.clear();
-      tmpcount.resize(div_part2);
-      all_case_count = pow(3, div_part2);
-      for (int j = 0; j < all_case_count; j++) {
-        ind = j;
-        pos = 0;
-        for (int p = 0; p < div_part2; p++) {
-          ind_res = ind % 3;
-          pos += (ind_res - 1) * (1 << (div_part2 - 1 - p));
-          tmpcount[p] = ind_res;
-          ind = (ind - ind_res) / 3;
-        }
-        current_pos = pos;
-        for (int k = 0; k < curr_n; k++) {
-          tmpvec[k] = 1.0;
-        }
-        for (int p = 0; p < div_part2; p++) {
-          current_pos = current_pos - (tmpcount[p] - 1) * (1 << (div_part2 - 1 - p));
-          for (int k = 0; k < curr_n; k++) {
-            tmpvec[k] = tmpvec[k] * orig_invcoeffvec[u][p + div_part1][tmpcount[p]][((k + basicstep2 * (curr_n + current_pos)) % curr_n)];
-          }
-        }
+void Bootstrapper::geninvfftcoeff_3(int u) {
+  int curr_logn = slot_vec[u];
+  int curr_n = (1 << curr_logn);
+  int div_part1 = floor(curr_logn / 3.0);
+  int div_part2 = floor((curr_logn - div_part1) / 2.0);
+  int div_part3 = curr_logn - div_part1 - div_part2;
+  bool full = (curr_logn == logNh);
 
-        for (int k = 0; k < curr_n; k++) {
-          invfftcoeff2[u][pos + totlen2][k] += tmpvec[k];
-        }
-      }
+  vector<vector<complex<double>>> coeff1, coeff2, coeff3;
+  merge_fft_levels(coeff1, u, 0, div_part1, true, true, curr_n);
+  merge_fft_levels(coeff2, u, div_part1, div_part2, true, false, curr_n);
+  merge_fft_levels(coeff3, u, div_part1 + div_part2, div_part3, true, false, full ? curr_n : 2 * curr_n);
 
-      tmpcount.clear();
-      tmpcount.resize(div_part3);
-      all_case_count = pow(3, div_part3);
-      for (int j = 0; j < all_case_count; j++) {
-        ind = j;
-        pos = 0;
-        for (int p = 0; p < div_part3; p++) {
-          ind_res = ind % 3;
-          pos += (ind_res - 1) * (1 << (div_part3 - 1 - p));
-          tmpcount[p] = ind_res;
-          ind = (ind - ind_res) / 3;
-        }
-        current_pos = pos;
-        for (int k = 0; k < curr_n; k++) {
-          tmpvec[k] = 1.0;
-        }
-        for (int p = 0; p < div_part3; p++) {
-          current_pos = current_pos - (tmpcount[p] - 1) * (1 << (div_part3 - 1 - p));
-          for (int k = 0; k < curr_n; k++) {
-            tmpvec[k] =
-                tmpvec[k] * orig_invcoeffvec[u][p + div_part1 + div_part2][tmpcount[p]][((k + basicstep3 * (curr_n + current_pos)) % curr_n)];
-          }
-        }
-
-        for (int k = 0; k < curr_n; k++) {
-          invfftcoeff3[u][pos + totlen3][k] += tmpvec[k];
-        }
-      }
-
-      for (int i = 0; i < totlen1 + 1; i++) {
-        for (int j = 0; j < curr_n; j++)
-          invfftcoeff1[u][i][j] *= 1.0 / (boundary_K * (1 << (logNh - curr_logn)));
-      }
-
-      for (int i = 0; i < 2 * totlen3 + 1; i++) {
-        for (int j = 0; j < curr_n; j++) {
-          invfftcoeff3[u][i][j] *= 0.5;
-          invfftcoeff3[u][i][j + curr_n] = complex<double>(0, -1) * invfftcoeff3[u][i][j];
-        }
-      }
+  for (auto &diag : coeff1) {
+    for (int j = 0; j < curr_n; j++)
+      diag[j] *= full ? 1.0 / boundary_K : 1.0 / (boundary_K * (1 << (logNh - curr_logn)));
+  }
+  for (auto &diag : coeff3) {
+    for (int j = 0; j < curr_n; j++) {
+      diag[j] *= 0.5;
+      if (!full)
+        diag[j + curr_n] = complex<double>(0, -1) * diag[j];
     }
   }
+  invfftcoeff1[u] = DiagonalStore(coeff1);
+  invfftcoeff2[u] = DiagonalStore(coeff2);
+  invfftcoeff3[u] = DiagonalStore(coeff3);
 }
 
-// void Bootstrapper::geninvfftcoeff_full_3() {
-// invfftcoeff1.resize(slot_vec.size());
-// invfftcoeff2.resize(slot_vec.size());
-// invfftcoeff3.resize(slot_vec.size());
-// vector<complex<double>> tmpvec;
-// vector<int> tmpcount;
-// int div_part1, div_part2, div_part3;
-// int totlen1, totlen2, totlen3;
-// int basicstep1, basicstep2, basicstep3;
-// int all_case_count, pos, current_pos, ind, ind_res;
-// int curr_logn, curr_n;
-
-// for(int u = 0; u < slot_vec.size(); u++) {
-// curr_logn = slot_vec[u];
-// curr_n = (1 << curr_logn);
-// div_part1 = floor(curr_logn / 3.0);
-// div_part2 = floor((curr_logn - div_part1) / 2.0);
-// div_part3 = curr_logn - div_part1 - div_part2;
-
-// totlen1 = (1 << div_part1) - 1;
-// totlen2 = (1 << div_part2) - 1;
-// totlen3 = (1 << div_part3) - 1;
-
-// basicstep1 = (1 << (curr_logn - div_part1));
-// basicstep2 = (1 << (curr_logn - div_part1 - div_part2));
-// basicstep3 = 1;
-
-// invfftcoeff1[u].resize(totlen1 + 1);
-// invfftcoeff2[u].resize(2*totlen2 + 1);
-// invfftcoeff3[u].resize(2*totlen3 + 1);
-
-// for(int i = 0; i < totlen1 + 1; i++) invfftcoeff1[u][i].resize(curr_n, 0);
-// for(int i = 0; i < 2*totlen2 + 1; i++) invfftcoeff2[u][i].resize(curr_n, 0);
-// for(int i = 0; i < 2*totlen3 + 1; i++) invfftcoeff3[u][i].resize(curr_n, 0);
-
-// tmpvec.clear();
-// tmpvec.resize(curr_n);
-
-// tmpcount.clear();
-// tmpcount.resize(div_part1);
-// all_case_count = pow(3, div_part1);
-
-// for(int j = 0; j < all_case_count; j++) {
-// ind = j;
-// pos = 0;
-// for(int p = 0; p < div_part1; p++) {
-// ind_res = ind % 3;
-// pos += (ind_res - 1) * (1 << (div_part1 - 1 - p));
-// tmpcount[p] = ind_res;
-// ind = (ind - ind_res) / 3;
-//}
-// current_pos = pos;
-// for(int k = 0; k < curr_n; k++) {
-// tmpvec[k] = 1.0;
-//}
-
-// for(int p = 0; p < div_part1; p++) {
-// current_pos = current_pos - (tmpcount[p] - 1) * (1 << (div_part1 - 1 - p));
-// for(int k = 0; k < curr_n; k++) {
-// tmpvec[k] = tmpvec[k] * orig_invcoeffvec[u][p][tmpcount[p]][((k + basicstep1 * (curr_n + current_pos)) % curr_n)];
-//}
-//}
-
-// for(int k = 0; k < curr_n; k++) {
-// invfftcoeff1[u][(pos + totlen1 + 1) % (totlen1 + 1)][k] += tmpvec[k];
-//}
-//}
-
-// tmpcount.clear();
-// tmpcount.resize(div_part2);
-// all_case_count = pow(3, div_part2);
-// for(int j = 0; j < all_case_count; j++) {
-// ind = j;
-// pos = 0;
-// for(int p = 0; p < div_part2; p++) {
-// ind_res = ind % 3;
-// pos += (ind_res - 1) * (1 << (div_part2 - 1 - p));
-// tmpcount[p] = ind_res;
-// ind = (ind - ind_res) / 3;
-//}
-// current_pos = pos;
-// for(int k = 0; k < curr_n; k++) {
-// tmpvec[k] = 1.0;
-//}
-// for(int p = 0; p < div_part2; p++) {
-// current_pos = current_pos - (tmpcount[p] - 1) * (1 << (div_part2 - 1 - p));
-// for(int k = 0; k < curr_n; k++) {
-// tmpvec[k] = tmpvec[k] * orig_invcoeffvec[u][p + div_part1][tmpcount[p]][((k + basicstep2 * (curr_n + current_pos)) % curr_n)];
-//}
-//}
-
-// for(int k = 0; k < curr_n; k++) {
-// invfftcoeff2[u][pos + totlen2][k] += tmpvec[k];
-//}
-//}
-
-// tmpcount.clear();
-// tmpcount.resize(div_part3);
-// all_case_count = pow(3, div_part3);
-// for(int j = 0; j < all_case_count; j++) {
-// ind = j;
-// pos = 0;
-// for(int p = 0; p < div_part3; p++) {
-// ind_res = ind % 3;
-// pos += (ind_res - 1) * (1 << (div_part3 - 1 - p));
-// tmpcount[p] = ind_res;
-// ind = (ind - ind_res) / 3;
-//}
-// current_pos = pos;
-// for(int k = 0; k < curr_n; k++) {
-// tmpvec[k] = 1.0;
-//}
-// for(int p = 0; p < div_part3; p++) {
-// current_pos = current_pos - (tmpcount[p] - 1) * (1 << (div_part3 - 1 - p));
-// for(int k = 0; k < curr_n; k++) {
-// tmpvec[k] = tmpvec[k] * orig_invcoeffvec[u][p + div_part1 + div_part2][tmpcount[p]][((k + basicstep3 * (curr_n + current_pos)) % curr_n)];
-//}
-//}
-
-// for(int k = 0; k < curr_n; k++) {
-// invfftcoeff3[u][pos + totlen3][k] += tmpvec[k];
-//}
-//}
-
-// for (int i = 0; i < totlen1 + 1; i++) {
-// for (int j = 0; j < curr_n; j++) invfftcoeff1[u][i][j] *= 1.0 / boundary_K;
-//}
-
-// for (int i = 0; i < 2*totlen3 + 1; i++) {
-// for (int j = 0; j < curr_n; j++) invfftcoeff3[u][i][j] *= 0.5;
-//}
-//}
-//}
-
 void Bootstrapper::generate_LT_coefficient() {
   genorigcoeff();
   if (logn == logNh) {
@@ -1962,12 +1059,172 @@ void Bootstrapper::generate_LT_coefficient() {
     genfftcoeff();
     geninvfftcoeff();
   }
+  release_origcoeff();
 }
 
 void Bootstrapper::generate_LT_coefficient_3() {
   genorigcoeff();
   genfftcoeff_3();
   geninvfftcoeff_3();
+  release_origcoeff();
+}
+
+// Rotations and plaintext products of one BSGS transform, laid out as
+// bsgs_linear_transform and rotated_bsgs_linear_transform run it, weighted by
+// rotation_cost
+double Bootstrapper::bsgs_cost(int totlen, bool rotated) {
+  int count, gs, giants;
+  if (rotated) {
+    count = totlen + 1;
+    gs = giantstep(count);
+    giants = floor((totlen + 0.0) / (gs + 0.0)) + 1;
+  } else {
+    count = 2 * totlen + 1;
+    gs = giantstep(count);
+    giants = floor((2 * totlen + 0.0) / (gs + 0.0)) + 1;
+  }
+  return rotation_cost * ((gs - 1) + (giants - 1)) + count;
+}
+
+// Splits the curr_logn butterfly levels into at most levels consecutive
+// transforms of least total bsgs_cost. CoeffToSlot (inverse) runs the levels of
+// orig_invcoeffvec, whose first transform always wraps around the n slots;
+// SlotToCoeff runs those of orig_coeffvec, whose last one wraps in full-slot mode.
+vector<LTStage> Bootstrapper::plan_linear_transform(long curr_logn, long levels, bool inverse) {
+  if (levels < 1)
+    throw invalid_argument("Linear transforms need one level at least!");
+  levels = min(levels, curr_logn);
+  bool full = (curr_logn == logNh);
+  auto is_rotated = [&](int first, int depth) { return inverse ? first == 0 : full && first + depth == curr_logn; };
+
+  // cost[i][l]: merging the levels from i on into at most l transforms
+  vector<vector<double>> cost(curr_logn + 1, vector<double>(levels + 1, INFINITY));
+  vector<vector<int>> cut(curr_logn + 1, vector<int>(levels + 1, 0));
+  for (long l = 0; l <= levels; l++)
+    cost[curr_logn][l] = 0;
+  for (int i = curr_logn - 1; i >= 0; i--) {
+    for (long l = 1; l <= levels; l++) {
+      for (int d = 1; i + d <= curr_logn; d++) {
+        double c = bsgs_cost((1 << d) - 1, is_rotated(i, d)) + cost[i + d][l - 1];
+        if (c < cost[i][l]) {
+          cost[i][l] = c;
+          cut[i][l] = d;
+        }
+      }
+    }
+  }
+
+  vector<LTStage> stages;
+  long l = levels;
+  for (int i = 0; i < curr_logn; l--) {
+    LTStage stage;
+    stage.first = i;
+    stage.depth = cut[i][l];
+    stage.totlen = (1 << stage.depth) - 1;
+    stage.basicstep = inverse ? (1 << (curr_logn - i - stage.depth)) : (1 << i);
+    stage.rotated = is_rotated(i, stage.depth);
+    stages.push_back(stage);
+    i += stage.depth;
+  }
+  return stages;
+}
+
+void Bootstrapper::generate_LT_coefficient_planned() {
+  genorigcoeff();
+  fftstages.resize(slot_vec.size());
+  invfftstages.resize(slot_vec.size());
+  for (size_t u = 0; u < slot_vec.size(); u++)
+    generate_LT_coefficient_planned(u);
+  release_origcoeff();
+}
+
+void Bootstrapper::generate_LT_coefficient_planned(int u) {
+  int curr_logn = slot_vec[u];
+  int curr_n = (1 << curr_logn);
+  bool full = (curr_logn == logNh);
+
+  // CoeffToSlot: the first transform divides by K, the last one halves and, in
+  // sparse mode, puts the imaginary parts into the upper n slots
+  invfftstages[u] = plan_linear_transform(curr_logn, cts_levels, true);
+  for (size_t s = 0; s < invfftstages[u].size(); s++) {
+    LTStage &stage = invfftstages[u][s];
+    bool last = (s + 1 == invfftstages[u].size());
+    vector<vector<complex<double>>> coeff;
+    merge_fft_levels(coeff, u, stage.first, stage.depth, true, stage.rotated, (last && !full) ? 2 * curr_n : curr_n);
+    for (auto &diag : coeff) {
+      for (int j = 0; j < curr_n; j++) {
+        if (s == 0)
+          diag[j] *= 1.0 / (boundary_K * (1 << (logNh - curr_logn)));
+        if (last) {
+          diag[j] *= 0.5;
+          if (!full)
+            diag[j + curr_n] = complex<double>(0, -1) * diag[j];
+        }
+      }
+    }
+    stage.coeff = DiagonalStore(coeff);
+  }
+
+  // SlotToCoeff: in sparse mode the diagonals repeat over 2n slots, the upper
+  // half of the last one by i
+  fftstages[u] = plan_linear_transform(curr_logn, stc_levels, false);
+  for (size_t s = 0; s < fftstages[u].size(); s++) {
+    LTStage &stage = fftstages[u][s];
+    bool last = (s + 1 == fftstages[u].size());
+    vector<vector<complex<double>>> coeff;
+    merge_fft_levels(coeff, u, stage.first, stage.depth, false, stage.rotated, full ? curr_n : 2 * curr_n);
+    if (!full) {
+      for (auto &diag : coeff) {
+        for (int j = 0; j < curr_n; j++)
+          diag[j + curr_n] = last ? complex<double>(0, 1) * diag[j] : diag[j];
+      }
+    }
+    stage.coeff = DiagonalStore(coeff);
+  }
+}
+
+void Bootstrapper::save_LT_coefficient(ostream &stream) const {
+  auto save_count = [&](uint64_t count) { stream.write(reinterpret_cast<const char *>(&count), sizeof(count)); };
+  for (const auto *table : {&fftcoeff1, &fftcoeff2, &fftcoeff3, &invfftcoeff1, &invfftcoeff2, &invfftcoeff3}) {
+    save_count(table->size());
+    for (const auto &coeff : *table)
+      coeff.save(stream);
+  }
+  for (const auto *stages : {&fftstages, &invfftstages}) {
+    save_count(stages->size());
+    for (const auto &plan : *stages) {
+      save_count(plan.size());
+      for (const auto &stage : plan)
+        stage.coeff.save(stream);
+    }
+  }
+}
+
+void Bootstrapper::load_LT_coefficient(istream &stream) {
+  auto load_count = [&]() {
+    uint64_t count = 0;
+    stream.read(reinterpret_cast<char *>(&count), sizeof(count));
+    if (!stream || count > slot_vec.size() * 64)
+      throw invalid_argument("Corrupt LT coefficients!");
+    return count;
+  };
+  for (auto *table : {&fftcoeff1, &fftcoeff2, &fftcoeff3, &invfftcoeff1, &invfftcoeff2, &invfftcoeff3}) {
+    table->resize(load_count());
+    for (auto &coeff : *table)
+      coeff.load(stream);
+  }
+  // The stage layout follows from the plan; only the diagonals are stored
+  for (bool inverse : {false, true}) {
+    auto &stages = inverse ? invfftstages : fftstages;
+    stages.resize(load_count());
+    for (size_t u = 0; u < stages.size(); u++) {
+      stages[u] = plan_linear_transform(slot_vec[u], inverse ? cts_levels : stc_levels, inverse);
+      if (load_count() != stages[u].size())
+        throw invalid_argument("LT coefficients were saved for another plan!");
+      for (auto &stage : stages[u])
+        stage.coeff.load(stream);
+    }
+  }
 }
 
 void Bootstrapper::prepare_mod_polynomial() {
@@ -1994,142 +1251,205 @@ void Bootstrapper::subsum(double scale, Ciphertext &cipher) {
   evaluator.rescale_to_next_inplace(cipher);
 }
 
+// The subsum doubles the n slots up to Nh in logNh - logn rotations. Every
+// log2(subsum_radix) consecutive doublings form one group, the rotations by all
+// multiples of the group's first step, which run as one hoisted rotation.
+vector<vector<int>> Bootstrapper::subsum_groups() {
+  long bits = max<long>(1, lround(log2(subsum_radix)));
+  vector<vector<int>> groups;
+  for (long i = logn; i < logNh; i += bits) {
+    vector<int> group;
+    for (int j = 1; j < (1 << min(bits, logNh - i)); j++)
+      group.push_back(j << i);
+    groups.push_back(group);
+  }
+  return groups;
+}
+
+// A group whose keys are not all present falls back to its doublings
+void Bootstrapper::subsum_inplace(Ciphertext &cipher) {
+  auto galois_tool = context.key_context_data()->galois_tool();
+  vector<Ciphertext> rot;
+  for (const auto &group : subsum_groups()) {
+    bool keyed = all_of(group.begin(), group.end(), [&](int step) {
+      return gal_keys.has_key(galois_tool->get_elt_from_step(step));
+    });
+    if (keyed) {
+      evaluator.rotate_vector_hoisted(cipher, group, gal_keys, rot);
+      for (auto &ct : rot)
+        evaluator.add_inplace(cipher, ct);
+    } else {
+      rot.resize(1);
+      for (size_t j = 1; j <= group.size(); j *= 2) {
+        evaluator.rotate_vector(cipher, group[j - 1], gal_keys, rot[0]);
+        evaluator.add_inplace(cipher, rot[0]);
+      }
+    }
+  }
+}
+
 void Bootstrapper::bsgs_linear_transform(
-    Ciphertext &rtncipher, Ciphertext &cipher, int totlen, int basicstep, int coeff_logn, const vector<vector<complex<double>>> &fftcoeff) {
+    Ciphertext &rtncipher, Ciphertext &cipher, int totlen, int basicstep, int coeff_logn, const DiagonalStore &fftcoeff) {
   int gs1 = giantstep(2 * totlen + 1);
   int basicstart1 = -totlen + gs1 * floor((totlen + 0.0) / (gs1 + 0.0));
   int giantfirst1 = -floor((totlen + 0.0) / (gs1 + 0.0));
   int giantlast1 = floor((2 * totlen + 0.0) / (gs1 + 0.0)) + giantfirst1;
 
   vector<Ciphertext> babyct(gs1, Ciphertext());
-  // Ciphertext* babyct = new Ciphertext[gs1];
-  Ciphertext giantct, tmpct;
-  bool giantbool = false, tmpctbool = false;
-  Ciphertext tmptmpct;
-  vector<complex<double>> rotatedcoeff;
-  rotatedcoeff.reserve(Nh);
-
-  Plaintext tmpplain;
-  Ciphertext addtmp1, addtmp2;
-
-  for (int i = basicstart1; i < basicstart1 + gs1; i++) {
+  stage_pool->parallel_for(gs1, [&](size_t t) {
+    int i = basicstart1 + t;
     if (i == 0)
-      babyct[i - basicstart1] = cipher;
+      babyct[t] = cipher;
     else
-      evaluator.rotate_vector(cipher, (Nh + i * basicstep) % Nh, gal_keys, babyct[i - basicstart1]);
-  }
-
-  for (int i = giantfirst1; i <= giantlast1; i++) {
-    giantbool = false;
-    if (i != giantlast1) {
-      for (int j = basicstart1; j < basicstart1 + gs1; j++) {
-        rotation(coeff_logn, Nh, (-i) * gs1 * basicstep, fftcoeff[(i * gs1 + j) + totlen], rotatedcoeff);
-        evaluator.multiply_vector_reduced_error(babyct[j - basicstart1], rotatedcoeff, tmptmpct);
-        if (!giantbool) {
-          giantct = tmptmpct;
-          giantbool = true;
-        } else
-          evaluator.add_inplace_reduced_error(giantct, tmptmpct);
-      }
-    } else {
-      for (int j = basicstart1; j <= totlen - i * gs1; j++) {
-        rotation(coeff_logn, Nh, (-i) * gs1 * basicstep, fftcoeff[(i * gs1 + j) + totlen], rotatedcoeff);
-        evaluator.multiply_vector_reduced_error(babyct[j - basicstart1], rotatedcoeff, tmptmpct);
-        if (!giantbool) {
-          giantct = tmptmpct;
-          giantbool = true;
-        } else
-          evaluator.add_inplace_reduced_error(giantct, tmptmpct);
-      }
+      evaluator.rotate_vector(cipher, (Nh + i * basicstep) % Nh, gal_keys, babyct[t]);
+  });
+
+  // Every giant step sums its diagonals and rotates independently of the others
+  vector<Ciphertext> giantct(giantlast1 - giantfirst1 + 1, Ciphertext());
+  stage_pool->parallel_for(giantct.size(), [&](size_t t) {
+    int i = giantfirst1 + t;
+    int basiclast1 = (i != giantlast1) ? basicstart1 + gs1 - 1 : totlen - i * gs1;
+    vector<complex<double>> rotatedcoeff;
+    rotatedcoeff.reserve(Nh);
+    Ciphertext sumct, tmptmpct;
+    for (int j = basicstart1; j <= basiclast1; j++) {
+      fftcoeff.rotation((i * gs1 + j) + totlen, coeff_logn, Nh, (-i) * gs1 * basicstep, rotatedcoeff);
+      evaluator.multiply_vector_reduced_error(babyct[j - basicstart1], rotatedcoeff, tmptmpct);
+      if (j == basicstart1)
+        sumct = tmptmpct;
+      else
+        evaluator.add_inplace_reduced_error(sumct, tmptmpct);
     }
 
-    if (i != 0) {
-      evaluator.rotate_vector(giantct, (Nh + i * gs1 * basicstep) % Nh, gal_keys, tmptmpct);
-      if (!tmpctbool) {
-        tmpct = tmptmpct;
-        tmpctbool = true;
-      } else
-        evaluator.add_inplace_reduced_error(tmpct, tmptmpct);
-    } else {
-      if (!tmpctbool) {
-        tmpct = giantct;
-        tmpctbool = true;
-      } else
-        evaluator.add_inplace_reduced_error(tmpct, giantct);
-    }
+    if (i != 0)
+      evaluator.rotate_vector(sumct, (Nh + i * gs1 * basicstep) % Nh, gal_keys, giantct[t]);
+    else
+      giantct[t] = std::move(sumct);
+  });
+
+  rtncipher = giantct[0];
+  for (size_t t = 1; t < giantct.size(); t++) {
+    evaluator.add_inplace_reduced_error(rtncipher, giantct[t]);
   }
-  rtncipher = tmpct;
 }
 
 void Bootstrapper::rotated_bsgs_linear_transform(
-    Ciphertext &rtncipher, Ciphertext &cipher, int totlen, int basicstep, int coeff_logn, const vector<vector<complex<double>>> &fftcoeff) {
+    Ciphertext &rtncipher, Ciphertext &cipher, int totlen, int basicstep, int coeff_logn, const DiagonalStore &fftcoeff) {
   int gs2 = giantstep(totlen + 1);
   int giantlast2 = floor((totlen + 0.0) / (gs2 + 0.0));
 
-  vector<Ciphertext> babyct(gs2, Ciphertext());
-  // Ciphertext* babyct = new Ciphertext[gs2];
-  Ciphertext giantct, tmpct;
-  bool giantbool = false, tmpctbool = false;
-  Ciphertext tmptmpct;
-  vector<complex<double>> rotatedcoeff;
-  rotatedcoeff.reserve(Nh);
-
-  Plaintext tmpplain;
-
-  Ciphertext addtmp1, addtmp2;
-
-  for (int i = 0; i < gs2; i++) {
+  vector<Ciphertext> babyct(gs2, Ciphertext());
+  stage_pool->parallel_for(gs2, [&](size_t i) {
     if (i == 0) {
       babyct[i] = cipher;
     } else {
       evaluator.rotate_vector(cipher, (Nh + i * basicstep) % Nh, gal_keys, babyct[i]);
     }
-  }
-
-  for (int i = 0; i <= giantlast2; i++) {
-    giantbool = false;
-    if (i != giantlast2) {
-      for (int j = 0; j < gs2; j++) {
-        rotation(coeff_logn, Nh, (-i) * gs2 * basicstep, fftcoeff[i * gs2 + j], rotatedcoeff);
-        evaluator.multiply_vector_reduced_error(babyct[j], rotatedcoeff, tmptmpct);
-        if (!giantbool) {
-          giantct = tmptmpct;
-          giantbool = true;
-        } else
-          evaluator.add_inplace_reduced_error(giantct, tmptmpct);
-      }
-    } else {
-      for (int j = 0; j <= totlen - i * gs2; j++) {
-        rotation(coeff_logn, Nh, (-i) * gs2 * basicstep, fftcoeff[i * gs2 + j], rotatedcoeff);
-        evaluator.multiply_vector_reduced_error(babyct[j], rotatedcoeff, tmptmpct);
-        if (!giantbool) {
-          giantct = tmptmpct;
-          giantbool = true;
-        } else
-          evaluator.add_inplace_reduced_error(giantct, tmptmpct);
-      }
+  });
+
+  vector<Ciphertext> giantct(giantlast2 + 1, Ciphertext());
+  stage_pool->parallel_for(giantct.size(), [&](size_t t) {
+    int i = t;
+    int basiclast2 = (i != giantlast2) ? gs2 - 1 : totlen - i * gs2;
+    vector<complex<double>> rotatedcoeff;
+    rotatedcoeff.reserve(Nh);
+    Ciphertext sumct, tmptmpct;
+    for (int j = 0; j <= basiclast2; j++) {
+      fftcoeff.rotation(i * gs2 + j, coeff_logn, Nh, (-i) * gs2 * basicstep, rotatedcoeff);
+      evaluator.multiply_vector_reduced_error(babyct[j], rotatedcoeff, tmptmpct);
+      if (j == 0)
+        sumct = tmptmpct;
+      else
+        evaluator.add_inplace_reduced_error(sumct, tmptmpct);
     }
 
-    if (i != 0) {
-      evaluator.rotate_vector(giantct, (Nh + i * gs2 * basicstep) % Nh, gal_keys, tmptmpct);
-      if (!tmpctbool) {
-        tmpct = tmptmpct;
-        tmpctbool = true;
-      } else
-        evaluator.add_inplace_reduced_error(tmpct, tmptmpct);
-    } else {
-      if (!tmpctbool) {
-        tmpct = giantct;
-        tmpctbool = true;
-      } else
-        evaluator.add_inplace_reduced_error(tmpct, giantct);
-    }
+    if (i != 0)
+      evaluator.rotate_vector(sumct, (Nh + i * gs2 * basicstep) % Nh, gal_keys, giantct[i]);
+    else
+      giantct[i] = std::move(sumct);
+  });
+
+  rtncipher = giantct[0];
+  for (size_t i = 1; i < giantct.size(); i++) {
+    evaluator.add_inplace_reduced_error(rtncipher, giantct[i]);
+  }
+}
+// The batched form of both BSGS loops above: baby steps basicstart, ...,
+// basicstart + gs - 1 and giant steps giantfirst, ..., giantlast, where diagonal
+// i * gs + j sits at fftcoeff[i * gs + j + coeff_offset]
+void Bootstrapper::bsgs_linear_transform_many(
+    vector<Ciphertext> &rtncipher, vector<Ciphertext> &cipher, int totlen, int basicstep, int coeff_logn,
+    const DiagonalStore &fftcoeff, int gs, int basicstart, int giantfirst, int giantlast,
+    int coeff_offset, ThreadPool &pool) {
+  size_t count = cipher.size();
+  vector<vector<Ciphertext>> babyct(count, vector<Ciphertext>(gs));
+  pool.parallel_for(count * gs, [&](size_t t) {
+    size_t b = t / gs;
+    int j = basicstart + static_cast<int>(t % gs);
+    if (j == 0)
+      babyct[b][t % gs] = cipher[b];
+    else
+      evaluator.rotate_vector(cipher[b], (Nh + j * basicstep) % Nh, gal_keys, babyct[b][t % gs]);
+  });
+
+  parms_id_type parms_id = cipher[0].parms_id();
+  double scale = cipher[0].scale();
+  vector<Plaintext> diagplain(gs);
+  rtncipher.assign(count, Ciphertext());
+
+  for (int i = giantfirst; i <= giantlast; i++) {
+    int width = (i != giantlast) ? gs : totlen - i * gs - basicstart + 1;
+
+    // One encoding per diagonal, directly at the level of the baby steps
+    pool.parallel_for(width, [&](size_t t) {
+      vector<complex<double>> rotatedcoeff;
+      rotatedcoeff.reserve(Nh);
+      fftcoeff.rotation(i * gs + basicstart + t + coeff_offset, coeff_logn, Nh, (-i) * gs * basicstep, rotatedcoeff);
+      encoder.encode(rotatedcoeff, parms_id, scale, diagplain[t]);
+    });
+
+    pool.parallel_for(count, [&](size_t b) {
+      Ciphertext giantct, tmptmpct;
+      evaluator.multiply_plain(babyct[b][0], diagplain[0], giantct);
+      for (int t = 1; t < width; t++) {
+        evaluator.multiply_plain(babyct[b][t], diagplain[t], tmptmpct);
+        evaluator.add_inplace_reduced_error(giantct, tmptmpct);
+      }
+
+      if (i != 0) {
+        evaluator.rotate_vector_inplace(giantct, (Nh + i * gs * basicstep) % Nh, gal_keys);
+      }
+      if (i == giantfirst)
+        rtncipher[b] = std::move(giantct);
+      else
+        evaluator.add_inplace_reduced_error(rtncipher[b], giantct);
+    });
   }
+}
+
+void Bootstrapper::bsgs_linear_transform_many(
+    vector<Ciphertext> &rtncipher, vector<Ciphertext> &cipher, int totlen, int basicstep, int coeff_logn,
+    const DiagonalStore &fftcoeff, ThreadPool &pool) {
+  int gs1 = giantstep(2 * totlen + 1);
+  int basicstart1 = -totlen + gs1 * floor((totlen + 0.0) / (gs1 + 0.0));
+  int giantfirst1 = -floor((totlen + 0.0) / (gs1 + 0.0));
+  int giantlast1 = floor((2 * totlen + 0.0) / (gs1 + 0.0)) + giantfirst1;
+
+  bsgs_linear_transform_many(
+      rtncipher, cipher, totlen, basicstep, coeff_logn, fftcoeff, gs1, basicstart1, giantfirst1, giantlast1, totlen, pool);
+}
 
-  rtncipher = tmpct;
+void Bootstrapper::rotated_bsgs_linear_transform_many(
+    vector<Ciphertext> &rtncipher, vector<Ciphertext> &cipher, int totlen, int basicstep, int coeff_logn,
+    const DiagonalStore &fftcoeff, ThreadPool &pool) {
+  int gs2 = giantstep(totlen + 1);
+  int giantlast2 = floor((totlen + 0.0) / (gs2 + 0.0));
+
+  bsgs_linear_transform_many(rtncipher, cipher, totlen, basicstep, coeff_logn, fftcoeff, gs2, 0, 0, giantlast2, 0, pool);
 }
+
 void Bootstrapper::bsgs_linear_transform_hoisting(
-    Ciphertext &rtncipher, Ciphertext &cipher, int totlen, int basicstep, int coeff_logn, vector<vector<complex<double>>> fftcoeff) {
+    Ciphertext &rtncipher, Ciphertext &cipher, int totlen, int basicstep, int coeff_logn, const DiagonalStore &fftcoeff) {
   int gs1 = giantstep(2 * totlen + 1);
   int basicstart1 = -totlen + gs1 * floor((totlen + 0.0) / (gs1 + 0.0));
   int giantfirst1 = -floor((totlen + 0.0) / (gs1 + 0.0));
@@ -2157,7 +1477,7 @@ void Bootstrapper::bsgs_linear_transform_hoisting(
     giantct = 0;
     if (i != giantlast1) {
       for (int j = basicstart1; j < basicstart1 + gs1; j++) {
-        rotation(coeff_logn, Nh, (-i) * gs1 * basicstep, fftcoeff[(i * gs1 + j) + totlen], rotatedcoeff);
+        fftcoeff.rotation((i * gs1 + j) + totlen, coeff_logn, Nh, (-i) * gs1 * basicstep, rotatedcoeff);
         evaluator.multiply_vector_reduced_error(babyct[j - basicstart1], rotatedcoeff, tmptmpct);
         if (giantct == 0) {
           giantct = new Ciphertext();
@@ -2167,7 +1487,7 @@ void Bootstrapper::bsgs_linear_transform_hoisting(
       }
     } else {
       for (int j = basicstart1; j <= totlen - i * gs1; j++) {
-        rotation(coeff_logn, Nh, (-i) * gs1 * basicstep, fftcoeff[(i * gs1 + j) + totlen], rotatedcoeff);
+        fftcoeff.rotation((i * gs1 + j) + totlen, coeff_logn, Nh, (-i) * gs1 * basicstep, rotatedcoeff);
         evaluator.multiply_vector_reduced_error(babyct[j - basicstart1], rotatedcoeff, tmptmpct);
         if (giantct == 0) {
           giantct = new Ciphertext();
@@ -2198,7 +1518,7 @@ void Bootstrapper::bsgs_linear_transform_hoisting(
 }
 
 void Bootstrapper::rotated_bsgs_linear_transform_hoisting(
-    Ciphertext &rtncipher, Ciphertext &cipher, int totlen, int basicstep, int coeff_logn, vector<vector<complex<double>>> fftcoeff) {
+    Ciphertext &rtncipher, Ciphertext &cipher, int totlen, int basicstep, int coeff_logn, const DiagonalStore &fftcoeff) {
   int gs2 = giantstep(totlen + 1);
   int giantlast2 = floor((totlen + 0.0) / (gs2 + 0.0));
 
@@ -2230,7 +1550,7 @@ void Bootstrapper::rotated_bsgs_linear_transform_hoisting(
     giantct = 0;
     if (i != giantlast2) {
       for (int j = 0; j < gs2; j++) {
-        rotation(coeff_logn, Nh, (-i) * gs2 * basicstep, fftcoeff[i * gs2 + j], rotatedcoeff);
+        fftcoeff.rotation(i * gs2 + j, coeff_logn, Nh, (-i) * gs2 * basicstep, rotatedcoeff);
         evaluator.multiply_vector_reduced_error(babyct[j], rotatedcoeff, tmptmpct);
         if (giantct == 0) {
           giantct = new Ciphertext();
@@ -2240,7 +1560,7 @@ void Bootstrapper::rotated_bsgs_linear_transform_hoisting(
       }
     } else {
       for (int j = 0; j <= totlen - i * gs2; j++) {
-        rotation(coeff_logn, Nh, (-i) * gs2 * basicstep, fftcoeff[i * gs2 + j], rotatedcoeff);
+        fftcoeff.rotation(i * gs2 + j, coeff_logn, Nh, (-i) * gs2 * basicstep, rotatedcoeff);
         evaluator.multiply_vector_reduced_error(babyct[j], rotatedcoeff, tmptmpct);
         if (giantct == 0) {
           giantct = new Ciphertext();
@@ -2270,7 +1590,7 @@ void Bootstrapper::rotated_bsgs_linear_transform_hoisting(
   delete[] babyct;
 }
 void Bootstrapper::rotated_nobsgs_linear_transform(
-    Ciphertext &rtncipher, Ciphertext &cipher, int totlen, int coeff_logn, vector<vector<complex<double>>> fftcoeff) {
+    Ciphertext &rtncipher, Ciphertext &cipher, int totlen, int coeff_logn, const DiagonalStore &fftcoeff) {
   Ciphertext *giantct = 0, *tmpct = 0;
 
   Ciphertext tmptmpct;
@@ -2282,7 +1602,7 @@ void Bootstrapper::rotated_nobsgs_linear_transform(
 
   for (int i = 0; i <= totlen; i++) {
     giantct = 0;
-    rotation(coeff_logn, Nh, -i, fftcoeff[i], rotatedcoeff);
+    fftcoeff.rotation(i, coeff_logn, Nh, -i, rotatedcoeff);
     evaluator.multiply_vector_reduced_error(cipher, rotatedcoeff, tmptmpct);
     giantct = new Ciphertext();
     *giantct = tmptmpct;
@@ -2307,15 +1627,8 @@ void Bootstrapper::rotated_nobsgs_linear_transform(
 
 void Bootstrapper::sfl_one_depth(Ciphertext &rtncipher, Ciphertext &cipher) {
   int totlen1 = (1 << logn) - 1;
-  vector<vector<complex<double>>> fftcoeff1_ext(2 * totlen1 + 1);
-  for (int i = 0; i < 2 * totlen1 + 1; i++) {
-    fftcoeff1_ext[i].resize(2 * n);
-    for (int j = 0; j < n; j++) {
-      fftcoeff1_ext[i][j] = fftcoeff1[slot_index][i][j];
-      fftcoeff1_ext[i][j + n] = fftcoeff1[slot_index][i][j];
-    }
-  }
-  bsgs_linear_transform(rtncipher, cipher, totlen1, 1, logn + 1, fftcoeff1_ext);
+  // The diagonals repeat over 2n slots, which their periods already do
+  bsgs_linear_transform(rtncipher, cipher, totlen1, 1, logn + 1, fftcoeff1[slot_index]);
 }
 
 void Bootstrapper::sfl_full_one_depth(Ciphertext &rtncipher, Ciphertext &cipher) {
@@ -2347,15 +1660,9 @@ void Bootstrapper::sfl(Ciphertext &rtncipher, Ciphertext &cipher) {
   double mod_zero = (double)modulus[0].value();
   double curr_mod = (double)modulus[curr_level].value();
 
-  vector<vector<complex<double>>> fftcoeff2_scale(2 * totlen2 + 1);
-  for (int i = 0; i < 2 * totlen2 + 1; i++)
-    fftcoeff2_scale[i].resize(2 * n);
-
-  for (int i = 0; i < 2 * totlen2 + 1; i++) {
-    for (int j = 0; j < 2 * n; j++) {
-      fftcoeff2_scale[i][j] = fftcoeff2[slot_index][i][j] * curr_mod * mod_zero * final_scale / (tmpct.scale() * tmpct.scale() * initial_scale);
-    }
-  }
+  DiagonalStore fftcoeff2_scale = fftcoeff2[slot_index];
+  for (auto &coeff : fftcoeff2_scale.values())
+    coeff = coeff * curr_mod * mod_zero * final_scale / (tmpct.scale() * tmpct.scale() * initial_scale);
 
   int basicstep = (1 << split_point);
   bsgs_linear_transform(rtncipher, tmpct, totlen2, basicstep, logn + 1, fftcoeff2_scale);
@@ -2376,15 +1683,9 @@ void Bootstrapper::sfl_full(Ciphertext &rtncipher, Ciphertext &cipher) {
 
   double mod_zero = (double)modulus[0].value();
   double curr_mod = (double)modulus[curr_level].value();
-  vector<vector<complex<double>>> fftcoeff2_scale(2 * totlen2 + 1);
-  for (int i = 0; i < totlen2 + 1; i++)
-    fftcoeff2_scale[i].resize(n);
-
-  for (int i = 0; i < totlen2 + 1; i++) {
-    for (int j = 0; j < n; j++) {
-      fftcoeff2_scale[i][j] = fftcoeff2[slot_index][i][j] * curr_mod * mod_zero * final_scale / (tmpct.scale() * tmpct.scale() * initial_scale);
-    }
-  }
+  DiagonalStore fftcoeff2_scale = fftcoeff2[slot_index];
+  for (auto &coeff : fftcoeff2_scale.values())
+    coeff = coeff * curr_mod * mod_zero * final_scale / (tmpct.scale() * tmpct.scale() * initial_scale);
 
   int basicstep = (1 << split_point);
   rotated_bsgs_linear_transform(rtncipher, tmpct, totlen2, basicstep, logn, fftcoeff2_scale);
@@ -2442,15 +1743,9 @@ void Bootstrapper::sfl_3(Ciphertext &rtncipher, Ciphertext &cipher) {  // not ye
 
   double mod_zero = (double)modulus[0].value();
   double curr_mod = (double)modulus[curr_level].value();
-  vector<vector<complex<double>>> fftcoeff3_scale(2 * totlen3 + 1);
-  for (int i = 0; i < 2 * totlen3 + 1; i++)
-    fftcoeff3_scale[i].resize(2 * n);
-
-  for (int i = 0; i < 2 * totlen3 + 1; i++) {
-    for (int j = 0; j < 2 * n; j++) {
-      fftcoeff3_scale[i][j] = fftcoeff3[slot_index][i][j] * curr_mod * mod_zero * final_scale / (tmpct2.scale() * tmpct2.scale() * initial_scale);
-    }
-  }
+  DiagonalStore fftcoeff3_scale = fftcoeff3[slot_index];
+  for (auto &coeff : fftcoeff3_scale.values())
+    coeff = coeff * curr_mod * mod_zero * final_scale / (tmpct2.scale() * tmpct2.scale() * initial_scale);
 
   bsgs_linear_transform(rtncipher, tmpct2, totlen3, basicstep3, logn + 1, fftcoeff3_scale);
   evaluator.rescale_to_next_inplace(rtncipher);
@@ -2482,15 +1777,9 @@ void Bootstrapper::sfl_full_3(Ciphertext &rtncipher, Ciphertext &cipher) {
 
   double mod_zero = (double)modulus[0].value();
   double curr_mod = (double)modulus[curr_level].value();
-  vector<vector<complex<double>>> fftcoeff3_scale(2 * totlen3 + 1);
-  for (int i = 0; i < totlen2 + 1; i++)
-    fftcoeff3_scale[i].resize(n);
-
-  for (int i = 0; i < totlen2 + 1; i++) {
-    for (int j = 0; j < n; j++) {
-      fftcoeff3_scale[i][j] = fftcoeff3[slot_index][i][j] * curr_mod * mod_zero * final_scale / (tmpct2.scale() * tmpct2.scale() * initial_scale);
-    }
-  }
+  DiagonalStore fftcoeff3_scale = fftcoeff3[slot_index];
+  for (auto &coeff : fftcoeff3_scale.values())
+    coeff = coeff * curr_mod * mod_zero * final_scale / (tmpct2.scale() * tmpct2.scale() * initial_scale);
 
   rotated_bsgs_linear_transform(rtncipher, tmpct2, totlen3, basicstep3, logn, fftcoeff3_scale);
   evaluator.rescale_to_next_inplace(rtncipher);
@@ -2521,15 +1810,9 @@ void Bootstrapper::sfl_half_3(Ciphertext &rtncipher, Ciphertext &cipher) {  // n
 
   double mod_zero = (double)modulus[0].value();
   double curr_mod = (double)modulus[curr_level].value();
-  vector<vector<complex<double>>> fftcoeff3_scale(2 * totlen3 + 1);
-  for (int i = 0; i < 2 * totlen3 + 1; i++)
-    fftcoeff3_scale[i].resize(2 * n);
-
-  for (int i = 0; i < 2 * totlen3 + 1; i++) {
-    for (int j = 0; j < 2 * n; j++) {
-      fftcoeff3_scale[i][j] = fftcoeff3[slot_index][i][j] * curr_mod * mod_zero * final_scale / (2 * tmpct2.scale() * tmpct2.scale() * initial_scale);
-    }
-  }
+  DiagonalStore fftcoeff3_scale = fftcoeff3[slot_index];
+  for (auto &coeff : fftcoeff3_scale.values())
+    coeff = coeff * curr_mod * mod_zero * final_scale / (2 * tmpct2.scale() * tmpct2.scale() * initial_scale);
 
   bsgs_linear_transform(rtncipher, tmpct2, totlen3, basicstep3, logn + 1, fftcoeff3_scale);
   evaluator.rescale_to_next_inplace(rtncipher);
@@ -2561,15 +1844,9 @@ void Bootstrapper::sfl_full_half_3(Ciphertext &rtncipher, Ciphertext &cipher) {
 
   double mod_zero = (double)modulus[0].value();
   double curr_mod = (double)modulus[curr_level].value();
-  vector<vector<complex<double>>> fftcoeff3_scale(2 * totlen3 + 1);
-  for (int i = 0; i < totlen2 + 1; i++)
-    fftcoeff3_scale[i].resize(n);
-
-  for (int i = 0; i < totlen2 + 1; i++) {
-    for (int j = 0; j < n; j++) {
-      fftcoeff3_scale[i][j] = fftcoeff3[slot_index][i][j] * curr_mod * mod_zero * final_scale / (2 * tmpct2.scale() * tmpct2.scale() * initial_scale);
-    }
-  }
+  DiagonalStore fftcoeff3_scale = fftcoeff3[slot_index];
+  for (auto &coeff : fftcoeff3_scale.values())
+    coeff = coeff * curr_mod * mod_zero * final_scale / (2 * tmpct2.scale() * tmpct2.scale() * initial_scale);
 
   rotated_bsgs_linear_transform(rtncipher, tmpct2, totlen3, basicstep3, logn, fftcoeff3_scale);
   evaluator.rescale_to_next_inplace(rtncipher);
@@ -2621,6 +1898,130 @@ void Bootstrapper::sflinv_full_3(Ciphertext &rtncipher, Ciphertext &cipher) {
   evaluator.rescale_to_next_inplace(rtncipher);
 }
 
+void Bootstrapper::planned_linear_transform(
+    Ciphertext &rtncipher, Ciphertext &cipher, const LTStage &stage, const DiagonalStore &coeff) {
+  int coeff_logn = 0;
+  while ((size_t(1) << coeff_logn) < coeff.length())
+    coeff_logn++;
+
+  if (stage.rotated)
+    rotated_bsgs_linear_transform(rtncipher, cipher, stage.totlen, stage.basicstep, coeff_logn, coeff);
+  else
+    bsgs_linear_transform(rtncipher, cipher, stage.totlen, stage.basicstep, coeff_logn, coeff);
+}
+
+void Bootstrapper::sfl_planned(Ciphertext &rtncipher, Ciphertext &cipher, bool half) {
+  const auto &stages = fftstages[slot_index];
+  Ciphertext tmpct = cipher;
+  for (size_t s = 0; s < stages.size(); s++) {
+    if (s + 1 < stages.size()) {
+      planned_linear_transform(rtncipher, tmpct, stages[s], stages[s].coeff);
+    } else {
+      const auto &modulus = iter(context.first_context_data()->parms().coeff_modulus());
+      auto curr_level = context.get_context_data(tmpct.parms_id())->chain_index();
+
+      double mod_zero = (double)modulus[0].value();
+      double curr_mod = (double)modulus[curr_level].value();
+      double half_div = half ? 2 : 1;
+      DiagonalStore coeff_scale = stages[s].coeff;
+      for (auto &c : coeff_scale.values())
+        c = c * curr_mod * mod_zero * final_scale / (half_div * tmpct.scale() * tmpct.scale() * initial_scale);
+      planned_linear_transform(rtncipher, tmpct, stages[s], coeff_scale);
+    }
+    evaluator.rescale_to_next_inplace(rtncipher);
+    swap(tmpct, rtncipher);
+  }
+  rtncipher = std::move(tmpct);
+}
+
+void Bootstrapper::sflinv_planned(Ciphertext &rtncipher, Ciphertext &cipher) {
+  Ciphertext tmpct = cipher;
+  for (const auto &stage : invfftstages[slot_index]) {
+    planned_linear_transform(rtncipher, tmpct, stage, stage.coeff);
+    evaluator.rescale_to_next_inplace(rtncipher);
+    swap(tmpct, rtncipher);
+  }
+  rtncipher = std::move(tmpct);
+}
+
+void Bootstrapper::sfl_3_many(vector<Ciphertext> &rtncipher, vector<Ciphertext> &cipher, bool half, ThreadPool &pool) {
+  bool full = (logn == logNh);
+  int coeff_logn = full ? logn : logn + 1;
+
+  int div_part3 = floor(logn / 3.0);
+  int div_part2 = floor((logn - div_part3) / 2.0);
+  int div_part1 = logn - div_part3 - div_part2;
+
+  int totlen1 = (1 << div_part1) - 1;
+  int totlen2 = (1 << div_part2) - 1;
+  int totlen3 = (1 << div_part3) - 1;
+
+  int basicstep1 = 1;
+  int basicstep2 = (1 << div_part1);
+  int basicstep3 = (1 << (div_part1 + div_part2));
+
+  auto rescale = [&](vector<Ciphertext> &ct) {
+    pool.parallel_for(ct.size(), [&](size_t i) { evaluator.rescale_to_next_inplace(ct[i]); });
+  };
+
+  vector<Ciphertext> tmpct;
+  bsgs_linear_transform_many(tmpct, cipher, totlen1, basicstep1, coeff_logn, fftcoeff1[slot_index], pool);
+  rescale(tmpct);
+
+  vector<Ciphertext> tmpct2;
+  bsgs_linear_transform_many(tmpct2, tmpct, totlen2, basicstep2, coeff_logn, fftcoeff2[slot_index], pool);
+  rescale(tmpct2);
+
+  const auto &modulus = iter(context.first_context_data()->parms().coeff_modulus());
+  auto curr_level = context.get_context_data(tmpct2[0].parms_id())->chain_index();
+
+  double mod_zero = (double)modulus[0].value();
+  double curr_mod = (double)modulus[curr_level].value();
+  double denominator = tmpct2[0].scale() * tmpct2[0].scale() * initial_scale;
+  if (half) {
+    denominator = 2 * tmpct2[0].scale() * tmpct2[0].scale() * initial_scale;
+  }
+  DiagonalStore fftcoeff3_scale = fftcoeff3[slot_index];
+  for (auto &coeff : fftcoeff3_scale.values()) {
+    coeff = coeff * curr_mod * mod_zero * final_scale / denominator;
+  }
+
+  if (full)
+    rotated_bsgs_linear_transform_many(rtncipher, tmpct2, totlen3, basicstep3, coeff_logn, fftcoeff3_scale, pool);
+  else
+    bsgs_linear_transform_many(rtncipher, tmpct2, totlen3, basicstep3, coeff_logn, fftcoeff3_scale, pool);
+  rescale(rtncipher);
+}
+
+void Bootstrapper::sflinv_3_many(vector<Ciphertext> &rtncipher, vector<Ciphertext> &cipher, ThreadPool &pool) {
+  bool full = (logn == logNh);
+
+  int div_part1 = floor(logn / 3.0);
+  int div_part2 = floor((logn - div_part1) / 2.0);
+  int div_part3 = logn - div_part1 - div_part2;
+
+  int totlen1 = (1 << div_part1) - 1;
+  int totlen2 = (1 << div_part2) - 1;
+  int totlen3 = (1 << div_part3) - 1;
+
+  int basicstep1 = (1 << (logn - div_part1));
+  int basicstep2 = (1 << (logn - div_part1 - div_part2));
+  int basicstep3 = 1;
+
+  auto rescale = [&](vector<Ciphertext> &ct) {
+    pool.parallel_for(ct.size(), [&](size_t i) { evaluator.rescale_to_next_inplace(ct[i]); });
+  };
+
+  vector<Ciphertext> tmpct;
+  rotated_bsgs_linear_transform_many(tmpct, cipher, totlen1, basicstep1, logn, invfftcoeff1[slot_index], pool);
+  rescale(tmpct);
+  vector<Ciphertext> tmpct2;
+  bsgs_linear_transform_many(tmpct2, tmpct, totlen2, basicstep2, logn, invfftcoeff2[slot_index], pool);
+  rescale(tmpct2);
+  bsgs_linear_transform_many(rtncipher, tmpct2, totlen3, basicstep3, full ? logn : logn + 1, invfftcoeff3[slot_index], pool);
+  rescale(rtncipher);
+}
+
 void Bootstrapper::sfl_hoisting(Ciphertext &rtncipher, Ciphertext &cipher) {
   int split_point = floor(logn / 2.0);
   int totlen1 = (1 << split_point) - 1;
@@ -2792,6 +2193,110 @@ void Bootstrapper::slottocoeff_full_half_3(Ciphertext &rtncipher, Ciphertext &ci
 
   sfl_full_half_3(rtncipher, tmpct3);
 }
+void Bootstrapper::coefftoslot_planned(Ciphertext &rtncipher, Ciphertext &cipher) {
+  Ciphertext tmpct1, tmpct2;
+  sflinv_planned(tmpct1, cipher);
+  evaluator.complex_conjugate(tmpct1, gal_keys, tmpct2);
+  evaluator.add_reduced_error(tmpct1, tmpct2, rtncipher);
+}
+
+void Bootstrapper::slottocoeff_planned(Ciphertext &rtncipher, Ciphertext &cipher, bool half) {
+  Ciphertext tmpct1, tmpct2;
+  sfl_planned(tmpct1, cipher, half);
+  evaluator.rotate_vector(tmpct1, n, gal_keys, tmpct2);
+  evaluator.add_reduced_error(tmpct1, tmpct2, rtncipher);
+}
+
+void Bootstrapper::coefftoslot_full_planned(Ciphertext &rtncipher1, Ciphertext &rtncipher2, Ciphertext &cipher) {
+  Ciphertext tmpct1, tmpct2, tmpct3, tmpct4;
+  sflinv_planned(tmpct1, cipher);
+  vector<complex<double>> tmpvec(Nh, complex<double>(0.0, -1.0));
+  Plaintext tmpplain;
+  encoder.encode(tmpvec, tmpct1.parms_id(), 1.0, tmpplain);
+  evaluator.multiply_plain(tmpct1, tmpplain, tmpct2);
+
+  evaluator.complex_conjugate(tmpct2, gal_keys, tmpct3);
+  evaluator.complex_conjugate(tmpct1, gal_keys, tmpct4);
+  evaluator.add_reduced_error(tmpct1, tmpct4, rtncipher1);
+  evaluator.add_reduced_error(tmpct2, tmpct3, rtncipher2);
+}
+
+void Bootstrapper::slottocoeff_full_planned(Ciphertext &rtncipher, Ciphertext &cipher1, Ciphertext &cipher2, bool half) {
+  Ciphertext tmpct1, tmpct2;
+  vector<complex<double>> tmpvec(Nh, complex<double>(0.0, 1.0));
+  Plaintext tmpplain;
+  encoder.encode(tmpvec, cipher2.parms_id(), 1.0, tmpplain);
+  evaluator.multiply_plain(cipher2, tmpplain, tmpct1);
+  evaluator.add_reduced_error(cipher1, tmpct1, tmpct2);
+
+  sfl_planned(rtncipher, tmpct2, half);
+}
+
+void Bootstrapper::coefftoslot_3_many(vector<Ciphertext> &rtncipher, vector<Ciphertext> &cipher, ThreadPool &pool) {
+  size_t count = cipher.size();
+  vector<Ciphertext> tmpct1;
+  sflinv_3_many(tmpct1, cipher, pool);
+
+  if (logn != logNh) {
+    rtncipher.resize(count);
+    pool.parallel_for(count, [&](size_t b) {
+      Ciphertext tmpct2;
+      evaluator.complex_conjugate(tmpct1[b], gal_keys, tmpct2);
+      evaluator.add_reduced_error(tmpct1[b], tmpct2, rtncipher[b]);
+    });
+    return;
+  }
+
+  complex<double> iunit(0.0, 1.0);
+  vector<complex<double>> tmpvec(Nh, -iunit);
+  Plaintext tmpplain;
+  encoder.encode(tmpvec, tmpct1[0].parms_id(), 1.0, tmpplain);
+
+  // Real parts land in the first half, imaginary parts in the second
+  rtncipher.resize(2 * count);
+  pool.parallel_for(2 * count, [&](size_t k) {
+    size_t b = k % count;
+    Ciphertext tmpct2, tmpct3;
+    if (k < count) {
+      evaluator.complex_conjugate(tmpct1[b], gal_keys, tmpct3);
+      evaluator.add_reduced_error(tmpct1[b], tmpct3, rtncipher[k]);
+    } else {
+      evaluator.multiply_plain(tmpct1[b], tmpplain, tmpct2);
+      evaluator.complex_conjugate(tmpct2, gal_keys, tmpct3);
+      evaluator.add_reduced_error(tmpct2, tmpct3, rtncipher[k]);
+    }
+  });
+}
+
+void Bootstrapper::slottocoeff_3_many(vector<Ciphertext> &rtncipher, vector<Ciphertext> &cipher, bool half, ThreadPool &pool) {
+  if (logn != logNh) {
+    size_t count = cipher.size();
+    vector<Ciphertext> tmpct1;
+    sfl_3_many(tmpct1, cipher, half, pool);
+    rtncipher.resize(count);
+    pool.parallel_for(count, [&](size_t b) {
+      Ciphertext tmpct2;
+      evaluator.rotate_vector(tmpct1[b], n, gal_keys, tmpct2);
+      evaluator.add_reduced_error(tmpct1[b], tmpct2, rtncipher[b]);
+    });
+    return;
+  }
+
+  size_t count = cipher.size() / 2;
+  complex<double> iunit(0.0, 1.0);
+  vector<complex<double>> tmpvec(Nh, iunit);
+  Plaintext tmpplain;
+  encoder.encode(tmpvec, cipher[count].parms_id(), 1.0, tmpplain);
+
+  vector<Ciphertext> tmpct3(count);
+  pool.parallel_for(count, [&](size_t b) {
+    Ciphertext tmpct1;
+    evaluator.multiply_plain(cipher[count + b], tmpplain, tmpct1);
+    evaluator.add_reduced_error(cipher[b], tmpct1, tmpct3[b]);
+  });
+  sfl_3_many(rtncipher, tmpct3, half, pool);
+}
+
 void Bootstrapper::coefftoslot_hoisting(Ciphertext &rtncipher, Ciphertext &cipher) {
   Ciphertext tmpct1, tmpct2, tmpct3;
   sflinv_hoisting(tmpct1, cipher);
@@ -2934,6 +2439,9 @@ void Bootstrapper::coefftoslot_full_mul_first(Ciphertext &rtncipher1, Ciphertext
   evaluator.add_reduced_error(tmpct2, tmpct4, rtncipher2);
 }
 
+// Lifts the coefficients, centered modulo q0, to every limb of the first level.
+// Each limb is filled in one branch-free pass of Barrett reductions and goes back
+// to NTT form right away, so the limbs are independent and run on stage_pool.
 void Bootstrapper::modraise_inplace(Ciphertext &cipher) {
   if (cipher.size() != 2) {
     throw invalid_argument("Ciphertexts of size 2 are supported only!");
@@ -2947,47 +2455,36 @@ void Bootstrapper::modraise_inplace(Ciphertext &cipher) {
     evaluator.transform_from_ntt_inplace(cipher);
   }
 
-  auto parms_id = context.first_parms_id();
-
-  // Make a copy of ciphertext
-  Ciphertext encrypted_copy(cipher);
+  // Only the q0 limbs of the two polynomials are read
+  auto poly_modulus_degree = cipher.poly_modulus_degree();
+  vector<uint64_t> src(cipher.data(), cipher.data() + 2 * poly_modulus_degree);
 
   // Resize to the full level.
-  cipher.resize(context, parms_id, 2);
-
-  auto ciphertext_size = cipher.size();
-  const auto &modulus = iter(context.first_context_data()->parms().coeff_modulus());
-  auto coeff_modulus_size = cipher.coeff_modulus_size();
-  auto poly_modulus_degree = cipher.poly_modulus_degree();
+  auto &context_data = *context.first_context_data();
+  cipher.resize(context, context_data.parms_id(), 2);
 
+  const auto &modulus = context_data.parms().coeff_modulus();
+  auto ntt_tables = context_data.small_ntt_tables();
   uint64_t q0 = modulus[0].value();
-  vector<uint64_t> minus_q0(coeff_modulus_size);
-  minus_q0[0] = 0;
-
-  for (size_t l = 1; l < coeff_modulus_size; l++) {
-    minus_q0[l] = modulus[l].value() - q0 % modulus[l].value();
-  }
-
-  for (size_t poly_idx = 0; poly_idx < ciphertext_size; poly_idx++) {
-    const auto &rns_poly_src = iter(encrypted_copy)[poly_idx];
-    const auto &rns_poly_dest = iter(cipher)[poly_idx];
-    const auto &poly_src_zero = rns_poly_src[0];
-
-    for (size_t j = 0; j < coeff_modulus_size; j++) {
-      const auto &poly_dest = rns_poly_dest[j];
+  uint64_t half_q0 = q0 >> 1;
+
+  stage_pool->parallel_for(modulus.size(), [&](size_t j) {
+    const Modulus &q = modulus[j];
+    uint64_t qj = q.value();
+    // A coefficient c > q0 / 2 stands for c - q0
+    uint64_t minus_q0 = qj - barrett_reduce_64(q0, q);
+    for (size_t poly_idx = 0; poly_idx < 2; poly_idx++) {
+      const uint64_t *poly_src = src.data() + poly_idx * poly_modulus_degree;
+      uint64_t *poly_dest = cipher.data(poly_idx) + j * poly_modulus_degree;
       for (size_t i = 0; i < poly_modulus_degree; i++) {
-        auto q = modulus[j].value();
-        poly_dest[i] = poly_src_zero[i] % q;
-        if (poly_src_zero[i] > (q0 >> 1)) {
-          poly_dest[i] += minus_q0[j];
-          poly_dest[i] -= (poly_dest[i] >= q) ? q : 0;
-        }
+        uint64_t c = barrett_reduce_64(poly_src[i], q);
+        c += SEAL_COND_SELECT(poly_src[i] > half_q0, minus_q0, 0);
+        poly_dest[i] = c - SEAL_COND_SELECT(c >= qj, qj, 0);
       }
+      ntt_negacyclic_harvey(CoeffIter(poly_dest), ntt_tables[j]);
     }
-  }
-
-  // Switch back to the NTT form.
-  evaluator.transform_to_ntt_inplace(cipher);
+  });
+  cipher.is_ntt_form() = true;
 }
 
 void Bootstrapper::bootstrap_sparse(Ciphertext &rtncipher, Ciphertext &cipher) {
@@ -2998,12 +2495,7 @@ void Bootstrapper::bootstrap_sparse(Ciphertext &rtncipher, Ciphertext &cipher) {
   cipher.scale() = ((double)modulus[0].value());
 
   cout << "Subsum..." << endl;
-  Ciphertext rot;
-  for (long i = logn; i < logNh; ++i) {
-    evaluator.rotate_vector(cipher, (1 << i), gal_keys, rot);
-    // evaluator.add_inplace_original(cipher, rot);
-    evaluator.add_inplace(cipher, rot);
-  }
+  subsum_inplace(cipher);
 
   Ciphertext rtn;
   if (logn == 0) {
@@ -3063,6 +2555,16 @@ void Bootstrapper::bootstrap_sparse(Ciphertext &rtncipher, Ciphertext &cipher) {
   rtncipher.scale() = final_scale;
 }
 
+// The two halves of a full-slot bootstrap go through EvalMod side by side
+void Bootstrapper::reduce_pair(Ciphertext &rtncipher1, Ciphertext &rtncipher2, Ciphertext &cipher1, Ciphertext &cipher2) {
+  stage_pool->parallel_for(2, [&](size_t k) {
+    if (k == 0)
+      mod_reducer->modular_reduction(rtncipher1, cipher1);
+    else
+      mod_reducer->modular_reduction(rtncipher2, cipher2);
+  });
+}
+
 void Bootstrapper::bootstrap_full(Ciphertext &rtncipher, Ciphertext &cipher) {
   // // for debugging
   // chrono::high_resolution_clock::time_point start, end;
@@ -3095,8 +2597,7 @@ void Bootstrapper::bootstrap_full(Ciphertext &rtncipher, Ciphertext &cipher) {
 
   cout << "Modular reduction..." << endl;
   Ciphertext modrtn1, modrtn2;
-  mod_reducer->modular_reduction(modrtn1, rtn1);
-  mod_reducer->modular_reduction(modrtn2, rtn2);
+  reduce_pair(modrtn1, modrtn2, rtn1, rtn2);
 
   // // for debugging
   // end = chrono::high_resolution_clock::now();
@@ -3139,22 +2640,22 @@ void print_ct(Ciphertext &ct, Decryptor &decryptor, CKKSEncoder &encoder) {
   cout << endl;
 }
 
-void Bootstrapper::bootstrap_sparse_3(Ciphertext &rtncipher, Ciphertext &cipher) {
-  cout << "Modulus Raising..." << endl;
+void Bootstrapper::bootstrap_sparse_3(
+    Ciphertext &rtncipher, Ciphertext &cipher, StageTimes *times, bool planned, bool verbose) {
+  StageTimes elapsed;
+  auto start = chrono::steady_clock::now();
+  if (verbose) cout << "Modulus Raising..." << endl;
   modraise_inplace(cipher);
+  elapsed.modraise = lap(start);
 
   const auto &modulus = iter(context.first_context_data()->parms().coeff_modulus());
   cipher.scale() = ((double)modulus[0].value());
 
   // print_ct(cipher, decryptor, encoder);
 
-  cout << "Subsum..." << endl;
-  Ciphertext rot;
-  for (long i = logn; i < logNh; ++i) {
-    evaluator.rotate_vector(cipher, (1 << i), gal_keys, rot);
-    // evaluator.add_inplace_original(cipher, rot);
-    evaluator.add_inplace(cipher, rot);
-  }
+  if (verbose) cout << "Subsum..." << endl;
+  subsum_inplace(cipher);
+  elapsed.subsum = lap(start);
 
   // print_ct(cipher, decryptor, encoder);
 
@@ -3176,15 +2677,20 @@ void Bootstrapper::bootstrap_sparse_3(Ciphertext &rtncipher, Ciphertext &cipher)
   }
 
   else {
-    cout << "Coefftoslot..." << endl;
-    coefftoslot_3(rtn, cipher);
+    if (verbose) cout << "Coefftoslot..." << endl;
+    if (planned)
+      coefftoslot_planned(rtn, cipher);
+    else
+      coefftoslot_3(rtn, cipher);
 
     // print_ct(rtn, decryptor, encoder);
   }
+  elapsed.coefftoslot = lap(start);
 
-  cout << "Modular reduction..." << endl;
+  if (verbose) cout << "Modular reduction..." << endl;
   Ciphertext modrtn;
   mod_reducer->modular_reduction(modrtn, rtn);
+  elapsed.evalmod = lap(start);
 
   // print_ct(modrtn, decryptor, encoder);
 
@@ -3213,37 +2719,55 @@ void Bootstrapper::bootstrap_sparse_3(Ciphertext &rtncipher, Ciphertext &cipher)
   }
 
   else {
-    cout << "Slottocoeff..." << endl;
-    slottocoeff_3(rtncipher, modrtn);
+    if (verbose) cout << "Slottocoeff..." << endl;
+    if (planned)
+      slottocoeff_planned(rtncipher, modrtn, false);
+    else
+      slottocoeff_3(rtncipher, modrtn);
 
     // print_ct(rtncipher, decryptor, encoder);
   }
+  elapsed.slottocoeff = lap(start);
   rtncipher.scale() = final_scale;
+  if (times) *times = elapsed;
 }
 
-void Bootstrapper::bootstrap_full_3(Ciphertext &rtncipher, Ciphertext &cipher) {
-  cout << "Modulus Raising..." << endl;
+void Bootstrapper::bootstrap_full_3(
+    Ciphertext &rtncipher, Ciphertext &cipher, StageTimes *times, bool planned, bool verbose) {
+  StageTimes elapsed;
+  auto start = chrono::steady_clock::now();
+  if (verbose) cout << "Modulus Raising..." << endl;
   modraise_inplace(cipher);
+  elapsed.modraise = lap(start);
 
   const auto &modulus = iter(context.first_context_data()->parms().coeff_modulus());
   cipher.scale() = ((double)modulus[0].value());
 
-  cout << "Coefftoslot..." << endl;
+  if (verbose) cout << "Coefftoslot..." << endl;
   Ciphertext rtn1, rtn2;
-  coefftoslot_full_3(rtn1, rtn2, cipher);
+  if (planned)
+    coefftoslot_full_planned(rtn1, rtn2, cipher);
+  else
+    coefftoslot_full_3(rtn1, rtn2, cipher);
+  elapsed.coefftoslot = lap(start);
 
-  cout << "Modular reduction..." << endl;
+  if (verbose) cout << "Modular reduction..." << endl;
   Ciphertext modrtn1, modrtn2;
-  mod_reducer->modular_reduction(modrtn1, rtn1);
-  mod_reducer->modular_reduction(modrtn2, rtn2);
+  reduce_pair(modrtn1, modrtn2, rtn1, rtn2);
+  elapsed.evalmod = lap(start);
 
-  cout << "Slottocoeff..." << endl;
-  slottocoeff_full_3(rtncipher, modrtn1, modrtn2);
+  if (verbose) cout << "Slottocoeff..." << endl;
+  if (planned)
+    slottocoeff_full_planned(rtncipher, modrtn1, modrtn2, false);
+  else
+    slottocoeff_full_3(rtncipher, modrtn1, modrtn2);
+  elapsed.slottocoeff = lap(start);
 
   rtncipher.scale() = final_scale;
+  if (times) *times = elapsed;
 }
 
-void Bootstrapper::bootstrap_sparse_real_3(Ciphertext &rtncipher, Ciphertext &cipher) {
+void Bootstrapper::bootstrap_sparse_half_3(Ciphertext &rtncipher, Ciphertext &cipher) {
   cout << "Modulus Raising..." << endl;
   modraise_inplace(cipher);
 
@@ -3251,12 +2775,7 @@ void Bootstrapper::bootstrap_sparse_real_3(Ciphertext &rtncipher, Ciphertext &ci
   cipher.scale() = ((double)modulus[0].value());
 
   cout << "Subsum..." << endl;
-  Ciphertext rot;
-  for (long i = logn; i < logNh; ++i) {
-    evaluator.rotate_vector(cipher, (1 << i), gal_keys, rot);
-    // evaluator.add_inplace_original(cipher, rot);
-    evaluator.add_inplace(cipher, rot);
-  }
+  subsum_inplace(cipher);
 
   Ciphertext rtn;
   if (logn == 0) {
@@ -3313,12 +2832,16 @@ void Bootstrapper::bootstrap_sparse_real_3(Ciphertext &rtncipher, Ciphertext &ci
     slottocoeff_half_3(rtncipher, modrtn);
   }
   rtncipher.scale() = final_scale;
+}
+
+void Bootstrapper::bootstrap_sparse_real_3(Ciphertext &rtncipher, Ciphertext &cipher) {
+  bootstrap_sparse_half_3(rtncipher, cipher);
   Ciphertext conjct;
   evaluator.complex_conjugate(rtncipher, gal_keys, conjct);
   evaluator.add_inplace_reduced_error(rtncipher, conjct);
 }
 
-void Bootstrapper::bootstrap_full_real_3(Ciphertext &rtncipher, Ciphertext &cipher) {
+void Bootstrapper::bootstrap_full_half_3(Ciphertext &rtncipher, Ciphertext &cipher) {
   cout << "Modulus Raising..." << endl;
   modraise_inplace(cipher);
 
@@ -3331,13 +2854,16 @@ void Bootstrapper::bootstrap_full_real_3(Ciphertext &rtncipher, Ciphertext &ciph
 
   cout << "Modular reduction..." << endl;
   Ciphertext modrtn1, modrtn2;
-  mod_reducer->modular_reduction(modrtn1, rtn1);
-  mod_reducer->modular_reduction(modrtn2, rtn2);
+  reduce_pair(modrtn1, modrtn2, rtn1, rtn2);
 
   cout << "Slottocoeff..." << endl;
   slottocoeff_full_half_3(rtncipher, modrtn1, modrtn2);
 
   rtncipher.scale() = final_scale;
+}
+
+void Bootstrapper::bootstrap_full_real_3(Ciphertext &rtncipher, Ciphertext &cipher) {
+  bootstrap_full_half_3(rtncipher, cipher);
   Ciphertext conjct;
   evaluator.complex_conjugate(rtncipher, gal_keys, conjct);
   evaluator.add_inplace_reduced_error(rtncipher, conjct);
@@ -3351,12 +2877,7 @@ void Bootstrapper::bootstrap_sparse_hoisting(Ciphertext &rtncipher, Ciphertext &
   cipher.scale() = ((double)modulus[0].value());
 
   cout << "Subsum..." << endl;
-  Ciphertext rot;
-  for (long i = logn; i < logNh; ++i) {
-    evaluator.rotate_vector(cipher, (1 << i), gal_keys, rot);
-    // evaluator.add_inplace_original(cipher, rot);
-    evaluator.add_inplace(cipher, rot);
-  }
+  subsum_inplace(cipher);
 
   Plaintext tmpplain;
 
@@ -3400,8 +2921,7 @@ void Bootstrapper::bootstrap_full_hoisting(Ciphertext &rtncipher, Ciphertext &ci
 
   cout << "Modular reduction..." << endl;
   Ciphertext modrtn1, modrtn2;
-  mod_reducer->modular_reduction(modrtn1, rtn1);
-  mod_reducer->modular_reduction(modrtn2, rtn2);
+  reduce_pair(modrtn1, modrtn2, rtn1, rtn2);
 
   cout << "Slottocoeff..." << endl;
   slottocoeff_full_hoisting(rtncipher, modrtn1, modrtn2);
@@ -3415,12 +2935,7 @@ void Bootstrapper::bootstrap_one_depth(Ciphertext &rtncipher, Ciphertext &cipher
   cipher.scale() = ((double)modulus[0].value());
 
   cout << "Subsum..." << endl;
-  Ciphertext rot;
-  for (long i = logn; i < logNh; ++i) {
-    evaluator.rotate_vector(cipher, (1 << i), gal_keys, rot);
-    // evaluator.add_inplace_original(cipher, rot);
-    evaluator.add_inplace(cipher, rot);
-  }
+  subsum_inplace(cipher);
 
   Plaintext tmpplain;
 
@@ -3465,8 +2980,7 @@ void Bootstrapper::bootstrap_more_depth(Ciphertext &rtncipher, Ciphertext &ciphe
 
   cout << "Modular reduction..." << endl;
   Ciphertext modrtn1, modrtn2;
-  mod_reducer->modular_reduction(modrtn1, rtn1);
-  mod_reducer->modular_reduction(modrtn2, rtn2);
+  reduce_pair(modrtn1, modrtn2, rtn1, rtn2);
 
   cout << "Slottocoeff..." << endl;
   slottocoeff_full_one_depth(rtncipher, modrtn1, modrtn2);
@@ -3489,9 +3003,9 @@ void Bootstrapper::bootstrap_inplace(Ciphertext &cipher) {
 void Bootstrapper::bootstrap_3(Ciphertext &rtncipher, Ciphertext &cipher) {
   initial_scale = cipher.scale();
   if (logn == logNh)
-    bootstrap_full_3(rtncipher, cipher);
+    bootstrap_full_3(rtncipher, cipher, &stage_times);
   else
-    bootstrap_sparse_3(rtncipher, cipher);
+    bootstrap_sparse_3(rtncipher, cipher, &stage_times);
 }
 
 void Bootstrapper::bootstrap_inplace_3(Ciphertext &cipher) {
@@ -3500,6 +3014,79 @@ void Bootstrapper::bootstrap_inplace_3(Ciphertext &cipher) {
   cipher = rtncipher;
 }
 
+void Bootstrapper::bootstrap_planned(Ciphertext &rtncipher, Ciphertext &cipher) {
+  initial_scale = cipher.scale();
+  if (logn == logNh)
+    bootstrap_full_3(rtncipher, cipher, &stage_times, true);
+  else
+    bootstrap_sparse_3(rtncipher, cipher, &stage_times, true);
+}
+
+void Bootstrapper::bootstrap_inplace_planned(Ciphertext &cipher) {
+  Ciphertext rtncipher;
+  bootstrap_planned(rtncipher, cipher);
+  cipher = rtncipher;
+}
+
+void Bootstrapper::check_batch(const vector<Ciphertext> &cipher) {
+  for (const auto &ct : cipher) {
+    if (ct.parms_id() != cipher[0].parms_id() || ct.scale() != cipher[0].scale()) {
+      throw invalid_argument("Ciphertexts of a batch must share their level and scale!");
+    }
+  }
+}
+
+void Bootstrapper::bootstrap_pass(vector<Ciphertext> &cipher, bool half, ThreadPool &pool) {
+  const auto &modulus = iter(context.first_context_data()->parms().coeff_modulus());
+  double mod_zero = (double)modulus[0].value();
+
+  pool.parallel_for(cipher.size(), [&](size_t b) {
+    modraise_inplace(cipher[b]);
+    cipher[b].scale() = mod_zero;
+
+    subsum_inplace(cipher[b]);
+  });
+
+  vector<Ciphertext> slots;
+  coefftoslot_3_many(slots, cipher, pool);
+
+  // In full-slot mode the real and imaginary parts reduce side by side
+  vector<Ciphertext> modrtn(slots.size());
+  pool.parallel_for(slots.size(), [&](size_t k) { mod_reducer->modular_reduction(modrtn[k], slots[k]); });
+  slots.clear();
+
+  slottocoeff_3_many(cipher, modrtn, half, pool);
+  for (auto &ct : cipher) {
+    ct.scale() = final_scale;
+  }
+}
+
+void Bootstrapper::bootstrap_many(vector<Ciphertext> &cipher, ThreadPool &pool) {
+  if (cipher.empty()) {
+    return;
+  }
+  check_batch(cipher);
+  initial_scale = cipher[0].scale();
+
+  // A single slot has no transform to share
+  if (logn == 0) {
+    pool.parallel_for(cipher.size(), [&](size_t i) {
+      Ciphertext rtncipher;
+      bootstrap_sparse_3(rtncipher, cipher[i], nullptr, false, false);
+      cipher[i] = std::move(rtncipher);
+    });
+    return;
+  }
+
+  for (size_t first = 0; first < cipher.size(); first += max_batch) {
+    size_t count = min(max_batch, cipher.size() - first);
+    vector<Ciphertext> batch(
+        make_move_iterator(cipher.begin() + first), make_move_iterator(cipher.begin() + first + count));
+    bootstrap_pass(batch, false, pool);
+    move(batch.begin(), batch.end(), cipher.begin() + first);
+  }
+}
+
 void Bootstrapper::bootstrap_real_3(Ciphertext &rtncipher, Ciphertext &cipher) {
   initial_scale = cipher.scale();
   if (logn == logNh)
@@ -3514,6 +3101,101 @@ void Bootstrapper::bootstrap_inplace_real_3(Ciphertext &cipher) {
   cipher = rtncipher;
 }
 
+// sign * i in every slot is the monomial sign * X^(N/2), which encodes exactly at
+// scale 1; the cache keeps one encoding per level instead of an FFT per call
+shared_ptr<const Plaintext> Bootstrapper::i_plain(double sign, parms_id_type parms_id) {
+  vector<complex<double>> ivec(Nh, complex<double>(0.0, sign));
+  return evaluator.plaintext_cache()->get_or_encode(
+      ivec, parms_id, 1.0, [&](Plaintext &plain) { encoder.encode(ivec, parms_id, 1.0, plain); });
+}
+
+// a + i * b; the product by i costs no level
+void Bootstrapper::pack_real_pair(Ciphertext &rtncipher, const Ciphertext &cipher_a, const Ciphertext &cipher_b) {
+  evaluator.multiply_plain(cipher_b, *i_plain(1.0, cipher_b.parms_id()), rtncipher);
+  evaluator.add_inplace(rtncipher, cipher_a);
+}
+
+// cipher holds (a + i * b) / 2, so a = z + conj(z) and b = -i * (z - conj(z))
+void Bootstrapper::unpack_real_pair(Ciphertext &rtncipher_a, Ciphertext &rtncipher_b, const Ciphertext &cipher) {
+  Ciphertext conjct, diffct;
+  evaluator.complex_conjugate(cipher, gal_keys, conjct);
+  evaluator.sub_reduced_error(cipher, conjct, diffct);
+  evaluator.add_reduced_error(cipher, conjct, rtncipher_a);
+  evaluator.multiply_plain(diffct, *i_plain(-1.0, diffct.parms_id()), rtncipher_b);
+}
+
+void Bootstrapper::bootstrap_real_pair_3(
+    Ciphertext &rtncipher_a, Ciphertext &rtncipher_b, Ciphertext &cipher_a, Ciphertext &cipher_b) {
+  if (cipher_a.parms_id() != cipher_b.parms_id() || cipher_a.scale() != cipher_b.scale()) {
+    throw invalid_argument("Ciphertexts of a pair must share their level and scale!");
+  }
+
+  // The single-slot transforms are not set up for the halving the split relies on
+  if (logn == 0) {
+    bootstrap_real_3(rtncipher_a, cipher_a);
+    bootstrap_real_3(rtncipher_b, cipher_b);
+    return;
+  }
+
+  Ciphertext packed, halfct;
+  pack_real_pair(packed, cipher_a, cipher_b);
+  initial_scale = packed.scale();
+  if (logn == logNh)
+    bootstrap_full_half_3(halfct, packed);
+  else
+    bootstrap_sparse_half_3(halfct, packed);
+  unpack_real_pair(rtncipher_a, rtncipher_b, halfct);
+}
+
+void Bootstrapper::bootstrap_inplace_real_pair_3(Ciphertext &cipher_a, Ciphertext &cipher_b) {
+  Ciphertext rtncipher_a, rtncipher_b;
+  bootstrap_real_pair_3(rtncipher_a, rtncipher_b, cipher_a, cipher_b);
+  cipher_a = rtncipher_a;
+  cipher_b = rtncipher_b;
+}
+
+void Bootstrapper::bootstrap_real_many(vector<Ciphertext> &cipher, ThreadPool &pool) {
+  if (cipher.empty()) {
+    return;
+  }
+  check_batch(cipher);
+  initial_scale = cipher[0].scale();
+
+  if (logn == 0) {
+    pool.parallel_for(cipher.size(), [&](size_t i) {
+      Ciphertext rtncipher;
+      bootstrap_sparse_real_3(rtncipher, cipher[i]);
+      cipher[i] = std::move(rtncipher);
+    });
+    return;
+  }
+
+  for (size_t first = 0; first < cipher.size(); first += 2 * max_batch) {
+    size_t count = min(2 * max_batch, cipher.size() - first);
+    vector<Ciphertext> batch((count + 1) / 2);
+    pool.parallel_for(batch.size(), [&](size_t p) {
+      size_t a = first + 2 * p;
+      if (2 * p + 1 < count)
+        pack_real_pair(batch[p], cipher[a], cipher[a + 1]);
+      else
+        batch[p] = cipher[a];
+    });
+
+    bootstrap_pass(batch, true, pool);
+
+    pool.parallel_for(batch.size(), [&](size_t p) {
+      size_t a = first + 2 * p;
+      if (2 * p + 1 < count) {
+        unpack_real_pair(cipher[a], cipher[a + 1], batch[p]);
+      } else {
+        Ciphertext conjct;
+        evaluator.complex_conjugate(batch[p], gal_keys, conjct);
+        evaluator.add_reduced_error(batch[p], conjct, cipher[a]);
+      }
+    });
+  }
+}
+
 void Bootstrapper::bootstrap_hoisting(Ciphertext &rtncipher, Ciphertext &cipher) {
   if (logn == logNh)
     bootstrap_full_hoisting(rtncipher, cipher);
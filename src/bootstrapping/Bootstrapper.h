@@ -1,17 +1,68 @@
 #pragma once
 
+#include <chrono>
 #include <cmath>
 #include <complex>
 #include <fstream>
 #include <iostream>
 
 #include "ModularReducer.h"
+#include "rotation_keys.h"
+#include "thread_pool.h"
 // #include "ScaleInvEvaluator.h"
 
 using namespace std;
 using namespace seal;
 using namespace seal::util;
 
+// The diagonals of one BSGS transform in a single buffer. Each diagonal keeps
+// only its shortest period, which rotation() repeats over the slots as it
+// encodes; the diagonals of the first SlotToCoeff levels repeat every few slots.
+class DiagonalStore {
+ public:
+  DiagonalStore() = default;
+  // The diagonals must share one power-of-two length
+  explicit DiagonalStore(const vector<vector<complex<double>>> &diags);
+
+  size_t size() const {
+    return offsets.size();
+  }
+  size_t period(size_t i) const {
+    return periods[i];
+  }
+  // Length of the diagonals the store was built from
+  size_t length() const {
+    return len;
+  }
+  // The periods of all diagonals back to back, e.g. to rescale them in place
+  vector<complex<double>> &values() {
+    return data;
+  }
+
+  // Diagonal i as rotation() lays it out: repeated every 2^logslot of the Nh
+  // slots and rotated left by shiftcount
+  void rotation(size_t i, int logslot, int Nh, int shiftcount, vector<complex<double>> &rtnvec) const;
+
+  void save(ostream &stream) const;
+  void load(istream &stream);
+
+ private:
+  size_t len = 0;
+  vector<complex<double>> data;
+  vector<size_t> offsets, periods;
+};
+
+// One BSGS transform of a planned LT: butterfly levels [first, first + depth)
+// merged into diagonals rotating by multiples of basicstep
+struct LTStage {
+  int first;
+  int depth;
+  int totlen;
+  int basicstep;
+  bool rotated;
+  DiagonalStore coeff;
+};
+
 class Bootstrapper {
  public:
   long loge;
@@ -41,14 +92,41 @@ class Bootstrapper {
   vector<long> slot_vec;
   long slot_index = 0;
   vector<vector<vector<vector<complex<double>>>>> orig_coeffvec, orig_invcoeffvec;
-  vector<vector<vector<complex<double>>>> fftcoeff1, fftcoeff2, fftcoeff3;
-  vector<vector<vector<complex<double>>>> invfftcoeff1, invfftcoeff2, invfftcoeff3;
+  vector<DiagonalStore> fftcoeff1, fftcoeff2, fftcoeff3;
+  vector<DiagonalStore> invfftcoeff1, invfftcoeff2, invfftcoeff3;
 
   vector<Plaintext> fftcoeff_plain1, fftcoeff_plain2, invfftcoeff_plain1, invfftcoeff_plain2;
   vector<RNSIter> fftcoeff_iter1, fftcoeff_iter2, invfftcoeff_iter1, invfftcoeff_iter2;
 
   ModularReducer *mod_reducer;
 
+  // Ciphertexts bootstrap_many carries through one pass of the pipeline; the baby
+  // steps of a linear transform hold this many times its giant step in ciphertexts
+  size_t max_batch = 16;
+
+  // Pool over which a single bootstrap runs its independent pieces: the baby and
+  // giant steps of the BSGS transforms and, in full-slot mode, the two EvalMods.
+  // A one-thread pool keeps them serial.
+  ThreadPool *stage_pool = &ThreadPool::shared();
+
+  // Level budgets of the planned CoeffToSlot and SlotToCoeff, and the cost of one
+  // rotation in plaintext products by which the planner splits them
+  long cts_levels = 3;
+  long stc_levels = 3;
+  double rotation_cost = 8.0;
+
+  // Rotations the subsum hoists together: subsum_radix - 1 per group, at the cost
+  // of a Galois key for every multiple of the group's stride. 2 keeps the plain
+  // ladder of powers of two.
+  long subsum_radix = 4;
+
+  // Seconds each stage of the last bootstrap_3 or bootstrap_planned took; the
+  // subsum stays 0 in full-slot mode. The concurrent batches never write it.
+  struct StageTimes {
+    double modraise = 0, subsum = 0, coefftoslot = 0, evalmod = 0, slottocoeff = 0;
+  } stage_times;
+  vector<vector<LTStage>> fftstages, invfftstages;
+
   Bootstrapper(
       long _loge,
       long _logn,
@@ -77,6 +155,10 @@ class Bootstrapper {
   // Add rotation keys needed in bootstrapping (private function)
   void addLeftRotKeys_Linear_to_vector(vector<int> &gal_steps_vector);
   void addLeftRotKeys_Linear_to_vector_3(vector<int> &gal_steps_vector);
+  void addLeftRotKeys_Linear_to_vector_planned(vector<int> &gal_steps_vector);
+  // The conjugation (step 0) and the subsum ladder, which also covers the final
+  // rotation by n of the sparse SlotToCoeff
+  void addLeftRotKeys_Subsum_to_vector(vector<int> &gal_steps_vector);
 
   void addLeftRotKeys_Linear_to_vector_other_slots(vector<int> &gal_steps_vector, long other_logn);
   void addLeftRotKeys_Linear_to_vector_3_other_slots(vector<int> &gal_steps_vector, long other_logn);
@@ -87,6 +169,9 @@ class Bootstrapper {
   // Add rotation keys needed in bootstrapping (public function)
   void addBootKeys(GaloisKeys &gal_keys);
   void addBootKeys_3(GaloisKeys &gal_keys);
+  // Only the rotations bootstrap_planned performs, generated on stage_pool; with
+  // max_keys set, the LT steps that exceed it are composed from fewer base keys
+  void addBootKeys_planned(GaloisKeys &gal_keys, size_t max_keys = 0);
   void addBootKeys_other_keys(GaloisKeys &gal_keys, vector<int> &other_keys);
   void addBootKeys_3_other_keys(GaloisKeys &gal_keys, vector<int> &other_keys);
 
@@ -98,12 +183,19 @@ class Bootstrapper {
   void addBootKeys_one_depth(GaloisKeys &gal_keys);
   void addBootKeys_one_depth_more_depth(GaloisKeys &gal_keys);
 
+  // Switches the bootstraps to 2^new_logn slots, generating the LT coefficients
+  // and Galois keys of a slot count on its first use. Not safe while another
+  // thread bootstraps with this Bootstrapper.
   void change_logn(long new_logn);
 
   // Prepare the FFT coefficients
   void genorigcoeff();
+  void genorigcoeff(int u);
+  void release_origcoeff();
   void merge_coeff(vector<vector<complex<double>>> merged_coeff, vector<vector<vector<complex<double>>>> orig_coeff);
   void rotated_merge_coeff(complex<double> **merged_coeff, complex<double> ***orig_coeff);
+  void merge_fft_levels(
+      vector<vector<complex<double>>> &coeff, int u, int first, int depth, bool inverse, bool rotated, int len);
   void genfftcoeff_one_depth();
   void genfftcoeff_full_one_depth();
   void geninvfftcoeff_one_depth();
@@ -115,27 +207,55 @@ class Bootstrapper {
   void geninvfftcoeff_full();
 
   void genfftcoeff_3();
+  void genfftcoeff_3(int u);
   void genfftcoeff_full_3();
   void geninvfftcoeff_3();
+  void geninvfftcoeff_3(int u);
   void geninvfftcoeff_full_3();
   void generate_LT_coefficient();
   void generate_LT_coefficient_3();
 
+  // LTs planned for cts_levels and stc_levels
+  double bsgs_cost(int totlen, bool rotated);
+  vector<LTStage> plan_linear_transform(long curr_logn, long levels, bool inverse);
+  void generate_LT_coefficient_planned();
+  void generate_LT_coefficient_planned(int u);
+
+  // The generated LT diagonals of every slot count, so that later runs with the
+  // same slot_vec, cts_levels and stc_levels can load them instead
+  void save_LT_coefficient(ostream &stream) const;
+  void load_LT_coefficient(istream &stream);
+
   // Prepare the approximate polynomial
   void prepare_mod_polynomial();
 
   void subsum(double scale, Ciphertext &cipher);
+  vector<vector<int>> subsum_groups();
+  void subsum_inplace(Ciphertext &cipher);
 
   void bsgs_linear_transform(
-      Ciphertext &rtncipher, Ciphertext &cipher, int totlen, int basicstep, int coeff_logn, const vector<vector<complex<double>>> &fftcoeff);
+      Ciphertext &rtncipher, Ciphertext &cipher, int totlen, int basicstep, int coeff_logn, const DiagonalStore &fftcoeff);
   void rotated_bsgs_linear_transform(
-      Ciphertext &rtncipher, Ciphertext &cipher, int totlen, int basicstep, int coeff_logn, const vector<vector<complex<double>>> &fftcoeff);
-  void rotated_nobsgs_linear_transform(Ciphertext &rtncipher, Ciphertext &cipher, int totlen, int coeff_logn, vector<vector<complex<double>>> fftcoeff);
+      Ciphertext &rtncipher, Ciphertext &cipher, int totlen, int basicstep, int coeff_logn, const DiagonalStore &fftcoeff);
+  void rotated_nobsgs_linear_transform(Ciphertext &rtncipher, Ciphertext &cipher, int totlen, int coeff_logn, const DiagonalStore &fftcoeff);
+
+  // Batched transforms: every diagonal is encoded once and applied to the whole
+  // batch, which must share its level and scale
+  void bsgs_linear_transform_many(
+      vector<Ciphertext> &rtncipher, vector<Ciphertext> &cipher, int totlen, int basicstep, int coeff_logn,
+      const DiagonalStore &fftcoeff, int gs, int basicstart, int giantfirst, int giantlast,
+      int coeff_offset, ThreadPool &pool);
+  void bsgs_linear_transform_many(
+      vector<Ciphertext> &rtncipher, vector<Ciphertext> &cipher, int totlen, int basicstep, int coeff_logn,
+      const DiagonalStore &fftcoeff, ThreadPool &pool);
+  void rotated_bsgs_linear_transform_many(
+      vector<Ciphertext> &rtncipher, vector<Ciphertext> &cipher, int totlen, int basicstep, int coeff_logn,
+      const DiagonalStore &fftcoeff, ThreadPool &pool);
 
   void bsgs_linear_transform_hoisting(
-      Ciphertext &rtncipher, Ciphertext &cipher, int totlen, int basicstep, int coeff_logn, vector<vector<complex<double>>> fftcoeff);
+      Ciphertext &rtncipher, Ciphertext &cipher, int totlen, int basicstep, int coeff_logn, const DiagonalStore &fftcoeff);
   void rotated_bsgs_linear_transform_hoisting(
-      Ciphertext &rtncipher, Ciphertext &cipher, int totlen, int basicstep, int coeff_logn, vector<vector<complex<double>>> fftcoeff);
+      Ciphertext &rtncipher, Ciphertext &cipher, int totlen, int basicstep, int coeff_logn, const DiagonalStore &fftcoeff);
 
   void sfl_one_depth(Ciphertext &rtncipher, Ciphertext &cipher);
   void sfl_full_one_depth(Ciphertext &rtncipher, Ciphertext &cipher);
@@ -154,6 +274,16 @@ class Bootstrapper {
   void sflinv_3(Ciphertext &rtncipher, Ciphertext &cipher);
   void sflinv_full_3(Ciphertext &rtncipher, Ciphertext &cipher);
 
+  // sfl_3/sfl_full_3 and sflinv_3/sflinv_full_3 over a batch, by logn == logNh;
+  // half gives sfl_half_3/sfl_full_half_3 instead
+  void sfl_3_many(vector<Ciphertext> &rtncipher, vector<Ciphertext> &cipher, bool half, ThreadPool &pool);
+  void sflinv_3_many(vector<Ciphertext> &rtncipher, vector<Ciphertext> &cipher, ThreadPool &pool);
+
+  void planned_linear_transform(
+      Ciphertext &rtncipher, Ciphertext &cipher, const LTStage &stage, const DiagonalStore &coeff);
+  void sfl_planned(Ciphertext &rtncipher, Ciphertext &cipher, bool half = false);
+  void sflinv_planned(Ciphertext &rtncipher, Ciphertext &cipher);
+
   void sfl_hoisting(Ciphertext &rtncipher, Ciphertext &cipher);
   void sfl_full_hoisting(Ciphertext &rtncipher, Ciphertext &cipher);
   void sflinv_hoisting(Ciphertext &rtncipher, Ciphertext &cipher);
@@ -174,6 +304,17 @@ class Bootstrapper {
   void coefftoslot_full_3(Ciphertext &rtncipher1, Ciphertext &rtncipher2, Ciphertext &cipher);
   void slottocoeff_full_3(Ciphertext &rtncipher, Ciphertext &cipher1, Ciphertext &cipher2);
   void slottocoeff_full_half_3(Ciphertext &rtncipher, Ciphertext &cipher1, Ciphertext &cipher2);
+
+  // In full-slot mode coefftoslot_3_many returns the real parts of the batch
+  // followed by its imaginary parts, which slottocoeff_3_many expects back
+  void coefftoslot_3_many(vector<Ciphertext> &rtncipher, vector<Ciphertext> &cipher, ThreadPool &pool);
+  void slottocoeff_3_many(vector<Ciphertext> &rtncipher, vector<Ciphertext> &cipher, bool half, ThreadPool &pool);
+  // planned LT
+  void coefftoslot_planned(Ciphertext &rtncipher, Ciphertext &cipher);
+  void slottocoeff_planned(Ciphertext &rtncipher, Ciphertext &cipher, bool half = false);
+  void coefftoslot_full_planned(Ciphertext &rtncipher1, Ciphertext &rtncipher2, Ciphertext &cipher);
+  void slottocoeff_full_planned(Ciphertext &rtncipher, Ciphertext &cipher1, Ciphertext &cipher2, bool half = false);
+
   // original bootstrapping hoisting version
   void coefftoslot_hoisting(Ciphertext &rtncipher, Ciphertext &cipher);
   void slottocoeff_hoisting(Ciphertext &rtncipher, Ciphertext &cipher);
@@ -196,10 +337,21 @@ class Bootstrapper {
   // API bootstrapping
   void bootstrap_sparse(Ciphertext &rtncipher, Ciphertext &cipher);
   void bootstrap_full(Ciphertext &rtncipher, Ciphertext &cipher);
-
-  void bootstrap_sparse_3(Ciphertext &rtncipher, Ciphertext &cipher);
-  void bootstrap_full_3(Ciphertext &rtncipher, Ciphertext &cipher);
-
+  // EvalMod of the two CoeffToSlot halves of the full-slot bootstraps, on stage_pool
+  void reduce_pair(Ciphertext &rtncipher1, Ciphertext &rtncipher2, Ciphertext &cipher1, Ciphertext &cipher2);
+
+  // Given times, the stages are timed into it. With verbose, each stage is reported
+  // on cout; bootstrap_many, which runs them concurrently, turns it off. With
+  // planned, the LTs are those of generate_LT_coefficient_planned.
+  void bootstrap_sparse_3(
+      Ciphertext &rtncipher, Ciphertext &cipher, StageTimes *times = nullptr, bool planned = false, bool verbose = true);
+  void bootstrap_full_3(
+      Ciphertext &rtncipher, Ciphertext &cipher, StageTimes *times = nullptr, bool planned = false, bool verbose = true);
+
+  // The _half_3 variants return half of the bootstrapped complex slots, which the
+  // _real_3 variants and the real pairs below add to their conjugate
+  void bootstrap_sparse_half_3(Ciphertext &rtncipher, Ciphertext &cipher);
+  void bootstrap_full_half_3(Ciphertext &rtncipher, Ciphertext &cipher);
   void bootstrap_sparse_real_3(Ciphertext &rtncipher, Ciphertext &cipher);
   void bootstrap_full_real_3(Ciphertext &rtncipher, Ciphertext &cipher);
 
@@ -212,10 +364,32 @@ class Bootstrapper {
 
   void bootstrap_3(Ciphertext &rtncipher, Ciphertext &cipher);
   void bootstrap_inplace_3(Ciphertext &cipher);
+  // bootstrap_inplace_3 for every ciphertext, which must share one level and
+  // scale. The pipeline runs stage by stage over up to max_batch ciphertexts, so
+  // each stage spreads over the pool and the LT diagonals are encoded once per pass.
+  void bootstrap_many(vector<Ciphertext> &cipher, ThreadPool &pool = ThreadPool::shared());
+  void check_batch(const vector<Ciphertext> &cipher);
+  // One pass of bootstrap_many, with the SlotToCoeff of the _half_3 variants if half
+  void bootstrap_pass(vector<Ciphertext> &cipher, bool half, ThreadPool &pool);
+
+  // bootstrap_3 with the LTs of generate_LT_coefficient_planned, which trade levels
+  // for rotations through cts_levels and stc_levels
+  void bootstrap_planned(Ciphertext &rtncipher, Ciphertext &cipher);
+  void bootstrap_inplace_planned(Ciphertext &cipher);
 
   void bootstrap_real_3(Ciphertext &rtncipher, Ciphertext &cipher);
   void bootstrap_inplace_real_3(Ciphertext &cipher);
 
+  // Two real-valued ciphertexts refreshed by one bootstrap of a + i * b, split
+  // again with a conjugation. Both must share their level and scale.
+  shared_ptr<const Plaintext> i_plain(double sign, parms_id_type parms_id);
+  void pack_real_pair(Ciphertext &rtncipher, const Ciphertext &cipher_a, const Ciphertext &cipher_b);
+  void unpack_real_pair(Ciphertext &rtncipher_a, Ciphertext &rtncipher_b, const Ciphertext &cipher);
+  void bootstrap_real_pair_3(Ciphertext &rtncipher_a, Ciphertext &rtncipher_b, Ciphertext &cipher_a, Ciphertext &cipher_b);
+  void bootstrap_inplace_real_pair_3(Ciphertext &cipher_a, Ciphertext &cipher_b);
+  // bootstrap_many for real-valued ciphertexts, which it bootstraps in pairs
+  void bootstrap_real_many(vector<Ciphertext> &cipher, ThreadPool &pool = ThreadPool::shared());
+
   void bootstrap_hoisting(Ciphertext &rtncipher, Ciphertext &cipher);
   void bootstrap_inplace_hoisting(Ciphertext &cipher);
 };
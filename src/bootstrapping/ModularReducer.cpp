@@ -60,7 +60,7 @@ void ModularReducer::modular_reduction(Ciphertext &rtn, Ciphertext &cipher) {
   Plaintext tmpplain;
   tmp1 = cipher;
 
-  sin_cos_polynomial.homomorphic_poly_evaluation(context, encoder, encryptor, evaluator, relin_keys, tmp2, tmp1, decryptor);
+  sin_cos_polynomial.homomorphic_poly_evaluation(context, evaluator, relin_keys, tmp2, tmp1);
 
   if (inverse_deg == 1) {
     double curr_scale = scale_inverse_coeff;
@@ -73,6 +73,6 @@ void ModularReducer::modular_reduction(Ciphertext &rtn, Ciphertext &cipher) {
 
   else {
     for (int i = 0; i < num_double_formula; i++) double_angle_formula(tmp2);
-    inverse_sin_polynomial.homomorphic_poly_evaluation(context, encoder, encryptor, evaluator, relin_keys, rtn, tmp2, decryptor);
+    inverse_sin_polynomial.homomorphic_poly_evaluation(context, evaluator, relin_keys, rtn, tmp2);
   }
 }
@@ -0,0 +1,8 @@
+#pragma once
+
+// Depth and nonscalar multiplication counts of odd minimax polynomials, kept
+// apart from MinicompFunc so that tools without NTL can use them
+namespace minicomp {
+int dep(int deg);
+int mult(int deg);
+}  // namespace minicomp
@@ -88,17 +88,6 @@ int dep(list<int> &lt) {
   for (iter = lt.begin(); iter != lt.end(); iter++) tot_depth += d[((*iter) - 1) / 2];
   return tot_depth;
 }
-int dep(int deg)  // only odd degrees
-{
-  int d[32] = {0, 2, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 5, 5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6};  // deg: 1,3,5,7,...,63
-  return d[(deg - 1) / 2];
-}
-int mult(int deg)  // only odd degrees
-{
-  //	int m[16]={0,2,3,4,4,5,6,7,7,8,8,8,10,10,10,10};
-  int m[32] = {0, 2, 3, 5, 5, 6, 7, 8, 8, 8, 9, 9, 10, 10, 11, 12, 11, 11, 11, 11, 12, 12, 13, 13, 14, 14, 14, 14, 15, 15, 16, 17};  // deg: 1,3,5,7,...,63
-  return m[(deg - 1) / 2];
-}
 
 RR exptoreal(RR x) {
   if (x < 0)
@@ -10,6 +10,7 @@
 #include<list>
 #include<vector>
 #include"Point.h"
+#include"MinicompCost.h"
 
 using namespace std;
 using namespace seal;
@@ -29,8 +30,6 @@ namespace minicomp
 	RR GetInvApproxError(int d, RR t, vector<RR> &X, vector<RR> &Y, long num);
 	RR real(RR p);
 	int dep(list<int> &lt);
-	int dep(int deg);
-	int mult(int deg);
 	int enough_mult(int a);
 	int enough_dep(int a);
 	RR exptoreal(RR x);
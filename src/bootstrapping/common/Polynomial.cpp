@@ -202,6 +202,8 @@ void Polynomial::generate_poly_heap_manual(long k, long m) {
       }
     }
   }
+
+  compile_heap_plan();
 }
 
 void Polynomial::generate_poly_heap_odd() {
@@ -249,10 +251,34 @@ void Polynomial::read_heap_from_file(ifstream &in) {
   }
 
   copy(*poly_heap[0]);
+
+  // The root is split by T_{k 2^(m-1)}, so its quotient gives k back
+  heap_m = static_cast<long>(log2(heaplen + 1)) - 1;
+  if (heap_m > 0 && poly_heap[1]) {
+    heap_k = (poly_heap[0]->deg - poly_heap[1]->deg) >> (heap_m - 1);
+  }
+  compile_heap_plan();
+}
+
+void Polynomial::compile_heap_plan() {
+  leaf_terms.assign(heaplen, {});
+  leaf_constants.assign(heaplen, 0.0);
+  for (long i = (1 << heap_m) - 1; i < heaplen; i++) {
+    if (!poly_heap[i]) continue;
+    if (poly_heap[i]->deg > heap_k) {
+      throw invalid_argument("Heap leaves must have degree at most heap_k!");
+    }
+
+    leaf_constants[i] = to_double(poly_heap[i]->chebcoeff[0]);
+    for (long j = 1; j <= poly_heap[i]->deg; j++) {
+      double c = to_double(poly_heap[i]->chebcoeff[j]);
+      if (c != 0) leaf_terms[i].emplace_back(j, c);
+    }
+  }
 }
 
 // void Polynomial::homomorphic_poly_evaluation(SEALContext &context, CKKSEncoder &encoder, Encryptor &encryptor, ScaleInvEvaluator &evaluator, RelinKeys &relin_keys, Ciphertext &rtn, Ciphertext &cipher, Decryptor &decryptor) {
-void Polynomial::homomorphic_poly_evaluation(SEALContext &context, CKKSEncoder &encoder, Encryptor &encryptor, Evaluator &evaluator, RelinKeys &relin_keys, Ciphertext &rtn, Ciphertext &cipher, Decryptor &decryptor) {
+void Polynomial::homomorphic_poly_evaluation(SEALContext &context, Evaluator &evaluator, RelinKeys &relin_keys, Ciphertext &rtn, Ciphertext &cipher, ThreadPool &pool) {
   double zero = 1. / cipher.scale();
   if (deg == 1) {
     // evaluator.multiply_const_scaleinv(cipher, to_double(coeff[1]), rtn);
@@ -320,188 +346,7 @@ void Polynomial::homomorphic_poly_evaluation(SEALContext &context, CKKSEncoder &
   }
 
   else {
-    vector<Ciphertext> baby(heap_k, Ciphertext());
-    vector<bool> babybool(heap_k, false);
-    // Ciphertext** baby = new Ciphertext*[heap_k];
-    Ciphertext addtmp1, addtmp2;
-
-    Plaintext tmpplain;
-
-    // for (int i = 0; i < heap_k; i++) {
-    //     baby[i] = 0;
-    // }
-    // baby[1] = new Ciphertext();
-    baby[1] = cipher;
-    babybool[1] = true;
-
-    for (int i = 2; i < heap_k; i *= 2) {
-      // baby[i] = new Ciphertext();
-
-      evaluator.square(baby[i / 2], baby[i]);
-      evaluator.relinearize_inplace(baby[i], relin_keys);
-      evaluator.rescale_to_next_inplace(baby[i]);
-      evaluator.double_inplace(baby[i]);
-
-      evaluator.add_const(baby[i], -1.0, baby[i]);
-      babybool[i] = true;
-    }
-
-    long lpow2, res, diff;
-    Ciphertext tmp;
-
-    for (int i = 1; i < heap_k; i++) {
-      if (!babybool[i]) {
-        lpow2 = (1 << (int)floor(log(i) / log(2)));
-        res = i - lpow2;
-        diff = abs(lpow2 - res);
-
-        // baby[i] = new Ciphertext();
-
-        // evaluator.multiply_scaleinv(baby[lpow2], baby[res], baby[i]);
-        evaluator.multiply_reduced_error(baby[lpow2], baby[res], relin_keys, baby[i]);
-        evaluator.rescale_to_next_inplace(baby[i]);
-        evaluator.double_inplace(baby[i]);
-
-        evaluator.sub_reduced_error(baby[i], baby[diff], baby[i]);
-        babybool[i] = true;
-      }
-    }
-
-    vector<Ciphertext> giant(heap_m, Ciphertext());
-    vector<bool> giantbool(heap_m, false);
-    // Ciphertext** giant = new Ciphertext*[heap_m];
-    giantbool[0] = true;
-    // giant[0] = new Ciphertext();
-    lpow2 = (1 << ((int)ceil(log(heap_k) / log(2)) - 1));
-    res = heap_k - lpow2;
-    diff = abs(lpow2 - res);
-
-    if (res == 0) {
-      giant[0] = baby[lpow2];
-    }
-
-    else if (diff == 0) {
-      evaluator.square(baby[lpow2], giant[0]);
-      evaluator.relinearize_inplace(giant[0], relin_keys);
-      evaluator.rescale_to_next_inplace(giant[0]);
-      evaluator.double_inplace(giant[0]);
-      evaluator.add_const(giant[0], -1.0, giant[0]);
-    }
-
-    else {
-      // evaluator.multiply_scaleinv(baby[lpow2], baby[res], giant[0]);
-      evaluator.multiply_reduced_error(baby[lpow2], baby[res], relin_keys, giant[0]);
-      evaluator.rescale_to_next_inplace(giant[0]);
-      evaluator.double_inplace(giant[0]);
-      evaluator.sub_reduced_error(giant[0], baby[diff], giant[0]);
-    }
-
-    // if(heap_k%4 == 0){
-    //     size_t i0 = heap_k/2 +1, i1 = heap_k - i0;
-    //     evaluator.multiply(*baby[i0], *baby[i1], *giant[0]);
-    //     evaluator.double_inplace(*giant[0]);
-    //     evaluator.sub(*giant[0], *baby[2], *giant[0]);
-    // }
-    // else{
-    //     evaluator.square(*baby[heap_k/2], *giant[0]);
-    //     evaluator.double_inplace(*giant[0]);
-    //     evaluator.add_const(*giant[0], -1.0, *giant[0]);
-    // }
-
-    for (int i = 1; i < heap_m; i++) {
-      // giant[i] = new Ciphertext();
-      giantbool[i] = true;
-
-      evaluator.square(giant[i - 1], giant[i]);
-      evaluator.relinearize_inplace(giant[i], relin_keys);
-      evaluator.rescale_to_next_inplace(giant[i]);
-      evaluator.double_inplace(giant[i]);
-
-      evaluator.add_const_inplace(giant[i], -1.0);
-    }
-
-    vector<Ciphertext> cipherheap((1 << (heap_m + 1)) - 1, Ciphertext());
-    vector<bool> cipherheapbool((1 << (heap_m + 1)) - 1, false);
-    // Ciphertext** cipherheap = new Ciphertext*[(1 << (heap_m + 1)) - 1];
-    // for (int i = 0; i < (1 << (heap_m + 1)) - 1; i++) {
-    //     cipherheap[i] = 0;
-    // }
-
-    long heapfirst = (1 << heap_m) - 1;
-    long heaplast = (1 << (heap_m + 1)) - 1;
-    double zero = 1. / cipher.scale();
-    for (int i = heapfirst; i < heaplast; i++) {
-      if (poly_heap[i]) {
-        // cipherheap[i] = new Ciphertext();
-        cipherheapbool[i] = true;
-
-        // evaluator.multiply_const_scaleinv(baby[1], to_double(poly_heap[i]->chebcoeff[1]), cipherheap[i]);
-        evaluator.multiply_const(baby[1], to_double(poly_heap[i]->chebcoeff[1]), cipherheap[i]);
-        evaluator.rescale_to_next_inplace(cipherheap[i]);
-
-        if (!(abs(to_double(poly_heap[i]->chebcoeff[1])) <= zero))
-          evaluator.add_const_inplace(cipherheap[i], to_double(poly_heap[i]->chebcoeff[0]));
-
-        for (int j = 2; j <= poly_heap[i]->deg; j++) {
-          if (abs(to_double(poly_heap[i]->chebcoeff[j])) <= zero)
-            continue;
-
-          if (j < heap_k) {
-            // evaluator.multiply_const_scaleinv(baby[j], to_double(poly_heap[i]->chebcoeff[j]), tmp);
-            evaluator.multiply_const(baby[j], to_double(poly_heap[i]->chebcoeff[j]), tmp);
-            evaluator.rescale_to_next_inplace(tmp);
-          } else {
-            // evaluator.multiply_const_scaleinv(giant[0], to_double(poly_heap[i]->chebcoeff[j]), tmp);
-            evaluator.multiply_const(giant[0], to_double(poly_heap[i]->chebcoeff[j]), tmp);
-            evaluator.rescale_to_next_inplace(tmp);
-          }
-
-          evaluator.add_reduced_error(cipherheap[i], tmp, cipherheap[i]);
-        }
-      }
-    }
-    long depth = heap_m;
-    long gindex = 0;
-
-    while (depth != 0) {
-      depth--;
-      heapfirst = (1 << depth) - 1;
-      heaplast = (1 << (depth + 1)) - 1;
-      for (int i = heapfirst; i < heaplast; i++) {
-        if (poly_heap[i]) {
-          // cipherheap[i] = new Ciphertext();
-          cipherheapbool[i] = true;
-          if (!cipherheapbool[2 * (i + 1) - 1]) {
-            cipherheap[i] = cipherheap[2 * (i + 1)];
-          } else {
-            // evaluator.multiply_scaleinv(cipherheap[2 * (i + 1) - 1], giant[gindex], cipherheap[i]);
-            evaluator.multiply_reduced_error(cipherheap[2 * (i + 1) - 1], giant[gindex], relin_keys, cipherheap[i]);
-            evaluator.rescale_to_next_inplace(cipherheap[i]);
-            evaluator.add_reduced_error(cipherheap[i], cipherheap[2 * (i + 1)], cipherheap[i]);
-          }
-        }
-      }
-      gindex++;
-    }
-
-    rtn = cipherheap[0];
-    // for (int i = 0; i < heap_k; i++) {
-    //     delete baby[i];
-    // }
-    //
-    // delete[] baby;
-    //
-    // for (int i = 0; i < heap_m; i++) {
-    //     delete giant[i];
-    // }
-    //
-    // delete[] giant;
-    //
-    // for (int i = 0; i < (1 << (heap_m + 1)) - 1; i++) {
-    //     delete cipherheap[i];
-    // }
-    //
-    // delete[] cipherheap;
+    evaluate_heap(context, evaluator, relin_keys, rtn, cipher, pool);
   }
 
   // Ciphertext** baby;
@@ -833,6 +678,164 @@ void Polynomial::homomorphic_poly_evaluation(SEALContext &context, CKKSEncoder &
   // }
 }
 
+namespace {
+// T_{a+b} = 2 T_a T_b - T_{|a-b|}, with T_0 = 1 when a = b. The difference term
+// is brought to the scale of the product before the single rescale
+void chebyshev_product(Evaluator &evaluator, RelinKeys &relin_keys, const Ciphertext &ta, const Ciphertext &tb, const Ciphertext *tdiff, Ciphertext &dest) {
+  if (&ta == &tb) {
+    evaluator.square(ta, dest);
+  } else if (ta.parms_id() == tb.parms_id()) {
+    evaluator.multiply(ta, tb, dest);
+  } else {
+    const Ciphertext &low = ta.coeff_modulus_size() < tb.coeff_modulus_size() ? ta : tb;
+    const Ciphertext &high = &low == &ta ? tb : ta;
+    Ciphertext switched;
+    evaluator.mod_switch_to(high, low.parms_id(), switched);
+    evaluator.multiply(low, switched, dest);
+  }
+  evaluator.relinearize_inplace(dest, relin_keys);
+  evaluator.double_inplace(dest);
+
+  if (tdiff) {
+    Ciphertext term;
+    evaluator.mod_switch_to(*tdiff, dest.parms_id(), term);
+    evaluator.multiply_const_inplace(term, 1.0, dest.scale() / term.scale());
+    term.scale() = dest.scale();
+    evaluator.sub_inplace(dest, term);
+  } else {
+    evaluator.add_const_inplace(dest, -1.0);
+  }
+  evaluator.rescale_to_next_inplace(dest);
+}
+}  // namespace
+
+void Polynomial::evaluate_heap(SEALContext &context, Evaluator &evaluator, RelinKeys &relin_keys, Ciphertext &rtn, const Ciphertext &cipher, ThreadPool &pool) {
+  vector<parms_id_type> level_parms(context.first_context_data()->chain_index() + 1);
+  for (auto data = context.first_context_data(); data; data = data->next_context_data()) {
+    level_parms[data->chain_index()] = data->parms_id();
+  }
+  auto level = [&](const Ciphertext &ct) { return static_cast<long>(context.get_context_data(ct.parms_id())->chain_index()); };
+  // The prime a rescale from level l divides by
+  auto last_prime = [&](long l) { return static_cast<double>(context.get_context_data(level_parms[l])->parms().coeff_modulus().back().value()); };
+
+  // Chebyshev basis T_1, ..., T_k, once per input. Round lo builds the T_i with
+  // lo < i <= 2 lo from earlier rounds only, so its products run in parallel
+  vector<Ciphertext> baby(heap_k + 1);
+  baby[1] = cipher;
+  for (long lo = 1; lo < heap_k; lo *= 2) {
+    long hi = min(2 * lo, heap_k);
+    pool.parallel_for(hi - lo, [&](size_t t) {
+      long i = lo + 1 + t, res = i - lo, diff = lo - res;
+      chebyshev_product(evaluator, relin_keys, baby[lo], baby[res], diff ? &baby[diff] : nullptr, baby[i]);
+    });
+  }
+
+  // giant[g] = T_{k 2^g} splits the nodes at depth heap_m - 1 - g
+  vector<Ciphertext> giant(max(heap_m, 1L));
+  giant[0] = baby[heap_k];
+  for (long g = 1; g < heap_m; g++) {
+    chebyshev_product(evaluator, relin_keys, giant[g - 1], giant[g - 1], nullptr, giant[g]);
+  }
+  auto giant_of = [&](long i) -> const Ciphertext & { return giant[heap_m - 1 - static_cast<long>(log2(i + 1))]; };
+
+  // Highest level each node can be produced at, bottom-up
+  long leaffirst = (1 << heap_m) - 1;
+  double zero = 1. / cipher.scale();
+  vector<long> top(heaplen, 0);
+  for (long i = heaplen - 1; i >= 0; i--) {
+    if (!poly_heap[i]) continue;
+    if (i >= leaffirst) {
+      top[i] = level(baby[1]);
+      for (auto &[j, c] : leaf_terms[i]) {
+        if (abs(c) > zero) top[i] = min(top[i], level(baby[j]));
+      }
+      top[i]--;
+    } else {
+      top[i] = top[2 * i + 2];
+      if (poly_heap[2 * i + 1]) top[i] = min(top[i], min(top[2 * i + 1], level(giant_of(i))) - 1);
+    }
+  }
+  if (top[0] < 0) {
+    throw invalid_argument("Not enough levels to evaluate the polynomial!");
+  }
+
+  // Top-down, each node is produced at the level and scale its parent adds it
+  // at, so no level is spent on matching scales
+  vector<long> target_level(heaplen, 0);
+  vector<double> target_scale(heaplen, 0);
+  target_level[0] = top[0];
+  target_scale[0] = cipher.scale();
+  for (long i = 0; i < leaffirst; i++) {
+    if (!poly_heap[i]) continue;
+    long l = target_level[i];
+    target_level[2 * i + 2] = l;
+    target_scale[2 * i + 2] = target_scale[i];
+    if (poly_heap[2 * i + 1]) {
+      target_level[2 * i + 1] = l + 1;
+      target_scale[2 * i + 1] = target_scale[i] * last_prime(l + 1) / giant_of(i).scale();
+    }
+  }
+
+  // Leaves in parallel: every coefficient is applied at the level above the
+  // leaf's target and at the scale that makes the terms agree, one rescale each
+  vector<Ciphertext> node(heaplen);
+  vector<long> leaves;
+  for (long i = leaffirst; i < heaplen; i++) {
+    if (poly_heap[i]) leaves.push_back(i);
+  }
+  pool.parallel_for(leaves.size(), [&](size_t t) {
+    long i = leaves[t];
+    const parms_id_type &parms = level_parms[target_level[i] + 1];
+    double scale = target_scale[i] * last_prime(target_level[i] + 1);
+    Ciphertext term;
+    bool empty = true;
+    for (auto &[j, c] : leaf_terms[i]) {
+      if (abs(c) <= zero) continue;
+      evaluator.mod_switch_to(baby[j], parms, term);
+      evaluator.multiply_const_inplace(term, c, scale / term.scale());
+      term.scale() = scale;
+      if (empty) {
+        node[i] = term;
+        empty = false;
+      } else {
+        evaluator.add_inplace(node[i], term);
+      }
+    }
+    if (empty) {
+      evaluator.mod_switch_to(baby[1], parms, term);
+      evaluator.sub(term, term, node[i]);
+      node[i].scale() = scale;
+    }
+    evaluator.add_const_inplace(node[i], leaf_constants[i]);
+    evaluator.rescale_to_next_inplace(node[i]);
+    node[i].scale() = target_scale[i];
+  });
+  baby.clear();
+
+  // Then each depth bottom-up, its nodes in parallel: q T_{k 2^g} + r
+  for (long depth = heap_m - 1; depth >= 0; depth--) {
+    long first = (1 << depth) - 1;
+    pool.parallel_for(first + 1, [&](size_t t) {
+      long i = first + t, q = 2 * i + 1, r = 2 * i + 2;
+      if (!poly_heap[i]) return;
+      if (!poly_heap[q]) {
+        node[i] = move(node[r]);
+        return;
+      }
+      Ciphertext switched;
+      evaluator.mod_switch_to(giant_of(i), node[q].parms_id(), switched);
+      evaluator.multiply_inplace(node[q], switched);
+      evaluator.relinearize_inplace(node[q], relin_keys);
+      evaluator.rescale_to_next_inplace(node[q]);
+      node[q].scale() = target_scale[i];
+      evaluator.add_inplace(node[q], node[r]);
+      node[i] = move(node[q]);
+      node[r].release();
+    });
+  }
+  rtn = move(node[0]);
+}
+
 void mul(Polynomial &rtn, Polynomial &a, Polynomial &b) {
   rtn.set_zero_polynomial(a.deg + b.deg);
   for (long i = 0; i <= rtn.deg; i++) {
@@ -7,8 +7,11 @@
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "func.h"
+#include "thread_pool.h"
 // #include"ScaleInvEvaluator.h"
 
 using namespace std;
@@ -24,6 +27,12 @@ class Polynomial {
   RR *chebcoeff = 0;
   Polynomial **poly_heap = 0;
 
+  // Evaluation plan of the heap, compiled once by compile_heap_plan(): the
+  // Chebyshev terms of every leaf as (basis index, coefficient) with the zero
+  // terms dropped, index heap_k standing for T_k, and the constant terms
+  vector<vector<pair<long, double>>> leaf_terms;
+  vector<double> leaf_constants;
+
   Polynomial();
   Polynomial(long _deg);
   Polynomial(long _deg, RR *_coeff, string tag);
@@ -50,9 +59,15 @@ class Polynomial {
 
   void write_heap_to_file(ofstream &out);
   void read_heap_from_file(ifstream &in);
+  void compile_heap_plan();
 
   // void homomorphic_poly_evaluation(SEALContext &context, CKKSEncoder &encoder, Encryptor &encryptor, ScaleInvEvaluator &evaluator, RelinKeys &relin_keys, Ciphertext &rtn, Ciphertext &cipher, Decryptor &decryptor);
-  void homomorphic_poly_evaluation(SEALContext &context, CKKSEncoder &encoder, Encryptor &encryptor, Evaluator &evaluator, RelinKeys &relin_keys, Ciphertext &rtn, Ciphertext &cipher, Decryptor &decryptor);
+  // Above degree 3 the leaves run concurrently on pool, then every depth of the
+  // heap bottom-up; the result keeps the scale of cipher
+  void homomorphic_poly_evaluation(SEALContext &context, Evaluator &evaluator, RelinKeys &relin_keys, Ciphertext &rtn, Ciphertext &cipher, ThreadPool &pool = ThreadPool::shared());
+
+ private:
+  void evaluate_heap(SEALContext &context, Evaluator &evaluator, RelinKeys &relin_keys, Ciphertext &rtn, const Ciphertext &cipher, ThreadPool &pool);
 };
 
 void mul(Polynomial &rtn, Polynomial &a, Polynomial &b);
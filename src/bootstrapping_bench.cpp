@@ -0,0 +1,357 @@
+#include <seal/seal.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Bootstrapper.h"
+
+using namespace std;
+using namespace seal;
+
+/*
+  Benchmark of the sparse and full-slot bootstrap_3 and bootstrap_planned:
+
+    ./bootstrapping_bench --logN 14,15 --logn 11,13 --deg 59 --reps 3 > bench.json
+
+  Every combination of the swept parameters (logN, logn, K, deg, loge, hw,
+  cts-levels, stc-levels) gets
+  its own context and keys, then bootstraps random real data reps times. One
+  JSON record per combination goes to stdout with the mean time of each stage,
+  the precision in bits and the levels consumed; progress and the Bootstrapper's
+  own messages go to stderr. A combination that fails is recorded with its
+  error so that a sweep runs to the end.
+
+  cts-levels and stc-levels set the level budgets of bootstrap_planned, which
+  trades levels for rotations; both at 0, the default, keep bootstrap_3 and its
+  three-level transforms.
+*/
+
+namespace {
+const vector<string> SWEPT = {"logN", "logn", "K", "deg", "loge", "hw", "cts-levels", "stc-levels"};
+
+struct Options {
+  map<string, vector<long>> sweep = {{"logN", {15}}, {"logn", {13}}, {"K", {25}}, {"deg", {59}}, {"loge", {10}}, {"hw", {192}},
+                                   {"cts-levels", {0}}, {"stc-levels", {0}}};
+  long reps = 3;
+  long threads = 0;  // 0 keeps the shared pool
+  long remaining_level = 16;
+  long boot_level = 0;  // 0 derives it from deg
+  long scale_factor = 2;
+  long logp = 46;
+  long logq = 51;
+  long log_special_prime = 51;
+  unsigned seed = 1;
+};
+
+struct Result {
+  double setup = 0, total = 0, total_min = 0;
+  Bootstrapper::StageTimes stages;
+  double max_err = 0, mean_err = 0;
+  long levels_consumed = 0, levels_left = 0;
+  size_t threads = 0, rotation_keys = 0;
+};
+
+void usage() {
+  cerr << "usage: bootstrapping_bench [--logN a,b,..] [--logn ..] [--K ..] [--deg ..] [--loge ..] [--hw ..]" << endl
+       << "                           [--cts-levels ..] [--stc-levels ..]" << endl
+       << "                           [--reps n] [--threads n] [--remaining-level n] [--boot-level n]" << endl
+       << "                           [--scale-factor n] [--logp n] [--logq n] [--seed n]" << endl;
+}
+
+vector<long> parse_list(const string &arg) {
+  vector<long> values;
+  stringstream in(arg);
+  string item;
+  while (getline(in, item, ',')) {
+    values.push_back(stol(item));
+  }
+  if (values.empty()) {
+    throw invalid_argument("empty list");
+  }
+  return values;
+}
+
+Options parse(int argc, char **argv) {
+  Options opt;
+  map<string, long *> scalars = {
+      {"reps", &opt.reps},
+      {"threads", &opt.threads},
+      {"remaining-level", &opt.remaining_level},
+      {"boot-level", &opt.boot_level},
+      {"scale-factor", &opt.scale_factor},
+      {"logp", &opt.logp},
+      {"logq", &opt.logq},
+  };
+  for (int i = 1; i < argc; i++) {
+    string flag = argv[i];
+    if (flag.rfind("--", 0) != 0 || i + 1 == argc) {
+      throw invalid_argument("bad argument " + flag);
+    }
+    string name = flag.substr(2), value = argv[++i];
+    if (opt.sweep.count(name)) {
+      opt.sweep[name] = parse_list(value);
+    } else if (scalars.count(name)) {
+      *scalars[name] = stol(value);
+    } else if (name == "seed") {
+      opt.seed = static_cast<unsigned>(stoul(value));
+    } else {
+      throw invalid_argument("unknown option " + flag);
+    }
+  }
+  if (opt.reps < 1) {
+    throw invalid_argument("reps must be positive");
+  }
+  return opt;
+}
+
+// Levels the bootstrap needs: those of CoeffToSlot and SlotToCoeff, then EvalMod's
+// Chebyshev tree of the sine-cosine polynomial and its double-angle steps
+long boot_levels(long lt_levels, long deg, long scale_factor) {
+  long k, m;
+  babycount(k, m, deg);
+  return lt_levels + static_cast<long>(ceil(log2(k))) + m + 1 + scale_factor;
+}
+
+Result run(map<string, long> &s, const Options &opt, mt19937_64 &rng) {
+  long logN = s["logN"], logn = s["logn"];
+  if (logn < 1 || logn > logN - 1) {
+    throw invalid_argument("logn must lie between 1 and logN - 1");
+  }
+  long cts_levels = s["cts-levels"], stc_levels = s["stc-levels"];
+  bool planned = cts_levels || stc_levels;
+  if (planned && (cts_levels < 1 || stc_levels < 1)) {
+    throw invalid_argument("cts-levels and stc-levels must both be positive, or both 0");
+  }
+  long lt_levels = planned ? cts_levels + stc_levels : 6;
+  long boot_level = opt.boot_level ? opt.boot_level : boot_levels(lt_levels, s["deg"], opt.scale_factor);
+  long total_level = opt.remaining_level + boot_level;
+
+  Result result;
+  auto start = chrono::steady_clock::now();
+
+  vector<int> coeff_bit_vec{static_cast<int>(opt.logq)};
+  coeff_bit_vec.insert(coeff_bit_vec.end(), opt.remaining_level, static_cast<int>(opt.logp));
+  coeff_bit_vec.insert(coeff_bit_vec.end(), boot_level, static_cast<int>(opt.logq));
+  coeff_bit_vec.push_back(static_cast<int>(opt.log_special_prime));
+
+  EncryptionParameters parms(scheme_type::ckks);
+  double scale = pow(2.0, opt.logp);
+  size_t poly_modulus_degree = static_cast<size_t>(1) << logN;
+  parms.set_poly_modulus_degree(poly_modulus_degree);
+  parms.set_coeff_modulus(CoeffModulus::Create(poly_modulus_degree, coeff_bit_vec));
+  parms.set_secret_key_hamming_weight(s["hw"]);
+  parms.set_sparse_slots(1 << logn);
+  SEALContext context(parms, true, sec_level_type::none);
+
+  KeyGenerator keygen(context);
+  PublicKey public_key;
+  keygen.create_public_key(public_key);
+  RelinKeys relin_keys;
+  keygen.create_relin_keys(relin_keys);
+  GaloisKeys gal_keys;
+
+  CKKSEncoder encoder(context);
+  Encryptor encryptor(context, public_key);
+  Evaluator evaluator(context, encoder);
+  Decryptor decryptor(context, keygen.secret_key());
+
+  Bootstrapper bootstrapper(
+      s["loge"], logn, logN - 1, total_level, scale, s["K"], s["deg"], opt.scale_factor, 1,
+      context, keygen, encoder, encryptor, decryptor, evaluator, relin_keys, gal_keys);
+  unique_ptr<ThreadPool> pool;
+  if (opt.threads > 0) {
+    pool.reset(new ThreadPool(opt.threads));
+    bootstrapper.stage_pool = pool.get();
+  }
+  result.threads = bootstrapper.stage_pool->size();
+
+  bootstrapper.cts_levels = cts_levels;
+  bootstrapper.stc_levels = stc_levels;
+
+  bootstrapper.prepare_mod_polynomial();
+  vector<int> gal_steps_vector;
+  bootstrapper.addLeftRotKeys_Subsum_to_vector(gal_steps_vector);
+  if (planned)
+    bootstrapper.addLeftRotKeys_Linear_to_vector_planned(gal_steps_vector);
+  else
+    bootstrapper.addLeftRotKeys_Linear_to_vector_3(gal_steps_vector);
+  GaloisKeyPlanner planner(context);
+  planner.add_steps(gal_steps_vector);
+  planner.create(keygen, gal_keys, *bootstrapper.stage_pool);
+  result.rotation_keys = gal_keys.size();
+  bootstrapper.slot_vec.push_back(logn);
+  if (planned)
+    bootstrapper.generate_LT_coefficient_planned();
+  else
+    bootstrapper.generate_LT_coefficient_3();
+  result.setup = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  size_t sparse_slots = static_cast<size_t>(1) << logn;
+  uniform_real_distribution<double> distribution(-1, 1);
+  double err_sum = 0;
+  result.total_min = INFINITY;
+  for (long rep = 0; rep < opt.reps; rep++) {
+    vector<double> sparse(sparse_slots), input(encoder.slot_count());
+    for (auto &x : sparse) {
+      x = distribution(rng);
+    }
+    for (size_t i = 0; i < input.size(); i++) {
+      input[i] = sparse[i % sparse_slots];
+    }
+
+    Plaintext plain;
+    Ciphertext cipher, rtn;
+    encoder.encode(input, context.last_parms_id(), scale, plain);
+    encryptor.encrypt(plain, cipher);
+    vector<double> before, after;
+    decryptor.decrypt(cipher, plain);
+    encoder.decode(plain, before);
+
+    start = chrono::steady_clock::now();
+    if (planned)
+      bootstrapper.bootstrap_planned(rtn, cipher);
+    else
+      bootstrapper.bootstrap_3(rtn, cipher);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    decryptor.decrypt(rtn, plain);
+    encoder.decode(plain, after);
+    for (size_t i = 0; i < sparse_slots; i++) {
+      double err = abs(before[i] - after[i]);
+      result.max_err = max(result.max_err, err);
+      err_sum += err;
+    }
+
+    const auto &times = bootstrapper.stage_times;
+    result.stages.modraise += times.modraise / opt.reps;
+    result.stages.subsum += times.subsum / opt.reps;
+    result.stages.coefftoslot += times.coefftoslot / opt.reps;
+    result.stages.evalmod += times.evalmod / opt.reps;
+    result.stages.slottocoeff += times.slottocoeff / opt.reps;
+    result.total += seconds / opt.reps;
+    result.total_min = min(result.total_min, seconds);
+
+    result.levels_left = context.get_context_data(rtn.parms_id())->chain_index();
+    result.levels_consumed = total_level - result.levels_left;
+  }
+  result.mean_err = err_sum / (opt.reps * sparse_slots);
+  return result;
+}
+
+string escape(const string &text) {
+  string out;
+  for (char c : text) {
+    if (c == '"' || c == '\\') out += '\\';
+    out += c;
+  }
+  return out;
+}
+
+// -log2(err) as a JSON number, or null when it is not finite: an exact result has
+// no finite precision, and JSON has no inf
+string precision_bits(double err) {
+  double bits = -log2(err);
+  if (!isfinite(bits)) {
+    return "null";
+  }
+  ostringstream out;
+  out << bits;
+  return out.str();
+}
+
+void write_record(ostream &json, map<string, long> &s, const Options &opt, const Result *result, const string &error) {
+  json << "    {";
+  for (const string &name : SWEPT) {
+    json << "\"" << name << "\": " << s[name] << ", ";
+  }
+  json << "\"reps\": " << opt.reps;
+  if (!result) {
+    json << ", \"error\": \"" << escape(error) << "\"}";
+    return;
+  }
+
+  const auto &r = *result;
+  json << ", \"threads\": " << r.threads << ", \"rotation_keys\": " << r.rotation_keys << ", \"setup_s\": " << r.setup
+       << ", \"total_s\": " << r.total << ", \"total_min_s\": " << r.total_min
+       << ", \"stages_s\": {\"modraise\": " << r.stages.modraise << ", \"subsum\": " << r.stages.subsum
+       << ", \"coefftoslot\": " << r.stages.coefftoslot << ", \"evalmod\": " << r.stages.evalmod
+       << ", \"slottocoeff\": " << r.stages.slottocoeff << "}"
+       << ", \"max_error\": " << r.max_err << ", \"mean_error\": " << r.mean_err
+       << ", \"precision_bits\": " << precision_bits(r.max_err)
+       << ", \"mean_precision_bits\": " << precision_bits(r.mean_err)
+       << ", \"levels_consumed\": " << r.levels_consumed << ", \"levels_left\": " << r.levels_left << "}";
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+  for (int i = 1; i < argc; i++) {
+    if (string(argv[i]) == "--help") {
+      usage();
+      return 0;
+    }
+  }
+
+  Options opt;
+  try {
+    opt = parse(argc, argv);
+  } catch (const exception &e) {
+    cerr << e.what() << endl;
+    usage();
+    return 1;
+  }
+
+  // Only the JSON goes to stdout
+  ostream json(cout.rdbuf());
+  cout.rdbuf(cerr.rdbuf());
+  json << setprecision(6);
+
+  mt19937_64 rng(opt.seed);
+  vector<size_t> index(SWEPT.size(), 0);
+  bool first = true;
+  json << "{\"runs\": [" << endl;
+  while (true) {
+    map<string, long> setting;
+    for (size_t i = 0; i < SWEPT.size(); i++) {
+      setting[SWEPT[i]] = opt.sweep[SWEPT[i]][index[i]];
+    }
+    cerr << "Benchmarking";
+    for (const string &name : SWEPT) {
+      cerr << " " << name << "=" << setting[name];
+    }
+    cerr << endl;
+
+    if (!first) json << "," << endl;
+    first = false;
+    try {
+      Result result = run(setting, opt, rng);
+      write_record(json, setting, opt, &result, "");
+    } catch (const exception &e) {
+      cerr << "failed: " << e.what() << endl;
+      write_record(json, setting, opt, nullptr, e.what());
+    } catch (const char *e) {
+      cerr << "failed: " << e << endl;
+      write_record(json, setting, opt, nullptr, e);
+    }
+    json.flush();
+
+    // Next combination, the last parameter varying fastest
+    size_t i = SWEPT.size();
+    while (i > 0 && ++index[i - 1] == opt.sweep[SWEPT[i - 1]].size()) {
+      index[--i] = 0;
+    }
+    if (i == 0) break;
+  }
+  json << endl << "]}" << endl;
+
+  cout.rdbuf(json.rdbuf());
+  return 0;
+}
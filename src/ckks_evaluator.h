@@ -3,12 +3,18 @@
 #include <seal/seal.h>
 #include <seal/util/uintarith.h>
 
+#include <complex>
+#include <memory>
 #include <vector>
 
+#include "sgn_tables.h"
+
 using namespace std;
 using namespace seal;
 using namespace seal::util;
 
+struct ManagedCiphertext;
+
 class CKKSEvaluator {
  private:
   double x_l = 1e-4, x_r = 1e3;
@@ -26,11 +32,14 @@ class CKKSEvaluator {
   int g4_scale = (1 << 10);
   Plaintext a, b, half, div_b, neg_p, err, M1, M2, C1, C2;
 
-  Ciphertext poly_eval(Ciphertext x, vector<Plaintext> coeff);
-  Ciphertext newtonIter(Ciphertext x, Ciphertext res, int iter = 4);
-  pair<Ciphertext, Ciphertext> goldSchmidtIter(Ciphertext v, Ciphertext y, int d = 1);
-  Ciphertext initGuess(Ciphertext x);
-  Ciphertext evalLine(Ciphertext x, Plaintext m, Plaintext c);
+  // res is refined in place
+  void newtonIter(const ManagedCiphertext &x, ManagedCiphertext &res, int iter = 4);
+  // sqrt(v) and 1/sqrt(v) from the initial guess y of 1/sqrt(v)
+  void goldSchmidtIter(
+      const ManagedCiphertext &v, const ManagedCiphertext &y, ManagedCiphertext &sqrt, ManagedCiphertext &inv_sqrt,
+      int d = 1);
+  void initGuess(const ManagedCiphertext &x, ManagedCiphertext &dest);
+  void evalLine(const ManagedCiphertext &x, double m, double c, ManagedCiphertext &dest);
 
  public:
   SEALContext *context = nullptr;
@@ -40,6 +49,59 @@ class CKKSEvaluator {
   Evaluator *evaluator = nullptr;
   RelinKeys *relin_keys = nullptr;
   GaloisKeys *galois_keys = nullptr;
+  // Shared with the SEAL evaluator, which caches multiply_vector plaintexts in it
+  shared_ptr<PlaintextCache> plain_cache;
+
+  /*
+    exp(x) for x in [lo, hi] is a Chebyshev interpolant of exp(x / 2^squarings)
+    of the given degree, squared squarings times. Interpolation at Chebyshev nodes
+    is within a few bits of the minimax polynomial for an analytic function, and
+    the affine map onto [-1, 1] absorbs the 2^-squarings, so the cost is
+    ceil(log2(degree + 1)) + 1 + squarings levels. Inputs outside [lo, hi] are not
+    approximated.
+  */
+  struct ExpParams {
+    double lo = -4.0, hi = 4.0;
+    int degree = 15;
+    int squarings = 0;
+  };
+
+  /*
+    Plans for 1/x and 1/sqrt(x) on x in [lo, hi], 0 < lo < hi, with the fewest
+    iterations that reach a relative error of precision in exact arithmetic; CKKS
+    noise comes on top. Both throw if precision is out of reach.
+
+    1/x scales x by the minimax constant guess c = 2 / (lo + hi), which leaves
+    |1 - c x| <= rho = (hi - lo) / (hi + lo); iter steps of inverse() then reach
+    rho^(2^(iter + 1)). The factor c on the result stays deferred.
+
+    1/sqrt(x) starts from the relative-error minimax line m x + c, damped by the
+    factor that lets the following Newton steps converge fastest. A step maps the
+    relative error e to -3/2 e^2 - 1/2 e^3. Goldschmidt steps follow the same
+    recurrence but need an extra level to set up, so plans use Newton only.
+  */
+  struct InversePlan {
+    double c = 1.0;
+    int iter = 0;
+    double error = 0.0;
+
+    int depth() const {
+      return iter + 1;
+    }
+  };
+
+  struct InvSqrtPlan {
+    double m = 0.0, c = 0.0;
+    int d_newt = 0;
+    double error = 0.0;
+
+    int depth() const {
+      return 1 + 2 * d_newt;
+    }
+  };
+
+  static InversePlan plan_inverse(double lo, double hi, double precision);
+  static InvSqrtPlan plan_invert_sqrt(double lo, double hi, double precision);
 
   double scale;
   size_t N;
@@ -67,6 +129,12 @@ class CKKSEvaluator {
     this->galois_keys = &galois_keys;
     this->context = &context;
 
+    plain_cache = evaluator.plaintext_cache();
+    if (!plain_cache) {
+      plain_cache = make_shared<PlaintextCache>();
+      evaluator.set_plaintext_cache(plain_cache);
+    }
+
     N = encoder.slot_count() * 2;
     degree = N;
     slot_count = encoder.slot_count();
@@ -89,15 +157,51 @@ class CKKSEvaluator {
   void print_decrypted_ct(Ciphertext &ct, int nums);
   void print_decoded_pt(Plaintext &pt, int num);
 
+  // values, zero-padded to sparse_slots, repeat over all slots as a bootstrap
+  // with logn = log2(sparse_slots) expects; sparse_slots is a power of two
+  void encode_sparse(const vector<double> &values, size_t sparse_slots, double scale, Plaintext &dest);
+  void encode_sparse(
+      const vector<double> &values, size_t sparse_slots, parms_id_type parms_id, double scale, Plaintext &dest);
+  // The sparse_slots values of a sparse-packed plaintext, averaged over their
+  // repetitions, which drops the noise of the other slots
+  void decode_sparse(const Plaintext &plain, size_t sparse_slots, vector<double> &dest);
+  void decrypt_sparse(const Ciphertext &ct, size_t sparse_slots, vector<double> &dest);
+
   vector<double> init_vec_with_value(int N, double init_value);
   vector<double> init_mask(int N, int m);
+  shared_ptr<const Plaintext> encode_const(double value, parms_id_type parms_id, double scale);
+  shared_ptr<const Plaintext> encode_vector(const vector<double> &values, parms_id_type parms_id, double scale);
+  shared_ptr<const Plaintext> encode_vector(
+      const vector<complex<double>> &values, parms_id_type parms_id, double scale);
   uint64_t get_modulus(Ciphertext &x, int k);
-  void eval_odd_deg9_poly(vector<double> &a, Ciphertext &x, Ciphertext &dest);
 
-  Ciphertext invert_sqrt(Ciphertext x, int d_newt = 5, int d_gold = 2);
-  Ciphertext sgn_eval(Ciphertext x, int d_g, int d_f, double sgn_factor = 0.5);
-  Ciphertext exp(Ciphertext x);
-  Ciphertext inverse(Ciphertext x, int iter = 4);
+  /*
+    Nonlinear primitives follow the SEAL convention: the input is taken by const
+    reference and the result goes to dest, which may alias x; the _inplace variants
+    overwrite x. No ciphertext is copied beyond what the computation itself needs.
+    They keep no state in the evaluator, so concurrent calls may share one instance.
+  */
+  void invert_sqrt(const Ciphertext &x, Ciphertext &dest, int d_newt = 5, int d_gold = 2);
+  void invert_sqrt_inplace(Ciphertext &x, int d_newt = 5, int d_gold = 2);
+  // x may carry a deferred factor, which is folded into the initial guess
+  void invert_sqrt(const ManagedCiphertext &x, Ciphertext &dest, int d_newt = 5, int d_gold = 2);
+  void invert_sqrt(const ManagedCiphertext &x, Ciphertext &dest, const InvSqrtPlan &plan);
+  void sgn_eval(const Ciphertext &x, int d_g, int d_f, Ciphertext &dest, double sgn_factor = 0.5);
+  void sgn_eval_inplace(Ciphertext &x, int d_g, int d_f, double sgn_factor = 0.5);
+  // Composite minimax sign; the output is sgn_factor * sgn(x) to within the table's precision.
+  // Throws on a table without stages
+  void sgn_eval(const Ciphertext &x, const SgnTable &table, Ciphertext &dest, double sgn_factor = 0.5);
+  void sgn_eval_inplace(Ciphertext &x, const SgnTable &table, double sgn_factor = 0.5);
+  // Shallowest table reaching precision 2^-alpha on |x| >= eps; throws if none does
+  static const SgnTable &sgn_table(double alpha, double eps);
+  void exp(const Ciphertext &x, Ciphertext &dest);
+  void exp(const Ciphertext &x, Ciphertext &dest, const ExpParams &params);
+  void exp_inplace(Ciphertext &x);
+  void exp_inplace(Ciphertext &x, const ExpParams &params);
+  void inverse(const Ciphertext &x, Ciphertext &dest, int iter = 4);
+  void inverse_inplace(Ciphertext &x, int iter = 4);
+  // dest = 1/x, carrying the plan's constant as a deferred factor
+  void inverse(const ManagedCiphertext &x, ManagedCiphertext &dest, const InversePlan &plan);
 
   double calculateMAE(vector<double> &y_true, Ciphertext &ct, int N);
 };
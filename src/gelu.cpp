@@ -1,113 +1,97 @@
 #include "gelu.h"
 
+#include <algorithm>
 #include <iostream>
 
-void GeLUEvaluator::gelu(Ciphertext &x, Ciphertext &res) {
-  Ciphertext b0, b1, b2;
-  Plaintext p0, p1, delta;
-  vector<double> dest;
+#include "managed_eval.h"
+#include "poly_eval.h"
 
-  ckks->encoder->encode(ckks->init_vec_with_value(ckks->slot_count, -3.5), x.parms_id(), x.scale(), p0);
-  ckks->encoder->encode(ckks->init_vec_with_value(ckks->slot_count, 3.5), x.parms_id(), x.scale(), p1);
-  ckks->encoder->encode(
-      ckks->init_vec_with_value(ckks->slot_count, 1.0 / 8.5), x.parms_id(), x.scale(), delta);
+namespace {
+// Ax = A[0]+A[1]x+A[2]x^2+A[3]x^4+A[4]x^6+A[5]x^8+A[6]x^10+A[7]x^12
+const vector<double> A = {2.25775755e-04, 0.5, 3.96880960e-01, 0, -6.37042698e-02, 0, 8.38841647e-03,
+                          0, -7.17830961e-04, 0, 3.49617829e-05, 0, -7.26059653e-07};
+}  // namespace
 
-  ckks->evaluator->sub_plain(x, p0, b0);
-  ckks->evaluator->multiply_plain_inplace(b0, delta);
+void GeLUEvaluator::gelu(const Ciphertext &x, Ciphertext &res) {
+  Ciphertext b0, b1;
+
+  // b0 = (x + 3.5) / 8.5, b1 = (x - 3.5) / 8.5
+  ckks->evaluator->add_const(x, 3.5, b0);
+  ckks->evaluator->multiply_const_inplace(b0, 1.0 / 8.5);
   ckks->evaluator->rescale_to_next_inplace(b0);
-  ckks->evaluator->sub_plain(x, p1, b1);
-  ckks->evaluator->multiply_plain_inplace(b1, delta);
+  ckks->evaluator->add_const(x, -3.5, b1);
+  ckks->evaluator->multiply_const_inplace(b1, 1.0 / 8.5);
   ckks->evaluator->rescale_to_next_inplace(b1);
 
-  b0 = ckks->sgn_eval(b0, 2, 2);
-  b1 = ckks->sgn_eval(b1, 2, 2);
-
-  Plaintext zero_point_five;
-  ckks->encoder->encode(ckks->init_vec_with_value(ckks->slot_count, 0.5), b1.parms_id(), b1.scale(), zero_point_five);
-  Ciphertext a0, a1, a2;
-
-  ckks->evaluator->sub(b0, b1, a1);                     // a1 = b0 - b1
-  ckks->evaluator->add_plain(b1, zero_point_five, a2);  // a2 = b1 + 0.5
-
-  Ciphertext x_2;
-  ckks->evaluator->square(x, x_2);
-  ckks->evaluator->relinearize_inplace(x_2, *ckks->relin_keys);
-  ckks->evaluator->rescale_to_next_inplace(x_2);
-
-  Ciphertext x_4;
-  ckks->evaluator->square(x_2, x_4);
-  ckks->evaluator->relinearize_inplace(x_4, *ckks->relin_keys);
-  ckks->evaluator->rescale_to_next_inplace(x_4);
-
-  Ciphertext x_6;
-  ckks->evaluator->mod_switch_to_inplace(x_2, x_4.parms_id());
-  ckks->evaluator->multiply(x_2, x_4, x_6);
-  ckks->evaluator->relinearize_inplace(x_6, *ckks->relin_keys);
-  ckks->evaluator->rescale_to_next_inplace(x_6);
-
-  Ciphertext x_8;
-  ckks->evaluator->square(x_4, x_8);
-  ckks->evaluator->relinearize_inplace(x_8, *ckks->relin_keys);
-  ckks->evaluator->rescale_to_next_inplace(x_8);
-
-  Ciphertext x_10;
-  ckks->evaluator->mod_switch_to_inplace(x_2, x_8.parms_id());
-  ckks->evaluator->multiply(x_2, x_8, x_10);
-  ckks->evaluator->relinearize_inplace(x_10, *ckks->relin_keys);
-  ckks->evaluator->rescale_to_next_inplace(x_10);
-
-  Ciphertext x_12;
-  ckks->evaluator->square(x_6, x_12);
-  ckks->evaluator->relinearize_inplace(x_12, *ckks->relin_keys);
-  ckks->evaluator->rescale_to_next_inplace(x_12);
-
-  double A[] = {2.25775755e-04, 0.5, 3.96880960e-01, -6.37042698e-02, 8.38841647e-03, -7.17830961e-04, 3.49617829e-05, -7.26059653e-07};
-  vector<Plaintext> coeff_A(8);
-  for (size_t i = 0; i < coeff_A.size(); i++) {
-    ckks->encoder->encode(A[i], ckks->scale, coeff_A[i]);
-  }
-  vector<Ciphertext> cts(8);
-  cts[1] = x;
-  cts[2] = x_2;
-  cts[3] = x_4;
-  cts[4] = x_6;
-  cts[5] = x_8;
-  cts[6] = x_10;
-  cts[7] = x_12;
-
-  // Ax = A[0]+A[1]x+A[2]x^2+A[3]x^4+A[4]x^6+A[5]x^8+A[6]x^10+A[7]x^12
-  for (size_t i = 1; i < coeff_A.size(); i++) {
-    ckks->evaluator->mod_switch_to_inplace(coeff_A[i], cts[i].parms_id());
-    ckks->evaluator->multiply_plain_inplace(cts[i], coeff_A[i]);
-    ckks->evaluator->rescale_to_next_inplace(cts[i]);
-    cts[i].scale() = ckks->scale;
-  }
+  const SgnTable &sgn = CKKSEvaluator::sgn_table(sgn_alpha, sgn_eps);
+  ckks->sgn_eval_inplace(b0, sgn);
+  ckks->sgn_eval_inplace(b1, sgn);
+
+  Ciphertext a1;
+  ckks->evaluator->sub(b0, b1, a1);             // a1 = b0 - b1
+  ckks->evaluator->add_const_inplace(b1, 0.5);  // a2 = b1 + 0.5
+  Ciphertext &a2 = b1;
 
-  Ciphertext Ax = cts[cts.size() - 1];
+  Ciphertext Ax;
+  PolyEvaluator(*ckks).evaluate(x, PolyEvaluator::Polynomial(A), ckks->scale, Ax);
 
-  for (size_t i = 1; i < coeff_A.size() - 1; i++) {
-    ckks->evaluator->mod_switch_to_inplace(cts[i], Ax.parms_id());
-    ckks->evaluator->add_inplace(Ax, cts[i]);
+  blend(x, Ax, a1, a2, res);
+}
+
+void GeLUEvaluator::gelu(const Ciphertext &x, Ciphertext &res, size_t len) {
+  size_t slots = ckks->encoder->slot_count();
+  if (2 * len > slots) {
+    gelu(x, res);
+    return;
   }
 
-  ckks->evaluator->mod_switch_to_inplace(coeff_A[0], Ax.parms_id());
-  ckks->evaluator->add_plain_inplace(Ax, coeff_A[0]);
-
-  Ciphertext s1, s2;
-  // // cout << Ax.scale() << " " << Bx.scale() << " " << a1.scale() << endl;
-  ckks->evaluator->mod_switch_to_inplace(Ax, a1.parms_id());
-  ckks->evaluator->multiply(Ax, a1, s1);
-  ckks->evaluator->relinearize_inplace(s1, *ckks->relin_keys);
-  ckks->evaluator->rescale_to_next_inplace(s1);
-
-  ckks->evaluator->mod_switch_to_inplace(x, a2.parms_id());
-  ckks->evaluator->multiply(x, a2, s2);
-  ckks->evaluator->relinearize_inplace(s2, *ckks->relin_keys);
-  ckks->evaluator->rescale_to_next_inplace(s2);
-  s1.scale() = ckks->scale;
-  s2.scale() = ckks->scale;
-  ckks->evaluator->mod_switch_to_inplace(s2, s1.parms_id());
-  ckks->evaluator->add(s1, s2, res);
+  // b = ([x, x] + [3.5, -3.5]) / 8.5 holds b0 and b1 side by side
+  Ciphertext b;
+  ckks->evaluator->rotate_vector(x, -static_cast<int>(len), *ckks->galois_keys, b);
+  ckks->evaluator->add_inplace(b, x);
+  vector<double> shift(slots, 0.0);
+  fill(shift.begin(), shift.begin() + len, 3.5);
+  fill(shift.begin() + len, shift.begin() + 2 * len, -3.5);
+  ckks->evaluator->add_plain_inplace(b, *ckks->encode_vector(shift, b.parms_id(), b.scale()));
+  ckks->evaluator->multiply_const_inplace(b, 1.0 / 8.5);
+  ckks->evaluator->rescale_to_next_inplace(b);
+
+  ckks->sgn_eval_inplace(b, CKKSEvaluator::sgn_table(sgn_alpha, sgn_eps));
+
+  // Bring sgn(b1) onto the slots of sgn(b0)
+  Ciphertext a2;
+  ckks->evaluator->rotate_vector(b, static_cast<int>(len), *ckks->galois_keys, a2);
+  Ciphertext &a1 = b;
+  ckks->evaluator->sub_inplace(a1, a2);         // a1 = b0 - b1
+  ckks->evaluator->add_const_inplace(a2, 0.5);  // a2 = b1 + 0.5
+
+  // a1 and a2 are garbage past len. x is zero there, and so is Ax once its
+  // constant term is restricted to the first len slots, which masks both
+  // products without spending a level on a mask multiplication.
+  vector<double> ax_coeffs = A;
+  ax_coeffs[0] = 0;
+  Ciphertext Ax;
+  PolyEvaluator(*ckks).evaluate(x, PolyEvaluator::Polynomial(ax_coeffs), ckks->scale, Ax);
+  vector<double> constant(slots, 0.0);
+  fill(constant.begin(), constant.begin() + len, A[0]);
+  ckks->evaluator->add_plain_inplace(Ax, *ckks->encode_vector(constant, Ax.parms_id(), Ax.scale()));
+
+  blend(x, Ax, a1, a2, res);
+}
+
+// res = Ax * a1 + x * a2, with both products sharing one relinearization and rescale
+void GeLUEvaluator::blend(const Ciphertext &x, Ciphertext &Ax, Ciphertext &a1, Ciphertext &a2, Ciphertext &res) {
+  ManagedEvaluator managed(*ckks);
+  ManagedCiphertext sum;
+  managed.multiply_accumulate(ManagedCiphertext(std::move(Ax)), ManagedCiphertext(std::move(a1)), sum);
+  managed.multiply_accumulate(ManagedCiphertext(x), ManagedCiphertext(std::move(a2)), sum);
+  managed.resolve(sum);
+  res = std::move(sum.ct);
+}
+
+void GeLUEvaluator::gelu(const vector<Ciphertext> &x, vector<Ciphertext> &res, ThreadPool &pool) {
+  res.resize(x.size());
+  pool.parallel_for(x.size(), [&](size_t i) { gelu(x[i], res[i]); });
 }
 
 vector<double> GeLUEvaluator::gelu_plain(vector<double> &input) {
@@ -121,3 +105,10 @@ vector<double> GeLUEvaluator::gelu_plain(vector<double> &input) {
 
   return output;
 }
+
+vector<int> GeLUEvaluator::rotation_steps(size_t len, size_t slots) {
+  if (2 * len > slots) {
+    return {};
+  }
+  return {-static_cast<int>(len), static_cast<int>(len)};
+}
@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "ckks_evaluator.h"
+#include "thread_pool.h"
 
 using namespace std;
 using namespace seal;
@@ -13,11 +14,25 @@ class GeLUEvaluator {
  private:
   CKKSEvaluator *ckks = nullptr;
 
+  void blend(const Ciphertext &x, Ciphertext &Ax, Ciphertext &a1, Ciphertext &a2, Ciphertext &res);
+
  public:
+  // Precision of the segment selection, which is exact for |x +- 3.5| >= 8.5 * sgn_eps
+  double sgn_alpha = 12, sgn_eps = 1.0 / 128;
+
   GeLUEvaluator(CKKSEvaluator &ckks) {
     this->ckks = &ckks;
   }
 
-  void gelu(Ciphertext &x, Ciphertext &res);
+  void gelu(const Ciphertext &x, Ciphertext &res);
+  // For x holding len values followed by zeros. If 2 * len slots fit, both segment
+  // comparisons share one sgn_eval and res keeps the zero padding; otherwise this
+  // is gelu(x, res). Needs the Galois keys for rotations by +-len.
+  void gelu(const Ciphertext &x, Ciphertext &res, size_t len);
+  // Evaluates each ciphertext of x independently on the pool; res may be x
+  void gelu(const vector<Ciphertext> &x, vector<Ciphertext> &res, ThreadPool &pool = ThreadPool::shared());
   vector<double> gelu_plain(vector<double> &input);
+
+  // The Galois steps gelu(x, res, len) rotates by within slots; none when it falls back to gelu(x, res)
+  static vector<int> rotation_steps(size_t len, size_t slots);
 };
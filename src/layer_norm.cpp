@@ -1,33 +1,108 @@
 #include "layer_norm.h"
 
+#include <algorithm>
+#include <complex>
 #include <iostream>
+#include <stdexcept>
 #include <vector>
 
-void LNEvaluator::layer_norm(Ciphertext &x, Ciphertext &res, int len) {
-  Ciphertext tmp, x2;
-  int log_step = log2(len);
-  ckks->evaluator->rotate_vector(x, -len, *ckks->galois_keys, tmp);
-  ckks->evaluator->add_inplace(x, tmp);
-  ckks->evaluator->square(x, x2);
-  ckks->evaluator->relinearize_inplace(x2, *ckks->relin_keys);
-  ckks->evaluator->rescale_to_next_inplace(x2);
-  tmp = x2;
+#include "managed_eval.h"
+
+// Multiplying every slot by +-i is multiplying by the monomial +-X^(N/2), which
+// the encoder produces exactly at scale 1, so it costs neither a level nor precision
+void LNEvaluator::multiply_i_inplace(Ciphertext &x, double sign) {
+  vector<complex<double>> i_vec(ckks->encoder->slot_count(), complex<double>(0, sign));
+  ckks->evaluator->multiply_plain_inplace(x, *ckks->encode_vector(i_vec, x.parms_id(), 1.0));
+}
+
+void LNEvaluator::layer_norm(const Ciphertext &x, Ciphertext &res, int len) {
+  size_t slots = ckks->encoder->slot_count();
+  if (len < 1 || (len & (len - 1)) != 0 || static_cast<size_t>(len) > slots) {
+    throw invalid_argument("len must be a power of two no larger than the slot count");
+  }
+  if (hidden < 1 || hidden > len || (!gamma.empty() && gamma.size() != static_cast<size_t>(hidden)) ||
+      (!beta.empty() && beta.size() != static_cast<size_t>(hidden))) {
+    throw invalid_argument("hidden size does not match len, gamma or beta");
+  }
 
+  // Repeat x over every len-slot segment, so that any len consecutive slots hold
+  // one full copy and every slot of the reduction below is a valid row statistic
+  ManagedEvaluator managed(*ckks);
+  Ciphertext x_rep = x, rotated;
+  for (size_t step = len; step < slots; step *= 2) {
+    ckks->evaluator->rotate_vector(x_rep, -static_cast<int>(step), *ckks->galois_keys, rotated);
+    ckks->evaluator->add_inplace(x_rep, rotated);
+  }
+
+  // x + i x^2 carries both moments through a single rotate-and-sum ladder
+  int log_step = log2(len);
+  ManagedCiphertext xr(std::move(x_rep)), sums, tmp;
+  managed.multiply(xr, xr, tmp);
+  multiply_i_inplace(tmp.ct, 1.0);
+  managed.add(xr, tmp, sums);
   for (int i = 0; i < log_step; ++i) {
-    ckks->evaluator->rotate_vector(tmp, pow(2, i), *ckks->galois_keys, res);
-    ckks->evaluator->add_inplace(res, tmp);
-    tmp = res;
+    managed.rotate(sums, 1 << i, tmp);
+    managed.add_inplace(sums, tmp);
+  }
+
+  // 2 sum(x) = s + conj(s) and 2 sum(x^2) = -i (s - conj(s))
+  if (sums.ct.size() > 2) {
+    ckks->evaluator->relinearize_inplace(sums.ct, *ckks->relin_keys);
   }
+  ManagedCiphertext conj = sums, sum_x, sum_sq;
+  ckks->evaluator->complex_conjugate_inplace(conj.ct, *ckks->galois_keys);
+  managed.add(sums, conj, sum_x);
+  managed.sub(sums, conj, sum_sq);
+  multiply_i_inplace(sum_sq.ct, -1.0);
 
-  Plaintext delta;
-  ckks->encoder->encode(1.0 / 768, res.parms_id(), res.scale(), delta);
-  ckks->evaluator->multiply_plain_inplace(res, delta);
-  ckks->evaluator->rescale_to_next_inplace(res);
+  // hidden^2 * var = hidden * sum(x^2) - sum(x)^2, with 1 / hidden^2 left deferred
+  // for the initial guess of the inverse square root
+  ManagedCiphertext var = sum_sq;
+  managed.multiply_const_inplace(var, 0.5 * hidden);
+  tmp = sum_x;
+  managed.square_inplace(tmp);
+  managed.multiply_const_inplace(tmp, 0.25);
+  managed.sub_inplace(var, tmp);
+  managed.multiply_const_inplace(var, 1.0 / (static_cast<double>(hidden) * hidden));
 
-  res = ckks->invert_sqrt(res, 4, 2);
+  Ciphertext inv_sqrt;
+  ckks->invert_sqrt(var, inv_sqrt, CKKSEvaluator::plan_invert_sqrt(var_lo, var_hi, precision));
 
-  ckks->evaluator->mod_switch_to_inplace(x, res.parms_id());
-  ckks->evaluator->multiply(res, x, res);
-  ckks->evaluator->relinearize_inplace(res, *ckks->relin_keys);
-  ckks->evaluator->rescale_to_next_inplace(res);
+  // gamma * (x - mean), with the deferred factor of x - mean folded into gamma.
+  // gamma is zero past hidden, which clears what x - mean leaves in the padding.
+  ManagedCiphertext centered(x), mean(std::move(sum_x));
+  managed.multiply_const_inplace(mean, 0.5 / hidden);
+  managed.sub_inplace(centered, mean);
+  vector<double> g(slots, 0.0);
+  for (int i = 0; i < hidden; i++) {
+    g[i] = gamma.empty() ? 1.0 : gamma[i];
+  }
+  managed.multiply_vector_inplace(centered, g);
+
+  ManagedCiphertext out(std::move(inv_sqrt));
+  managed.multiply_inplace(out, centered);
+  managed.resolve(out);
+  res = std::move(out.ct);
+
+  if (!beta.empty()) {
+    vector<double> b(slots, 0.0);
+    copy(beta.begin(), beta.end(), b.begin());
+    ckks->evaluator->add_plain_inplace(res, *ckks->encode_vector(b, res.parms_id(), res.scale()));
+  }
+}
+
+void LNEvaluator::layer_norm(const vector<Ciphertext> &x, vector<Ciphertext> &res, int len, ThreadPool &pool) {
+  res.resize(x.size());
+  pool.parallel_for(x.size(), [&](size_t i) { layer_norm(x[i], res[i], len); });
+}
+
+vector<int> LNEvaluator::rotation_steps(int len, size_t slots) {
+  vector<int> steps{0};
+  for (size_t step = len; step < slots; step *= 2) {
+    steps.push_back(-static_cast<int>(step));
+  }
+  for (int i = 1; i < len; i *= 2) {
+    steps.push_back(i);
+  }
+  return steps;
 }
@@ -2,7 +2,10 @@
 
 #include <seal/seal.h>
 
+#include <vector>
+
 #include "ckks_evaluator.h"
+#include "thread_pool.h"
 
 using namespace std;
 using namespace seal;
@@ -11,10 +14,34 @@ class LNEvaluator {
  private:
   CKKSEvaluator *ckks = nullptr;
 
+  void multiply_i_inplace(Ciphertext &x, double sign);
+
  public:
+  // Range of the variance and the relative precision of its inverse square root,
+  // from which the approximation and its iteration count are planned
+  double var_lo = 1.0, var_hi = 100.0, precision = 1e-3;
+  // Number of features per token, and the affine parameters; an empty gamma or
+  // beta stands for ones or zeros
+  int hidden = 768;
+  vector<double> gamma, beta;
+
   LNEvaluator(CKKSEvaluator &ckks) {
     this->ckks = &ckks;
   }
 
-  void layer_norm(Ciphertext &x, Ciphertext &res, int len);
+  /*
+    x holds hidden features followed by zeros in its first len slots, len a power
+    of two. x is repeated across the ciphertext and x + i x^2 is reduced by one
+    rotate-and-sum ladder, after which the real and imaginary parts give the mean
+    and the variance in every slot. gamma rides on the centered input, which has
+    levels to spare, and beta is added as a plaintext. res holds
+    gamma * (x - mean) / sqrt(var) + beta in the first hidden slots and zeros after.
+    Needs the Galois keys for power-of-two rotations and complex conjugation.
+  */
+  void layer_norm(const Ciphertext &x, Ciphertext &res, int len);
+  // Evaluates each ciphertext of x independently on the pool; res may be x
+  void layer_norm(const vector<Ciphertext> &x, vector<Ciphertext> &res, int len, ThreadPool &pool = ThreadPool::shared());
+
+  // The Galois steps layer_norm rotates by within slots, with 0 for the conjugation
+  static vector<int> rotation_steps(int len, size_t slots);
 };
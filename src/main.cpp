@@ -11,6 +11,7 @@
 #include "gelu.h"
 #include "layer_norm.h"
 #include "matrix_mul.h"
+#include "rotation_keys.h"
 #include "softmax.h"
 
 using namespace std;
@@ -57,8 +58,16 @@ int main() {
   keygen.create_public_key(public_key);
   RelinKeys relin_keys;
   keygen.create_relin_keys(relin_keys);
+  // GELU over the full slots needs no rotation
   GaloisKeys galois_keys;
-  keygen.create_galois_keys(galois_keys);
+  GaloisKeyPlanner planner(context);
+  if (TEST_TARGET == TEST_TARGETS[3]) {
+    planner.add_steps(LNEvaluator::rotation_steps(1024, poly_modulus_degree / 2));
+  }
+  if (TEST_TARGET == TEST_TARGETS[4]) {
+    planner.add_steps(SoftmaxEvaluator::rotation_steps(128, false));
+  }
+  planner.create(keygen, galois_keys);
 
   Encryptor encryptor(context, public_key);
   CKKSEncoder encoder(context);
@@ -187,8 +196,8 @@ void argmax_test() {
   int logq = 51;
   int log_special_prime = 58;
 
-  // QuickMax: 17
-  int main_mod_count = 17;  // Mod count after bootstrapping: 18
+  // Two tournament rounds of 10 levels fit between bootstraps
+  int main_mod_count = 21;  // Mod count after bootstrapping: 22
   // Subsum 1 + coefftoslot 2 + ModReduction 9 + slottocoeff 2
   int bs_mod_count = 14;
   int total_level = main_mod_count + bs_mod_count;
@@ -223,6 +232,27 @@ void argmax_test() {
 
   SEALContext context(parms, true, sec_level_type::none);
 
+  double num;
+  int argmax_input_size = 0;
+  vector<double> argmax_input, argmax_calibration;
+
+  ifstream input_file("../data/input/argmax_input_8.txt");
+  while (input_file >> num) {
+    argmax_input.push_back(num);
+    argmax_input_size++;
+  }
+  input_file.close();
+
+  // argmax works on the input and its duplicate, so the bootstraps only need
+  // 2 * argmax_input_size slots
+  long argmax_logn = static_cast<long>(log2(2 * argmax_input_size));
+
+  ifstream calibration_file("../data/calibration/argmax_calibration_8.txt");
+  while (calibration_file >> num) {
+    argmax_calibration.push_back(num);
+  }
+  calibration_file.close();
+
   KeyGenerator keygen(context);
   SecretKey secret_key = keygen.secret_key();
   PublicKey public_key;
@@ -230,7 +260,9 @@ void argmax_test() {
   RelinKeys relin_keys;
   keygen.create_relin_keys(relin_keys);
   GaloisKeys galois_keys;
-  keygen.create_galois_keys(galois_keys);
+  GaloisKeyPlanner planner(context);
+  planner.add_steps(ArgmaxEvaluator::rotation_steps(argmax_input_size));
+  planner.create(keygen, galois_keys);
   GaloisKeys bootstrapping_keys;
 
   CKKSEncoder encoder(context);
@@ -239,59 +271,23 @@ void argmax_test() {
   Decryptor decryptor(context, secret_key);
 
   CKKSEvaluator ckks_evaluator(context, encryptor, decryptor, encoder, evaluator, scale, relin_keys, galois_keys);
-  Bootstrapper bootstrapper(loge, logn, logN - 1, total_level, scale, boundary_K, deg, scale_factor, inverse_deg,
+  Bootstrapper bootstrapper(loge, argmax_logn, logN - 1, total_level, scale, boundary_K, deg, scale_factor, inverse_deg,
                             context, keygen, encoder, encryptor, decryptor, evaluator,
                             relin_keys, bootstrapping_keys);
 
   cout << "Generating Optimal Minimax Polynomials..." << endl;
   bootstrapper.prepare_mod_polynomial();
 
-  cout << "Adding Bootstrapping Keys..." << endl;
-  vector<int> gal_steps_vector;
-  gal_steps_vector.push_back(0);
-  for (int i = 0; i < logN - 1; i++) {
-    gal_steps_vector.push_back((1 << i));
-  }
-  bootstrapper.addLeftRotKeys_Linear_to_vector_3(gal_steps_vector);
-  keygen.create_galois_keys(gal_steps_vector, bootstrapping_keys);
-  bootstrapper.slot_vec.push_back(logn);
-
-  cout << "Generating Linear Transformation Coefficients..." << endl;
-  bootstrapper.generate_LT_coefficient_3();
+  cout << "Generating Linear Transformation Coefficients and Bootstrapping Keys..." << endl;
+  bootstrapper.change_logn(argmax_logn);
 
   ArgmaxEvaluator argmax_evaluator(ckks_evaluator, bootstrapper);
 
-  size_t slot_count = encoder.slot_count();
-
   Plaintext plain_input;
   Ciphertext cipher_input;
   Ciphertext cipher_output;
-  vector<double> output;
-  vector<double> input(slot_count, 0.0);
-
-  double num;
-  int argmax_input_size = 0;
-  vector<double> argmax_input(sparse_slots, 0.0), argmax_calibration;
 
-  ifstream input_file("../data/input/argmax_input_8.txt");
-  while (input_file >> num) {
-    argmax_input[argmax_input_size] = num;
-    argmax_input_size++;
-  }
-  input_file.close();
-
-  ifstream calibration_file("../data/calibration/argmax_calibration_8.txt");
-  while (calibration_file >> num) {
-    argmax_calibration.push_back(num);
-  }
-  calibration_file.close();
-
-  // Sparse input (TODO: create a dedicated encoding function: encode_sparse in ckks evaluator)
-  for (size_t i = 0; i < slot_count; i++) {
-    input[i] = argmax_input[i % sparse_slots];
-  }
-
-  ckks_evaluator.encoder->encode(input, scale, plain_input);
+  ckks_evaluator.encode_sparse(argmax_input, 1 << argmax_logn, scale, plain_input);
   ckks_evaluator.encryptor->encrypt(plain_input, cipher_input);
 
   // Mod switch to remaining level
@@ -299,6 +295,9 @@ void argmax_test() {
     ckks_evaluator.evaluator->mod_switch_to_next_inplace(cipher_input);
   }
 
+  auto plan = argmax_evaluator.plan(argmax_input_size, main_mod_count, main_mod_count);
+  cout << "[Argmax] " << plan.bootstraps << " bootstrap(s) planned" << endl;
+
   auto start = high_resolution_clock::now();
   argmax_evaluator.argmax(cipher_input, cipher_output, argmax_input_size);
   auto end = high_resolution_clock::now();
@@ -326,11 +325,12 @@ void MM_test() {
   keygen.create_relin_keys(relin_keys);
   GaloisKeys galois_keys;
 
-  std::vector<std::uint32_t> rots;
+  // The automorphisms of the ciphertext expansion
+  GaloisKeyPlanner planner(context);
   for (int i = 0; i < logN; i++) {
-    rots.push_back((poly_modulus_degree + exponentiate_uint(2, i)) / exponentiate_uint(2, i));
+    planner.add_galois_elt((poly_modulus_degree + exponentiate_uint(2, i)) / exponentiate_uint(2, i));
   }
-  keygen.create_galois_keys(rots, galois_keys);
+  planner.create(keygen, galois_keys);
 
   Encryptor encryptor(context, public_key);
   CKKSEncoder encoder(context);
@@ -0,0 +1,293 @@
+#include "managed_eval.h"
+
+#include <cmath>
+#include <stdexcept>
+
+int ManagedEvaluator::level(const ManagedCiphertext &a) const {
+  return static_cast<int>(ckks->context->get_context_data(a.ct.parms_id())->chain_index());
+}
+
+parms_id_type ManagedEvaluator::parms_id_at(int level) const {
+  for (auto context_data = ckks->context->first_context_data(); context_data;
+       context_data = context_data->next_context_data()) {
+    if (context_data->chain_index() == static_cast<size_t>(level)) {
+      return context_data->parms_id();
+    }
+  }
+  throw invalid_argument("level is not in the modulus chain");
+}
+
+double ManagedEvaluator::prime(int level) const {
+  auto context_data = ckks->context->get_context_data(parms_id_at(level));
+  return static_cast<double>(context_data->parms().coeff_modulus().back().value());
+}
+
+void ManagedEvaluator::lift(ManagedCiphertext &a, double value, double scale) {
+  ckks->evaluator->multiply_const_inplace(a.ct, value, scale / a.ct.scale());
+  a.ct.scale() = scale;
+  a.pending = true;
+}
+
+// The factor is encoded at target * q / scale, so the next rescale lands exactly on the target scale
+void ManagedEvaluator::apply_factor(ManagedCiphertext &a) {
+  if (a.factor == 1.0) {
+    return;
+  }
+  rescale_inplace(a);
+  lift(a, a.factor, ckks->scale * prime(level(a)));
+  a.factor = 1.0;
+}
+
+void ManagedEvaluator::drop_to(ManagedCiphertext &a, int level) {
+  if (this->level(a) > level && a.pending) {
+    rescale_inplace(a);
+  }
+  if (this->level(a) > level) {
+    ckks->evaluator->mod_switch_to_inplace(a.ct, parms_id_at(level));
+  }
+}
+
+const ManagedCiphertext &ManagedEvaluator::align(
+    ManagedCiphertext &a, const ManagedCiphertext &b, ManagedCiphertext &tmp) {
+  const ManagedCiphertext *y = &b;
+  auto own = [&]() -> ManagedCiphertext & {
+    if (y != &tmp) {
+      tmp = *y;
+      y = &tmp;
+    }
+    return tmp;
+  };
+
+  int common = min(level(a), level(b));
+  drop_to(a, common);
+  if (level(b) > common) {
+    drop_to(own(), common);
+  }
+
+  double ratio = y->factor / a.factor;
+  if (a.pending && !y->pending) {
+    ManagedCiphertext &t = own();
+    lift(t, ratio, a.ct.scale());
+    t.factor = a.factor;
+  } else if (!a.pending && y->pending) {
+    lift(a, 1.0 / ratio, y->ct.scale());
+    a.factor = y->factor;
+  } else if (ratio == -1.0 && fabs(a.ct.scale() / y->ct.scale() - 1.0) <= scale_tolerance) {
+    // Opposite factors, which a subtraction of like operands produces, only need a negation
+    ManagedCiphertext &t = own();
+    ckks->evaluator->negate_inplace(t.ct);
+    t.ct.scale() = a.ct.scale();
+    t.factor = a.factor;
+  } else if (ratio != 1.0 || fabs(a.ct.scale() / y->ct.scale() - 1.0) > scale_tolerance) {
+    // Neither side can absorb the difference for free, so both move onto a fresh
+    // pending scale; the rescale this owes is the level the difference costs
+    if (a.pending) {
+      rescale_inplace(a);
+      rescale_inplace(own());
+    }
+    double scale = ckks->scale * prime(level(a));
+    ManagedCiphertext &t = own();
+    lift(t, ratio, scale);
+    t.factor = a.factor;
+    lift(a, 1.0, scale);
+  } else if (a.ct.scale() != y->ct.scale()) {
+    own().ct.scale() = a.ct.scale();
+  }
+  return *y;
+}
+
+void ManagedEvaluator::add_inplace(ManagedCiphertext &a, const ManagedCiphertext &b) {
+  ManagedCiphertext tmp;
+  const ManagedCiphertext &y = align(a, b, tmp);
+  ckks->evaluator->add_inplace(a.ct, y.ct);
+}
+
+void ManagedEvaluator::add(const ManagedCiphertext &a, const ManagedCiphertext &b, ManagedCiphertext &dest) {
+  if (&b == &dest) {
+    add_inplace(dest, a);
+  } else {
+    dest = a;
+    add_inplace(dest, b);
+  }
+}
+
+// a - b = -(-a + b), which needs no copy of b
+void ManagedEvaluator::sub_inplace(ManagedCiphertext &a, const ManagedCiphertext &b) {
+  if (&a == &b) {
+    ManagedCiphertext b_copy = b;
+    sub_inplace(a, b_copy);
+    return;
+  }
+  a.factor = -a.factor;
+  add_inplace(a, b);
+  a.factor = -a.factor;
+}
+
+void ManagedEvaluator::sub(const ManagedCiphertext &a, const ManagedCiphertext &b, ManagedCiphertext &dest) {
+  if (&b == &dest) {
+    negate_inplace(dest);
+    add_inplace(dest, a);
+  } else {
+    dest = a;
+    sub_inplace(dest, b);
+  }
+}
+
+void ManagedEvaluator::negate_inplace(ManagedCiphertext &a) {
+  a.factor = -a.factor;
+}
+
+void ManagedEvaluator::add_const_inplace(ManagedCiphertext &a, double value) {
+  ckks->evaluator->add_const_inplace(a.ct, value / a.factor);
+}
+
+void ManagedEvaluator::multiply_vector_inplace(ManagedCiphertext &a, const vector<double> &values) {
+  rescale_inplace(a);
+  vector<double> folded;
+  const vector<double> *v = &values;
+  if (a.factor != 1.0) {
+    folded = values;
+    for (double &value : folded) {
+      value *= a.factor;
+    }
+    v = &folded;
+  }
+  double scale = ckks->scale * prime(level(a));
+  ckks->evaluator->multiply_plain_inplace(a.ct, *ckks->encode_vector(*v, a.ct.parms_id(), scale / a.ct.scale()));
+  a.ct.scale() = scale;
+  a.factor = 1.0;
+  a.pending = true;
+}
+
+void ManagedEvaluator::multiply_const_inplace(ManagedCiphertext &a, double value) {
+  if (value == 0.0) {
+    throw invalid_argument("cannot defer a multiplication by zero");
+  }
+  a.factor *= value;
+}
+
+const ManagedCiphertext &ManagedEvaluator::prepare_product(
+    ManagedCiphertext &a, const ManagedCiphertext &b, ManagedCiphertext &tmp) {
+  const ManagedCiphertext *y = &b;
+  auto own = [&]() -> ManagedCiphertext & {
+    if (y != &tmp) {
+      tmp = *y;
+      y = &tmp;
+    }
+    return tmp;
+  };
+
+  rescale_inplace(a);
+  if (y->pending) {
+    rescale_inplace(own());
+  }
+
+  // Fold both factors into the higher operand, where the level is free
+  double factor = a.factor * y->factor;
+  if (factor != 1.0) {
+    if (level(*y) > level(a)) {
+      ManagedCiphertext &t = own();
+      t.factor = factor;
+      apply_factor(t);
+      rescale_inplace(t);
+      a.factor = 1.0;
+    } else {
+      a.factor = factor;
+      apply_factor(a);
+      rescale_inplace(a);
+    }
+  }
+
+  int common = min(level(a), level(*y));
+  drop_to(a, common);
+  if (level(*y) > common) {
+    drop_to(own(), common);
+  }
+  return *y;
+}
+
+void ManagedEvaluator::multiply_inplace(ManagedCiphertext &a, const ManagedCiphertext &b) {
+  if (&a == &b) {
+    square_inplace(a);
+    return;
+  }
+
+  ManagedCiphertext tmp;
+  const ManagedCiphertext &y = prepare_product(a, b, tmp);
+  ckks->evaluator->multiply_inplace(a.ct, y.ct);
+  a.factor = 1.0;
+  a.pending = true;
+}
+
+// Accumulates straight into acc when it is an earlier product of the same level
+// and scale, and otherwise falls back to a product and an aligned addition
+void ManagedEvaluator::multiply_accumulate(ManagedCiphertext a, const ManagedCiphertext &b, ManagedCiphertext &acc) {
+  ManagedCiphertext tmp;
+  const ManagedCiphertext &y = prepare_product(a, b, tmp);
+  double scale = a.ct.scale() * y.ct.scale();
+  if (acc.ct.size() == 0) {
+    ckks->evaluator->multiply_accumulate(a.ct, y.ct, acc.ct);
+    acc.factor = 1.0;
+    acc.pending = true;
+  } else if (&b != &acc && acc.pending && acc.factor == 1.0 && level(acc) == level(a) &&
+             fabs(acc.ct.scale() / scale - 1.0) <= scale_tolerance) {
+    double acc_scale = acc.ct.scale();
+    acc.ct.scale() = scale;
+    ckks->evaluator->multiply_accumulate(a.ct, y.ct, acc.ct);
+    acc.ct.scale() = acc_scale;
+  } else {
+    ckks->evaluator->multiply_inplace(a.ct, y.ct);
+    a.factor = 1.0;
+    a.pending = true;
+    add_inplace(acc, a);
+  }
+}
+
+void ManagedEvaluator::multiply(const ManagedCiphertext &a, const ManagedCiphertext &b, ManagedCiphertext &dest) {
+  if (&b == &dest) {
+    multiply_inplace(dest, a);
+  } else {
+    dest = a;
+    multiply_inplace(dest, b);
+  }
+}
+
+void ManagedEvaluator::square_inplace(ManagedCiphertext &a) {
+  rescale_inplace(a);
+  if (a.factor != 1.0) {
+    apply_factor(a);
+    rescale_inplace(a);
+  }
+  ckks->evaluator->square_inplace(a.ct);
+  a.pending = true;
+}
+
+void ManagedEvaluator::rotate(const ManagedCiphertext &a, int step, ManagedCiphertext &dest) {
+  dest = a;
+  rotate_inplace(dest, step);
+}
+
+void ManagedEvaluator::rotate_inplace(ManagedCiphertext &a, int step) {
+  if (a.ct.size() > 2) {
+    ckks->evaluator->relinearize_inplace(a.ct, *ckks->relin_keys);
+  }
+  ckks->evaluator->rotate_vector_inplace(a.ct, step, *ckks->galois_keys);
+}
+
+void ManagedEvaluator::rescale_inplace(ManagedCiphertext &a) {
+  if (a.pending) {
+    ckks->evaluator->relinearize_rescale_inplace(a.ct, *ckks->relin_keys);
+    a.pending = false;
+  }
+}
+
+void ManagedEvaluator::resolve(ManagedCiphertext &a) {
+  apply_factor(a);
+  rescale_inplace(a);
+}
+
+void ManagedEvaluator::resolve(const ManagedCiphertext &a, Ciphertext &dest) {
+  ManagedCiphertext tmp = a;
+  resolve(tmp);
+  dest = std::move(tmp.ct);
+}
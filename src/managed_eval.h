@@ -0,0 +1,109 @@
+#pragma once
+
+#include <seal/seal.h>
+
+#include "ckks_evaluator.h"
+
+using namespace std;
+using namespace seal;
+
+/*
+  A ciphertext together with the bookkeeping ManagedEvaluator needs to place
+  levels and scales by itself. Its value is factor * Decode(ct) / ct.scale().
+
+  factor is a plaintext scalar that has not been multiplied in yet. Deferring it
+  lets the evaluator fold it into a later constant, into the operand of a product
+  that has a level to spare, or into the scale lift of an addition, instead of
+  spending a level where it was written.
+
+  pending marks a ciphertext whose rescale is still owed: ct.scale() is then
+  about target * q for the last prime q of its level. A pending product is also
+  left unrelinearized, so sums of products share a single key switch as well as
+  a single rescale; relinearization happens in the fused step right before the
+  rescale, or before a rotation.
+*/
+struct ManagedCiphertext {
+  Ciphertext ct;
+  double factor = 1.0;
+  bool pending = false;
+
+  ManagedCiphertext() = default;
+  explicit ManagedCiphertext(Ciphertext ct) : ct(std::move(ct)) {}
+};
+
+/*
+  Level and scale management for CKKS code written against ManagedCiphertext.
+
+  Operands are aligned lazily where they meet. A pending operand above the other
+  is rescaled, since it owes that rescale anyway; any remaining gap is closed by
+  mod-switching the higher operand. A non-pending operand added to a pending one
+  is lifted onto its exact scale by a constant encoded at the scale ratio, which
+  costs no level. Constants are encoded at the level and scale where they are
+  consumed, and rescaling only happens when a product or resolve() needs it.
+
+  Products never carry a deferred factor forward, so the magnitude inside ct
+  stays bounded: the factor is folded into whichever operand sits higher, for
+  free, or into the left operand at the cost of one level.
+*/
+class ManagedEvaluator {
+ public:
+  ManagedEvaluator(CKKSEvaluator &ckks) {
+    this->ckks = &ckks;
+  }
+
+  void add(const ManagedCiphertext &a, const ManagedCiphertext &b, ManagedCiphertext &dest);
+  void add_inplace(ManagedCiphertext &a, const ManagedCiphertext &b);
+  void sub(const ManagedCiphertext &a, const ManagedCiphertext &b, ManagedCiphertext &dest);
+  void sub_inplace(ManagedCiphertext &a, const ManagedCiphertext &b);
+  void negate_inplace(ManagedCiphertext &a);
+
+  void add_const_inplace(ManagedCiphertext &a, double value);
+  // Slot-wise product with plaintext values, which absorb the deferred factor.
+  // They are encoded through the plaintext cache at the scale that makes the owed
+  // rescale land on the target.
+  void multiply_vector_inplace(ManagedCiphertext &a, const vector<double> &values);
+  // Deferred; throws for zero, which would make later constants unbounded
+  void multiply_const_inplace(ManagedCiphertext &a, double value);
+
+  void multiply(const ManagedCiphertext &a, const ManagedCiphertext &b, ManagedCiphertext &dest);
+  void multiply_inplace(ManagedCiphertext &a, const ManagedCiphertext &b);
+  // acc += a * b; sums of products built this way share one relinearization and
+  // skip the size-3 temporary of each product. An empty acc starts the sum.
+  void multiply_accumulate(ManagedCiphertext a, const ManagedCiphertext &b, ManagedCiphertext &acc);
+  void square_inplace(ManagedCiphertext &a);
+
+  void rotate(const ManagedCiphertext &a, int step, ManagedCiphertext &dest);
+  void rotate_inplace(ManagedCiphertext &a, int step);
+
+  // Performs an owed rescale but keeps the factor deferred
+  void rescale_inplace(ManagedCiphertext &a);
+
+  // Applies the factor and the owed rescale; a.ct is then an ordinary ciphertext
+  void resolve(ManagedCiphertext &a);
+  void resolve(const ManagedCiphertext &a, Ciphertext &dest);
+
+  int level(const ManagedCiphertext &a) const;
+
+ private:
+  CKKSEvaluator *ckks = nullptr;
+
+  // Scales within this relative distance are treated as equal, which is the
+  // approximation the unmanaged code makes when it assigns scale() by hand
+  static constexpr double scale_tolerance = 1.0 / 1024;
+
+  parms_id_type parms_id_at(int level) const;
+  double prime(int level) const;
+
+  // Multiplies ct by value encoded at scale / ct.scale(), landing exactly on scale
+  void lift(ManagedCiphertext &a, double value, double scale);
+  void apply_factor(ManagedCiphertext &a);
+  void drop_to(ManagedCiphertext &a, int level);
+
+  // Brings b to the level, scale, factor and pending state of a. Returns b itself
+  // when it already matches, and otherwise the adjusted copy made in tmp.
+  const ManagedCiphertext &align(ManagedCiphertext &a, const ManagedCiphertext &b, ManagedCiphertext &tmp);
+
+  // Brings a and b to a common level with no rescale owed and both factors folded
+  // in, ready to multiply. Returns b itself or the adjusted copy made in tmp.
+  const ManagedCiphertext &prepare_product(ManagedCiphertext &a, const ManagedCiphertext &b, ManagedCiphertext &tmp);
+};
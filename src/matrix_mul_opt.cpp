@@ -2,8 +2,10 @@
 #include "matrix_mul_opt.h"
 #include "pretty_print.h"
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <iterator>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -216,13 +218,11 @@ void MMEvaluatorOpt::matrix_encode(vector<vector<double>> &x, vector<Plaintext>
 
     INFO_PRINT("Encoding matrix of size %d x %d", rows, cols);
     
-    // encode to plaintext
-    res.reserve(rows);
-    for (int i = 0; i < rows; i++) {
-        Plaintext pt;
-        ckks->encoder->encode(x[i], ckks->scale, pt);
-        res.emplace_back(pt);
-    }
+    // encode to plaintext, sharing the encoder scratch space across rows
+    vector<Plaintext> pts;
+    ckks->encoder->encode_many(x, ckks->scale, pts);
+    res.reserve(res.size() + rows);
+    move(pts.begin(), pts.end(), back_inserter(res));
 
     OK_PRINT("Encoding is finished");
 }
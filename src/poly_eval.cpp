@@ -0,0 +1,311 @@
+#include "poly_eval.h"
+
+#include <climits>
+#include <stdexcept>
+
+namespace {
+int ceil_log2(int i) {
+  int l = 0;
+  while ((1 << l) < i) {
+    l++;
+  }
+  return l;
+}
+}  // namespace
+
+vector<double> PolyEvaluator::normalize(const Polynomial &poly) {
+  vector<double> coeffs = poly.coeffs;
+  for (size_t i = 0; i < coeffs.size(); i++) {
+    if ((poly.parity == Polynomial::Parity::odd && i % 2 == 0) ||
+        (poly.parity == Polynomial::Parity::even && i % 2 == 1)) {
+      coeffs[i] = 0;
+    }
+  }
+  coeffs.resize(degree(coeffs) + 1);
+  return coeffs;
+}
+
+int PolyEvaluator::degree(const vector<double> &coeffs) {
+  int deg = static_cast<int>(coeffs.size()) - 1;
+  while (deg >= 0 && coeffs[deg] == 0) {
+    deg--;
+  }
+  return deg;
+}
+
+bool PolyEvaluator::is_constant(const vector<double> &coeffs) {
+  return degree(coeffs) <= 0;
+}
+
+vector<int> PolyEvaluator::giant_steps(int k, int deg) {
+  vector<int> giants;
+  for (int g = k; g <= deg; g *= 2) {
+    giants.push_back(g);
+  }
+  return giants;
+}
+
+// coeffs = q * P_giant + r with deg(r) < giant. In the Chebyshev basis this uses
+// T_{g+i} = 2 T_g T_i - T_{g-i}.
+void PolyEvaluator::split(
+    const vector<double> &coeffs, int giant, Polynomial::Basis basis, vector<double> &q, vector<double> &r) {
+  int deg = degree(coeffs);
+  r.assign(coeffs.begin(), coeffs.begin() + giant);
+  q.assign(coeffs.begin() + giant, coeffs.begin() + deg + 1);
+  if (basis == Polynomial::Basis::chebyshev) {
+    for (int i = 1; i <= deg - giant; i++) {
+      q[i] *= 2;
+      r[giant - i] -= coeffs[giant + i];
+    }
+  }
+}
+
+// Powers are built as P_i = P_a * P_{i-a} with a the largest power of two below i
+// (P_i = P_{i/2}^2 for powers of two), which puts P_i exactly ceil(log2(i)) levels
+// below x. Chebyshev products additionally need T_{2a-i}.
+void PolyEvaluator::need_power(int i, Polynomial::Basis basis, map<int, bool> &needed) {
+  if (needed[i] || i <= 1) {
+    needed[i] = true;
+    return;
+  }
+  needed[i] = true;
+  int a = 1 << (ceil_log2(i) - 1);
+  need_power(a, basis, needed);
+  if (a != i - a) {
+    need_power(i - a, basis, needed);
+    if (basis == Polynomial::Basis::chebyshev) {
+      need_power(2 * a - i, basis, needed);
+    }
+  }
+}
+
+int PolyEvaluator::plan_node(
+    const vector<double> &coeffs, bool pre_rescale, int top, Polynomial::Basis basis, int k, const vector<int> &giants,
+    map<int, bool> &needed, int &mults) {
+  int deg = degree(coeffs);
+  int level = INT_MAX;
+  if (deg < k) {
+    for (int i = 1; i <= deg; i++) {
+      if (coeffs[i] != 0) {
+        need_power(i, basis, needed);
+        level = min(level, top - ceil_log2(i));
+      }
+    }
+  } else {
+    int giant = giants[ceil_log2(deg + 1) - ceil_log2(k) - 1];
+    vector<double> q, r;
+    split(coeffs, giant, basis, q, r);
+    need_power(giant, basis, needed);
+    level = top - ceil_log2(giant);
+    if (!is_constant(q)) {
+      level = min(level, plan_node(q, false, top, basis, k, giants, needed, mults));
+      mults++;
+    }
+    if (!is_constant(r)) {
+      level = min(level, plan_node(r, true, top, basis, k, giants, needed, mults));
+    }
+  }
+  return pre_rescale ? level : level - 1;
+}
+
+PolyEvaluator::Plan PolyEvaluator::plan(const vector<double> &coeffs, Polynomial::Basis basis) {
+  int deg = degree(coeffs);
+  Plan best;
+  best.depth = INT_MAX;
+  for (int log_baby = 1; (1 << (log_baby - 1)) <= deg; log_baby++) {
+    int k = 1 << log_baby;
+    map<int, bool> needed;
+    int mults = 0;
+    int level = plan_node(coeffs, false, 0, basis, k, giant_steps(k, deg), needed, mults);
+    mults += static_cast<int>(needed.size()) - 1;
+    if (-level < best.depth || (-level == best.depth && mults < best.mults)) {
+      best.log_baby = log_baby;
+      best.depth = -level;
+      best.mults = mults;
+    }
+  }
+  return best;
+}
+
+PolyEvaluator::Plan PolyEvaluator::plan(const Polynomial &poly) const {
+  vector<double> coeffs = normalize(poly);
+  if (degree(coeffs) < 1) {
+    throw invalid_argument("polynomial must have positive degree");
+  }
+  Plan result = plan(coeffs, poly.basis);
+  if (poly.basis == Polynomial::Basis::chebyshev && (poly.a != -1.0 || poly.b != 1.0)) {
+    result.depth++;
+  }
+  return result;
+}
+
+void PolyEvaluator::at_level(const Ciphertext &ct, int level, Ciphertext &dest) {
+  dest = ct;
+  if (ckks->context->get_context_data(ct.parms_id())->chain_index() > static_cast<size_t>(level)) {
+    ckks->evaluator->mod_switch_to_inplace(dest, levels[level]->parms_id());
+  }
+}
+
+double PolyEvaluator::prime(int level) const {
+  return static_cast<double>(levels[level]->parms().coeff_modulus().back().value());
+}
+
+const Ciphertext &PolyEvaluator::power(int i) {
+  auto it = powers.find(i);
+  if (it != powers.end()) {
+    return it->second;
+  }
+
+  int a = 1 << (ceil_log2(i) - 1);
+  const Ciphertext &pa = power(a);
+  const Ciphertext &pb = power(i - a);
+  size_t level_a = ckks->context->get_context_data(pa.parms_id())->chain_index();
+  size_t level_b = ckks->context->get_context_data(pb.parms_id())->chain_index();
+  int level = static_cast<int>(min(level_a, level_b));
+
+  Ciphertext res, other;
+  at_level(pa, level, res);
+  if (a == i - a) {
+    ckks->evaluator->square_inplace(res);
+  } else {
+    at_level(pb, level, other);
+    ckks->evaluator->multiply_inplace(res, other);
+  }
+
+  if (basis == Polynomial::Basis::chebyshev) {
+    // T_i = 2 T_a T_{i-a} - T_{2a-i}, with T_0 = 1; T_{2a-i} is lifted onto the
+    // product scale with a unit constant so the subtraction happens before rescaling
+    ckks->evaluator->add_inplace(res, res);
+    if (a == i - a) {
+      ckks->evaluator->add_const_inplace(res, -1.0);
+    } else {
+      at_level(power(2 * a - i), level, other);
+      ckks->evaluator->multiply_const_inplace(other, 1.0, res.scale() / other.scale());
+      other.scale() = res.scale();
+      ckks->evaluator->sub_inplace(res, other);
+    }
+  }
+  ckks->evaluator->relinearize_rescale_inplace(res, *ckks->relin_keys);
+
+  return powers.emplace(i, std::move(res)).first->second;
+}
+
+// Produces coeffs evaluated at exactly (level, scale). A normal node computes one
+// level higher at scale * q and rescales; a pre-rescale node is the remainder of
+// a split, computed directly on the not yet rescaled scale of its parent. Products
+// stay unrelinearized until the node's rescale, and the giant product is
+// accumulated straight onto the remainder, so a node and the remainders folded
+// into it share one key switch.
+// Constants are encoded at target / scale(power), so every term reaches the target
+// scale up to double rounding, which is what the scale() assignments absorb.
+void PolyEvaluator::eval_node(
+    const vector<double> &coeffs, bool pre_rescale, int level, double scale, Ciphertext &dest) {
+  int deg = degree(coeffs);
+  int work_level = pre_rescale ? level : level + 1;
+  double work_scale = pre_rescale ? scale : scale * prime(level + 1);
+
+  if (deg < k) {
+    bool first = true;
+    for (int i = 1; i <= deg; i++) {
+      if (coeffs[i] == 0) {
+        continue;
+      }
+      Ciphertext term;
+      at_level(power(i), work_level, term);
+      ckks->evaluator->multiply_const_inplace(term, coeffs[i], work_scale / term.scale());
+      term.scale() = work_scale;
+      if (first) {
+        dest = std::move(term);
+        first = false;
+      } else {
+        ckks->evaluator->add_inplace(dest, term);
+      }
+    }
+    if (coeffs[0] != 0) {
+      ckks->evaluator->add_const_inplace(dest, coeffs[0]);
+    }
+  } else {
+    int giant = giants[ceil_log2(deg + 1) - ceil_log2(k) - 1];
+    vector<double> q, r;
+    split(coeffs, giant, basis, q, r);
+
+    Ciphertext g;
+    at_level(power(giant), work_level, g);
+
+    // The remainder comes first, so that the giant product accumulates onto it
+    if (!is_constant(r)) {
+      eval_node(r, true, work_level, work_scale, dest);
+    } else {
+      dest = Ciphertext();
+    }
+    if (is_constant(q)) {
+      Ciphertext term = g;
+      ckks->evaluator->multiply_const_inplace(term, q[0], work_scale / g.scale());
+      term.scale() = work_scale;
+      if (dest.size() == 0) {
+        dest = std::move(term);
+      } else {
+        ckks->evaluator->add_inplace(dest, term);
+      }
+    } else {
+      Ciphertext quotient;
+      eval_node(q, false, work_level, work_scale / g.scale(), quotient);
+      if (dest.size() != 0) {
+        dest.scale() = quotient.scale() * g.scale();
+      }
+      ckks->evaluator->multiply_accumulate(quotient, g, dest);
+    }
+    dest.scale() = work_scale;
+
+    if (is_constant(r) && !r.empty() && r[0] != 0) {
+      ckks->evaluator->add_const_inplace(dest, r[0]);
+    }
+  }
+
+  if (!pre_rescale) {
+    ckks->evaluator->relinearize_rescale_inplace(dest, *ckks->relin_keys);
+    dest.scale() = scale;
+  }
+}
+
+void PolyEvaluator::evaluate(const Ciphertext &x, const Polynomial &poly, Ciphertext &dest) {
+  evaluate(x, poly, x.scale(), dest);
+}
+
+void PolyEvaluator::evaluate(const Ciphertext &x, const Polynomial &poly, double target_scale, Ciphertext &dest) {
+  vector<double> coeffs = normalize(poly);
+  int deg = degree(coeffs);
+  if (deg < 1) {
+    throw invalid_argument("polynomial must have positive degree");
+  }
+
+  Plan p = plan(coeffs, poly.basis);
+  basis = poly.basis;
+  k = 1 << p.log_baby;
+  giants = giant_steps(k, deg);
+
+  auto context_data = ckks->context->first_context_data();
+  levels.assign(context_data->chain_index() + 1, nullptr);
+  for (; context_data; context_data = context_data->next_context_data()) {
+    levels[context_data->chain_index()] = context_data.get();
+  }
+
+  // T_1 is x itself, or x mapped affinely onto [-1, 1] at the cost of one level
+  Ciphertext t1 = x;
+  if (basis == Polynomial::Basis::chebyshev && (poly.a != -1.0 || poly.b != 1.0)) {
+    int x_level = static_cast<int>(ckks->context->get_context_data(x.parms_id())->chain_index());
+    ckks->evaluator->multiply_const_inplace(t1, 2.0 / (poly.b - poly.a), prime(x_level));
+    ckks->evaluator->rescale_to_next_inplace(t1);
+    t1.scale() = x.scale();
+    ckks->evaluator->add_const_inplace(t1, -(poly.a + poly.b) / (poly.b - poly.a));
+  }
+  top_level = static_cast<int>(ckks->context->get_context_data(t1.parms_id())->chain_index());
+  if (p.depth > top_level) {
+    throw invalid_argument("not enough levels to evaluate the polynomial");
+  }
+
+  powers.clear();
+  powers.emplace(1, std::move(t1));
+  eval_node(coeffs, false, top_level - p.depth, target_scale, dest);
+  powers.clear();
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <seal/seal.h>
+
+#include <map>
+#include <vector>
+
+#include "ckks_evaluator.h"
+
+using namespace std;
+using namespace seal;
+
+/*
+  Baby-step giant-step (Paterson-Stockmeyer) polynomial evaluation with exact
+  scale management.
+
+  Baby steps are the powers 1..k-1 with k = 2^l, giant steps are k * 2^j. A
+  polynomial of degree >= k is split as q * G + r on the largest giant step G,
+  and both halves recurse. Every node is produced at a prescribed (level, scale):
+  the remainder r is evaluated directly at the pre-rescale scale of q * G, so it
+  costs no level, and constants are encoded at the ratio of the target scale to
+  the scale of the power they multiply. The result therefore lands on the
+  requested scale up to double rounding, which the scale() assignments after
+  each such product absorb, in ceil(log2(deg + 1)) levels (plus one for a
+  Chebyshev interval other than [-1, 1]).
+
+  l is chosen per polynomial to minimize depth first and then the number of
+  non-scalar multiplications; only the powers a plan actually touches are
+  computed.
+*/
+class PolyEvaluator {
+ public:
+  /*
+    coeffs[i] is the coefficient of x^i (power basis) or of T_i(y) (Chebyshev
+    basis, with y = (2x - a - b) / (b - a) mapping [a, b] onto [-1, 1]). A parity
+    hint drops the coefficients of the other parity, so near-zero noise left by a
+    fitting routine does not cost extra powers.
+  */
+  struct Polynomial {
+    enum class Basis { power, chebyshev };
+    enum class Parity { none, odd, even };
+
+    vector<double> coeffs;
+    Basis basis = Basis::power;
+    Parity parity = Parity::none;
+    double a = -1.0, b = 1.0;
+
+    Polynomial() = default;
+    Polynomial(vector<double> coeffs, Basis basis = Basis::power, Parity parity = Parity::none)
+        : coeffs(std::move(coeffs)), basis(basis), parity(parity) {}
+
+    static Polynomial chebyshev(vector<double> coeffs, double a, double b, Parity parity = Parity::none) {
+      Polynomial poly(std::move(coeffs), Basis::chebyshev, parity);
+      poly.a = a;
+      poly.b = b;
+      return poly;
+    }
+  };
+
+  struct Plan {
+    int log_baby = 1;
+    int depth = 0;
+    int mults = 0;
+  };
+
+  PolyEvaluator(CKKSEvaluator &ckks) {
+    this->ckks = &ckks;
+  }
+
+  // dest = poly(x) at scale x.scale()
+  void evaluate(const Ciphertext &x, const Polynomial &poly, Ciphertext &dest);
+
+  // dest = poly(x) at the given scale
+  void evaluate(const Ciphertext &x, const Polynomial &poly, double target_scale, Ciphertext &dest);
+
+  // The plan evaluate() uses; depth is the number of levels consumed
+  Plan plan(const Polynomial &poly) const;
+
+ private:
+  CKKSEvaluator *ckks = nullptr;
+
+  // State of the current evaluate() call
+  Polynomial::Basis basis = Polynomial::Basis::power;
+  int k = 2;
+  int top_level = 0;
+  vector<int> giants;
+  vector<const SEALContext::ContextData *> levels;
+  map<int, Ciphertext> powers;
+
+  static vector<double> normalize(const Polynomial &poly);
+  static int degree(const vector<double> &coeffs);
+  static bool is_constant(const vector<double> &coeffs);
+  static vector<int> giant_steps(int k, int deg);
+  static void split(
+      const vector<double> &coeffs, int giant, Polynomial::Basis basis, vector<double> &q, vector<double> &r);
+
+  // Symbolic pass over the same recursion as eval_node: the highest level a node
+  // can be produced at, with top the level of x. Collects the powers the node
+  // needs and counts its products.
+  static int plan_node(
+      const vector<double> &coeffs, bool pre_rescale, int top, Polynomial::Basis basis, int k,
+      const vector<int> &giants, map<int, bool> &needed, int &mults);
+  static void need_power(int i, Polynomial::Basis basis, map<int, bool> &needed);
+  static Plan plan(const vector<double> &coeffs, Polynomial::Basis basis);
+
+  const Ciphertext &power(int i);
+  void at_level(const Ciphertext &ct, int level, Ciphertext &dest);
+  double prime(int level) const;
+  void eval_node(const vector<double> &coeffs, bool pre_rescale, int level, double scale, Ciphertext &dest);
+};
@@ -0,0 +1,116 @@
+#include "rotation_keys.h"
+
+#include <seal/util/numth.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+void GaloisKeyPlanner::add_step(int step, size_t uses) {
+  size_t slots = context->key_context_data()->parms().poly_modulus_degree() / 2;
+  if (static_cast<size_t>(abs(step)) >= slots) {
+    throw invalid_argument("rotation step must be smaller than the slot count");
+  }
+  steps[step] += uses;
+}
+
+void GaloisKeyPlanner::add_steps(const vector<int> &steps, size_t uses) {
+  for (int step : steps) {
+    add_step(step, uses);
+  }
+}
+
+void GaloisKeyPlanner::add_galois_elt(uint32_t elt) {
+  elts.insert(elt);
+}
+
+uint32_t GaloisKeyPlanner::elt(int step) const {
+  return context->key_context_data()->galois_tool()->get_elt_from_step(step);
+}
+
+vector<int> GaloisKeyPlanner::naf_terms(int step) const {
+  vector<int> naf = util::naf(step);
+  if (step == 0 || naf.size() == 1) {
+    return {step};
+  }
+
+  // Like Evaluator::rotate_vector, drop a term of a full turn
+  int slots = static_cast<int>(context->key_context_data()->parms().poly_modulus_degree() / 2);
+  naf.erase(remove_if(naf.begin(), naf.end(), [&](int t) { return abs(t) == slots; }), naf.end());
+  return naf;
+}
+
+vector<uint32_t> GaloisKeyPlanner::galois_elts() const {
+  set<uint32_t> keys = elts;
+  vector<int> composed;
+  for (const auto &[step, uses] : steps) {
+    if (max_keys == 0 || naf_terms(step).size() == 1) {
+      keys.insert(elt(step));
+    } else {
+      composed.push_back(step);
+    }
+  }
+
+  // Steps that save the most key switches get their own key first
+  auto saved = [&](int step) { return steps.at(step) * (naf_terms(step).size() - 1); };
+  stable_sort(composed.begin(), composed.end(), [&](int a, int b) { return saved(a) > saved(b); });
+
+  vector<bool> own(composed.size(), false);
+  auto planned = [&]() {
+    set<uint32_t> all = keys;
+    for (size_t i = 0; i < composed.size(); i++) {
+      if (own[i]) {
+        all.insert(elt(composed[i]));
+      } else {
+        for (int t : naf_terms(composed[i])) {
+          all.insert(elt(t));
+        }
+      }
+    }
+    return all;
+  };
+  for (size_t i = 0; i < composed.size(); i++) {
+    own[i] = true;
+    if (planned().size() > max_keys) {
+      own[i] = false;
+    }
+  }
+
+  auto all = planned();
+  return vector<uint32_t>(all.begin(), all.end());
+}
+
+void GaloisKeyPlanner::create(KeyGenerator &keygen, GaloisKeys &keys, ThreadPool &pool) const {
+  // Keys already in keys are kept, so a workload only adds the ones it lacks
+  vector<uint32_t> all;
+  for (uint32_t e : galois_elts()) {
+    if (!keys.has_key(e)) {
+      all.push_back(e);
+    }
+  }
+  if (all.empty()) {
+    return;
+  }
+
+  size_t shares = max<size_t>(min(pool.size(), all.size()), 1);
+  vector<vector<uint32_t>> share_elts(shares);
+  for (size_t i = 0; i < all.size(); i++) {
+    share_elts[i % shares].push_back(all[i]);
+  }
+
+  vector<GaloisKeys> parts(shares);
+  pool.parallel_for(shares, [&](size_t i) { keygen.create_galois_keys(share_elts[i], parts[i]); });
+
+  // Every element has its own slot in data(), so the shares merge by moving keys over
+  size_t first = 0;
+  if (keys.data().empty()) {
+    keys = std::move(parts[0]);
+    first = 1;
+  }
+  for (size_t i = first; i < shares; i++) {
+    for (uint32_t e : share_elts[i]) {
+      size_t index = GaloisKeys::get_index(e);
+      keys.data()[index] = std::move(parts[i].data()[index]);
+    }
+  }
+  keys.precompute_shoup_operands(*context);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <seal/seal.h>
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include "thread_pool.h"
+
+using namespace std;
+using namespace seal;
+
+/*
+  Collects the rotations a workload performs and generates the Galois keys for
+  exactly those, instead of every power of two or the full LT key set.
+
+  Steps are recorded as passed to rotate_vector, sign included, with 0 standing
+  for complex conjugation as in KeyGenerator::create_galois_keys. With max_keys
+  set, a step left without a key of its own is rotated by SEAL through the terms
+  of its non-adjacent form, one key switch per term, so only those +-2^k keys
+  are kept for it. Steps are then promoted to their own key, most key switches
+  saved first, while the budget allows; a step that is itself a power of two
+  always has its own key. A budget below the NAF base set yields the base set.
+*/
+class GaloisKeyPlanner {
+ public:
+  // Largest number of keys to generate; 0 gives every step its own key
+  size_t max_keys = 0;
+
+  GaloisKeyPlanner(const SEALContext &context) : context(&context) {}
+
+  // uses weighs how often the step is applied, e.g. per bootstrap or per layer
+  void add_step(int step, size_t uses = 1);
+  void add_steps(const vector<int> &steps, size_t uses = 1);
+  // A Galois automorphism applied directly, as the ciphertext expansion does
+  void add_galois_elt(uint32_t elt);
+
+  vector<uint32_t> galois_elts() const;
+
+  // Generates the keys of galois_elts() on the pool, one share of the elements
+  // per worker, and merges them into keys; keys already there are not generated again
+  void create(KeyGenerator &keygen, GaloisKeys &keys, ThreadPool &pool = ThreadPool::shared()) const;
+
+ private:
+  const SEALContext *context = nullptr;
+  map<int, size_t> steps;
+  set<uint32_t> elts;
+
+  uint32_t elt(int step) const;
+  // The rotations SEAL falls back to for step; a single term means step needs its own key
+  vector<int> naf_terms(int step) const;
+};
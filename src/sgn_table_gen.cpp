@@ -0,0 +1,351 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <map>
+#include <vector>
+
+#include "MinicompCost.h"
+
+using namespace std;
+
+/*
+  Offline generator for sgn_tables.cpp, run from the build directory:
+
+    ./bin/sgn_table_gen > ../src/sgn_tables.cpp
+
+  For every (alpha, eps) target it searches the composition of odd minimax
+  polynomials that maps [-1, -eps] u [eps, 1] into +-[1 - 2^-alpha, 1 + 2^-alpha]
+  with the least multiplicative depth, then the fewest nonscalar multiplications.
+  Each stage is fitted by the Remez exchange below on [-1, -r] u [r, 1], where r
+  is the lower end of what the previous stage produces; the normalization onto
+  [-1, 1] is folded into that previous stage's coefficients, so every stage is an
+  odd Chebyshev series on [-1, 1] and costs exactly minicomp::dep(degree) levels.
+
+  The exchange runs in long double rather than through the NTL RR of RemezApp
+  and MinicompRemez: the stages stop at degree 63 and errors of 2^-22, well
+  within its precision. Apart from the depth and multiplication counts of
+  MinicompCost, the generator needs nothing else from the tree, nor NTL or SEAL.
+*/
+
+namespace {
+const int max_degree = 63;
+const int max_depth = 40;
+
+struct Target {
+  double alpha;
+  double eps;
+};
+
+const vector<Target> TARGETS = {
+    {8, 1.0 / 32},   {12, 1.0 / 32},   {16, 1.0 / 32},   {20, 1.0 / 32},    //
+    {8, 1.0 / 64},   {12, 1.0 / 64},   {16, 1.0 / 64},   {20, 1.0 / 64},    //
+    {8, 1.0 / 128},  {12, 1.0 / 128},  {16, 1.0 / 128},  {20, 1.0 / 128},   //
+    {8, 1.0 / 256},  {12, 1.0 / 256},  {16, 1.0 / 256},  {20, 1.0 / 256},   //
+    {8, 1.0 / 1024}, {12, 1.0 / 1024}, {16, 1.0 / 1024}, {20, 1.0 / 1024},  //
+};
+
+struct Stage {
+  int degree;
+  double error;
+  vector<double> coeffs;
+};
+
+typedef long double ld;
+
+// sum_j coeffs[j] T_{2j+1}(x)
+ld odd_chebyshev(const vector<ld> &coeffs, ld x) {
+  ld t0 = 1, t1 = x, sum = coeffs[0] * x;
+  for (size_t j = 1; j < coeffs.size(); j++) {
+    for (int step = 0; step < 2; step++) {
+      ld t2 = 2 * x * t1 - t0;
+      t0 = t1;
+      t1 = t2;
+    }
+    sum += coeffs[j] * t1;
+  }
+  return sum;
+}
+
+// Gaussian elimination with partial pivoting; false on a singular system
+bool solve(vector<vector<ld>> a, vector<ld> b, vector<ld> &x) {
+  size_t n = b.size();
+  for (size_t c = 0; c < n; c++) {
+    size_t p = c;
+    for (size_t r = c + 1; r < n; r++) {
+      if (fabsl(a[r][c]) > fabsl(a[p][c])) p = r;
+    }
+    if (fabsl(a[p][c]) < 1e-300L) {
+      return false;
+    }
+    swap(a[p], a[c]);
+    swap(b[p], b[c]);
+    for (size_t r = c + 1; r < n; r++) {
+      ld f = a[r][c] / a[c][c];
+      for (size_t k = c; k < n; k++) {
+        a[r][k] -= f * a[c][k];
+      }
+      b[r] -= f * b[c];
+    }
+  }
+  x.assign(n, 0);
+  for (size_t c = n; c-- > 0;) {
+    ld sum = b[c];
+    for (size_t k = c + 1; k < n; k++) {
+      sum -= a[c][k] * x[k];
+    }
+    x[c] = sum / a[c][c];
+  }
+  return true;
+}
+
+// Point of [a, b] where sign * (p(x) - 1) peaks, by golden-section search
+ld refine(const vector<ld> &coeffs, ld a, ld b, int sign) {
+  const ld g = (sqrtl(5.0L) - 1) / 2;
+  auto f = [&](ld x) { return sign * (odd_chebyshev(coeffs, x) - 1); };
+  ld x1 = b - g * (b - a), x2 = a + g * (b - a), f1 = f(x1), f2 = f(x2);
+  for (int i = 0; i < 80; i++) {
+    if (f1 > f2) {
+      b = x2;
+      x2 = x1;
+      f2 = f1;
+      x1 = b - g * (b - a);
+      f1 = f(x1);
+    } else {
+      a = x1;
+      x1 = x2;
+      f1 = f2;
+      x2 = a + g * (b - a);
+      f2 = f(x2);
+    }
+  }
+  return (a + b) / 2;
+}
+
+// x in [r, 1] such that x^2 follows the Chebyshev nodes of [r^2, 1]
+ld node(ld r, int i, int count) {
+  return sqrtl(r * r + (1 - r * r) * (1 - cosl(M_PIl * i / count)) / 2);
+}
+
+// Odd minimax approximation of 1 on [r, 1], hence of sgn on [-1, -r] u [r, 1];
+// coeffs receives the odd Chebyshev coefficients and the maximum error is returned
+ld remez(int degree, ld r, vector<ld> &coeffs) {
+  int n = (degree + 1) / 2, m = n + 1, grid = 200 * m;
+  vector<ld> ref(m), best;
+  for (int i = 0; i < m; i++) {
+    ref[i] = node(r, i, m - 1);
+  }
+  ld best_error = 1e30L;
+  for (int iter = 0; iter < 200; iter++) {
+    // p(ref[i]) + (-1)^i E = 1
+    vector<vector<ld>> a(m, vector<ld>(m));
+    vector<ld> b(m, 1), sol;
+    for (int i = 0; i < m; i++) {
+      ld x = ref[i], t0 = 1, t1 = x;
+      a[i][0] = x;
+      for (int j = 1; j < n; j++) {
+        for (int step = 0; step < 2; step++) {
+          ld t2 = 2 * x * t1 - t0;
+          t0 = t1;
+          t1 = t2;
+        }
+        a[i][j] = t1;
+      }
+      a[i][n] = i % 2 ? -1 : 1;
+    }
+    if (!solve(a, b, sol)) break;
+    coeffs.assign(sol.begin(), sol.begin() + n);
+
+    // Local extrema of the error on a fine grid, refined in between grid points
+    vector<ld> xs(grid + 1), es(grid + 1);
+    for (int i = 0; i <= grid; i++) {
+      xs[i] = node(r, i, grid);
+      es[i] = odd_chebyshev(coeffs, xs[i]) - 1;
+    }
+    vector<pair<ld, ld>> extrema;
+    for (int i = 0; i <= grid; i++) {
+      bool inner = i > 0 && i < grid;
+      if (inner && !((es[i] >= es[i - 1] && es[i] >= es[i + 1]) || (es[i] <= es[i - 1] && es[i] <= es[i + 1]))) {
+        continue;
+      }
+      ld x = inner ? refine(coeffs, xs[i - 1], xs[i + 1], es[i] > 0 ? 1 : -1) : xs[i];
+      extrema.push_back({x, odd_chebyshev(coeffs, x) - 1});
+    }
+
+    // Keep the largest of each run of equal sign, then trim to m alternating points
+    vector<pair<ld, ld>> alt;
+    for (const auto &e : extrema) {
+      if (!alt.empty() && (alt.back().second > 0) == (e.second > 0)) {
+        if (fabsl(e.second) > fabsl(alt.back().second)) alt.back() = e;
+      } else {
+        alt.push_back(e);
+      }
+    }
+    while (static_cast<int>(alt.size()) > m) {
+      if (fabsl(alt.front().second) < fabsl(alt.back().second))
+        alt.erase(alt.begin());
+      else
+        alt.pop_back();
+    }
+
+    ld max_error = 0, min_error = 1e30L;
+    for (const auto &e : extrema) {
+      max_error = max(max_error, fabsl(e.second));
+    }
+    for (const auto &e : alt) {
+      min_error = min(min_error, fabsl(e.second));
+    }
+    if (max_error < best_error) {
+      best_error = max_error;
+      best = coeffs;
+    }
+    if (static_cast<int>(alt.size()) < m) break;
+    for (int i = 0; i < m; i++) {
+      ref[i] = alt[i].first;
+    }
+    if ((max_error - min_error) / max_error < 1e-12L) break;
+  }
+  coeffs = best;
+  return best_error;
+}
+
+// Odd minimax approximation of sgn on [-1, -r] u [r, 1], memoized since the
+// searches below revisit the same prefixes
+const Stage &fit(int degree, double r) {
+  static map<pair<int, double>, Stage> cache;
+  auto it = cache.find({degree, r});
+  if (it != cache.end()) {
+    return it->second;
+  }
+
+  vector<ld> coeffs;
+  ld error = remez(degree, r, coeffs);
+  Stage stage{degree, static_cast<double>(error), vector<double>(degree + 1, 0.0)};
+  for (int j = 0; j < static_cast<int>(coeffs.size()); j++) {
+    stage.coeffs[2 * j + 1] = static_cast<double>(coeffs[j]);
+  }
+  return cache.emplace(make_pair(degree, r), stage).first->second;
+}
+
+// Fits the stages of a composition in turn; returns false once a stage no longer
+// separates the two intervals
+bool compose(const vector<int> &degrees, double eps, vector<Stage> &stages) {
+  stages.clear();
+  double r = eps;
+  for (int degree : degrees) {
+    const Stage &stage = fit(degree, r);
+    if (stage.error >= 1) {
+      return false;
+    }
+    stages.push_back(stage);
+    r = (1 - stage.error) / (1 + stage.error);
+  }
+  return true;
+}
+
+int depth(const vector<int> &degrees) {
+  int d = 0;
+  for (int degree : degrees) {
+    d += minicomp::dep(degree);
+  }
+  return d;
+}
+
+int mults(const vector<int> &degrees) {
+  int m = 0;
+  for (int degree : degrees) {
+    m += minicomp::mult(degree);
+  }
+  return m;
+}
+
+// Collects in best the composition of at most budget levels, built from the
+// largest degree of each depth, with the fewest multiplications and then the
+// smallest error
+void search(double r, int budget, double target, vector<int> &prefix, vector<int> &best, double &best_error) {
+  for (int d = 2; d <= budget && (1 << d) - 1 <= max_degree; d++) {
+    int degree = (1 << d) - 1;
+    const Stage &stage = fit(degree, r);
+    if (stage.error >= 1) {
+      continue;
+    }
+    prefix.push_back(degree);
+    if (stage.error <= target) {
+      if (best.empty() || mults(prefix) < mults(best) || (mults(prefix) == mults(best) && stage.error < best_error)) {
+        best = prefix;
+        best_error = stage.error;
+      }
+    } else {
+      double next = (1 - stage.error) / (1 + stage.error);
+      if (next > r) {
+        search(next, budget - d, target, prefix, best, best_error);
+      }
+    }
+    prefix.pop_back();
+  }
+}
+
+// Lowers each stage to the smallest degree of the same depth that still meets
+// the target, which saves multiplications at no cost in depth
+void trim(vector<int> &degrees, double eps, double target) {
+  vector<Stage> stages;
+  for (size_t i = 0; i < degrees.size(); i++) {
+    int current = degrees[i];
+    for (int degree = 3; degree < current; degree += 2) {
+      if (minicomp::dep(degree) != minicomp::dep(current)) {
+        continue;
+      }
+      degrees[i] = degree;
+      if (compose(degrees, eps, stages) && stages.back().error <= target) {
+        break;
+      }
+      degrees[i] = current;
+    }
+  }
+}
+
+void print_table(const Target &t) {
+  double target = pow(2.0, -t.alpha);
+  vector<int> degrees;
+  double error = 0;
+  for (int budget = 2; budget <= max_depth && degrees.empty(); budget++) {
+    vector<int> prefix;
+    search(t.eps, budget, target, prefix, degrees, error);
+  }
+  if (degrees.empty()) {
+    fprintf(stderr, "no composition within %d levels for alpha = %g, eps = %g\n", max_depth, t.alpha, t.eps);
+    return;
+  }
+  trim(degrees, t.eps, target);
+
+  vector<Stage> stages;
+  compose(degrees, t.eps, stages);
+  printf("    // alpha = %g, eps = 2^%g: degrees", t.alpha, log2(t.eps));
+  for (int degree : degrees) {
+    printf(" %d", degree);
+  }
+  printf(", %d mults, error 2^%.2f\n", mults(degrees), log2(stages.back().error));
+  printf("    {%g, %.17g, %d, {\n", t.alpha, t.eps, depth(degrees));
+  for (size_t i = 0; i < stages.size(); i++) {
+    // The next stage expects its input on [-1, 1]
+    double norm = i + 1 < stages.size() ? 1 + stages[i].error : 1.0;
+    printf("        {");
+    for (size_t j = 0; j < stages[i].coeffs.size(); j++) {
+      printf(j == 0 ? "%.17g" : ", %.17g", stages[i].coeffs[j] / norm);
+    }
+    printf("},\n");
+  }
+  printf("    }},\n");
+}
+}  // namespace
+
+int main() {
+  printf("// Generated by sgn_table_gen (src/sgn_table_gen.cpp): ./bin/sgn_table_gen > ../src/sgn_tables.cpp\n");
+  printf("// Do not edit.\n\n");
+  printf("#include \"sgn_tables.h\"\n\n");
+  printf("const vector<SgnTable> SGN_TABLES = {\n");
+  for (const Target &t : TARGETS) {
+    print_table(t);
+  }
+  printf("};\n");
+  return 0;
+}
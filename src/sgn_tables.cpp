@@ -0,0 +1,118 @@
+// Generated by sgn_table_gen (src/sgn_table_gen.cpp): ./bin/sgn_table_gen > ../src/sgn_tables.cpp
+// Do not edit.
+
+#include "sgn_tables.h"
+
+const vector<SgnTable> SGN_TABLES = {
+    // alpha = 8, eps = 2^-5: degrees 13 15, 15 mults, error 2^-8.55
+    {8, 0.03125, 8, {
+        {0, 0.83406896549965093, 0, -0.27879444231083722, 0, 0.1682852320275055, 0, -0.12144738668739777, 0, 0.096024007400902764, 0, -0.080611977558629908, 0, 0.38247560162880573},
+        {0, 1.2626828657644995, 0, -0.39358823715157759, 0, 0.20596629457449905, 0, -0.11898411911920845, 0, 0.068684726467200072, 0, -0.037578810314677143, 0, 0.01850208568820207, 0, -0.0083578557600334346},
+    }},
+    // alpha = 12, eps = 2^-5: degrees 11 27, 16 mults, error 2^-12.54
+    {12, 0.03125, 9, {
+        {0, 0.80716671009850427, 0, -0.27049168190333484, 0, 0.16419095571637904, 0, -0.11966384163667385, 0, 0.096179509393122184, 0, -0.41030343564508598},
+        {0, 1.2677694205896881, 0, -0.40824710296589906, 0, 0.22849760168979388, 0, -0.14687505848423263, 0, 0.099020043805718438, 0, -0.067492594711395168, 0, 0.045583187940755283, 0, -0.030081331559154177, 0, 0.019163785278207304, 0, -0.011635807678124981, 0, 0.0066254409666757531, 0, -0.0034539216794608873, 0, 0.0015801850744272038, 0, -0.00062187788470460434},
+    }},
+    // alpha = 16, eps = 2^-5: degrees 13 31, 19 mults, error 2^-16.41
+    {16, 0.03125, 9, {
+        {0, 0.83406896549965093, 0, -0.27879444231083722, 0, 0.1682852320275055, 0, -0.12144738668739777, 0, 0.096024007400902764, 0, -0.080611977558629908, 0, 0.38247560162880573},
+        {0, 1.2675205949702124, 0, -0.40753249209408787, 0, 0.22740731071515854, 0, -0.14554207316302742, 0, 0.097598111155864781, 0, -0.066131731455880596, 0, 0.044407512044291414, 0, -0.029173202381706662, 0, 0.018556711777458424, 0, -0.011316625391540118, 0, 0.0065443338565699784, 0, -0.0035394065236540829, 0, 0.0017554782311646046, 0, -0.00077381887733812154, 0, 0.00028577009697541459, 0, -7.7964077071871523e-05},
+    }},
+    // alpha = 20, eps = 2^-5: degrees 7 7 15, 18 mults, error 2^-22.20
+    {20, 0.03125, 10, {
+        {0, 0.75078790233062687, 0, -0.25542764595361411, 0, 0.16074369826402526, 0, -0.4796115284578914},
+        {0, 1.0879717012293126, 0, -0.3471799197277336, 0, 0.1910022840112317, 0, -0.21347530888035277},
+        {0, 1.245721608521503, 0, -0.34820402497766867, 0, 0.14587260524491555, 0, -0.059625351406256293, 0, 0.021135053174584542, 0, -0.0059598176675067895, 0, 0.0011857638380134096, 0, -0.0001260438940150129},
+    }},
+    // alpha = 8, eps = 2^-6: degrees 13 29, 18 mults, error 2^-8.48
+    {8, 0.015625, 9, {
+        {0, 0.74140312057716939, 0, -0.24861572185344352, 0, 0.15104118064968144, 0, -0.11007641871344215, 0, 0.088194978632358076, 0, -0.075294320147796093, 0, 0.45334718085547282},
+        {0, 1.2703332246506156, 0, -0.41575873102929001, 0, 0.24043622821903252, 0, -0.16243199928403487, 0, 0.11717976395183129, 0, -0.087131303593908291, 0, 0.065572892670720889, 0, -0.04938708447975021, 0, 0.03692343346903558, 0, -0.027214515692002086, 0, 0.019641090960541029, 0, -0.013773567906032701, 0, 0.009291426108950054, 0, -0.0059403908069600398, 0, 0.005055609590610321},
+    }},
+    // alpha = 12, eps = 2^-6: degrees 7 7 15, 18 mults, error 2^-12.54
+    {12, 0.015625, 10, {
+        {0, 0.69644402058625776, 0, -0.23827988581458157, 0, 0.15168240370469491, 0, -0.51927537965132564},
+        {0, 0.92478232485041989, 0, -0.30719116017817194, 0, 0.18401616722814476, 0, -0.34818108536958436},
+        {0, 1.2567202157239463, 0, -0.37705021412573597, 0, 0.18246696549469935, 0, -0.093266770151134049, 0, 0.045226454603512198, 0, -0.019444921452010724, 0, 0.0068160976735644049, 0, -0.0016352049729504599},
+    }},
+    // alpha = 16, eps = 2^-6: degrees 27 31, 22 mults, error 2^-16.92
+    {16, 0.015625, 10, {
+        {0, 0.84010018037272516, 0, -0.28019363053165269, 0, 0.16831267269837255, 0, -0.12044155286969424, 0, 0.093914597289509905, 0, -0.077098321705919223, 0, 0.065520975017847274, 0, -0.057098622484271708, 0, 0.05073126607368586, 0, -0.04578589853541299, 0, 0.041875316912720596, 0, -0.038752833437869075, 0, 0.036258226472183401, 0, -0.35780971910956938},
+        {0, 1.2673207258986068, 0, -0.40695341263918716, 0, 0.22650745119106686, 0, -0.14440891894999988, 0, 0.096335356739950431, 0, -0.064844836933310473, 0, 0.043190241437668607, 0, -0.028097357582323991, 0, 0.017666478152621706, 0, -0.01062792234912226, 0, 0.0060485619754576808, 0, -0.0032102233674622433, 0, 0.001556860871923459, 0, -0.00066771899270637986, 0, 0.00023806861282791596, 0, -6.1403227138978424e-05},
+    }},
+    // alpha = 20, eps = 2^-6: degrees 7 13 15, 20 mults, error 2^-21.00
+    {20, 0.015625, 11, {
+        {0, 0.69644402058625776, 0, -0.23827988581458157, 0, 0.15168240370469491, 0, -0.51927537965132564},
+        {0, 1.0758391107257532, 0, -0.35455112751726492, 0, 0.2079497348242447, 0, -0.14358683644954046, 0, 0.10681782557688572, 0, -0.082825897934655876, 0, 0.19035719077445162},
+        {0, 1.246798527598902, 0, -0.35093543749998213, 0, 0.14910456915267764, 0, -0.062282575486325285, 0, 0.022749755371168235, 0, -0.0066741505181379217, 0, 0.0013976673082571527, 0, -0.00015883125599974629},
+    }},
+    // alpha = 8, eps = 2^-7: degrees 23 31, 21 mults, error 2^-8.09
+    {8, 0.0078125, 10, {
+        {0, 0.72943146570035278, 0, -0.24363196164840548, 0, 0.1467742941894041, 0, -0.10549358940994759, 0, 0.082755685027735643, 0, -0.068466673445209361, 0, 0.058751063080978161, 0, -0.051808038072039861, 0, 0.046693540955923013, 0, -0.042872719822859159, 0, 0.040029796729366261, 0, -0.44666043874492795},
+        {0, 1.270850139174718, 0, -0.41728814154864252, 0, 0.24291534262592571, 0, -0.16576010715054096, 0, 0.12122387560137642, 0, -0.09173351450367194, 0, 0.070558989810000805, 0, -0.054575835943240322, 0, 0.042135967793798523, 0, -0.032283204565119683, 0, 0.024417397388621365, 0, -0.018134406952781915, 0, 0.01314369986190253, 0, -0.0092234939245128718, 0, 0.0061954355448153213, 0, -0.0061216988860414928},
+    }},
+    // alpha = 12, eps = 2^-7: degrees 7 15 15, 21 mults, error 2^-13.32
+    {12, 0.0078125, 11, {
+        {0, 0.6680934445469745, 0, -0.22919989808098226, 0, 0.14670415388235536, 0, -0.53977312199502248},
+        {0, 0.94152450175033486, 0, -0.31335217177669217, 0, 0.18746312855328462, 0, -0.13338976581827286, 0, 0.10333757878186062, 0, -0.084315870365155809, 0, 0.071390756763633045, 0, -0.29341976634148292},
+        {0, 1.2556473631679037, 0, -0.37414254342196479, 0, 0.17852796579700697, 0, -0.089270513871251164, 0, 0.041961560058925748, 0, -0.01728726797051575, 0, 0.0057109443029762265, 0, -0.0012454232263162423},
+    }},
+    // alpha = 16, eps = 2^-7: degrees 25 61, 26 mults, error 2^-16.01
+    {16, 0.0078125, 11, {
+        {0, 0.73705132321928146, 0, -0.2460853815148443, 0, 0.14813978278511866, 0, -0.10634970419218132, 0, 0.083290108228126422, 0, -0.068758398963468081, 0, 0.058834903053087619, 0, -0.051695295484424725, 0, 0.046379375870199462, 0, -0.042338009060956673, 0, 0.039239712252758609, 0, -0.036879231448456867, 0, 0.43917081525575968},
+        {0, 1.2717590856815368, 0, -0.4199903731504025, 0, 0.24733799078968993, 0, -0.17178486325000206, 0, 0.12869154369859295, 0, -0.10045008255313026, 0, 0.080302935997269342, 0, -0.065106332381099544, 0, 0.053201607010623889, 0, -0.043630856853227158, 0, 0.035800809735800847, 0, -0.029322176407556473, 0, 0.023926294104060497, 0, -0.019419046794081633, 0, 0.015654111631482184, 0, -0.012516832223454918, 0, 0.0099142235521408068, 0, -0.0077686554260954803, 0, 0.0060138106271832945, 0, -0.0045920801453328518, 0, 0.003452877159786072, 0, -0.0025515389217294722, 0, 0.0018486001704668216, 0, -0.0013092942994528101, 0, 0.00090318621375518298, 0, -0.00060387327070944249, 0, 0.00038871339361105879, 0, -0.00023855564796350031, 0, 0.00013746023285494285, 0, -7.2403184143521047e-05, 0, 3.8886273205768969e-05},
+    }},
+    // alpha = 20, eps = 2^-7: degrees 13 15 15, 23 mults, error 2^-22.19
+    {20, 0.0078125, 12, {
+        {0, 0.69066129794228204, 0, -0.23194782148802803, 0, 0.14134022889032918, 0, -0.10347677946732881, 0, 0.083416610669587096, 0, -0.071765491762600234, 0, 0.49177195521575878},
+        {0, 1.0923752033642562, 0, -0.36058510288637247, 0, 0.2121628914278702, 0, -0.14716673703403643, 0, 0.11008728749340352, 0, -0.085826378172576698, 0, 0.068626271269860747, 0, -0.17167837602307795},
+        {0, 1.2457350200412649, 0, -0.34823791867572873, 0, 0.14591241746991565, 0, -0.059657715088724347, 0, 0.021154410919725464, 0, -0.0059682025904208898, 0, 0.0011881829974978548, 0, -0.00012640447401261008},
+    }},
+    // alpha = 8, eps = 2^-8: degrees 23 61, 25 mults, error 2^-8.07
+    {8, 0.00390625, 11, {
+        {0, 0.68413719575655429, 0, -0.22859936778381296, 0, 0.13783371283547982, 0, -0.099192761093192264, 0, 0.077944511876329003, 0, -0.06462311973381954, 0, 0.05559483902850227, 0, -0.049171841595954793, 0, 0.04447005030946375, 0, -0.040989488108501268, 0, 0.038436088976868135, 0, -0.48152397968913208},
+        {0, 1.2726183529986554, 0, -0.42255252932741388, 0, 0.25155653997010963, 0, -0.17758376747244142, 0, 0.1359673488593067, 0, -0.10907478391252404, 0, 0.090127478391490046, 0, -0.075964618570149023, 0, 0.06491487144194516, 0, -0.056012252169514144, 0, 0.048660049920689806, 0, -0.042470083532925924, 0, 0.03717910489262248, 0, -0.03260235002477925, 0, 0.028606306926133265, 0, -0.025092023896234716, 0, 0.021984488777970827, 0, -0.01922565272038575, 0, 0.016769721258692007, 0, -0.014579900423957714, 0, 0.01262610247638437, 0, -0.010883300069077364, 0, 0.0093303281598395137, 0, -0.0079490011620453726, 0, 0.0067234559452629085, 0, -0.0056396591899266794, 0, 0.0046850360166939518, 0, -0.0038481891995697844, 0, 0.0031186867508125123, 0, -0.0024869015638151657, 0, 0.0048073705251140105},
+    }},
+    // alpha = 12, eps = 2^-8: degrees 13 15 15, 23 mults, error 2^-12.48
+    {12, 0.00390625, 12, {
+        {0, 0.66429377886927266, 0, -0.22325377917948269, 0, 0.13623971790496331, 0, -0.099960953574037448, 0, 0.080818950658334249, 0, -0.069786440027184898, 0, 0.51164872534813488},
+        {0, 0.92371457811823976, 0, -0.30763516451416872, 0, 0.18429732106014393, 0, -0.1314134532967054, 0, 0.10209892340227654, 0, -0.083612504392962167, 0, 0.071118153592063499, 0, -0.30743445657641794},
+        {0, 1.2568155090671942, 0, -0.37730947657178698, 0, 0.18282096071244366, 0, -0.093630344221866113, 0, 0.045528699192519083, 0, -0.019649486605601188, 0, 0.0069244218045728077, 0, -0.0016756986551885195},
+    }},
+    // alpha = 16, eps = 2^-8: degrees 49 63, 31 mults, error 2^-16.19
+    {16, 0.00390625, 12, {
+        {0, 0.73499295944372045, 0, -0.24510259933740189, 0, 0.14718793978932215, 0, -0.10527044928120974, 0, 0.08201943877298136, 0, -0.067254033026433666, 0, 0.057058710031712187, 0, -0.049606411931114154, 0, 0.043930051254108385, 0, -0.039469911050409687, 0, 0.035879676778165143, 0, -0.03293367244866368, 0, 0.030478627254025819, 0, -0.028406883509266075, 0, 0.026640695764836412, 0, -0.025122613162676808, 0, 0.023809365445671173, 0, -0.022667852579445025, 0, 0.021672443750368576, 0, -0.020803117822824822, 0, 0.020044160547584001, 0, -0.019383240529544099, 0, 0.018810750259024931, 0, -0.018319338541772996, 0, 0.43181530412924218},
+        {0, 1.2718320455651917, 0, -0.42020749071674657, 0, 0.24769404381262095, 0, -0.17227135849351563, 0, 0.12929702245631111, 0, -0.10116052862382319, 0, 0.081102267597109146, 0, -0.065976955950658125, 0, 0.054125008493586528, 0, -0.044588204912846485, 0, 0.036773545568404287, 0, -0.030292566268977725, 0, 0.024877923272509272, 0, -0.020337237276593065, 0, 0.016526250254746144, 0, -0.013332600571711798, 0, 0.010665726244150662, 0, -0.0084504481777506642, 0, 0.0066228341596921035, 0, -0.0051275100359283662, 0, 0.0039159030018531583, 0, -0.0029450885274360634, 0, 0.0021770259347673143, 0, -0.001578039234835195, 0, 0.0011184466050239181, 0, -0.00077227348672268448, 0, 0.00051700627097473178, 0, -0.00033335920589356362, 0, 0.00020503848427321376, 0, -0.00011849567731701821, 0, 6.2668551131652418e-05, 0, -3.3981577381068702e-05},
+    }},
+    // alpha = 20, eps = 2^-8: degrees 63 63, 34 mults, error 2^-20.24
+    {20, 0.00390625, 12, {
+        {0, 0.76128992852710831, 0, -0.25382007341843127, 0, 0.15236031836551497, 0, -0.1089022324436488, 0, 0.08477830234285437, 0, -0.069442918482803359, 0, 0.058840143823571764, 0, -0.051077268226334654, 0, 0.04515232501220745, 0, -0.040485281831314529, 0, 0.036717123021624748, 0, -0.03361375913138849, 0, 0.031016060458982558, 0, -0.028812098525760835, 0, 0.026920874491984881, 0, -0.02528234695501887, 0, 0.023851086766804426, 0, -0.022592108178395857, 0, 0.021478052967596646, 0, -0.020487242013154227, 0, 0.019602298286049702, 0, -0.018809155413367785, 0, 0.018096332088927504, 0, -0.017454393410866686, 0, 0.016875546053865112, 0, -0.016353330909669055, 0, 0.015882387892466297, 0, -0.015458275069712511, 0, 0.015077329413334064, 0, -0.014736560068798308, 0, 0.014433567623316264, 0, -0.40924661744724378},
+        {0, 1.2714164042496019, 0, -0.41897257157886181, 0, 0.24567533185654306, 0, -0.16952626071958779, 0, 0.12590236906319746, 0, -0.097209273967408513, 0, 0.0766995740603897, 0, -0.061235874559800688, 0, 0.049161986853024364, 0, -0.039518655036407939, 0, 0.031707691738477824, 0, -0.025331767472985867, 0, 0.020111628255065614, 0, -0.015840685717458513, 0, 0.012358984402349263, 0, -0.0095378013749132778, 0, 0.0072703400785614691, 0, -0.0054660277486016226, 0, 0.0040469825987063278, 0, -0.0029457923785101412, 0, 0.0021040750901664472, 0, -0.00147149004446503, 0, 0.0010049910463440707, 0, -0.00066819382618834265, 0, 0.00043078344337761751, 0, -0.00026792358283622019, 0, 0.00015965387837937515, 0, -9.0276980787078155e-05, 0, 4.7746267648247539e-05, 0, -2.3069473255606933e-05, 0, 9.7443600479092914e-06, 0, -3.431501265305991e-06},
+    }},
+    // alpha = 8, eps = 2^-10: degrees 15 15 31, 28 mults, error 2^-8.29
+    {8, 0.0009765625, 13, {
+        {0, 0.6449849726591439, 0, -0.21640102285929227, 0, 0.13158426674703999, 0, -0.095964538139199612, 0, 0.076860786070947082, 0, -0.065419296332762888, 0, 0.058315318666609155, 0, -0.52163864165959917},
+        {0, 0.73228135464969302, 0, -0.24523924016572424, 0, 0.14857093372190608, 0, -0.1077525132807597, 0, 0.085661361921031562, 0, -0.072230432499245906, 0, 0.063666644930578664, 0, -0.45535858594877204},
+        {0, 1.2707677867238802, 0, -0.41704436332358386, 0, 0.24251980020922875, 0, -0.16522832811364205, 0, 0.1205764284289388, 0, -0.090994925916737593, 0, 0.069756470998389372, 0, -0.053737895241872273, 0, 0.041290993172593, 0, -0.031458099603561697, 0, 0.023636349217471507, 0, -0.017417854389636889, 0, 0.012507555409427931, 0, -0.0086786554826158192, 0, 0.0057476038413048431, 0, -0.0054330473232082899},
+    }},
+    // alpha = 12, eps = 2^-10: degrees 13 27 31, 29 mults, error 2^-12.18
+    {12, 0.0009765625, 14, {
+        {0, 0.64411783351339302, 0, -0.21658760588350709, 0, 0.13231203178476103, 0, -0.097234502456987698, 0, 0.078783045700197549, 0, -0.068210675759154335, 0, 0.52681987310129741},
+        {0, 0.78127994588606842, 0, -0.26070498652132318, 0, 0.15676159995878805, 0, -0.11234376256679983, 0, 0.087776012704938525, 0, -0.072240597167426604, 0, 0.061579717200914409, 0, -0.053856159548627144, 0, 0.048047821031270532, 0, -0.043567025294344738, 0, 0.040054886784275878, 0, -0.037283468989062034, 0, 0.035105618749804772, 0, -0.40354104971356203},
+        {0, 1.2692008755257058, 0, -0.41243002005038454, 0, 0.2351103397623632, 0, -0.15542209316715924, 0, 0.10888679028639076, 0, -0.078011170739379687, 0, 0.056100275806106312, 0, -0.040019408426448411, 0, 0.028068414107258344, 0, -0.019204128673344745, 0, 0.012714027350451825, 0, -0.0080672400663993459, 0, 0.0048435282564062501, 0, -0.0026990237453192278, 0, 0.001349749833752929, 0, -0.00063642990421057793},
+    }},
+    // alpha = 16, eps = 2^-10: degrees 7 13 15 15, 28 mults, error 2^-17.30
+    {16, 0.0009765625, 15, {
+        {0, 0.64269878949837356, 0, -0.22099674236819969, 0, 0.14211326081385509, 0, -0.55803167155159261},
+        {0, 0.67704489647484023, 0, -0.22746075550220535, 0, 0.13871103230887347, 0, -0.10166808600799611, 0, 0.082084347506600541, 0, -0.070755182341461789, 0, 0.50204374756134906},
+        {0, 1.0177191108344013, 0, -0.33753734402419855, 0, 0.20051962789727637, 0, -0.14115809383049366, 0, 0.10776271325148484, 0, -0.086275784689981885, 0, 0.071344976582210742, 0, -0.23273582286783595},
+        {0, 1.2506445520764651, 0, -0.36085361628669277, 0, 0.1612457704043288, 0, -0.072807264881349767, 0, 0.029641574971927705, 0, -0.010048650369000706, 0, 0.0025459468348379638, 0, -0.00037452582387782134},
+    }},
+    // alpha = 20, eps = 2^-10: degrees 21 31 31, 33 mults, error 2^-20.74
+    {20, 0.0009765625, 15, {
+        {0, 0.64784693134608851, 0, -0.21665920161170871, 0, 0.13086215210437033, 0, -0.09442800835086472, 0, 0.074474891254607697, 0, -0.062045280997643754, 0, 0.053705345242277998, 0, -0.047866089790044031, 0, 0.043703134077530487, 0, -0.040761369156015172, 0, 0.51116749588140142},
+        {0, 0.88527668571150109, 0, -0.29512266799464076, 0, 0.17711236843347006, 0, -0.12655444016440309, 0, 0.098484585829310994, 0, -0.080641110903357599, 0, 0.068309252111637436, 0, -0.059290103550773972, 0, 0.052420958847716886, 0, -0.047030257876745855, 0, 0.042704096525867916, 0, -0.039174690264075308, 0, 0.036262549151566639, 0, -0.033844586342669049, 0, 0.031835744203128048, 0, -0.32017653911531946},
+        {0, 1.2658744487774729, 0, -0.40278508952248887, 0, 0.22009807689686722, 0, -0.13646539478853192, 0, 0.087670984476146283, 0, -0.056250996142181674, 0, 0.035325549126758803, 0, -0.021414347187317863, 0, 0.012385273009695294, 0, -0.0067547100166514074, 0, 0.0034270960393764077, 0, -0.0015893325264766799, 0, 0.00065676177457778956, 0, -0.00023200379393524065, 0, 6.4691480486826726e-05, 0, -1.1578575684688932e-05},
+    }},
+};
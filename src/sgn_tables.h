@@ -0,0 +1,21 @@
+#pragma once
+
+#include <vector>
+
+using namespace std;
+
+/*
+  Composite minimax approximations of sgn(x), generated by sgn_table_gen.
+
+  Composing the stages of a table maps [-1, -eps] u [eps, 1] into
+  +-[1 - 2^-alpha, 1 + 2^-alpha]. Every stage is an odd polynomial given by its
+  Chebyshev coefficients on [-1, 1], so the whole composition costs depth levels.
+*/
+struct SgnTable {
+  double alpha;
+  double eps;
+  int depth;
+  vector<vector<double>> stages;
+};
+
+extern const vector<SgnTable> SGN_TABLES;
@@ -1,42 +1,111 @@
 #include "softmax.h"
 
 #include <iostream>
+#include <stdexcept>
 #include <vector>
 
-void SoftmaxEvaluator::softmax(Ciphertext &x, Ciphertext &res, int len) {
+#include "managed_eval.h"
+
+void SoftmaxEvaluator::softmax(const Ciphertext &x, Ciphertext &res, int len) {
   Ciphertext tmp, exp_x;
 
   int log_step = log2(len);
 
-  ckks->evaluator->rotate_vector(x, -len, *ckks->galois_keys, tmp);
-  ckks->evaluator->add_inplace(x, tmp);
+  ckks->evaluator->rotate_vector(x, -len, *ckks->galois_keys, exp_x);
+  ckks->evaluator->add_inplace(exp_x, x);
 
-  exp_x = ckks->exp(x);
+  ckks->exp_inplace(exp_x, exp_params);
 
-  tmp = exp_x;
+  res = exp_x;
   for (int i = 0; i < log_step; ++i) {
-    ckks->evaluator->rotate_vector(tmp, pow(2, i), *ckks->galois_keys, res);
+    ckks->evaluator->rotate_vector(res, pow(2, i), *ckks->galois_keys, tmp);
     ckks->evaluator->add_inplace(res, tmp);
-    tmp = res;
   }
 
-  // let res/delta in [0, 1]
-  Plaintext delta;
-  ckks->encoder->encode(0.01, res.parms_id(), res.scale(), delta);
-  ckks->evaluator->multiply_plain_inplace(res, delta);
-  ckks->evaluator->rescale_to_next_inplace(res);
+  normalize(exp_x, res, len, res);
 
-  res = ckks->inverse(res);
+  // cout << "Moduli left after SoftMax: " << res.coeff_modulus_size() << endl;
+}
 
-  // recover to 1/res
-  ckks->encoder->encode(0.01, res.parms_id(), res.scale(), delta);
-  ckks->evaluator->multiply_plain_inplace(res, delta);
-  ckks->evaluator->rescale_to_next_inplace(res);
+void SoftmaxEvaluator::softmax_rows(const Ciphertext &x, Ciphertext &res, int len) {
+  size_t slots = ckks->encoder->slot_count();
+  if (len < 1 || (len & (len - 1)) != 0 || slots % len != 0) {
+    throw invalid_argument("row length must be a power of two dividing the slot count");
+  }
+  int log_step = log2(len);
 
-  ckks->evaluator->mod_switch_to_inplace(exp_x, res.parms_id());
-  ckks->evaluator->multiply(res, exp_x, res);
-  ckks->evaluator->relinearize_inplace(res, *ckks->relin_keys);
-  ckks->evaluator->rescale_to_next_inplace(res);
+  Ciphertext exp_x, sum, tmp;
+  ckks->exp(x, exp_x, exp_params);
 
-  // cout << "Moduli left after SoftMax: " << res.coeff_modulus_size() << endl;
+  // Slot i sums exp_x[i, i + len), which is exactly its row at the row's first slot
+  sum = exp_x;
+  for (int i = 0; i < log_step; ++i) {
+    ckks->evaluator->rotate_vector(sum, 1 << i, *ckks->galois_keys, tmp);
+    ckks->evaluator->add_inplace(sum, tmp);
+  }
+
+  // Keep the first slot of every row
+  vector<double> heads(slots, 0.0);
+  for (size_t i = 0; i < slots; i += len) {
+    heads[i] = 1.0;
+  }
+  ManagedEvaluator managed(*ckks);
+  ManagedCiphertext head_sums(std::move(sum));
+  managed.multiply_vector_inplace(head_sums, heads);
+  managed.resolve(head_sums);
+  sum = std::move(head_sums.ct);
+
+  // Spread each row sum forward over its row; the masked zeros keep rows apart
+  for (int i = 0; i < log_step; ++i) {
+    ckks->evaluator->rotate_vector(sum, -(1 << i), *ckks->galois_keys, tmp);
+    ckks->evaluator->add_inplace(sum, tmp);
+  }
+
+  normalize(exp_x, sum, len, res);
+}
+
+void SoftmaxEvaluator::normalize(Ciphertext &exp_x, Ciphertext &sum, int len, Ciphertext &res) {
+  // The plan's constant on 1/sum folds into the exp_x side, which has levels to spare
+  ManagedEvaluator managed(*ckks);
+  ManagedCiphertext inv;
+  auto plan = CKKSEvaluator::plan_inverse(sum_lo, sum_hi > 0 ? sum_hi : len, precision);
+  ckks->inverse(ManagedCiphertext(std::move(sum)), inv, plan);
+
+  ManagedCiphertext out(std::move(exp_x));
+  managed.multiply_inplace(out, inv);
+  managed.resolve(out);
+  res = std::move(out.ct);
+}
+
+void SoftmaxEvaluator::softmax(const vector<Ciphertext> &x, vector<Ciphertext> &res, int len, ThreadPool &pool) {
+  res.resize(x.size());
+  pool.parallel_for(x.size(), [&](size_t i) { softmax(x[i], res[i], len); });
+}
+
+void SoftmaxEvaluator::softmax_rows(const vector<Ciphertext> &x, vector<Ciphertext> &res, int len, ThreadPool &pool) {
+  res.resize(x.size());
+  pool.parallel_for(x.size(), [&](size_t i) { softmax_rows(x[i], res[i], len); });
+}
+
+vector<vector<double>> SoftmaxEvaluator::pack_rows(const vector<double> &rows, int len, size_t slots) {
+  size_t per_ct = slots / len * len;
+  vector<vector<double>> packed((rows.size() + per_ct - 1) / per_ct, vector<double>(slots, 0.0));
+  for (size_t i = 0; i < rows.size(); i++) {
+    packed[i / per_ct][i % per_ct] = rows[i];
+  }
+  return packed;
+}
+
+vector<int> SoftmaxEvaluator::rotation_steps(int len, bool rows) {
+  vector<int> steps;
+  if (!rows) {
+    steps.push_back(-len);
+  }
+  for (int i = 1; i < len; i *= 2) {
+    steps.push_back(i);
+    if (rows) {
+      steps.push_back(-i);
+    }
+  }
+  return steps;
 }
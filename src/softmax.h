@@ -2,7 +2,10 @@
 
 #include <seal/seal.h>
 
+#include <vector>
+
 #include "ckks_evaluator.h"
+#include "thread_pool.h"
 
 using namespace std;
 using namespace seal;
@@ -12,9 +15,40 @@ class SoftmaxEvaluator {
   CKKSEvaluator *ckks = nullptr;
 
  public:
+  // Inputs are expected shifted by their row maximum, so a row of exp(x) sums to
+  // between 1 and len; sum_hi = 0 stands for len. The reciprocal of the sum is
+  // planned on [sum_lo, sum_hi] to the given relative precision.
+  CKKSEvaluator::ExpParams exp_params{-10.0, 0.0, 15, 0};
+  double sum_lo = 1.0, sum_hi = 0.0, precision = 1e-3;
+
   SoftmaxEvaluator(CKKSEvaluator &ckks) {
     this->ckks = &ckks;
   }
 
-  void softmax(Ciphertext &x, Ciphertext &res, int len);
+  void softmax(const Ciphertext &x, Ciphertext &res, int len);
+  // Evaluates each ciphertext of x independently on the pool; res may be x
+  void softmax(const vector<Ciphertext> &x, vector<Ciphertext> &res, int len, ThreadPool &pool = ThreadPool::shared());
+
+  /*
+    Row-wise softmax of x holding slots / len rows of len values back to back,
+    with len a power of two. Each row is reduced within its own segment: a
+    rotate-and-sum ladder leaves the row sum in the row's first slot, a mask keeps
+    those, and a second ladder spreads each back over its row. This costs one more
+    level than softmax() but handles every packed row at once.
+  */
+  void softmax_rows(const Ciphertext &x, Ciphertext &res, int len);
+  // All heads' attention maps, packed by pack_rows, on the pool; res may be x
+  void softmax_rows(
+      const vector<Ciphertext> &x, vector<Ciphertext> &res, int len, ThreadPool &pool = ThreadPool::shared());
+
+  // Splits rows of len values, concatenated across heads, into slot vectors of
+  // slots / len rows each; the last one is padded with zero rows
+  static vector<vector<double>> pack_rows(const vector<double> &rows, int len, size_t slots);
+  // The Galois steps softmax_rows, or softmax for rows = false, rotates by; the
+  // same keys serve every row and head
+  static vector<int> rotation_steps(int len, bool rows = true);
+
+ private:
+  // exp_x / sum with the reciprocal planned for row length len
+  void normalize(Ciphertext &exp_x, Ciphertext &sum, int len, Ciphertext &res);
 };
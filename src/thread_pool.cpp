@@ -0,0 +1,105 @@
+#include "thread_pool.h"
+
+namespace {
+// The pool of the worker running on this thread, if any
+thread_local const MemoryPoolHandle *worker_pool = nullptr;
+
+class WorkerProf : public MMProf {
+ public:
+  MemoryPoolHandle get_pool(mm_prof_opt_t) override {
+    return worker_pool ? *worker_pool : MemoryPoolHandle::Global();
+  }
+};
+}  // namespace
+
+ThreadPool::ThreadPool(size_t threads) {
+  threads = max<size_t>(threads, 1);
+  pools.reserve(threads);
+  for (size_t i = 0; i < threads; i++) {
+    pools.push_back(MemoryPoolHandle::New());
+  }
+  for (size_t i = 0; i < threads; i++) {
+    workers.emplace_back(&ThreadPool::work, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    lock_guard<mutex> lock(state_mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+ThreadPool &ThreadPool::shared() {
+  static ThreadPool pool;
+  return pool;
+}
+
+void ThreadPool::drain(const function<void(size_t)> &task, size_t count) {
+  for (size_t i = next++; i < count; i = next++) {
+    try {
+      task(i);
+    } catch (...) {
+      lock_guard<mutex> lock(state_mutex);
+      if (!error) {
+        error = current_exception();
+      }
+    }
+  }
+}
+
+void ThreadPool::work(size_t id) {
+  worker_pool = &pools[id];
+  size_t seen = 0;
+  while (true) {
+    unique_lock<mutex> lock(state_mutex);
+    wake.wait(lock, [&] { return stopping || generation != seen; });
+    if (stopping) {
+      return;
+    }
+    seen = generation;
+    const function<void(size_t)> &current = *task;
+    size_t n = count;
+    lock.unlock();
+
+    drain(current, n);
+
+    lock.lock();
+    if (--busy == 0) {
+      done.notify_one();
+    }
+  }
+}
+
+void ThreadPool::parallel_for(size_t n, const function<void(size_t)> &task) {
+  if (worker_pool || n <= 1 || workers.size() == 1) {
+    for (size_t i = 0; i < n; i++) {
+      task(i);
+    }
+    return;
+  }
+
+  lock_guard<mutex> batch(batch_mutex);
+  MMProfGuard guard(make_unique<WorkerProf>());
+  {
+    lock_guard<mutex> lock(state_mutex);
+    this->task = &task;
+    count = n;
+    next = 0;
+    busy = workers.size();
+    error = nullptr;
+    generation++;
+  }
+  wake.notify_all();
+
+  unique_lock<mutex> lock(state_mutex);
+  done.wait(lock, [&] { return busy == 0; });
+  this->task = nullptr;
+  if (error) {
+    rethrow_exception(error);
+  }
+}
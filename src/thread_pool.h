@@ -0,0 +1,67 @@
+#pragma once
+
+#include <seal/seal.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace seal;
+
+/*
+  A fixed set of worker threads for the batched nonlinear layers.
+
+  Each worker owns a SEAL memory pool. While parallel_for runs, the SEAL memory
+  manager profile is switched so that MemoryManager::GetPool(), which every
+  evaluator call uses by default, returns the calling worker's pool; concurrent
+  evaluations then allocate their temporaries without contending on the global
+  pool. The pools are thread-safe, so ciphertexts a worker produced can be used
+  and released by any thread afterwards.
+
+  One batch runs at a time; a parallel_for issued from inside a worker runs
+  serially on that worker instead of deadlocking.
+*/
+class ThreadPool {
+ public:
+  explicit ThreadPool(size_t threads = thread::hardware_concurrency());
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  size_t size() const {
+    return workers.size();
+  }
+
+  // Runs task(i) for every i in [0, n) and returns once all have finished. The
+  // first exception thrown by a task is rethrown here after the batch drains.
+  void parallel_for(size_t n, const function<void(size_t)> &task);
+
+  // Process-wide pool with one worker per hardware thread
+  static ThreadPool &shared();
+
+ private:
+  vector<thread> workers;
+  vector<MemoryPoolHandle> pools;
+
+  mutex batch_mutex;  // serializes parallel_for calls
+  mutex state_mutex;
+  condition_variable wake, done;
+
+  // State of the current batch, guarded by state_mutex except for next
+  const function<void(size_t)> *task = nullptr;
+  size_t count = 0;
+  atomic<size_t> next{0};
+  size_t busy = 0;
+  size_t generation = 0;
+  bool stopping = false;
+  exception_ptr error;
+
+  void work(size_t id);
+  void drain(const function<void(size_t)> &task, size_t count);
+};
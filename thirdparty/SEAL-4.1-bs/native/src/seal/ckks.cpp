@@ -28,54 +28,70 @@ namespace seal
         slots_ = coeff_count >> 1;
         sparse_slots_ = context_data.parms().sparse_slots();
         if (sparse_slots_ == 0) sparse_slots_ = slots_;
-        int logn = get_power_of_two(coeff_count);
+        log_slots_ = get_power_of_two(coeff_count) - 1;
+
+        // Real-coefficient polynomials take conjugate values at conjugate roots, so only the evaluations at the
+        // powers psi^(5^i mod 2n) of the primitive 2n-th root psi are computed. These exponents are all 1 modulo 4,
+        // i.e., the evaluation points are the roots of X^(n/2) - psi^(n/2), and the embedding becomes a transform of
+        // size n/2 applied to c_j + sqrt(-1) * c_{j + n/2}. Node t of its Cooley-Tukey tree reduces modulo
+        // X^len - psi^e[t], with e[1] = n/2 and children X^(len/2) -/+ psi^(e[t]/2), so node t uses the root
+        // psi^(e[t]/2) and the leaves t = n/2, ..., n-1 hold the evaluations at psi^e[t] in this order.
+        uint64_t m = static_cast<uint64_t>(coeff_count) << 1;
+        vector<uint64_t> node_exponents(slots_ << 1);
+        node_exponents[1] = slots_;
+        for (size_t t = 1; t < slots_; t++)
+        {
+            node_exponents[t << 1] = node_exponents[t] >> 1;
+            node_exponents[(t << 1) | 1] = ((node_exponents[t] >> 1) + coeff_count) & (m - 1);
+        }
 
-        matrix_reps_index_map_ = allocate<size_t>(coeff_count, pool_);
+        vector<size_t> leaf_index(safe_cast<size_t>(m));
+        for (size_t t = slots_; t < (slots_ << 1); t++)
+        {
+            leaf_index[safe_cast<size_t>(node_exponents[t])] = t - slots_;
+        }
 
-        // Copy from the matrix to the value vectors
+        // Slot i holds the evaluation at psi^(5^i mod 2n)
+        matrix_reps_index_map_ = allocate<size_t>(slots_, pool_);
         uint64_t gen = 5;
         uint64_t pos = 1;
-        uint64_t m = static_cast<uint64_t>(coeff_count) << 1;
         for (size_t i = 0; i < slots_; i++)
         {
-            // Position in normal bit order
-            uint64_t index1 = (pos - 1) >> 1;
-            uint64_t index2 = (m - pos - 1) >> 1;
-
-            // Set the bit-reversed locations
-            matrix_reps_index_map_[i] = safe_cast<size_t>(reverse_bits(index1, logn));
-            matrix_reps_index_map_[slots_ | i] = safe_cast<size_t>(reverse_bits(index2, logn));
+            matrix_reps_index_map_[i] = leaf_index[safe_cast<size_t>(pos)];
 
             // Next primitive root
             pos *= gen;
             pos &= (m - 1);
         }
 
-        // We need 1~(n-1)-th powers of the primitive 2n-th root, m = 2n
-        root_powers_ = allocate<complex<double>>(coeff_count, pool_);
-        inv_root_powers_ = allocate<complex<double>>(coeff_count, pool_);
+        // The forward transform uses the node roots in order; the inverse transform visits the nodes level by level
+        // from the leaves up and needs the inverse roots in that (scrambled) order.
+        root_powers_ = allocate<complex<double>>(slots_, pool_);
+        inv_root_powers_ = allocate<complex<double>>(slots_, pool_);
         // Powers of the primitive 2n-th root have 4-fold symmetry
         if (m >= 8)
         {
             complex_roots_ = make_shared<util::ComplexRoots>(util::ComplexRoots(static_cast<size_t>(m), pool_));
-            for (size_t i = 1; i < coeff_count; i++)
+            for (size_t t = 1; t < slots_; t++)
             {
-                root_powers_[i] = complex_roots_->get_root(reverse_bits(i, logn));
-                inv_root_powers_[i] = conj(complex_roots_->get_root(reverse_bits(i - 1, logn) + 1));
+                root_powers_[t] = complex_roots_->get_root(safe_cast<size_t>(node_exponents[t] >> 1));
+            }
+            size_t inv_index = 1;
+            for (size_t level_size = slots_ >> 1; level_size; level_size >>= 1)
+            {
+                for (size_t t = level_size; t < (level_size << 1); t++)
+                {
+                    inv_root_powers_[inv_index++] = conj(root_powers_[t]);
+                }
             }
-        }
-        else if (m == 4)
-        {
-            root_powers_[1] = { 0, 1 };
-            inv_root_powers_[1] = { 0, -1 };
         }
 
         complex_arith_ = ComplexArith();
         fft_handler_ = FFTHandler(complex_arith_);
     }
 
-    void CKKSEncoder::encode_internal(
-        double value, parms_id_type parms_id, double scale, Plaintext &destination, MemoryPoolHandle pool) const
+    void CKKSEncoder::encode_rns_constant(
+        double value, parms_id_type parms_id, double scale, uint64_t *destination, MemoryPoolHandle pool) const
     {
         // Verify parameters.
         auto context_data_ptr = context_.get_context_data(parms_id);
@@ -83,6 +99,10 @@ namespace seal
         {
             throw invalid_argument("parms_id is not valid for encryption parameters");
         }
+        if (!destination)
+        {
+            throw invalid_argument("destination cannot be null");
+        }
         if (!pool)
         {
             throw invalid_argument("pool is uninitialized");
@@ -92,13 +112,6 @@ namespace seal
         auto &parms = context_data.parms();
         auto &coeff_modulus = parms.coeff_modulus();
         size_t coeff_modulus_size = coeff_modulus.size();
-        size_t coeff_count = parms.poly_modulus_degree();
-
-        // Quick sanity check
-        if (!product_fits_in(coeff_modulus_size, coeff_count))
-        {
-            throw logic_error("invalid parameters");
-        }
 
         // Check that scale is positive and not too large
         if (scale <= 0 || (static_cast<int>(log2(scale)) >= context_data.total_coeff_modulus_bit_count()))
@@ -117,12 +130,6 @@ namespace seal
 
         double two_pow_64 = pow(2.0, 64);
 
-        // Resize destination to appropriate size
-        // Need to first set parms_id to zero, otherwise resize
-        // will throw an exception.
-        destination.parms_id() = parms_id_zero;
-        destination.resize(coeff_count * coeff_modulus_size);
-
         double coeffd = round(value);
         bool is_negative = signbit(coeffd);
         coeffd = fabs(coeffd);
@@ -130,59 +137,26 @@ namespace seal
         // Use faster decomposition methods when possible
         if (coeff_bit_count <= 64)
         {
-            uint64_t coeffu = static_cast<uint64_t>(fabs(coeffd));
-
-            if (is_negative)
-            {
-                for (size_t j = 0; j < coeff_modulus_size; j++)
-                {
-                    fill_n(
-                        destination.data() + (j * coeff_count), coeff_count,
-                        negate_uint_mod(barrett_reduce_64(coeffu, coeff_modulus[j]), coeff_modulus[j]));
-                }
-            }
-            else
+            uint64_t coeffu = static_cast<uint64_t>(coeffd);
+            for (size_t j = 0; j < coeff_modulus_size; j++)
             {
-                for (size_t j = 0; j < coeff_modulus_size; j++)
-                {
-                    fill_n(
-                        destination.data() + (j * coeff_count), coeff_count,
-                        barrett_reduce_64(coeffu, coeff_modulus[j]));
-                }
+                destination[j] = barrett_reduce_64(coeffu, coeff_modulus[j]);
             }
         }
         else if (coeff_bit_count <= 128)
         {
             uint64_t coeffu[2]{ static_cast<uint64_t>(fmod(coeffd, two_pow_64)),
                                 static_cast<uint64_t>(coeffd / two_pow_64) };
-
-            if (is_negative)
+            for (size_t j = 0; j < coeff_modulus_size; j++)
             {
-                for (size_t j = 0; j < coeff_modulus_size; j++)
-                {
-                    fill_n(
-                        destination.data() + (j * coeff_count), coeff_count,
-                        negate_uint_mod(barrett_reduce_128(coeffu, coeff_modulus[j]), coeff_modulus[j]));
-                }
-            }
-            else
-            {
-                for (size_t j = 0; j < coeff_modulus_size; j++)
-                {
-                    fill_n(
-                        destination.data() + (j * coeff_count), coeff_count,
-                        barrett_reduce_128(coeffu, coeff_modulus[j]));
-                }
+                destination[j] = barrett_reduce_128(coeffu, coeff_modulus[j]);
             }
         }
         else
         {
-            // Slow case
-            auto coeffu(allocate_uint(coeff_modulus_size, pool));
-
-            // We are at this point guaranteed to fit in the allocated space
-            set_zero_uint(coeff_modulus_size, coeffu.get());
-            auto coeffu_ptr = coeffu.get();
+            // Slow case; we are at this point guaranteed to fit in the allocated space
+            set_zero_uint(coeff_modulus_size, destination);
+            auto coeffu_ptr = destination;
             while (coeffd >= 1)
             {
                 *coeffu_ptr++ = static_cast<uint64_t>(fmod(coeffd, two_pow_64));
@@ -190,26 +164,58 @@ namespace seal
             }
 
             // Next decompose this coefficient
-            context_data.rns_tool()->base_q()->decompose(coeffu.get(), pool);
+            context_data.rns_tool()->base_q()->decompose(destination, pool);
+        }
 
-            // Finally replace the sign if necessary
-            if (is_negative)
-            {
-                for (size_t j = 0; j < coeff_modulus_size; j++)
-                {
-                    fill_n(
-                        destination.data() + (j * coeff_count), coeff_count,
-                        negate_uint_mod(coeffu[j], coeff_modulus[j]));
-                }
-            }
-            else
+        // Finally replace the sign if necessary
+        if (is_negative)
+        {
+            for (size_t j = 0; j < coeff_modulus_size; j++)
             {
-                for (size_t j = 0; j < coeff_modulus_size; j++)
-                {
-                    fill_n(destination.data() + (j * coeff_count), coeff_count, coeffu[j]);
-                }
+                destination[j] = negate_uint_mod(destination[j], coeff_modulus[j]);
             }
         }
+    }
+
+    void CKKSEncoder::encode_internal(
+        double value, parms_id_type parms_id, double scale, Plaintext &destination, MemoryPoolHandle pool) const
+    {
+        // Verify parameters.
+        auto context_data_ptr = context_.get_context_data(parms_id);
+        if (!context_data_ptr)
+        {
+            throw invalid_argument("parms_id is not valid for encryption parameters");
+        }
+        if (!pool)
+        {
+            throw invalid_argument("pool is uninitialized");
+        }
+
+        auto &parms = context_data_ptr->parms();
+        size_t coeff_modulus_size = parms.coeff_modulus().size();
+        size_t coeff_count = parms.poly_modulus_degree();
+
+        // Quick sanity check
+        if (!product_fits_in(coeff_modulus_size, coeff_count))
+        {
+            throw logic_error("invalid parameters");
+        }
+
+        // A constant polynomial is the same constant at every NTT point, so
+        // only one residue per prime needs to be computed.
+        auto residues(allocate_uint(coeff_modulus_size, pool));
+        encode_rns_constant(value, parms_id, scale, residues.get(), pool);
+
+        // Resize destination to appropriate size
+        // Need to first set parms_id to zero, otherwise resize
+        // will throw an exception.
+        destination.parms_id() = parms_id_zero;
+        destination.resize(coeff_count * coeff_modulus_size);
+
+        for (size_t j = 0; j < coeff_modulus_size; j++)
+        {
+            fill_n(destination.data() + (j * coeff_count), coeff_count, residues[j]);
+        }
 
         destination.parms_id() = parms_id;
         destination.scale() = scale;
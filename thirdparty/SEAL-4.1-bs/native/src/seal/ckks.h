@@ -59,9 +59,11 @@ namespace seal
                 return a - b;
             }
 
+            // Spelled out to avoid the C99 Annex G checks of std::complex multiplication (__muldc3), which block
+            // inlining and vectorization of the FFT butterflies; roots are finite so the checks never apply.
             inline std::complex<double> mul_root(const std::complex<double> &a, const std::complex<double> &r) const
             {
-                return a * r;
+                return { a.real() * r.real() - a.imag() * r.imag(), a.real() * r.imag() + a.imag() * r.real() };
             }
 
             inline std::complex<double> mul_scalar(const std::complex<double> &a, const double &s) const
@@ -249,6 +251,72 @@ namespace seal
             encode(values, context_.first_parms_id(), scale, destination, std::move(pool));
         }
 #endif
+        /**
+        Encodes several vectors of double-precision floating-point real or complex
+        numbers into plaintext polynomials, one per vector. Append zeros to each
+        vector whose size is less than N/2. Parameters are validated once and the
+        scratch space is shared by all encodings, which makes this cheaper than
+        calling encode repeatedly. Dynamic memory allocations in the process are
+        allocated from the memory pool pointed to by the given MemoryPoolHandle.
+
+        @tparam T Vector value type (double or std::complex<double>)
+        @param[in] values The vectors of double-precision floating-point numbers
+        (of type T) to encode
+        @param[in] parms_id parms_id determining the encryption parameters to
+        be used by the result plaintexts
+        @param[in] scale Scaling parameter defining encoding precision
+        @param[out] destination The plaintext polynomials to overwrite with the
+        results; resized to values.size()
+        @param[in] pool The MemoryPoolHandle pointing to a valid memory pool
+        @throws std::invalid_argument if any vector has invalid size
+        @throws std::invalid_argument if parms_id is not valid for the encryption
+        parameters
+        @throws std::invalid_argument if scale is not strictly positive
+        @throws std::invalid_argument if encoding is too large for the encryption
+        parameters
+        @throws std::invalid_argument if pool is uninitialized
+        */
+        template <
+            typename T, typename = std::enable_if_t<
+                            std::is_same<std::remove_cv_t<T>, double>::value ||
+                            std::is_same<std::remove_cv_t<T>, std::complex<double>>::value>>
+        inline void encode_many(
+            const std::vector<std::vector<T>> &values, parms_id_type parms_id, double scale,
+            std::vector<Plaintext> &destination, MemoryPoolHandle pool = MemoryManager::GetPool()) const
+        {
+            encode_many_internal(values, parms_id, scale, destination, std::move(pool));
+        }
+
+        /**
+        Encodes several vectors of double-precision floating-point real or complex
+        numbers into plaintext polynomials, one per vector, using the top level
+        parameters for the given context. Append zeros to each vector whose size
+        is less than N/2. Dynamic memory allocations in the process are allocated
+        from the memory pool pointed to by the given MemoryPoolHandle.
+
+        @tparam T Vector value type (double or std::complex<double>)
+        @param[in] values The vectors of double-precision floating-point numbers
+        (of type T) to encode
+        @param[in] scale Scaling parameter defining encoding precision
+        @param[out] destination The plaintext polynomials to overwrite with the
+        results; resized to values.size()
+        @param[in] pool The MemoryPoolHandle pointing to a valid memory pool
+        @throws std::invalid_argument if any vector has invalid size
+        @throws std::invalid_argument if scale is not strictly positive
+        @throws std::invalid_argument if encoding is too large for the encryption
+        parameters
+        @throws std::invalid_argument if pool is uninitialized
+        */
+        template <
+            typename T, typename = std::enable_if_t<
+                            std::is_same<std::remove_cv_t<T>, double>::value ||
+                            std::is_same<std::remove_cv_t<T>, std::complex<double>>::value>>
+        inline void encode_many(
+            const std::vector<std::vector<T>> &values, double scale, std::vector<Plaintext> &destination,
+            MemoryPoolHandle pool = MemoryManager::GetPool()) const
+        {
+            encode_many(values, context_.first_parms_id(), scale, destination, std::move(pool));
+        }
         /**
         Encodes a double-precision floating-point real number into a plaintext
         polynomial. The number repeats for N/2 times to fill all slots. Dynamic
@@ -299,6 +367,30 @@ namespace seal
             encode(value, context_.first_parms_id(), scale, destination, std::move(pool));
         }
 
+        /**
+        Computes the RNS residues of round(value * scale) modulo each prime in
+        the coefficient modulus determined by parms_id. This is the single word
+        per prime that encode(double, ...) broadcasts over every coefficient, and
+        it lets callers add or multiply a constant into an NTT-form ciphertext
+        without materializing a plaintext.
+
+        @param[in] value The double-precision floating-point number to encode
+        @param[in] parms_id parms_id determining the coefficient modulus
+        @param[in] scale Scaling parameter defining encoding precision
+        @param[out] destination Buffer of coeff_modulus_size words to overwrite
+        with the residues
+        @param[in] pool The MemoryPoolHandle pointing to a valid memory pool
+        @throws std::invalid_argument if parms_id is not valid for the encryption
+        parameters
+        @throws std::invalid_argument if scale is not strictly positive
+        @throws std::invalid_argument if encoding is too large for the encryption
+        parameters
+        @throws std::invalid_argument if pool is uninitialized
+        */
+        void encode_rns_constant(
+            double value, parms_id_type parms_id, double scale, std::uint64_t *destination,
+            MemoryPoolHandle pool = MemoryManager::GetPool()) const;
+
         /**
         Encodes a double-precision complex number into a plaintext polynomial.
         Append zeros to fill all slots. Dynamic memory allocations in the process
@@ -459,11 +551,6 @@ namespace seal
             MemoryPoolHandle pool) const
         {
             // Verify parameters.
-            auto context_data_ptr = context_.get_context_data(parms_id);
-            if (!context_data_ptr)
-            {
-                throw std::invalid_argument("parms_id is not valid for encryption parameters");
-            }
             if (!values && values_size > 0)
             {
                 throw std::invalid_argument("values cannot be null");
@@ -472,6 +559,51 @@ namespace seal
             {
                 throw std::invalid_argument("values_size is too large");
             }
+            auto &context_data = verify_encode_parameters(parms_id, scale, pool);
+
+            auto fft_values = util::allocate<std::complex<double>>(slots_, pool);
+            auto coeffs = util::allocate<double>(util::mul_safe(slots_, std::size_t(2)), pool);
+            encode_slots(values, values_size, context_data, scale, destination, fft_values.get(), coeffs.get(), pool);
+        }
+
+        template <
+            typename T, typename = std::enable_if_t<
+                            std::is_same<std::remove_cv_t<T>, double>::value ||
+                            std::is_same<std::remove_cv_t<T>, std::complex<double>>::value>>
+        void encode_many_internal(
+            const std::vector<std::vector<T>> &values, parms_id_type parms_id, double scale,
+            std::vector<Plaintext> &destination, MemoryPoolHandle pool) const
+        {
+            // Verify parameters.
+            for (auto &each_values : values)
+            {
+                if (each_values.size() > slots_)
+                {
+                    throw std::invalid_argument("values_size is too large");
+                }
+            }
+            auto &context_data = verify_encode_parameters(parms_id, scale, pool);
+
+            // The scratch space is shared by all encodings
+            auto fft_values = util::allocate<std::complex<double>>(slots_, pool);
+            auto coeffs = util::allocate<double>(util::mul_safe(slots_, std::size_t(2)), pool);
+            destination.resize(values.size());
+            for (std::size_t i = 0; i < values.size(); i++)
+            {
+                encode_slots(
+                    values[i].data(), values[i].size(), context_data, scale, destination[i], fft_values.get(),
+                    coeffs.get(), pool);
+            }
+        }
+
+        const SEALContext::ContextData &verify_encode_parameters(
+            parms_id_type parms_id, double scale, const MemoryPoolHandle &pool) const
+        {
+            auto context_data_ptr = context_.get_context_data(parms_id);
+            if (!context_data_ptr)
+            {
+                throw std::invalid_argument("parms_id is not valid for encryption parameters");
+            }
             if (!pool)
             {
                 throw std::invalid_argument("pool is uninitialized");
@@ -479,12 +611,9 @@ namespace seal
 
             auto &context_data = *context_data_ptr;
             auto &parms = context_data.parms();
-            auto &coeff_modulus = parms.coeff_modulus();
-            std::size_t coeff_modulus_size = coeff_modulus.size();
-            std::size_t coeff_count = parms.poly_modulus_degree();
 
             // Quick sanity check
-            if (!util::product_fits_in(coeff_modulus_size, coeff_count))
+            if (!util::product_fits_in(parms.coeff_modulus().size(), parms.poly_modulus_degree()))
             {
                 throw std::logic_error("invalid parameters");
             }
@@ -494,26 +623,39 @@ namespace seal
             {
                 throw std::invalid_argument("scale out of bounds");
             }
+            return context_data;
+        }
 
+        /**
+        Encodes values_size (at most slots_) values with verified parameters. fft_values must hold slots_ complex
+        numbers and coeffs must hold 2 * slots_ doubles; their contents are overwritten.
+        */
+        template <typename T>
+        void encode_slots(
+            const T *values, std::size_t values_size, const SEALContext::ContextData &context_data, double scale,
+            Plaintext &destination, std::complex<double> *fft_values, double *coeffs, MemoryPoolHandle &pool) const
+        {
+            auto &parms = context_data.parms();
+            auto &coeff_modulus = parms.coeff_modulus();
+            std::size_t coeff_modulus_size = coeff_modulus.size();
+            std::size_t coeff_count = parms.poly_modulus_degree();
             auto ntt_tables = context_data.small_ntt_tables();
 
-            // values_size is guaranteed to be no bigger than slots_
-            std::size_t n = util::mul_safe(slots_, std::size_t(2));
-
-            auto conj_values = util::allocate<std::complex<double>>(n, pool, 0);
+            std::fill_n(fft_values, slots_, std::complex<double>(0.0));
             for (std::size_t i = 0; i < values_size; i++)
             {
-                conj_values[matrix_reps_index_map_[i]] = values[i];
-                // TODO: if values are real, the following values should be set to zero, and multiply results by 2.
-                conj_values[matrix_reps_index_map_[i + slots_]] = std::conj(values[i]);
+                fft_values[matrix_reps_index_map_[i]] = values[i];
             }
-            double fix = scale / static_cast<double>(n);
-            fft_handler_.transform_from_rev(conj_values.get(), util::get_power_of_two(n), inv_root_powers_.get(), &fix);
+            double fix = scale / static_cast<double>(slots_);
+            transform_from_slots(fft_values, fix);
 
+            // The real and imaginary parts are the low and high halves of the coefficients
             double max_coeff = 0;
-            for (std::size_t i = 0; i < n; i++)
+            for (std::size_t i = 0; i < slots_; i++)
             {
-                max_coeff = std::max<>(max_coeff, std::fabs(conj_values[i].real()));
+                coeffs[i] = fft_values[i].real();
+                coeffs[i + slots_] = fft_values[i].imag();
+                max_coeff = std::max<>(max_coeff, std::max<>(std::fabs(coeffs[i]), std::fabs(coeffs[i + slots_])));
             }
             // Verify that the values are not too large to fit in coeff_modulus
             // Note that we have an extra + 1 for the sign bit
@@ -535,35 +677,29 @@ namespace seal
             // Use faster decomposition methods when possible
             if (max_coeff_bit_count <= 64)
             {
-                for (std::size_t i = 0; i < n; i++)
+                // Round all coefficients first so that each RNS component is then filled in one contiguous pass
+                auto coeffu(util::allocate_uint(coeff_count, pool));
+                for (std::size_t i = 0; i < coeff_count; i++)
                 {
-                    double coeffd = std::round(conj_values[i].real());
-                    bool is_negative = std::signbit(coeffd);
-
-                    std::uint64_t coeffu = static_cast<std::uint64_t>(std::fabs(coeffd));
-
-                    if (is_negative)
-                    {
-                        for (std::size_t j = 0; j < coeff_modulus_size; j++)
-                        {
-                            destination[i + (j * coeff_count)] = util::negate_uint_mod(
-                                util::barrett_reduce_64(coeffu, coeff_modulus[j]), coeff_modulus[j]);
-                        }
-                    }
-                    else
+                    coeffs[i] = std::round(coeffs[i]);
+                    coeffu[i] = static_cast<std::uint64_t>(std::fabs(coeffs[i]));
+                }
+                for (std::size_t j = 0; j < coeff_modulus_size; j++)
+                {
+                    std::uint64_t *destination_ptr = destination.data() + (j * coeff_count);
+                    for (std::size_t i = 0; i < coeff_count; i++)
                     {
-                        for (std::size_t j = 0; j < coeff_modulus_size; j++)
-                        {
-                            destination[i + (j * coeff_count)] = util::barrett_reduce_64(coeffu, coeff_modulus[j]);
-                        }
+                        std::uint64_t reduced = util::barrett_reduce_64(coeffu[i], coeff_modulus[j]);
+                        destination_ptr[i] =
+                            std::signbit(coeffs[i]) ? util::negate_uint_mod(reduced, coeff_modulus[j]) : reduced;
                     }
                 }
             }
             else if (max_coeff_bit_count <= 128)
             {
-                for (std::size_t i = 0; i < n; i++)
+                for (std::size_t i = 0; i < coeff_count; i++)
                 {
-                    double coeffd = std::round(conj_values[i].real());
+                    double coeffd = std::round(coeffs[i]);
                     bool is_negative = std::signbit(coeffd);
                     coeffd = std::fabs(coeffd);
 
@@ -591,9 +727,9 @@ namespace seal
             {
                 // Slow case
                 auto coeffu(util::allocate_uint(coeff_modulus_size, pool));
-                for (std::size_t i = 0; i < n; i++)
+                for (std::size_t i = 0; i < coeff_count; i++)
                 {
-                    double coeffd = std::round(conj_values[i].real());
+                    double coeffd = std::round(coeffs[i]);
                     bool is_negative = std::signbit(coeffd);
                     coeffd = std::fabs(coeffd);
 
@@ -633,10 +769,32 @@ namespace seal
                 util::ntt_negacyclic_harvey(destination.data(i * coeff_count), ntt_tables[i]);
             }
 
-            destination.parms_id() = parms_id;
+            destination.parms_id() = parms.parms_id();
             destination.scale() = scale;
         }
 
+        // Inverse embedding of size slots_ with all outputs multiplied by scalar
+        inline void transform_from_slots(std::complex<double> *values, double scalar) const
+        {
+            if (log_slots_ > 0)
+            {
+                fft_handler_.transform_from_rev(values, log_slots_, inv_root_powers_.get(), &scalar);
+            }
+            else
+            {
+                values[0] *= scalar;
+            }
+        }
+
+        // Forward embedding of size slots_
+        inline void transform_to_slots(std::complex<double> *values) const
+        {
+            if (log_slots_ > 0)
+            {
+                fft_handler_.transform_to_rev(values, log_slots_, root_powers_.get());
+            }
+        }
+
         template <
             typename T, typename = std::enable_if_t<
                             std::is_same<std::remove_cv_t<T>, double>::value ||
@@ -714,10 +872,10 @@ namespace seal
 
             // Create floating-point representations of the multi-precision integer coefficients
             double two_pow_64 = std::pow(2.0, 64);
-            auto res(util::allocate<std::complex<double>>(coeff_count, pool));
+            auto coeffs(util::allocate<double>(coeff_count, pool));
             for (std::size_t i = 0; i < coeff_count; i++)
             {
-                res[i] = 0.0;
+                coeffs[i] = 0.0;
                 if (util::is_greater_than_or_equal_uint(
                         plain_copy.get() + (i * coeff_modulus_size), upper_half_threshold, coeff_modulus_size))
                 {
@@ -727,12 +885,12 @@ namespace seal
                         if (plain_copy[i * coeff_modulus_size + j] > decryption_modulus[j])
                         {
                             auto diff = plain_copy[i * coeff_modulus_size + j] - decryption_modulus[j];
-                            res[i] += diff ? static_cast<double>(diff) * scaled_two_pow_64 : 0.0;
+                            coeffs[i] += diff ? static_cast<double>(diff) * scaled_two_pow_64 : 0.0;
                         }
                         else
                         {
                             auto diff = decryption_modulus[j] - plain_copy[i * coeff_modulus_size + j];
-                            res[i] -= diff ? static_cast<double>(diff) * scaled_two_pow_64 : 0.0;
+                            coeffs[i] -= diff ? static_cast<double>(diff) * scaled_two_pow_64 : 0.0;
                         }
                     }
                 }
@@ -742,17 +900,23 @@ namespace seal
                     for (std::size_t j = 0; j < coeff_modulus_size; j++, scaled_two_pow_64 *= two_pow_64)
                     {
                         auto curr_coeff = plain_copy[i * coeff_modulus_size + j];
-                        res[i] += curr_coeff ? static_cast<double>(curr_coeff) * scaled_two_pow_64 : 0.0;
+                        coeffs[i] += curr_coeff ? static_cast<double>(curr_coeff) * scaled_two_pow_64 : 0.0;
                     }
                 }
 
                 // Scaling instead incorporated above; this can help in cases
                 // where otherwise pow(two_pow_64, j) would overflow due to very
                 // large coeff_modulus_size and very large scale
-                // res[i] = res_accum * inv_scale;
+                // coeffs[i] = res_accum * inv_scale;
             }
 
-            fft_handler_.transform_to_rev(res.get(), logn, root_powers_.get());
+            // The low and high halves of the coefficients are the real and imaginary parts of the embedding input
+            auto res(util::allocate<std::complex<double>>(slots_, pool));
+            for (std::size_t i = 0; i < slots_; i++)
+            {
+                res[i] = std::complex<double>(coeffs[i], coeffs[i + slots_]);
+            }
+            transform_to_slots(res.get());
 
             for (std::size_t i = 0; i < sparse_slots_; i++)
             {
@@ -781,14 +945,17 @@ namespace seal
 
         std::size_t sparse_slots_;
 
+        int log_slots_;
+
         std::shared_ptr<util::ComplexRoots> complex_roots_;
 
-        // Holds 1~(n-1)-th powers of root in bit-reversed order, the 0-th power is left unset.
+        // Holds 1~(n/2-1)-th powers of root in bit-reversed order, the 0-th power is left unset.
         util::Pointer<std::complex<double>> root_powers_;
 
-        // Holds 1~(n-1)-th powers of inverse root in scrambled order, the 0-th power is left unset.
+        // Holds 1~(n/2-1)-th powers of inverse root in scrambled order, the 0-th power is left unset.
         util::Pointer<std::complex<double>> inv_root_powers_;
 
+        // Maps each slot to its bit-reversed location in the embedding of size n/2
         util::Pointer<std::size_t> matrix_reps_index_map_;
 
         ComplexArith complex_arith_;
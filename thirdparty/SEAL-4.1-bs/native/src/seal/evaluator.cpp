@@ -393,28 +393,95 @@ namespace seal
     }
 
     void Evaluator::add_const_inplace(Ciphertext &encrypted, double value) const {
-        Plaintext const_plain;
+        // Verify parameters.
+        if (!is_metadata_valid_for(encrypted, context_) || !is_buffer_valid(encrypted))
+        {
+            throw invalid_argument("encrypted is not valid for encryption parameters");
+        }
+        if (!encrypted.is_ntt_form())
+        {
+            throw invalid_argument("CKKS encrypted must be in NTT form");
+        }
 
-        encoder_.encode(value, encrypted.scale(), const_plain);
-        mod_switch_to_inplace(const_plain, encrypted.parms_id());
-        add_plain_inplace(encrypted, const_plain);
-    }
+        auto &context_data = *context_.get_context_data(encrypted.parms_id());
+        auto &parms = context_data.parms();
+        if (parms.scheme() != scheme_type::ckks)
+        {
+            throw invalid_argument("unsupported scheme");
+        }
+        auto &coeff_modulus = parms.coeff_modulus();
+        size_t coeff_count = parms.poly_modulus_degree();
+        size_t coeff_modulus_size = coeff_modulus.size();
 
-    void Evaluator::multiply_const_inplace(Ciphertext &encrypted, double value) const{
-        Plaintext const_plain;
+        // The residues are taken at the top level, exactly as if the constant
+        // were encoded there and switched down to the level of encrypted.
+        auto pool = MemoryManager::GetPool();
+        auto residues(allocate_uint(context_.first_context_data()->parms().coeff_modulus().size(), pool));
+        encoder_.encode_rns_constant(value, context_.first_parms_id(), encrypted.scale(), residues.get(), pool);
 
-        encoder_.encode(value, encrypted.scale(), const_plain);
-        mod_switch_to_inplace(const_plain, encrypted.parms_id());
-        multiply_plain_inplace(encrypted, const_plain);
+        RNSIter c0(encrypted.data(0), coeff_count);
+        SEAL_ITERATE(iter(c0, coeff_modulus, residues.get()), coeff_modulus_size, [&](auto I) {
+            add_poly_scalar_coeffmod(get<0>(I), coeff_count, get<2>(I), get<1>(I), get<0>(I));
+        });
+
+#ifdef SEAL_THROW_ON_TRANSPARENT_CIPHERTEXT
+        // Transparent ciphertext output is not allowed.
+        if (encrypted.is_transparent())
+        {
+            throw logic_error("result ciphertext is transparent");
+        }
+#endif
     }
 
-    template <typename T>
-    void Evaluator::multiply_vector_inplace(Ciphertext &encrypted, const std::vector<T> &value) const {
-        Plaintext vector_plain;
+    void Evaluator::multiply_const_inplace(Ciphertext &encrypted, double value, double scale) const{
+        // Verify parameters.
+        if (!is_metadata_valid_for(encrypted, context_) || !is_buffer_valid(encrypted))
+        {
+            throw invalid_argument("encrypted is not valid for encryption parameters");
+        }
+        if (!encrypted.is_ntt_form())
+        {
+            throw invalid_argument("CKKS encrypted must be in NTT form");
+        }
+
+        auto &context_data = *context_.get_context_data(encrypted.parms_id());
+        auto &parms = context_data.parms();
+        if (parms.scheme() != scheme_type::ckks)
+        {
+            throw invalid_argument("unsupported scheme");
+        }
+        auto &coeff_modulus = parms.coeff_modulus();
+        size_t coeff_count = parms.poly_modulus_degree();
+        size_t coeff_modulus_size = coeff_modulus.size();
+        size_t encrypted_size = encrypted.size();
+
+        auto pool = MemoryManager::GetPool();
+        auto residues(allocate_uint(context_.first_context_data()->parms().coeff_modulus().size(), pool));
+        encoder_.encode_rns_constant(value, context_.first_parms_id(), scale, residues.get(), pool);
 
-        encoder_.encode(value, encrypted.scale(), vector_plain);
-        mod_switch_to_inplace(vector_plain, encrypted.parms_id());
-        multiply_plain_inplace(encrypted, vector_plain);
+        for (size_t j = 0; j < coeff_modulus_size; j++)
+        {
+            MultiplyUIntModOperand scalar;
+            scalar.set(residues[j], coeff_modulus[j]);
+            SEAL_ITERATE(iter(encrypted), encrypted_size, [&](auto I) {
+                multiply_poly_scalar_coeffmod(I[j], coeff_count, scalar, coeff_modulus[j], I[j]);
+            });
+        }
+
+        // Set the scale
+        encrypted.scale() *= scale;
+        if (!is_scale_within_bounds(encrypted.scale(), context_data))
+        {
+            throw invalid_argument("scale out of bounds");
+        }
+
+#ifdef SEAL_THROW_ON_TRANSPARENT_CIPHERTEXT
+        // Transparent ciphertext output is not allowed.
+        if (encrypted.is_transparent())
+        {
+            throw logic_error("result ciphertext is transparent");
+        }
+#endif
     }
 
     void Evaluator::add_inplace_reduced_error(Ciphertext &encrypted1, const Ciphertext &encrypted2) const {
@@ -533,6 +600,147 @@ namespace seal
         }
     }
 
+    void Evaluator::multiply_relin_rescale_inplace(
+        Ciphertext &encrypted1, const Ciphertext &encrypted2, const RelinKeys &relin_keys, MemoryPoolHandle pool) const
+    {
+        multiply_inplace(encrypted1, encrypted2, pool);
+        relinearize_rescale_inplace(encrypted1, relin_keys, std::move(pool));
+    }
+
+    void Evaluator::square_relin_rescale_inplace(
+        Ciphertext &encrypted, const RelinKeys &relin_keys, MemoryPoolHandle pool) const
+    {
+        square_inplace(encrypted, pool);
+        relinearize_rescale_inplace(encrypted, relin_keys, std::move(pool));
+    }
+
+    void Evaluator::relinearize_rescale_inplace(
+        Ciphertext &encrypted, const RelinKeys &relin_keys, MemoryPoolHandle pool) const
+    {
+        relinearize_internal(encrypted, relin_keys, 2, pool);
+        rescale_to_next(encrypted, encrypted, std::move(pool));
+    }
+
+    void Evaluator::multiply_accumulate(
+        const Ciphertext &encrypted1, const Ciphertext &encrypted2, Ciphertext &destination,
+        MemoryPoolHandle pool) const
+    {
+        // Verify parameters.
+        if (!is_metadata_valid_for(encrypted1, context_) || !is_buffer_valid(encrypted1))
+        {
+            throw invalid_argument("encrypted1 is not valid for encryption parameters");
+        }
+        if (!is_metadata_valid_for(encrypted2, context_) || !is_buffer_valid(encrypted2))
+        {
+            throw invalid_argument("encrypted2 is not valid for encryption parameters");
+        }
+        if (encrypted1.parms_id() != encrypted2.parms_id())
+        {
+            throw invalid_argument("encrypted1 and encrypted2 parameter mismatch");
+        }
+        if (&destination == &encrypted1 || &destination == &encrypted2)
+        {
+            throw invalid_argument("destination cannot alias an input");
+        }
+        if (context_.first_context_data()->parms().scheme() != scheme_type::ckks)
+        {
+            throw invalid_argument("unsupported scheme");
+        }
+        if (encrypted1.size() != 2 || encrypted2.size() != 2)
+        {
+            throw invalid_argument("encrypted1 and encrypted2 must have size 2");
+        }
+        if (!encrypted1.is_ntt_form() || !encrypted2.is_ntt_form())
+        {
+            throw invalid_argument("encrypted1 or encrypted2 must be in NTT form");
+        }
+
+        auto &context_data = *context_.get_context_data(encrypted1.parms_id());
+        auto &parms = context_data.parms();
+        size_t coeff_count = parms.poly_modulus_degree();
+        size_t coeff_modulus_size = parms.coeff_modulus().size();
+        double scale = encrypted1.scale() * encrypted2.scale();
+
+        if (destination.size() == 0)
+        {
+            if (!is_scale_within_bounds(scale, context_data))
+            {
+                throw invalid_argument("scale out of bounds");
+            }
+            destination.resize(context_, context_data.parms_id(), 3);
+            fill_n(destination.data(), destination.dyn_array().size(), uint64_t(0));
+            destination.is_ntt_form() = true;
+            destination.scale() = scale;
+        }
+        else
+        {
+            if (!is_metadata_valid_for(destination, context_) || !is_buffer_valid(destination))
+            {
+                throw invalid_argument("destination is not valid for encryption parameters");
+            }
+            if (destination.parms_id() != encrypted1.parms_id())
+            {
+                throw invalid_argument("destination parameter mismatch");
+            }
+            if (!destination.is_ntt_form())
+            {
+                throw invalid_argument("destination must be in NTT form");
+            }
+            if (!util::are_close<double>(destination.scale(), scale))
+            {
+                throw invalid_argument("scale mismatch");
+            }
+            if (destination.size() > 3)
+            {
+                throw invalid_argument("destination must have size at most 3");
+            }
+            // Growing a size-2 accumulator zero-fills the new component
+            destination.resize(context_, context_data.parms_id(), 3);
+        }
+
+        // Same tiling as ckks_multiply: the four inputs, three outputs and temp stay in L1
+        size_t tile_size = min<size_t>(coeff_count, size_t(256));
+        size_t num_tiles = coeff_count / tile_size;
+        auto coeff_modulus = iter(parms.coeff_modulus());
+
+        ConstPolyIter encrypted1_iter = iter(encrypted1);
+        ConstPolyIter encrypted2_iter = iter(encrypted2);
+        PolyIter destination_iter = iter(destination);
+        ConstRNSIter encrypted1_0_iter(*encrypted1_iter[0], tile_size);
+        ConstRNSIter encrypted1_1_iter(*encrypted1_iter[1], tile_size);
+        ConstRNSIter encrypted2_0_iter(*encrypted2_iter[0], tile_size);
+        ConstRNSIter encrypted2_1_iter(*encrypted2_iter[1], tile_size);
+        RNSIter destination_0_iter(*destination_iter[0], tile_size);
+        RNSIter destination_1_iter(*destination_iter[1], tile_size);
+        RNSIter destination_2_iter(*destination_iter[2], tile_size);
+
+        SEAL_ALLOCATE_GET_COEFF_ITER(temp, tile_size, pool);
+
+        // destination += (x[0] * y[0], x[0] * y[1] + x[1] * y[0], x[1] * y[1])
+        SEAL_ITERATE(coeff_modulus, coeff_modulus_size, [&](auto I) {
+            SEAL_ITERATE(iter(size_t(0)), num_tiles, [&](SEAL_MAYBE_UNUSED auto J) {
+                dyadic_product_coeffmod(encrypted1_0_iter[0], encrypted2_0_iter[0], tile_size, I, temp);
+                add_poly_coeffmod(destination_0_iter[0], temp, tile_size, I, destination_0_iter[0]);
+
+                dyadic_product_coeffmod(encrypted1_0_iter[0], encrypted2_1_iter[0], tile_size, I, temp);
+                add_poly_coeffmod(destination_1_iter[0], temp, tile_size, I, destination_1_iter[0]);
+                dyadic_product_coeffmod(encrypted1_1_iter[0], encrypted2_0_iter[0], tile_size, I, temp);
+                add_poly_coeffmod(destination_1_iter[0], temp, tile_size, I, destination_1_iter[0]);
+
+                dyadic_product_coeffmod(encrypted1_1_iter[0], encrypted2_1_iter[0], tile_size, I, temp);
+                add_poly_coeffmod(destination_2_iter[0], temp, tile_size, I, destination_2_iter[0]);
+
+                encrypted1_0_iter++;
+                encrypted1_1_iter++;
+                encrypted2_0_iter++;
+                encrypted2_1_iter++;
+                destination_0_iter++;
+                destination_1_iter++;
+                destination_2_iter++;
+            });
+        });
+    }
+
     void Evaluator::multiply_inplace_reduced_error(Ciphertext &encrypted1, const Ciphertext &encrypted2, const RelinKeys &relin_keys) const {
         size_t encrypted1_coeff_modulus_size = encrypted1.coeff_modulus_size();
         size_t encrypted2_coeff_modulus_size = encrypted2.coeff_modulus_size();
@@ -1431,6 +1639,24 @@ namespace seal
         size_t coeff_count = next_parms.poly_modulus_degree();
         size_t next_coeff_modulus_size = next_parms.coeff_modulus().size();
 
+        if (&encrypted == &destination && next_parms.scheme() == scheme_type::ckks)
+        {
+            // Divide in place and pack the surviving RNS components of each polynomial
+            // down, instead of going through two full copies of the ciphertext
+            double q_last = static_cast<double>(context_data.parms().coeff_modulus().back().value());
+            SEAL_ITERATE(iter(destination), encrypted_size, [&](auto I) {
+                rns_tool->divide_and_round_q_last_ntt_inplace(I, context_data.small_ntt_tables(), pool);
+            });
+            size_t next_poly_size = mul_safe(coeff_count, next_coeff_modulus_size);
+            for (size_t i = 1; i < encrypted_size; i++)
+            {
+                copy_n(destination.data(i), next_poly_size, destination.data() + i * next_poly_size);
+            }
+            destination.resize(context_, next_context_data.parms_id(), encrypted_size);
+            destination.scale() /= q_last;
+            return;
+        }
+
         Ciphertext encrypted_copy(pool);
         encrypted_copy = encrypted;
 
@@ -2721,6 +2947,239 @@ namespace seal
         }
     }
 
+    void Evaluator::rotate_vector_hoisted(
+        const Ciphertext &encrypted, const vector<int> &steps, const GaloisKeys &galois_keys,
+        vector<Ciphertext> &destination, MemoryPoolHandle pool) const
+    {
+        // Verify parameters.
+        if (context_.key_context_data()->parms().scheme() != scheme_type::ckks)
+        {
+            throw logic_error("unsupported scheme");
+        }
+        if (!is_metadata_valid_for(encrypted, context_) || !is_buffer_valid(encrypted))
+        {
+            throw invalid_argument("encrypted is not valid for encryption parameters");
+        }
+        if (galois_keys.parms_id() != context_.key_parms_id())
+        {
+            throw invalid_argument("galois_keys is not valid for encryption parameters");
+        }
+        if (!encrypted.is_ntt_form() || encrypted.size() != 2)
+        {
+            throw invalid_argument("encrypted must be in NTT form and of size 2");
+        }
+        if (!context_.using_keyswitching())
+        {
+            throw logic_error("keyswitching is not supported by the context");
+        }
+        if (!pool)
+        {
+            throw invalid_argument("pool is uninitialized");
+        }
+
+        auto &context_data = *context_.get_context_data(encrypted.parms_id());
+        auto &key_context_data = *context_.key_context_data();
+        auto galois_tool = key_context_data.galois_tool();
+        size_t coeff_count = context_data.parms().poly_modulus_degree();
+        size_t decomp_modulus_size = context_data.parms().coeff_modulus().size();
+        auto &key_modulus = key_context_data.parms().coeff_modulus();
+        size_t key_modulus_size = key_modulus.size();
+        size_t rns_modulus_size = decomp_modulus_size + 1;
+        auto key_ntt_tables = iter(key_context_data.small_ntt_tables());
+        auto modswitch_factors = key_context_data.rns_tool()->inv_q_last_mod_q();
+        size_t rotation_count = steps.size();
+
+        vector<uint32_t> galois_elts(rotation_count);
+        for (size_t r = 0; r < rotation_count; r++)
+        {
+            galois_elts[r] = galois_tool->get_elt_from_step(steps[r]);
+            if (!galois_keys.has_key(galois_elts[r]))
+            {
+                throw invalid_argument("Galois key not present");
+            }
+        }
+
+        // The rotations of the first component need no key switching
+        destination.resize(rotation_count);
+        for (size_t r = 0; r < rotation_count; r++)
+        {
+            destination[r].resize(context_, encrypted.parms_id(), 2);
+            destination[r].is_ntt_form() = true;
+            destination[r].scale() = encrypted.scale();
+            destination[r].correction_factor() = encrypted.correction_factor();
+            galois_tool->apply_galois_ntt(
+                iter(encrypted)[0], decomp_modulus_size, galois_elts[r], iter(destination[r])[0]);
+            set_zero_poly(coeff_count, decomp_modulus_size, destination[r].data(1));
+        }
+        if (!rotation_count)
+        {
+            return;
+        }
+
+        // The digits of the second component in coefficient form
+        ConstRNSIter target_iter = iter(encrypted)[1];
+        SEAL_ALLOCATE_GET_RNS_ITER(t_target, coeff_count, decomp_modulus_size, pool);
+        set_uint(target_iter, decomp_modulus_size * coeff_count, t_target);
+        inverse_ntt_negacyclic_harvey(t_target, decomp_modulus_size, key_ntt_tables);
+
+        // Key inner products of every rotation over all RNS factors, the special prime last
+        auto t_prod(allocate_poly_array(rotation_count * 2, coeff_count, rns_modulus_size, pool));
+        auto prod = [&](size_t r, size_t k, size_t i) {
+            return CoeffIter(t_prod.get() + ((r * 2 + k) * rns_modulus_size + i) * coeff_count);
+        };
+
+        SEAL_ALLOCATE_GET_RNS_ITER(t_digits, coeff_count, decomp_modulus_size, pool);
+        SEAL_ALLOCATE_GET_COEFF_ITER(t_perm, coeff_count, pool);
+        auto t_acc(allocate_poly_array(2, coeff_count, 2, pool));
+        for (size_t i = 0; i < rns_modulus_size; i++)
+        {
+            size_t key_index = (i == decomp_modulus_size ? key_modulus_size - 1 : i);
+            const Modulus &modulus = key_modulus[key_index];
+
+            // The decomposition, shared by all rotations; NTT outputs lie in [0, 4q)
+            SEAL_ITERATE(iter(size_t(0)), decomp_modulus_size, [&](auto J) {
+                if (key_index == J)
+                {
+                    set_uint(target_iter[J], coeff_count, t_digits[J]);
+                    return;
+                }
+                if (key_modulus[J] <= modulus)
+                {
+                    set_uint(t_target[J], coeff_count, t_digits[J]);
+                }
+                else
+                {
+                    modulo_poly_coeffs(t_target[J], coeff_count, modulus, t_digits[J]);
+                }
+                ntt_negacyclic_harvey_lazy(t_digits[J], key_ntt_tables[key_index]);
+            });
+
+            for (size_t r = 0; r < rotation_count; r++)
+            {
+                size_t kswitch_keys_index = GaloisKeys::get_index(galois_elts[r]);
+                auto &key_vector = galois_keys.data()[kswitch_keys_index];
+                bool use_shoup = galois_keys.has_shoup_operands(kswitch_keys_index);
+                size_t lazy_reduction_summand_bound =
+                    use_shoup ? safe_cast<size_t>(((numeric_limits<uint64_t>::max() / modulus.value()) - 1) >> 1)
+                              : size_t(SEAL_MULTIPLY_ACCUMULATE_USER_MOD_MAX);
+                size_t lazy_summand_count = 0;
+                PolyIter accumulator_iter(t_acc.get(), 2, coeff_count);
+
+                for (size_t J = 0; J < decomp_modulus_size; J++)
+                {
+                    galois_tool->apply_galois_ntt(t_digits[J], galois_elts[r], t_perm);
+                    bool reduce = (++lazy_summand_count == lazy_reduction_summand_bound);
+                    for (size_t k = 0; k < 2; k++)
+                    {
+                        ConstCoeffIter key_iter(key_vector[J].data().data(k) + key_index * coeff_count);
+                        CoeffIter dest = prod(r, k, i);
+                        if (use_shoup)
+                        {
+                            ConstCoeffIter shoup_iter(
+                                galois_keys.shoup_data()[kswitch_keys_index][J].cbegin() +
+                                (k * key_modulus_size + key_index) * coeff_count);
+                            SEAL_ITERATE(iter(t_perm, key_iter, shoup_iter, dest), coeff_count, [&](auto L) {
+                                uint64_t product = multiply_uint_mod_lazy(
+                                    get<0>(L), MultiplyUIntModOperand{ get<1>(L), get<2>(L) }, modulus);
+                                get<3>(L) = J ? get<3>(L) + product : product;
+                                if (reduce)
+                                {
+                                    get<3>(L) = barrett_reduce_64(get<3>(L), modulus);
+                                }
+                            });
+                        }
+                        else
+                        {
+                            // Products are up to 120 bits and accumulate in 128
+                            SEAL_ITERATE(iter(t_perm, key_iter, accumulator_iter[k]), coeff_count, [&](auto L) {
+                                unsigned long long qword[2]{ 0, 0 };
+                                multiply_uint64(get<0>(L), get<1>(L), qword);
+                                if (J)
+                                {
+                                    add_uint128(qword, get<2>(L).ptr(), qword);
+                                }
+                                if (reduce)
+                                {
+                                    qword[0] = barrett_reduce_128(qword, modulus);
+                                    qword[1] = 0;
+                                }
+                                get<2>(L)[0] = qword[0];
+                                get<2>(L)[1] = qword[1];
+                            });
+                        }
+                    }
+                    if (reduce)
+                    {
+                        lazy_summand_count = 0;
+                    }
+                }
+
+                // Final modular reduction
+                for (size_t k = 0; k < 2; k++)
+                {
+                    CoeffIter dest = prod(r, k, i);
+                    if (use_shoup)
+                    {
+                        SEAL_ITERATE(dest, coeff_count, [&](auto &L) { L = barrett_reduce_64(L, modulus); });
+                    }
+                    else
+                    {
+                        SEAL_ITERATE(iter(accumulator_iter[k], dest), coeff_count, [&](auto L) {
+                            get<1>(L) = barrett_reduce_128(get<0>(L).ptr(), modulus);
+                        });
+                    }
+                }
+            }
+        }
+
+        // Modulus switching by the special prime, as in switch_key_inplace
+        const Modulus &qk_modulus = key_modulus[key_modulus_size - 1];
+        uint64_t qk = qk_modulus.value();
+        uint64_t qk_half = qk >> 1;
+        SEAL_ALLOCATE_GET_COEFF_ITER(t_ntt, coeff_count, pool);
+        for (size_t r = 0; r < rotation_count; r++)
+        {
+            for (size_t k = 0; k < 2; k++)
+            {
+                // Add (p-1)/2 to change from flooring to rounding.
+                CoeffIter t_last = prod(r, k, decomp_modulus_size);
+                inverse_ntt_negacyclic_harvey_lazy(t_last, key_ntt_tables[key_modulus_size - 1]);
+                SEAL_ITERATE(t_last, coeff_count, [&](auto &J) { J = barrett_reduce_64(J + qk_half, qk_modulus); });
+
+                RNSIter dest_iter = iter(destination[r])[k];
+                SEAL_ITERATE(
+                    iter(size_t(0), key_modulus, key_ntt_tables, modswitch_factors), decomp_modulus_size,
+                    [&](auto I) {
+                        uint64_t qi = get<1>(I).value();
+                        uint64_t fix = qi - barrett_reduce_64(qk_half, get<1>(I));
+                        if (qk > qi)
+                        {
+                            modulo_poly_coeffs(t_last, coeff_count, get<1>(I), t_ntt);
+                        }
+                        else
+                        {
+                            set_uint(t_last, coeff_count, t_ntt);
+                        }
+                        SEAL_ITERATE(t_ntt, coeff_count, [fix](auto &K) { K += fix; });
+                        ntt_negacyclic_harvey_lazy(t_ntt, get<2>(I));
+#if SEAL_USER_MOD_BIT_COUNT_MAX > 60
+                        uint64_t qi_lazy = qi << 1;
+                        SEAL_ITERATE(
+                            t_ntt, coeff_count, [&](auto &K) { K -= SEAL_COND_SELECT(K >= qi_lazy, qi_lazy, 0); });
+#else
+                        uint64_t qi_lazy = qi << 2;
+#endif
+                        SEAL_ITERATE(
+                            iter(dest_iter[get<0>(I)], prod(r, k, get<0>(I)), t_ntt), coeff_count, [&](auto K) {
+                                get<0>(K) = add_uint_mod(
+                                    get<0>(K), multiply_uint_mod(get<1>(K) + qi_lazy - get<2>(K), get<3>(I), get<1>(I)),
+                                    get<1>(I));
+                            });
+                    });
+            }
+        }
+    }
+
     void Evaluator::switch_key_inplace(
         Ciphertext &encrypted, ConstRNSIter target_iter, const KSwitchKeys &kswitch_keys, size_t kswitch_keys_index,
         MemoryPoolHandle pool) const
@@ -2811,29 +3270,33 @@ namespace seal
             inverse_ntt_negacyclic_harvey(t_target, decomp_modulus_size, key_ntt_tables);
         }
 
-        // Temporary result
-        auto t_poly_prod(allocate_zero_poly_array(key_component_count, coeff_count, rns_modulus_size, pool));
+        // With precomputed Shoup quotients the products are reduced lazily to [0, 2q) and accumulated in 64 bits;
+        // otherwise fall back to accumulating full 128-bit products.
+        bool use_shoup = kswitch_keys.has_shoup_operands(kswitch_keys_index);
 
-        SEAL_ITERATE(iter(size_t(0)), rns_modulus_size, [&](auto I) {
-            size_t key_index = (I == decomp_modulus_size ? key_modulus_size - 1 : I);
+        // Scratch space is allocated once for all RNS factors
+        SEAL_ALLOCATE_GET_COEFF_ITER(t_ntt, coeff_count, pool);
+        auto t_poly_lazy(allocate_poly_array(use_shoup ? 0 : key_component_count, coeff_count, 2, pool));
 
-            // Product of two numbers is up to 60 + 60 = 120 bits, so we can sum up to 256 of them without reduction.
-            size_t lazy_reduction_summand_bound = size_t(SEAL_MULTIPLY_ACCUMULATE_USER_MOD_MAX);
-            size_t lazy_reduction_counter = lazy_reduction_summand_bound;
+        // Computes the inner product of the decomposed target with the keys modulo key_modulus[key_index] for every
+        // key component, writing the result in [0, key_modulus[key_index]) to destination.
+        auto inner_product = [&](size_t key_index, PolyIter destination) {
+            const Modulus &modulus = key_modulus[key_index];
 
-            // Allocate memory for a lazy accumulator (128-bit coefficients)
-            auto t_poly_lazy(allocate_zero_poly_array(key_component_count, coeff_count, 2, pool));
+            // The number of summands that can be added to a reduced accumulator before it must be reduced again
+            size_t lazy_reduction_summand_bound =
+                use_shoup ? safe_cast<size_t>(((numeric_limits<uint64_t>::max() / modulus.value()) - 1) >> 1)
+                          : size_t(SEAL_MULTIPLY_ACCUMULATE_USER_MOD_MAX);
+            size_t lazy_summand_count = 0;
 
             // Semantic misuse of PolyIter; this is really pointing to the data for a single RNS factor
             PolyIter accumulator_iter(t_poly_lazy.get(), 2, coeff_count);
 
-            // Multiply with keys and perform lazy reduction on product's coefficients
             SEAL_ITERATE(iter(size_t(0)), decomp_modulus_size, [&](auto J) {
-                SEAL_ALLOCATE_GET_COEFF_ITER(t_ntt, coeff_count, pool);
                 ConstCoeffIter t_operand;
 
                 // RNS-NTT form exists in input
-                if ((scheme == scheme_type::ckks || scheme == scheme_type::bgv) && (I == J))
+                if ((scheme == scheme_type::ckks || scheme == scheme_type::bgv) && (key_index == J))
                 {
                     t_operand = target_iter[J];
                 }
@@ -2841,80 +3304,118 @@ namespace seal
                 else
                 {
                     // No need to perform RNS conversion (modular reduction)
-                    if (key_modulus[J] <= key_modulus[key_index])
+                    if (key_modulus[J] <= modulus)
                     {
                         set_uint(t_target[J], coeff_count, t_ntt);
                     }
                     // Perform RNS conversion (modular reduction)
                     else
                     {
-                        modulo_poly_coeffs(t_target[J], coeff_count, key_modulus[key_index], t_ntt);
+                        modulo_poly_coeffs(t_target[J], coeff_count, modulus, t_ntt);
                     }
                     // NTT conversion lazy outputs in [0, 4q)
                     ntt_negacyclic_harvey_lazy(t_ntt, key_ntt_tables[key_index]);
                     t_operand = t_ntt;
                 }
 
-                // Multiply with keys and modular accumulate products in a lazy fashion
-                SEAL_ITERATE(iter(key_vector[J].data(), accumulator_iter), key_component_count, [&](auto K) {
-                    if (!lazy_reduction_counter)
-                    {
-                        SEAL_ITERATE(iter(t_operand, get<0>(K)[key_index], get<1>(K)), coeff_count, [&](auto L) {
-                            unsigned long long qword[2]{ 0, 0 };
-                            multiply_uint64(get<0>(L), get<1>(L), qword);
+                if (use_shoup)
+                {
+                    auto &key_shoup = kswitch_keys.shoup_data()[kswitch_keys_index][J];
+                    SEAL_ITERATE(iter(size_t(0), destination), key_component_count, [&](auto K) {
+                        ConstCoeffIter key_iter(key_vector[J].data().data(get<0>(K)) + key_index * coeff_count);
+                        ConstCoeffIter shoup_iter(
+                            key_shoup.cbegin() + (get<0>(K) * key_modulus_size + key_index) * coeff_count);
+                        if (!J)
+                        {
+                            SEAL_ITERATE(iter(t_operand, key_iter, shoup_iter, *get<1>(K)), coeff_count, [&](auto L) {
+                                get<3>(L) = multiply_uint_mod_lazy(
+                                    get<0>(L), MultiplyUIntModOperand{ get<1>(L), get<2>(L) }, modulus);
+                            });
+                        }
+                        else
+                        {
+                            SEAL_ITERATE(iter(t_operand, key_iter, shoup_iter, *get<1>(K)), coeff_count, [&](auto L) {
+                                get<3>(L) += multiply_uint_mod_lazy(
+                                    get<0>(L), MultiplyUIntModOperand{ get<1>(L), get<2>(L) }, modulus);
+                            });
+                        }
+                    });
 
-                            // Accumulate product of t_operand and t_key_acc to t_poly_lazy and reduce
-                            add_uint128(qword, get<2>(L).ptr(), qword);
-                            get<2>(L)[0] = barrett_reduce_128(qword, key_modulus[key_index]);
-                            get<2>(L)[1] = 0;
+                    if (++lazy_summand_count == lazy_reduction_summand_bound)
+                    {
+                        SEAL_ITERATE(destination, key_component_count, [&](auto K) {
+                            SEAL_ITERATE(*K, coeff_count, [&](auto &L) { L = barrett_reduce_64(L, modulus); });
                         });
+                        lazy_summand_count = 0;
                     }
-                    else
-                    {
-                        // Same as above but no reduction
+                }
+                else
+                {
+                    // Product of two numbers is up to 60 + 60 = 120 bits, so we can sum up to 256 of them without
+                    // reduction.
+                    bool reduce = (++lazy_summand_count == lazy_reduction_summand_bound);
+                    SEAL_ITERATE(iter(key_vector[J].data(), accumulator_iter), key_component_count, [&](auto K) {
                         SEAL_ITERATE(iter(t_operand, get<0>(K)[key_index], get<1>(K)), coeff_count, [&](auto L) {
                             unsigned long long qword[2]{ 0, 0 };
                             multiply_uint64(get<0>(L), get<1>(L), qword);
-                            add_uint128(qword, get<2>(L).ptr(), qword);
-                            get<2>(L)[0] = qword[0];
-                            get<2>(L)[1] = qword[1];
+                            if (J)
+                            {
+                                add_uint128(qword, get<2>(L).ptr(), qword);
+                            }
+                            if (reduce)
+                            {
+                                get<2>(L)[0] = barrett_reduce_128(qword, modulus);
+                                get<2>(L)[1] = 0;
+                            }
+                            else
+                            {
+                                get<2>(L)[0] = qword[0];
+                                get<2>(L)[1] = qword[1];
+                            }
                         });
+                    });
+                    if (reduce)
+                    {
+                        lazy_summand_count = 0;
                     }
-                });
-
-                if (!--lazy_reduction_counter)
-                {
-                    lazy_reduction_counter = lazy_reduction_summand_bound;
                 }
             });
 
-            // PolyIter pointing to the destination t_poly_prod, shifted to the appropriate modulus
-            PolyIter t_poly_prod_iter(t_poly_prod.get() + (I * coeff_count), coeff_count, rns_modulus_size);
-
             // Final modular reduction
-            SEAL_ITERATE(iter(accumulator_iter, t_poly_prod_iter), key_component_count, [&](auto K) {
-                if (lazy_reduction_counter == lazy_reduction_summand_bound)
+            if (use_shoup)
+            {
+                if (lazy_summand_count)
                 {
-                    SEAL_ITERATE(iter(get<0>(K), *get<1>(K)), coeff_count, [&](auto L) {
-                        get<1>(L) = static_cast<uint64_t>(*get<0>(L));
+                    SEAL_ITERATE(destination, key_component_count, [&](auto K) {
+                        SEAL_ITERATE(*K, coeff_count, [&](auto &L) { L = barrett_reduce_64(L, modulus); });
                     });
                 }
-                else
-                {
-                    // Same as above except need to still do reduction
+            }
+            else
+            {
+                SEAL_ITERATE(iter(accumulator_iter, destination), key_component_count, [&](auto K) {
                     SEAL_ITERATE(iter(get<0>(K), *get<1>(K)), coeff_count, [&](auto L) {
-                        get<1>(L) = barrett_reduce_128(get<0>(L).ptr(), key_modulus[key_index]);
+                        get<1>(L) = barrett_reduce_128(get<0>(L).ptr(), modulus);
                     });
-                }
+                });
+            }
+        };
+
+        if (scheme == scheme_type::bgv)
+        {
+            // Temporary result
+            auto t_poly_prod(allocate_poly_array(key_component_count, coeff_count, rns_modulus_size, pool));
+            SEAL_ITERATE(iter(size_t(0)), rns_modulus_size, [&](auto I) {
+                size_t key_index = (I == decomp_modulus_size ? key_modulus_size - 1 : I);
+
+                // PolyIter pointing to the destination t_poly_prod, shifted to the appropriate modulus
+                inner_product(key_index, PolyIter(t_poly_prod.get() + (I * coeff_count), coeff_count, rns_modulus_size));
             });
-        });
-        // Accumulated products are now stored in t_poly_prod
+            // Accumulated products are now stored in t_poly_prod
 
-        // Perform modulus switching with scaling
-        PolyIter t_poly_prod_iter(t_poly_prod.get(), coeff_count, rns_modulus_size);
-        SEAL_ITERATE(iter(encrypted, t_poly_prod_iter), key_component_count, [&](auto I) {
-            if (scheme == scheme_type::bgv)
-            {
+            // Perform modulus switching with scaling
+            PolyIter t_poly_prod_iter(t_poly_prod.get(), coeff_count, rns_modulus_size);
+            SEAL_ITERATE(iter(encrypted, t_poly_prod_iter), key_component_count, [&](auto I) {
                 const Modulus &plain_modulus = parms.plain_modulus();
                 // qk is the special prime
                 uint64_t qk = key_modulus[key_modulus_size - 1].value();
@@ -2956,44 +3457,55 @@ namespace seal
 
                     add_poly_coeffmod(get<0, 1>(J), get<0, 0>(J), coeff_count, get<1>(J), get<0, 0>(J));
                 });
-            }
-            else
-            {
-                // Lazy reduction; this needs to be then reduced mod qi
-                CoeffIter t_last(get<1>(I)[decomp_modulus_size]);
-                inverse_ntt_negacyclic_harvey_lazy(t_last, key_ntt_tables[key_modulus_size - 1]);
+            });
+            return;
+        }
 
-                // Add (p-1)/2 to change from flooring to rounding.
-                uint64_t qk = key_modulus[key_modulus_size - 1].value();
-                uint64_t qk_half = qk >> 1;
-                SEAL_ITERATE(t_last, coeff_count, [&](auto &J) {
-                    J = barrett_reduce_64(J + qk_half, key_modulus[key_modulus_size - 1]);
-                });
+        // For CKKS and BFV the modulus switching is fused with the inner product: the special prime is processed
+        // first, and every other RNS factor is consumed by the modulus switching as soon as it is computed, so
+        // that only two RNS factors of the product are ever held in memory.
+        SEAL_ALLOCATE_GET_POLY_ITER(t_last, key_component_count, coeff_count, 1, pool);
+        SEAL_ALLOCATE_GET_POLY_ITER(t_poly_prod, key_component_count, coeff_count, 1, pool);
+
+        // Lazy reduction; this needs to be then reduced mod qi
+        const Modulus &qk_modulus = key_modulus[key_modulus_size - 1];
+        inner_product(key_modulus_size - 1, t_last);
+
+        // Add (p-1)/2 to change from flooring to rounding.
+        uint64_t qk = qk_modulus.value();
+        uint64_t qk_half = qk >> 1;
+        SEAL_ITERATE(t_last, key_component_count, [&](auto I) {
+            inverse_ntt_negacyclic_harvey_lazy(*I, key_ntt_tables[key_modulus_size - 1]);
+            SEAL_ITERATE(*I, coeff_count, [&](auto &J) { J = barrett_reduce_64(J + qk_half, qk_modulus); });
+        });
 
-                SEAL_ITERATE(iter(I, key_modulus, key_ntt_tables, modswitch_factors), decomp_modulus_size, [&](auto J) {
-                    SEAL_ALLOCATE_GET_COEFF_ITER(t_ntt, coeff_count, pool);
+        SEAL_ITERATE(
+            iter(size_t(0), key_modulus, key_ntt_tables, modswitch_factors), decomp_modulus_size, [&](auto I) {
+                inner_product(get<0>(I), t_poly_prod);
 
+                // Lazy substraction, results in [0, 2*qi), since fix is in [0, qi].
+                uint64_t qi = get<1>(I).value();
+                uint64_t fix = qi - barrett_reduce_64(qk_half, get<1>(I));
+
+                SEAL_ITERATE(iter(encrypted, t_last, t_poly_prod), key_component_count, [&](auto J) {
                     // (ct mod 4qk) mod qi
-                    uint64_t qi = get<1>(J).value();
                     if (qk > qi)
                     {
-                        // This cannot be spared. NTT only tolerates input that is less than 4*modulus (i.e. qk <=4*qi).
-                        modulo_poly_coeffs(t_last, coeff_count, get<1>(J), t_ntt);
+                        // This cannot be spared. NTT only tolerates input that is less than 4*modulus (i.e.
+                        // qk <=4*qi).
+                        modulo_poly_coeffs(*get<1>(J), coeff_count, get<1>(I), t_ntt);
                     }
                     else
                     {
-                        set_uint(t_last, coeff_count, t_ntt);
+                        set_uint(*get<1>(J), coeff_count, t_ntt);
                     }
-
-                    // Lazy substraction, results in [0, 2*qi), since fix is in [0, qi].
-                    uint64_t fix = qi - barrett_reduce_64(qk_half, get<1>(J));
                     SEAL_ITERATE(t_ntt, coeff_count, [fix](auto &K) { K += fix; });
 
                     uint64_t qi_lazy = qi << 1; // some multiples of qi
                     if (scheme == scheme_type::ckks)
                     {
                         // This ntt_negacyclic_harvey_lazy results in [0, 4*qi).
-                        ntt_negacyclic_harvey_lazy(t_ntt, get<2>(J));
+                        ntt_negacyclic_harvey_lazy(t_ntt, get<2>(I));
 #if SEAL_USER_MOD_BIT_COUNT_MAX > 60
                         // Reduce from [0, 4qi) to [0, 2qi)
                         SEAL_ITERATE(
@@ -3003,20 +3515,18 @@ namespace seal
                         qi_lazy = qi << 2;
 #endif
                     }
-                    else if (scheme == scheme_type::bfv)
+                    else
                     {
-                        inverse_ntt_negacyclic_harvey_lazy(get<0, 1>(J), get<2>(J));
+                        inverse_ntt_negacyclic_harvey_lazy(*get<2>(J), get<2>(I));
                     }
 
-                    // ((ct mod qi) - (ct mod qk)) mod qi with output in [0, 2 * qi_lazy)
-                    SEAL_ITERATE(
-                        iter(get<0, 1>(J), t_ntt), coeff_count, [&](auto K) { get<0>(K) += qi_lazy - get<1>(K); });
-
-                    // qk^(-1) * ((ct mod qi) - (ct mod qk)) mod qi
-                    multiply_poly_scalar_coeffmod(get<0, 1>(J), coeff_count, get<3>(J), get<1>(J), get<0, 1>(J));
-                    add_poly_coeffmod(get<0, 1>(J), get<0, 0>(J), coeff_count, get<1>(J), get<0, 0>(J));
+                    // qk^(-1) * ((ct mod qi) - (ct mod qk)) mod qi, accumulated directly into the ciphertext
+                    SEAL_ITERATE(iter(get<0>(J)[get<0>(I)], *get<2>(J), t_ntt), coeff_count, [&](auto K) {
+                        get<0>(K) = add_uint_mod(
+                            get<0>(K), multiply_uint_mod(get<1>(K) + qi_lazy - get<2>(K), get<3>(I), get<1>(I)),
+                            get<1>(I));
+                    });
                 });
-            }
-        });
+            });
     }
 } // namespace seal
@@ -10,11 +10,13 @@
 #include "seal/memorymanager.h"
 #include "seal/modulus.h"
 #include "seal/plaintext.h"
+#include "seal/plaintextcache.h"
 #include "seal/relinkeys.h"
 #include "seal/secretkey.h"
 #include "seal/valcheck.h"
 #include "seal/util/iterator.h"
 #include <map>
+#include <memory>
 #include <stdexcept>
 #include <vector>
 
@@ -1232,6 +1234,27 @@ namespace seal
             rotate_vector_inplace(destination, steps, galois_keys, std::move(pool));
         }
 
+        /**
+        Rotates one CKKS ciphertext by several steps with hoisted key switching. The RNS decomposition of the second
+        ciphertext component and its NTT over the key moduli are computed once and shared by all rotations, which
+        are applied to the decomposed digits as NTT-domain permutations; each step then only costs its key inner
+        product and modulus switch. Every step must have its own Galois key.
+
+        @param[in] encrypted The ciphertext to rotate
+        @param[in] steps The numbers of steps to rotate (positive left, negative right)
+        @param[in] galois_keys The Galois keys
+        @param[out] destination The rotated ciphertexts, one per step
+        @param[in] pool The MemoryPoolHandle pointing to a valid memory pool
+        @throws std::logic_error if scheme is not scheme_type::ckks
+        @throws std::invalid_argument if encrypted or galois_keys is not valid for
+        the encryption parameters
+        @throws std::invalid_argument if encrypted is not in NTT form or has size larger than 2
+        @throws std::invalid_argument if the Galois key of a step is not present
+        */
+        void rotate_vector_hoisted(
+            const Ciphertext &encrypted, const std::vector<int> &steps, const GaloisKeys &galois_keys,
+            std::vector<Ciphertext> &destination, MemoryPoolHandle pool = MemoryManager::GetPool()) const;
+
         /**
         Complex conjugates plaintext slot values. When using the CKKS scheme, this function complex conjugates all
         values in the underlying plaintext. Dynamic memory allocations in the process are allocated from the memory pool
@@ -1296,6 +1319,11 @@ namespace seal
         /*
         J.-W. Lee: Since we need to add/multiply constants or vectors to the 
         ciphertext, we add the required function as follows.
+
+        add_const_inplace and multiply_const_inplace work directly on the RNS
+        residues of round(value * scale): a constant polynomial is the same
+        constant at every NTT point, so no plaintext is materialized. Vectors
+        go through the plaintext cache set with set_plaintext_cache, if any.
         */
         void add_const_inplace(Ciphertext &encrypted, double value) const;
 
@@ -1304,22 +1332,61 @@ namespace seal
             add_const_inplace(destination, value);
         }
 
-        void multiply_const_inplace(Ciphertext &encrypted, double value) const;
+        inline void multiply_const_inplace(Ciphertext &encrypted, double value) const {
+            multiply_const_inplace(encrypted, value, encrypted.scale());
+        }
 
         inline void multiply_const(const Ciphertext &encrypted, double value, Ciphertext &destination) const {
             destination = encrypted;
             multiply_const_inplace(destination, value);
         }
 
-        template <typename T>
-        void multiply_vector_inplace(Ciphertext &encrypted, const std::vector<T> &value) const;
+        /*
+        Multiplies by value encoded at the given scale rather than at the scale
+        of encrypted; the result has scale encrypted.scale() * scale. This is
+        what exact scale management needs to land a product on a chosen scale.
+        */
+        void multiply_const_inplace(Ciphertext &encrypted, double value, double scale) const;
 
-        template <typename T>
+        inline void multiply_const(
+            const Ciphertext &encrypted, double value, double scale, Ciphertext &destination) const {
+            destination = encrypted;
+            multiply_const_inplace(destination, value, scale);
+        }
+
+        template <typename T, typename = std::enable_if_t<std::is_same<std::remove_cv_t<T>, double>::value ||std::is_same<std::remove_cv_t<T>, std::complex<double>>::value>>
+        void multiply_vector_inplace(Ciphertext &encrypted, const std::vector<T> &value) const
+        {
+            multiply_plain_inplace(encrypted, *encode_vector(value, encrypted.parms_id(), encrypted.scale()));
+        }
+
+        template <typename T, typename = std::enable_if_t<std::is_same<std::remove_cv_t<T>, double>::value ||std::is_same<std::remove_cv_t<T>, std::complex<double>>::value>>
         void multiply_vector(Ciphertext &encrypted, const std::vector<T> &value, Ciphertext &destination) const {
             destination = encrypted;
             multiply_vector_inplace(destination, value);
         }
 
+        /**
+        Sets the plaintext cache used by multiply_vector_inplace and
+        multiply_vector_inplace_reduced_error. The cache may be shared with
+        other evaluators and with application code. Pass nullptr to disable
+        caching, which is the default.
+
+        @param[in] cache The plaintext cache to use
+        */
+        inline void set_plaintext_cache(std::shared_ptr<PlaintextCache> cache) noexcept
+        {
+            plaintext_cache_ = std::move(cache);
+        }
+
+        /**
+        Returns the plaintext cache in use, or nullptr if caching is disabled.
+        */
+        SEAL_NODISCARD inline const std::shared_ptr<PlaintextCache> &plaintext_cache() const noexcept
+        {
+            return plaintext_cache_;
+        }
+
         /*
         J.-W. Lee: Kim et al. (CT-RSA 2022) proposed the methods to reduce the 
         approximation error in CKKS scheme. The following functions are the 
@@ -1353,6 +1420,47 @@ namespace seal
             sub_inplace_reduced_error(destination, encrypted2);
         }
 
+        /*
+        Fused multiply, relinearize and rescale. The product is relinearized and
+        then divided by the last prime in place, so the size-3 intermediate is the
+        only buffer the chain needs.
+        */
+        void multiply_relin_rescale_inplace(
+            Ciphertext &encrypted1, const Ciphertext &encrypted2, const RelinKeys &relin_keys,
+            MemoryPoolHandle pool = MemoryManager::GetPool()) const;
+
+        inline void multiply_relin_rescale(
+            const Ciphertext &encrypted1, const Ciphertext &encrypted2, const RelinKeys &relin_keys,
+            Ciphertext &destination, MemoryPoolHandle pool = MemoryManager::GetPool()) const
+        {
+            if (&encrypted2 == &destination)
+            {
+                multiply_relin_rescale_inplace(destination, encrypted1, relin_keys, std::move(pool));
+            }
+            else
+            {
+                destination = encrypted1;
+                multiply_relin_rescale_inplace(destination, encrypted2, relin_keys, std::move(pool));
+            }
+        }
+
+        void square_relin_rescale_inplace(
+            Ciphertext &encrypted, const RelinKeys &relin_keys, MemoryPoolHandle pool = MemoryManager::GetPool()) const;
+
+        void relinearize_rescale_inplace(
+            Ciphertext &encrypted, const RelinKeys &relin_keys, MemoryPoolHandle pool = MemoryManager::GetPool()) const;
+
+        /*
+        Adds encrypted1 * encrypted2 to destination without relinearizing, so that
+        a sum of products pays for a single key switch. The tensor product is
+        accumulated directly into the size-3 destination. An empty destination is
+        initialized to the product; otherwise it must be at the same level and
+        scale as the product. Only CKKS ciphertexts of size 2 are supported.
+        */
+        void multiply_accumulate(
+            const Ciphertext &encrypted1, const Ciphertext &encrypted2, Ciphertext &destination,
+            MemoryPoolHandle pool = MemoryManager::GetPool()) const;
+
         void multiply_inplace_reduced_error(Ciphertext &encrypted1, const Ciphertext &encrypted2, const RelinKeys &relin_keys) const;
 
         inline void multiply_reduced_error(const Ciphertext &encrypted1, const Ciphertext &encrypted2, const RelinKeys &relin_keys, Ciphertext &destination) const
@@ -1371,11 +1479,7 @@ namespace seal
 		template <typename T, typename = std::enable_if_t<std::is_same<std::remove_cv_t<T>, double>::value ||std::is_same<std::remove_cv_t<T>, std::complex<double>>::value>>
 		void multiply_vector_inplace_reduced_error(Ciphertext &encrypted, const std::vector<T> &value)
 		{
-			Plaintext plain;
-			
-			encoder_.encode(value, encrypted.scale(), plain);
-			mod_switch_to_inplace(plain, encrypted.parms_id());
-			multiply_plain_inplace(encrypted, plain);
+			multiply_plain_inplace(encrypted, *encode_vector(value, encrypted.parms_id(), encrypted.scale()));
 		}
 
 		template <typename T, typename = std::enable_if_t<std::is_same<std::remove_cv_t<T>, double>::value ||std::is_same<std::remove_cv_t<T>, std::complex<double>>::value>>
@@ -1456,8 +1560,30 @@ namespace seal
 
         void multiply_plain_ntt(Ciphertext &encrypted_ntt, const Plaintext &plain_ntt) const;
 
+        // Encodes value at the top level and switches it down to parms_id, going
+        // through plaintext_cache_ when one is set.
+        template <typename T>
+        std::shared_ptr<const Plaintext> encode_vector(
+            const std::vector<T> &value, parms_id_type parms_id, double scale) const
+        {
+            auto encode = [&](Plaintext &plain) {
+                encoder_.encode(value, scale, plain);
+                mod_switch_to_inplace(plain, parms_id);
+            };
+            if (plaintext_cache_)
+            {
+                return plaintext_cache_->get_or_encode(value, parms_id, scale, encode);
+            }
+
+            auto plain = std::make_shared<Plaintext>();
+            encode(*plain);
+            return plain;
+        }
+
         SEALContext context_;
 
         CKKSEncoder &encoder_;
+
+        std::shared_ptr<PlaintextCache> plaintext_cache_;
     };
 } // namespace seal
@@ -158,6 +158,12 @@ namespace seal
         // Set the parms_id
         relin_keys.parms_id() = context_data.parms_id();
 
+        // Seeded keys are only meant to be serialized; otherwise speed up keyswitching
+        if (!save_seed)
+        {
+            relin_keys.precompute_shoup_operands(context_);
+        }
+
         return relin_keys;
     }
 
@@ -219,6 +225,12 @@ namespace seal
         // Set the parms_id
         galois_keys.parms_id_ = context_data.parms_id();
 
+        // Seeded keys are only meant to be serialized; otherwise speed up keyswitching
+        if (!save_seed)
+        {
+            galois_keys.precompute_shoup_operands(context_);
+        }
+
         return galois_keys;
     }
 
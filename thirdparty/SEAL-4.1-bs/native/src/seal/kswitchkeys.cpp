@@ -2,6 +2,8 @@
 // Licensed under the MIT license.
 
 #include "seal/kswitchkeys.h"
+#include "seal/util/iterator.h"
+#include "seal/util/uintarithsmallmod.h"
 #include <stdexcept>
 
 using namespace std;
@@ -36,9 +38,82 @@ namespace seal
             }
         }
 
+        // Finally copy over the Shoup quotients, if any
+        shoup_keys_.clear();
+        size_t shoup_dim1 = assign.shoup_keys_.size();
+        shoup_keys_.reserve(shoup_dim1);
+        for (size_t i = 0; i < shoup_dim1; i++)
+        {
+            size_t shoup_dim2 = assign.shoup_keys_[i].size();
+            shoup_keys_.emplace_back();
+            shoup_keys_[i].reserve(shoup_dim2);
+            for (size_t j = 0; j < shoup_dim2; j++)
+            {
+                shoup_keys_[i].emplace_back(pool_);
+                shoup_keys_[i][j] = assign.shoup_keys_[i][j];
+            }
+        }
+
         return *this;
     }
 
+    void KSwitchKeys::precompute_shoup_operands(const SEALContext &context)
+    {
+        // Verify parameters
+        if (!context.parameters_set())
+        {
+            throw invalid_argument("encryption parameters are not set correctly");
+        }
+        if (!is_valid_for(*this, context))
+        {
+            throw invalid_argument("keyswitching keys are not valid for encryption parameters");
+        }
+
+        auto &key_parms = context.key_context_data()->parms();
+        auto &key_modulus = key_parms.coeff_modulus();
+        size_t coeff_count = key_parms.poly_modulus_degree();
+        size_t key_modulus_size = key_modulus.size();
+
+        vector<vector<DynArray<uint64_t>>> new_shoup_keys;
+        new_shoup_keys.reserve(keys_.size());
+        for (auto &key_dim1 : keys_)
+        {
+            new_shoup_keys.emplace_back();
+            new_shoup_keys.back().reserve(key_dim1.size());
+            for (auto &key : key_dim1)
+            {
+                auto &key_data = key.data();
+                size_t key_component_count = key_data.size();
+                DynArray<uint64_t> shoup(mul_safe(key_component_count, key_modulus_size, coeff_count), pool_);
+
+                ConstPolyIter key_iter(key_data);
+                PolyIter shoup_iter(shoup.begin(), coeff_count, key_modulus_size);
+                SEAL_ITERATE(iter(key_iter, shoup_iter), key_component_count, [&](auto I) {
+                    SEAL_ITERATE(iter(get<0>(I), get<1>(I), key_modulus), key_modulus_size, [&](auto J) {
+                        SEAL_ITERATE(iter(get<0>(J), get<1>(J)), coeff_count, [&](auto K) {
+                            get<1>(K) = shoup_quotient(get<0>(K), get<2>(J));
+                        });
+                    });
+                });
+                new_shoup_keys.back().emplace_back(move(shoup));
+            }
+        }
+
+        swap(shoup_keys_, new_shoup_keys);
+    }
+
+    void KSwitchKeys::try_precompute_shoup_operands(const SEALContext &context)
+    {
+        if (context.parameters_set() && context.using_keyswitching() && is_valid_for(*this, context))
+        {
+            precompute_shoup_operands(context);
+        }
+        else
+        {
+            shoup_keys_.clear();
+        }
+    }
+
     void KSwitchKeys::save_members(ostream &stream) const
     {
         auto old_except_mask = stream.exceptions();
@@ -3,6 +3,7 @@
 
 #pragma once
 
+#include "seal/dynarray.h"
 #include "seal/encryptionparams.h"
 #include "seal/memorymanager.h"
 #include "seal/publickey.h"
@@ -25,6 +26,16 @@ namespace seal
     (vector) of keys. In RelinKeys, each key is an encryption of a power of the
     secret key. In GaloisKeys, each key corresponds to a type of rotation.
 
+    @par Shoup Operands
+    To speed up keyswitching, KSwitchKeys can additionally hold the Shoup quotients
+    floor(k * 2^64 / q) of every key coefficient k modulo q. These are computed
+    automatically when keys are generated by KeyGenerator (without seeds) or loaded
+    from a stream, and are used by Evaluator to replace 128-bit products in the
+    keyswitching inner product by cheaper lazy Shoup multiplications. They double
+    the memory footprint of the keys; call clear_shoup_operands() to release them.
+    If the keys are modified through data(), precompute_shoup_operands() must be
+    called again, or the Shoup operands must be cleared.
+
     @par Thread Safety
     In general, reading from KSwitchKeys is thread-safe as long as no
     other thread is concurrently mutating it. This is due to the underlying
@@ -130,6 +141,47 @@ namespace seal
             return keys_[index];
         }
 
+        /**
+        Computes the Shoup quotients of all keyswitching keys and stores them
+        alongside the keys, replacing any previously computed values.
+
+        @param[in] context The SEALContext
+        @throws std::invalid_argument if the encryption parameters are not valid
+        @throws std::invalid_argument if the keys are not valid for the encryption
+        parameters
+        */
+        void precompute_shoup_operands(const SEALContext &context);
+
+        /**
+        Releases the memory held by the Shoup quotients. Keyswitching then falls
+        back to 128-bit lazy accumulation.
+        */
+        inline void clear_shoup_operands() noexcept
+        {
+            shoup_keys_.clear();
+        }
+
+        /**
+        Returns whether the Shoup quotients are available for the keyswitching key
+        at a given index.
+
+        @param[in] index The index of the keyswitching key
+        */
+        SEAL_NODISCARD inline bool has_shoup_operands(std::size_t index) const noexcept
+        {
+            return index < keys_.size() && index < shoup_keys_.size() && !keys_[index].empty() &&
+                   shoup_keys_[index].size() == keys_[index].size();
+        }
+
+        /**
+        Returns a const reference to the Shoup quotients. Each entry mirrors the
+        corresponding PublicKey in data() and has the same coefficient layout.
+        */
+        SEAL_NODISCARD inline auto &shoup_data() const noexcept
+        {
+            return shoup_keys_;
+        }
+
         /**
         Returns a reference to parms_id.
 
@@ -218,7 +270,10 @@ namespace seal
         inline std::streamoff unsafe_load(const SEALContext &context, std::istream &stream)
         {
             using namespace std::placeholders;
-            return Serialization::Load(std::bind(&KSwitchKeys::load_members, this, context, _1, _2), stream, false);
+            auto in_size =
+                Serialization::Load(std::bind(&KSwitchKeys::load_members, this, context, _1, _2), stream, false);
+            try_precompute_shoup_operands(context);
+            return in_size;
         }
 
         /**
@@ -286,7 +341,10 @@ namespace seal
         inline std::streamoff unsafe_load(const SEALContext &context, const seal_byte *in, std::size_t size)
         {
             using namespace std::placeholders;
-            return Serialization::Load(std::bind(&KSwitchKeys::load_members, this, context, _1, _2), in, size, false);
+            auto in_size =
+                Serialization::Load(std::bind(&KSwitchKeys::load_members, this, context, _1, _2), in, size, false);
+            try_precompute_shoup_operands(context);
+            return in_size;
         }
 
         /**
@@ -330,6 +388,12 @@ namespace seal
 
         void load_members(const SEALContext &context, std::istream &stream, SEALVersion version);
 
+        /**
+        Computes the Shoup quotients if the loaded keys have valid metadata and
+        otherwise leaves them empty; unsafe_load must not throw on such keys.
+        */
+        void try_precompute_shoup_operands(const SEALContext &context);
+
         MemoryPoolHandle pool_ = MemoryManager::GetPool();
 
         parms_id_type parms_id_ = parms_id_zero;
@@ -338,5 +402,10 @@ namespace seal
         The vector of keyswitching keys.
         */
         std::vector<std::vector<PublicKey>> keys_{};
+
+        /**
+        The Shoup quotients of keys_, with the same shape and coefficient layout.
+        */
+        std::vector<std::vector<DynArray<std::uint64_t>>> shoup_keys_{};
     };
 } // namespace seal
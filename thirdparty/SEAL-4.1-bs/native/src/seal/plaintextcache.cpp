@@ -0,0 +1,161 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include "seal/plaintextcache.h"
+#include <cstring>
+
+using namespace std;
+
+namespace seal
+{
+    namespace
+    {
+        inline uint64_t double_bits(double value)
+        {
+            uint64_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            return bits;
+        }
+
+        inline uint64_t mix(uint64_t seed, uint64_t value)
+        {
+            // Same combiner as boost::hash_combine, widened to 64 bits
+            return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+        }
+    } // namespace
+
+    bool PlaintextCache::Key::operator==(const Key &other) const
+    {
+        return kind == other.kind && values_hash == other.values_hash && parms_id == other.parms_id &&
+               double_bits(scale) == double_bits(other.scale);
+    }
+
+    size_t PlaintextCache::KeyHash::operator()(const Key &key) const
+    {
+        uint64_t result = static_cast<uint64_t>(key.kind);
+        result = mix(result, key.values_hash);
+        result = mix(result, hash<parms_id_type>()(key.parms_id));
+        result = mix(result, double_bits(key.scale));
+        return static_cast<size_t>(result);
+    }
+
+    uint64_t PlaintextCache::hash_values(const double *values, size_t count)
+    {
+        uint64_t result = count;
+        for (size_t i = 0; i < count; i++)
+        {
+            result = mix(result, double_bits(values[i]));
+        }
+        return result;
+    }
+
+    shared_ptr<const Plaintext> PlaintextCache::find(const Key &key, const double *values, size_t count)
+    {
+        lock_guard<mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it == index_.end() || it->second->values.size() != count ||
+            memcmp(it->second->values.data(), values, count * sizeof(double)))
+        {
+            misses_++;
+            return nullptr;
+        }
+
+        // Move to the front of the recency list
+        entries_.splice(entries_.begin(), entries_, it->second);
+        hits_++;
+        return it->second->plain;
+    }
+
+    shared_ptr<const Plaintext> PlaintextCache::insert(
+        const Key &key, const double *values, size_t count, shared_ptr<const Plaintext> plain)
+    {
+        size_t entry_bytes = plain->dyn_array().size() * sizeof(Plaintext::pt_coeff_type) + count * sizeof(double);
+
+        lock_guard<mutex> lock(mutex_);
+        if (entry_bytes > max_bytes_)
+        {
+            return plain;
+        }
+
+        auto it = index_.find(key);
+        if (it != index_.end())
+        {
+            if (it->second->values.size() == count &&
+                !memcmp(it->second->values.data(), values, count * sizeof(double)))
+            {
+                // Another thread inserted the same entry while we were encoding
+                entries_.splice(entries_.begin(), entries_, it->second);
+                return it->second->plain;
+            }
+
+            // Hash collision; the newer entry replaces the older one
+            bytes_ -= it->second->bytes;
+            entries_.erase(it->second);
+            index_.erase(it);
+        }
+
+        evict_to(max_bytes_ - entry_bytes);
+        entries_.push_front(Entry{ key, vector<double>(values, values + count), plain, entry_bytes });
+        index_.emplace(key, entries_.begin());
+        bytes_ += entry_bytes;
+        return plain;
+    }
+
+    void PlaintextCache::evict_to(size_t max_bytes)
+    {
+        while (bytes_ > max_bytes && !entries_.empty())
+        {
+            auto &last = entries_.back();
+            bytes_ -= last.bytes;
+            index_.erase(last.key);
+            entries_.pop_back();
+        }
+    }
+
+    void PlaintextCache::clear()
+    {
+        lock_guard<mutex> lock(mutex_);
+        index_.clear();
+        entries_.clear();
+        bytes_ = 0;
+        hits_ = 0;
+        misses_ = 0;
+    }
+
+    void PlaintextCache::set_max_bytes(size_t max_bytes)
+    {
+        lock_guard<mutex> lock(mutex_);
+        max_bytes_ = max_bytes;
+        evict_to(max_bytes_);
+    }
+
+    size_t PlaintextCache::max_bytes() const
+    {
+        lock_guard<mutex> lock(mutex_);
+        return max_bytes_;
+    }
+
+    size_t PlaintextCache::bytes() const
+    {
+        lock_guard<mutex> lock(mutex_);
+        return bytes_;
+    }
+
+    size_t PlaintextCache::size() const
+    {
+        lock_guard<mutex> lock(mutex_);
+        return entries_.size();
+    }
+
+    uint64_t PlaintextCache::hits() const
+    {
+        lock_guard<mutex> lock(mutex_);
+        return hits_;
+    }
+
+    uint64_t PlaintextCache::misses() const
+    {
+        lock_guard<mutex> lock(mutex_);
+        return misses_;
+    }
+} // namespace seal
@@ -0,0 +1,224 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include "seal/encryptionparams.h"
+#include "seal/plaintext.h"
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace seal
+{
+    /**
+    A bounded, least-recently-used cache of encoded CKKS plaintexts. Entries are
+    keyed by the encoded data (a single real constant, or a vector of real or
+    complex values), the parms_id of the plaintext, and the scale it was encoded
+    at. Evaluator uses a cache to avoid re-encoding the same constants and
+    diagonal vectors in multiply_vector_inplace, and applications can share the
+    same instance to cache their own constants.
+
+    @par Bounds
+    The cache is bounded by the total number of bytes held by the cached
+    plaintexts and their keys. When an insertion exceeds the bound, the least
+    recently used entries are evicted. A plaintext larger than the whole budget
+    is returned to the caller without being cached.
+
+    @par Keys
+    Vectors are looked up by a hash of their bit patterns, but a hit is only
+    reported when the stored values compare bit-for-bit equal to the requested
+    ones, so hash collisions can never return a wrong plaintext.
+
+    @par Thread Safety
+    All member functions are thread-safe. The encoding callback passed to
+    get_or_encode runs outside of the internal lock, so concurrent misses on
+    the same key may both encode; the first insertion wins. Returned plaintexts
+    are shared and must not be modified.
+    */
+    class PlaintextCache
+    {
+    public:
+        /**
+        The default memory budget of 256 MiB.
+        */
+        static constexpr std::size_t default_max_bytes = std::size_t(256) << 20;
+
+        /**
+        Creates an empty cache holding at most max_bytes of plaintext data.
+
+        @param[in] max_bytes The memory budget for cached plaintexts
+        */
+        explicit PlaintextCache(std::size_t max_bytes = default_max_bytes) : max_bytes_(max_bytes)
+        {}
+
+        PlaintextCache(const PlaintextCache &copy) = delete;
+
+        PlaintextCache &operator=(const PlaintextCache &assign) = delete;
+
+        /**
+        Returns the plaintext cached for a real constant at the given parms_id and
+        scale, invoking encode(Plaintext &) to produce and insert it on a miss.
+
+        @param[in] value The real constant
+        @param[in] parms_id The parms_id of the encoded plaintext
+        @param[in] scale The scale of the encoded plaintext
+        @param[in] encode Callable that encodes the plaintext on a miss
+        */
+        template <typename Encode>
+        std::shared_ptr<const Plaintext> get_or_encode(
+            double value, parms_id_type parms_id, double scale, Encode &&encode)
+        {
+            return get_or_encode_values(KeyKind::scalar, &value, 1, parms_id, scale, std::forward<Encode>(encode));
+        }
+
+        /**
+        Returns the plaintext cached for a vector of real or complex values at the
+        given parms_id and scale, invoking encode(Plaintext &) to produce and
+        insert it on a miss.
+
+        @param[in] values The encoded values
+        @param[in] parms_id The parms_id of the encoded plaintext
+        @param[in] scale The scale of the encoded plaintext
+        @param[in] encode Callable that encodes the plaintext on a miss
+        */
+        template <
+            typename T, typename Encode,
+            typename = std::enable_if_t<
+                std::is_same<std::remove_cv_t<T>, double>::value ||
+                std::is_same<std::remove_cv_t<T>, std::complex<double>>::value>>
+        std::shared_ptr<const Plaintext> get_or_encode(
+            const std::vector<T> &values, parms_id_type parms_id, double scale, Encode &&encode)
+        {
+            constexpr bool is_complex = std::is_same<std::remove_cv_t<T>, std::complex<double>>::value;
+            return get_or_encode_values(
+                is_complex ? KeyKind::complex_vector : KeyKind::real_vector,
+                reinterpret_cast<const double *>(values.data()), values.size() * (is_complex ? 2 : 1), parms_id,
+                scale, std::forward<Encode>(encode));
+        }
+
+        /**
+        Removes all entries and resets the hit and miss counters.
+        */
+        void clear();
+
+        /**
+        Changes the memory budget, evicting entries if necessary.
+
+        @param[in] max_bytes The new memory budget
+        */
+        void set_max_bytes(std::size_t max_bytes);
+
+        /**
+        Returns the memory budget.
+        */
+        SEAL_NODISCARD std::size_t max_bytes() const;
+
+        /**
+        Returns the number of bytes currently held by the cache.
+        */
+        SEAL_NODISCARD std::size_t bytes() const;
+
+        /**
+        Returns the number of cached plaintexts.
+        */
+        SEAL_NODISCARD std::size_t size() const;
+
+        /**
+        Returns the number of lookups answered from the cache.
+        */
+        SEAL_NODISCARD std::uint64_t hits() const;
+
+        /**
+        Returns the number of lookups that required encoding.
+        */
+        SEAL_NODISCARD std::uint64_t misses() const;
+
+    private:
+        enum class KeyKind : std::uint8_t
+        {
+            scalar = 0,
+
+            real_vector = 1,
+
+            complex_vector = 2
+        };
+
+        struct Key
+        {
+            KeyKind kind;
+
+            std::uint64_t values_hash;
+
+            parms_id_type parms_id;
+
+            double scale;
+
+            SEAL_NODISCARD bool operator==(const Key &other) const;
+        };
+
+        struct KeyHash
+        {
+            std::size_t operator()(const Key &key) const;
+        };
+
+        struct Entry
+        {
+            Key key;
+
+            std::vector<double> values;
+
+            std::shared_ptr<const Plaintext> plain;
+
+            std::size_t bytes;
+        };
+
+        template <typename Encode>
+        std::shared_ptr<const Plaintext> get_or_encode_values(
+            KeyKind kind, const double *values, std::size_t count, parms_id_type parms_id, double scale,
+            Encode &&encode)
+        {
+            Key key{ kind, hash_values(values, count), parms_id, scale };
+            if (auto plain = find(key, values, count))
+            {
+                return plain;
+            }
+
+            auto plain = std::make_shared<Plaintext>();
+            encode(*plain);
+            return insert(key, values, count, std::move(plain));
+        }
+
+        SEAL_NODISCARD static std::uint64_t hash_values(const double *values, std::size_t count);
+
+        std::shared_ptr<const Plaintext> find(const Key &key, const double *values, std::size_t count);
+
+        std::shared_ptr<const Plaintext> insert(
+            const Key &key, const double *values, std::size_t count, std::shared_ptr<const Plaintext> plain);
+
+        // Must be called with mutex_ held.
+        void evict_to(std::size_t max_bytes);
+
+        mutable std::mutex mutex_;
+
+        std::size_t max_bytes_;
+
+        std::size_t bytes_ = 0;
+
+        std::uint64_t hits_ = 0;
+
+        std::uint64_t misses_ = 0;
+
+        // Most recently used entries at the front
+        std::list<Entry> entries_;
+
+        std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index_;
+    };
+} // namespace seal
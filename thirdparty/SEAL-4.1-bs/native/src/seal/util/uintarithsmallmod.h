@@ -284,6 +284,33 @@ namespace seal
             }
         };
 
+        /**
+        Returns floor((operand << 64) / modulus), i.e., the quotient stored in MultiplyUIntModOperand. Unlike
+        MultiplyUIntModOperand::set_quotient this avoids the 128-bit division by using the precomputed Barrett
+        ratio of modulus, which makes it suitable for converting entire polynomials (e.g., keyswitching keys).
+        Correctness: operand must be less than modulus.
+        */
+        SEAL_NODISCARD inline std::uint64_t shoup_quotient(std::uint64_t operand, const Modulus &modulus)
+        {
+#ifdef SEAL_DEBUG
+            if (operand >= modulus.value())
+            {
+                throw std::invalid_argument("input must be less than modulus");
+            }
+#endif
+            // Estimate floor(operand * floor(2^128 / p) / 2^64); this is either exact or one too small.
+            auto &const_ratio = modulus.const_ratio();
+            unsigned long long low_product[2];
+            unsigned long long high_product[2];
+            multiply_uint64(operand, const_ratio[0], low_product);
+            multiply_uint64(operand, const_ratio[1], high_product);
+            std::uint64_t estimate = high_product[0] + low_product[1];
+
+            // The remainder (operand << 64) - estimate * p lies in [0, 2p) and fits in 64 bits.
+            std::uint64_t remainder = std::uint64_t(0) - estimate * modulus.value();
+            return estimate + static_cast<std::uint64_t>(remainder >= modulus.value());
+        }
+
         /**
         Returns x * y mod modulus.
         This is a highly-optimized variant of Barrett reduction.
@@ -341,4 +341,53 @@ namespace sealtest
             }
         }
     }
+
+    TEST(CKKSEncoderTest, CKKSEncoderEncodeManyDecodeTest)
+    {
+        EncryptionParameters parms(scheme_type::ckks);
+        size_t slots = 32;
+        parms.set_poly_modulus_degree(slots << 1);
+        parms.set_coeff_modulus(CoeffModulus::Create(slots << 1, { 40, 40, 40, 40 }));
+        SEALContext context(parms, false, sec_level_type::none);
+        CKKSEncoder encoder(context);
+        double delta = static_cast<double>(1ULL << 30);
+
+        srand(static_cast<unsigned>(time(NULL)));
+        int data_bound = (1 << 10);
+        vector<vector<double>> values(5);
+        for (size_t k = 0; k < values.size(); k++)
+        {
+            // Shorter vectors are padded with zeros
+            values[k].resize(slots - k);
+            for (auto &value : values[k])
+            {
+                value = static_cast<double>(rand() % data_bound);
+            }
+        }
+
+        vector<Plaintext> plains;
+        encoder.encode_many(values, context.first_parms_id(), delta, plains);
+        ASSERT_EQ(values.size(), plains.size());
+
+        Plaintext plain;
+        vector<double> result;
+        for (size_t k = 0; k < values.size(); k++)
+        {
+            // Batched encoding is identical to encoding each vector on its own
+            encoder.encode(values[k], context.first_parms_id(), delta, plain);
+            ASSERT_TRUE(plains[k].parms_id() == plain.parms_id());
+            ASSERT_EQ(plains[k].coeff_count(), plain.coeff_count());
+            ASSERT_TRUE(equal(plain.data(), plain.data() + plain.coeff_count(), plains[k].data()));
+
+            encoder.decode(plains[k], result);
+            for (size_t i = 0; i < slots; i++)
+            {
+                double expected = (i < values[k].size()) ? values[k][i] : 0.0;
+                ASSERT_TRUE(abs(expected - result[i]) < 0.5);
+            }
+        }
+
+        vector<vector<double>> too_long(1, vector<double>(slots + 1));
+        ASSERT_THROW(encoder.encode_many(too_long, delta, plains), invalid_argument);
+    }
 } // namespace sealtest
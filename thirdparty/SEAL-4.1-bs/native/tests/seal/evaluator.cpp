@@ -6140,4 +6140,390 @@ namespace sealtest
         ASSERT_TRUE(encrypted.parms_id() == parms_id);
         ASSERT_TRUE(plain.to_string() == "5x^64 + Ax^5");
     }
+
+    TEST(EvaluatorTest, KeySwitchShoupOperands)
+    {
+        // Keyswitching with precomputed Shoup quotients must match the 128-bit accumulation exactly; ten 60-bit
+        // primes also force intermediate lazy reductions in the inner product.
+        auto keyswitch_shoup = [](scheme_type scheme) {
+            EncryptionParameters parms(scheme);
+            parms.set_poly_modulus_degree(64);
+            if (scheme == scheme_type::bfv)
+            {
+                parms.set_plain_modulus(PlainModulus::Batching(64, 20));
+            }
+            parms.set_coeff_modulus(CoeffModulus::Create(64, vector<int>(10, 60)));
+            SEALContext context(parms, false, sec_level_type::none);
+            KeyGenerator keygen(context);
+            PublicKey pk;
+            keygen.create_public_key(pk);
+            RelinKeys rlk;
+            keygen.create_relin_keys(rlk);
+            GaloisKeys glk;
+            keygen.create_galois_keys(vector<int>{ 1 }, glk);
+            ASSERT_TRUE(rlk.has_shoup_operands(RelinKeys::get_index(2)));
+
+            RelinKeys rlk_plain = rlk;
+            rlk_plain.clear_shoup_operands();
+            ASSERT_FALSE(rlk_plain.has_shoup_operands(RelinKeys::get_index(2)));
+            GaloisKeys glk_plain = glk;
+            glk_plain.clear_shoup_operands();
+
+            // The Evaluator requires a CKKSEncoder, which can only be created from CKKS parameters
+            EncryptionParameters encoder_parms(scheme_type::ckks);
+            encoder_parms.set_poly_modulus_degree(64);
+            encoder_parms.set_coeff_modulus(parms.coeff_modulus());
+            SEALContext encoder_context(encoder_parms, false, sec_level_type::none);
+            CKKSEncoder encoder(encoder_context);
+            Encryptor encryptor(context, pk);
+            Evaluator evaluator(context, encoder);
+
+            Plaintext plain("1x^63 + 3Fx^5 + 2");
+            if (scheme == scheme_type::ckks)
+            {
+                encoder.encode(
+                    vector<double>{ 1.0, 2.0, 3.0 }, context.first_parms_id(), static_cast<double>(1ULL << 40), plain);
+            }
+            Ciphertext encrypted;
+            encryptor.encrypt(plain, encrypted);
+            Ciphertext squared;
+            evaluator.square(encrypted, squared);
+
+            Ciphertext relin1 = squared;
+            Ciphertext relin2 = squared;
+            evaluator.relinearize_inplace(relin1, rlk);
+            evaluator.relinearize_inplace(relin2, rlk_plain);
+            ASSERT_EQ(relin1.dyn_array().size(), relin2.dyn_array().size());
+            ASSERT_TRUE(equal(relin1.dyn_array().cbegin(), relin1.dyn_array().cend(), relin2.dyn_array().cbegin()));
+
+            uint32_t galois_elt = context.key_context_data()->galois_tool()->get_elt_from_step(1);
+            Ciphertext rotated1;
+            Ciphertext rotated2;
+            evaluator.apply_galois(encrypted, galois_elt, glk, rotated1);
+            evaluator.apply_galois(encrypted, galois_elt, glk_plain, rotated2);
+            ASSERT_TRUE(
+                equal(rotated1.dyn_array().cbegin(), rotated1.dyn_array().cend(), rotated2.dyn_array().cbegin()));
+        };
+
+        keyswitch_shoup(scheme_type::bfv);
+        keyswitch_shoup(scheme_type::ckks);
+    }
+
+    TEST(EvaluatorTest, CKKSConstFastPath)
+    {
+        // add_const_inplace and multiply_const_inplace work on RNS residues directly and must agree bit-for-bit with
+        // encoding the constant at the top level and switching it down to the ciphertext level.
+        EncryptionParameters parms(scheme_type::ckks);
+        parms.set_poly_modulus_degree(64);
+        parms.set_coeff_modulus(CoeffModulus::Create(64, { 60, 60, 60, 60, 60 }));
+        SEALContext context(parms, true, sec_level_type::none);
+        KeyGenerator keygen(context);
+        PublicKey pk;
+        keygen.create_public_key(pk);
+        CKKSEncoder encoder(context);
+        Encryptor encryptor(context, pk);
+        Evaluator evaluator(context, encoder);
+
+        vector<double> values(encoder.slot_count());
+        for (size_t i = 0; i < values.size(); i++)
+        {
+            values[i] = static_cast<double>(i % 5) - 2.0;
+        }
+
+        // Scaled constants below 64 bits, between 64 and 128 bits, and above 128 bits
+        for (double scale : { pow(2.0, 40), pow(2.0, 80), pow(2.0, 100) })
+        {
+            for (double value : { 0.0, 1.5, -0.5, 3.25e10, -7.0e12 })
+            {
+                Plaintext plain;
+                encoder.encode(values, scale, plain);
+                Ciphertext encrypted;
+                encryptor.encrypt(plain, encrypted);
+                evaluator.mod_switch_to_next_inplace(encrypted);
+
+                Plaintext const_plain;
+                encoder.encode(value, scale, const_plain);
+                evaluator.mod_switch_to_inplace(const_plain, encrypted.parms_id());
+
+                Ciphertext expected;
+                Ciphertext actual;
+                evaluator.add_plain(encrypted, const_plain, expected);
+                evaluator.add_const(encrypted, value, actual);
+                ASSERT_EQ(expected.dyn_array().size(), actual.dyn_array().size());
+                ASSERT_TRUE(equal(expected.data(), expected.data() + expected.dyn_array().size(), actual.data()));
+                ASSERT_EQ(expected.scale(), actual.scale());
+
+                if (value == 0.0)
+                {
+                    // Multiplying by zero yields a transparent ciphertext
+                    continue;
+                }
+                if (scale * scale < pow(2.0, 170))
+                {
+                    evaluator.multiply_plain(encrypted, const_plain, expected);
+                    evaluator.multiply_const(encrypted, value, actual);
+                    ASSERT_TRUE(equal(expected.data(), expected.data() + expected.dyn_array().size(), actual.data()));
+                    ASSERT_EQ(expected.scale(), actual.scale());
+                }
+                else
+                {
+                    ASSERT_THROW(evaluator.multiply_const(encrypted, value, actual), invalid_argument);
+                }
+            }
+        }
+    }
+
+    TEST(EvaluatorTest, CKKSMultiplyVectorCache)
+    {
+        EncryptionParameters parms(scheme_type::ckks);
+        parms.set_poly_modulus_degree(64);
+        parms.set_coeff_modulus(CoeffModulus::Create(64, { 60, 40, 40, 60 }));
+        SEALContext context(parms, true, sec_level_type::none);
+        KeyGenerator keygen(context);
+        PublicKey pk;
+        keygen.create_public_key(pk);
+        CKKSEncoder encoder(context);
+        Encryptor encryptor(context, pk);
+        Evaluator evaluator(context, encoder);
+        ASSERT_FALSE(evaluator.plaintext_cache());
+
+        double scale = pow(2.0, 40);
+        vector<complex<double>> values(encoder.slot_count());
+        vector<double> weights(encoder.slot_count());
+        for (size_t i = 0; i < values.size(); i++)
+        {
+            values[i] = complex<double>(static_cast<double>(i % 3), 0.5);
+            weights[i] = 0.25 * static_cast<double>(i % 4);
+        }
+        Plaintext plain;
+        encoder.encode(values, scale, plain);
+        Ciphertext encrypted;
+        encryptor.encrypt(plain, encrypted);
+        evaluator.mod_switch_to_next_inplace(encrypted);
+
+        Ciphertext expected;
+        evaluator.multiply_vector(encrypted, weights, expected);
+
+        auto cache = make_shared<PlaintextCache>();
+        evaluator.set_plaintext_cache(cache);
+        for (int i = 0; i < 3; i++)
+        {
+            Ciphertext actual;
+            evaluator.multiply_vector(encrypted, weights, actual);
+            ASSERT_TRUE(equal(expected.data(), expected.data() + expected.dyn_array().size(), actual.data()));
+            ASSERT_EQ(expected.scale(), actual.scale());
+
+            actual = encrypted;
+            evaluator.multiply_vector_inplace_reduced_error(actual, weights);
+            ASSERT_TRUE(equal(expected.data(), expected.data() + expected.dyn_array().size(), actual.data()));
+        }
+        ASSERT_EQ(1ULL, cache->size());
+        ASSERT_EQ(1ULL, cache->misses());
+        ASSERT_EQ(5ULL, cache->hits());
+
+        evaluator.set_plaintext_cache(nullptr);
+        ASSERT_FALSE(evaluator.plaintext_cache());
+    }
+
+    TEST(EvaluatorTest, CKKSFusedMultiplyRelinRescale)
+    {
+        // The fused chain and the in-place rescale must match the separate operations bit-for-bit
+        EncryptionParameters parms(scheme_type::ckks);
+        parms.set_poly_modulus_degree(64);
+        parms.set_coeff_modulus(CoeffModulus::Create(64, { 60, 40, 40, 60 }));
+        SEALContext context(parms, true, sec_level_type::none);
+        KeyGenerator keygen(context);
+        PublicKey pk;
+        keygen.create_public_key(pk);
+        RelinKeys rlk;
+        keygen.create_relin_keys(rlk);
+        CKKSEncoder encoder(context);
+        Encryptor encryptor(context, pk);
+        Evaluator evaluator(context, encoder);
+
+        double scale = pow(2.0, 40);
+        vector<double> values1(encoder.slot_count()), values2(encoder.slot_count());
+        for (size_t i = 0; i < values1.size(); i++)
+        {
+            values1[i] = static_cast<double>(i % 7) / 7.0;
+            values2[i] = 1.0 - static_cast<double>(i % 3);
+        }
+        Plaintext plain;
+        Ciphertext encrypted1, encrypted2;
+        encoder.encode(values1, scale, plain);
+        encryptor.encrypt(plain, encrypted1);
+        encoder.encode(values2, scale, plain);
+        encryptor.encrypt(plain, encrypted2);
+
+        Ciphertext product, expected, actual;
+        evaluator.multiply(encrypted1, encrypted2, product);
+        evaluator.relinearize_inplace(product, rlk);
+        evaluator.rescale_to_next(product, expected);
+        evaluator.multiply_relin_rescale(encrypted1, encrypted2, rlk, actual);
+        ASSERT_EQ(expected.parms_id(), actual.parms_id());
+        ASSERT_EQ(expected.dyn_array().size(), actual.dyn_array().size());
+        ASSERT_TRUE(equal(expected.data(), expected.data() + expected.dyn_array().size(), actual.data()));
+        ASSERT_EQ(expected.scale(), actual.scale());
+
+        evaluator.rescale_to_next_inplace(product);
+        ASSERT_TRUE(equal(expected.data(), expected.data() + expected.dyn_array().size(), product.data()));
+        ASSERT_EQ(expected.scale(), product.scale());
+
+        evaluator.square(encrypted1, product);
+        evaluator.relinearize_inplace(product, rlk);
+        evaluator.rescale_to_next(product, expected);
+        actual = encrypted1;
+        evaluator.square_relin_rescale_inplace(actual, rlk);
+        ASSERT_TRUE(equal(expected.data(), expected.data() + expected.dyn_array().size(), actual.data()));
+        ASSERT_EQ(expected.scale(), actual.scale());
+    }
+
+    TEST(EvaluatorTest, CKKSMultiplyAccumulate)
+    {
+        EncryptionParameters parms(scheme_type::ckks);
+        parms.set_poly_modulus_degree(64);
+        parms.set_coeff_modulus(CoeffModulus::Create(64, { 60, 40, 40, 60 }));
+        SEALContext context(parms, true, sec_level_type::none);
+        KeyGenerator keygen(context);
+        PublicKey pk;
+        keygen.create_public_key(pk);
+        RelinKeys rlk;
+        keygen.create_relin_keys(rlk);
+        CKKSEncoder encoder(context);
+        Encryptor encryptor(context, pk);
+        Decryptor decryptor(context, keygen.secret_key());
+        Evaluator evaluator(context, encoder);
+
+        double scale = pow(2.0, 40);
+        size_t slot_count = encoder.slot_count();
+        vector<Ciphertext> lhs(3), rhs(3);
+        vector<double> expected_values(slot_count, 0.0);
+        for (size_t k = 0; k < lhs.size(); k++)
+        {
+            vector<double> values1(slot_count), values2(slot_count);
+            for (size_t i = 0; i < slot_count; i++)
+            {
+                values1[i] = static_cast<double>((i + k) % 5) / 4.0;
+                values2[i] = static_cast<double>(k) - static_cast<double>(i % 3) / 2.0;
+                expected_values[i] += values1[i] * values2[i];
+            }
+            Plaintext plain;
+            encoder.encode(values1, scale, plain);
+            encryptor.encrypt(plain, lhs[k]);
+            encoder.encode(values2, scale, plain);
+            encryptor.encrypt(plain, rhs[k]);
+        }
+
+        // Bit-exact with summing unrelinearized products
+        Ciphertext sum, accumulated;
+        evaluator.multiply(lhs[0], rhs[0], sum);
+        for (size_t k = 0; k < lhs.size(); k++)
+        {
+            if (k > 0)
+            {
+                Ciphertext product;
+                evaluator.multiply(lhs[k], rhs[k], product);
+                evaluator.add_inplace(sum, product);
+            }
+            evaluator.multiply_accumulate(lhs[k], rhs[k], accumulated);
+        }
+        ASSERT_EQ(3ULL, accumulated.size());
+        ASSERT_TRUE(equal(sum.data(), sum.data() + sum.dyn_array().size(), accumulated.data()));
+        ASSERT_EQ(sum.scale(), accumulated.scale());
+
+        evaluator.relinearize_rescale_inplace(accumulated, rlk);
+        Plaintext plain;
+        decryptor.decrypt(accumulated, plain);
+        vector<double> result;
+        encoder.decode(plain, result);
+        for (size_t i = 0; i < slot_count; i++)
+        {
+            ASSERT_NEAR(expected_values[i], result[i], 0.001);
+        }
+
+        // The accumulator must match the product in level and scale, and cannot alias an input
+        Ciphertext mismatched = lhs[0];
+        ASSERT_THROW(evaluator.multiply_accumulate(lhs[1], rhs[1], mismatched), invalid_argument);
+        ASSERT_THROW(evaluator.multiply_accumulate(lhs[1], lhs[1], accumulated), invalid_argument);
+    }
+
+    TEST(EvaluatorTest, CKKSRotateVectorHoisted)
+    {
+        // Hoisted rotations must decrypt to the same slots as separate rotate_vector calls, for either rotation
+        // direction, with and without precomputed Shoup operands in the keys, and below the top data level
+        EncryptionParameters parms(scheme_type::ckks);
+        parms.set_poly_modulus_degree(64);
+        parms.set_coeff_modulus(CoeffModulus::Create(64, { 60, 40, 40, 60 }));
+        SEALContext context(parms, true, sec_level_type::none);
+        KeyGenerator keygen(context);
+        PublicKey pk;
+        keygen.create_public_key(pk);
+        vector<int> steps{ 1, -1, 3, -4 };
+        GaloisKeys glk;
+        keygen.create_galois_keys(steps, glk);
+        GaloisKeys glk_plain = glk;
+        glk_plain.clear_shoup_operands();
+        GaloisKeys glk_shoup = glk_plain;
+        glk_shoup.precompute_shoup_operands(context);
+        CKKSEncoder encoder(context);
+        Encryptor encryptor(context, pk);
+        Decryptor decryptor(context, keygen.secret_key());
+        Evaluator evaluator(context, encoder);
+
+        double scale = pow(2.0, 40);
+        size_t slot_count = encoder.slot_count();
+        vector<complex<double>> values(slot_count);
+        for (size_t i = 0; i < slot_count; i++)
+        {
+            values[i] = complex<double>(static_cast<double>(i % 7) - 3.0, static_cast<double>(i % 3) / 2.0);
+        }
+        Plaintext plain;
+        encoder.encode(values, scale, plain);
+        Ciphertext encrypted;
+        encryptor.encrypt(plain, encrypted);
+
+        auto decrypt = [&](const Ciphertext &ciphertext) {
+            Plaintext plain;
+            decryptor.decrypt(ciphertext, plain);
+            vector<complex<double>> result;
+            encoder.decode(plain, result);
+            return result;
+        };
+
+        for (int level = 0; level < 2; level++)
+        {
+            if (level > 0)
+            {
+                evaluator.mod_switch_to_next_inplace(encrypted);
+            }
+            for (const GaloisKeys *keys : { &glk, &glk_plain, &glk_shoup })
+            {
+                vector<Ciphertext> hoisted;
+                evaluator.rotate_vector_hoisted(encrypted, steps, *keys, hoisted);
+                ASSERT_EQ(steps.size(), hoisted.size());
+                for (size_t j = 0; j < steps.size(); j++)
+                {
+                    Ciphertext rotated;
+                    evaluator.rotate_vector(encrypted, steps[j], *keys, rotated);
+                    ASSERT_EQ(rotated.parms_id(), hoisted[j].parms_id());
+                    ASSERT_EQ(rotated.scale(), hoisted[j].scale());
+
+                    auto expected = decrypt(rotated);
+                    auto result = decrypt(hoisted[j]);
+                    for (size_t i = 0; i < slot_count; i++)
+                    {
+                        auto value = values[static_cast<size_t>(static_cast<int>(i + slot_count) + steps[j]) % slot_count];
+                        ASSERT_NEAR(expected[i].real(), result[i].real(), 0.001);
+                        ASSERT_NEAR(expected[i].imag(), result[i].imag(), 0.001);
+                        ASSERT_NEAR(value.real(), result[i].real(), 0.001);
+                        ASSERT_NEAR(value.imag(), result[i].imag(), 0.001);
+                    }
+                }
+            }
+        }
+
+        // Every step needs its own key
+        vector<Ciphertext> hoisted;
+        ASSERT_THROW(evaluator.rotate_vector_hoisted(encrypted, { 2 }, glk, hoisted), invalid_argument);
+    }
 } // namespace sealtest
@@ -0,0 +1,132 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT license.
+
+#include "seal/ckks.h"
+#include "seal/context.h"
+#include "seal/modulus.h"
+#include "seal/plaintextcache.h"
+#include <complex>
+#include <vector>
+#include "gtest/gtest.h"
+
+using namespace seal;
+using namespace std;
+
+namespace sealtest
+{
+    TEST(PlaintextCacheTest, HitsAndMisses)
+    {
+        EncryptionParameters parms(scheme_type::ckks);
+        parms.set_poly_modulus_degree(64);
+        parms.set_coeff_modulus(CoeffModulus::Create(64, { 40, 40, 40 }));
+        SEALContext context(parms, true, sec_level_type::none);
+        CKKSEncoder encoder(context);
+        double scale = pow(2.0, 30);
+
+        PlaintextCache cache;
+        int encodes = 0;
+        auto encode_scalar = [&](double value, parms_id_type parms_id) {
+            return cache.get_or_encode(value, parms_id, scale, [&](Plaintext &plain) {
+                encodes++;
+                encoder.encode(value, parms_id, scale, plain);
+            });
+        };
+
+        auto p1 = encode_scalar(1.5, context.first_parms_id());
+        auto p2 = encode_scalar(1.5, context.first_parms_id());
+        ASSERT_EQ(1, encodes);
+        ASSERT_EQ(p1.get(), p2.get());
+        ASSERT_EQ(1ULL, cache.hits());
+        ASSERT_EQ(1ULL, cache.misses());
+
+        // Value and parms_id are both part of the key
+        auto p3 = encode_scalar(-1.5, context.first_parms_id());
+        auto p4 = encode_scalar(1.5, context.last_parms_id());
+        ASSERT_EQ(3, encodes);
+        ASSERT_NE(p1.get(), p3.get());
+        ASSERT_EQ(context.last_parms_id(), p4->parms_id());
+        ASSERT_EQ(3ULL, cache.size());
+
+        // Scale is part of the key
+        cache.get_or_encode(1.5, context.first_parms_id(), scale * 2, [&](Plaintext &plain) {
+            encodes++;
+            encoder.encode(1.5, scale * 2, plain);
+        });
+        ASSERT_EQ(4, encodes);
+
+        // Real and complex vectors with the same bit patterns do not collide
+        vector<double> real_values{ 1.0, 0.0, 2.0, 0.0 };
+        vector<complex<double>> complex_values{ { 1.0, 0.0 }, { 2.0, 0.0 } };
+        auto p5 = cache.get_or_encode(real_values, context.first_parms_id(), scale, [&](Plaintext &plain) {
+            encodes++;
+            encoder.encode(real_values, scale, plain);
+        });
+        auto p6 = cache.get_or_encode(complex_values, context.first_parms_id(), scale, [&](Plaintext &plain) {
+            encodes++;
+            encoder.encode(complex_values, scale, plain);
+        });
+        ASSERT_EQ(6, encodes);
+        ASSERT_NE(p5.get(), p6.get());
+
+        vector<double> decoded;
+        encoder.decode(*p5, decoded);
+        ASSERT_NEAR(2.0, decoded[2], 0.001);
+
+        cache.clear();
+        ASSERT_EQ(0ULL, cache.size());
+        ASSERT_EQ(0ULL, cache.bytes());
+        ASSERT_EQ(0ULL, cache.hits());
+    }
+
+    TEST(PlaintextCacheTest, LeastRecentlyUsedEviction)
+    {
+        EncryptionParameters parms(scheme_type::ckks);
+        parms.set_poly_modulus_degree(64);
+        parms.set_coeff_modulus(CoeffModulus::Create(64, { 40, 40, 40 }));
+        SEALContext context(parms, true, sec_level_type::none);
+        CKKSEncoder encoder(context);
+        double scale = pow(2.0, 30);
+
+        // Each top-level plaintext holds 64 * 2 words plus the one key value
+        size_t entry_bytes = (64 * 2 + 1) * sizeof(uint64_t);
+        PlaintextCache cache(3 * entry_bytes);
+        int encodes = 0;
+        auto encode_scalar = [&](double value) {
+            return cache.get_or_encode(value, context.first_parms_id(), scale, [&](Plaintext &plain) {
+                encodes++;
+                encoder.encode(value, scale, plain);
+            });
+        };
+
+        encode_scalar(1.0);
+        encode_scalar(2.0);
+        encode_scalar(3.0);
+        ASSERT_EQ(3ULL, cache.size());
+        ASSERT_EQ(3 * entry_bytes, cache.bytes());
+
+        // Touch 1.0 so that 2.0 becomes the least recently used entry
+        encode_scalar(1.0);
+        encode_scalar(4.0);
+        ASSERT_EQ(3ULL, cache.size());
+        ASSERT_EQ(4, encodes);
+
+        encode_scalar(1.0);
+        encode_scalar(3.0);
+        encode_scalar(4.0);
+        ASSERT_EQ(4, encodes);
+        encode_scalar(2.0);
+        ASSERT_EQ(5, encodes);
+
+        // Shrinking the budget evicts immediately
+        cache.set_max_bytes(entry_bytes);
+        ASSERT_EQ(1ULL, cache.size());
+        ASSERT_EQ(entry_bytes, cache.bytes());
+
+        // Plaintexts larger than the budget are returned but not cached
+        cache.set_max_bytes(entry_bytes - 1);
+        auto plain = encode_scalar(5.0);
+        ASSERT_EQ(64ULL * 2, plain->coeff_count());
+        ASSERT_EQ(0ULL, cache.size());
+        ASSERT_EQ(0ULL, cache.bytes());
+    }
+} // namespace sealtest
@@ -6,6 +6,7 @@
 #include "seal/modulus.h"
 #include "seal/relinkeys.h"
 #include "seal/util/polyarithsmallmod.h"
+#include "seal/util/uintarithsmallmod.h"
 #include "seal/util/uintcore.h"
 #include "gtest/gtest.h"
 
@@ -201,4 +202,50 @@ namespace sealtest
         relin_keys_seeded_save_load(scheme_type::bfv);
         relin_keys_seeded_save_load(scheme_type::bgv);
     }
+
+    TEST(RelinKeysTest, RelinKeysShoupOperands)
+    {
+        EncryptionParameters parms(scheme_type::ckks);
+        parms.set_poly_modulus_degree(64);
+        parms.set_coeff_modulus(CoeffModulus::Create(64, { 60, 50, 60 }));
+        SEALContext context(parms, false, sec_level_type::none);
+        KeyGenerator keygen(context);
+        size_t index = RelinKeys::get_index(2);
+
+        RelinKeys keys;
+        keygen.create_relin_keys(keys);
+        ASSERT_TRUE(keys.has_shoup_operands(index));
+        ASSERT_FALSE(keys.has_shoup_operands(index + 1));
+
+        // Every stored quotient matches MultiplyUIntModOperand
+        auto &key_modulus = context.key_context_data()->parms().coeff_modulus();
+        for (size_t j = 0; j < keys.key(2).size(); j++)
+        {
+            auto &key = keys.key(2)[j].data();
+            auto &shoup = keys.shoup_data()[index][j];
+            ASSERT_EQ(key.dyn_array().size(), shoup.size());
+            for (size_t k = 0; k < shoup.size(); k++)
+            {
+                MultiplyUIntModOperand y;
+                y.set(key.dyn_array()[k], key_modulus[(k / 64) % key_modulus.size()]);
+                ASSERT_EQ(y.quotient, shoup[k]);
+            }
+        }
+
+        // Copies and loaded keys carry the quotients; seeded keys are expanded on load
+        RelinKeys copied_keys;
+        copied_keys = keys;
+        ASSERT_TRUE(copied_keys.has_shoup_operands(index));
+
+        stringstream stream;
+        keygen.create_relin_keys().save(stream);
+        RelinKeys loaded_keys;
+        loaded_keys.load(context, stream);
+        ASSERT_TRUE(loaded_keys.has_shoup_operands(index));
+
+        keys.clear_shoup_operands();
+        ASSERT_FALSE(keys.has_shoup_operands(index));
+        keys.precompute_shoup_operands(context);
+        ASSERT_TRUE(keys.has_shoup_operands(index));
+    }
 } // namespace sealtest
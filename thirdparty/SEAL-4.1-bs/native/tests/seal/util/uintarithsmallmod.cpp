@@ -403,6 +403,32 @@ namespace sealtest
             ASSERT_EQ(18446744073709551607ULL, y.quotient);
         }
 
+        TEST(UIntArithSmallMod, ShoupQuotient)
+        {
+            Modulus mod(3);
+            ASSERT_EQ(0ULL, shoup_quotient(0, mod));
+            ASSERT_EQ(6148914691236517205ULL, shoup_quotient(1, mod));
+            ASSERT_EQ(12297829382473034410ULL, shoup_quotient(2, mod));
+
+            mod = 2147483647ULL;
+            ASSERT_EQ(8589934596ULL, shoup_quotient(1, mod));
+            ASSERT_EQ(18446744065119617019ULL, shoup_quotient(2147483646ULL, mod));
+
+            mod = 2305843009211596801ULL;
+            ASSERT_EQ(8ULL, shoup_quotient(1, mod));
+            ASSERT_EQ(18446744073709551607ULL, shoup_quotient(2305843009211596800ULL, mod));
+
+            MultiplyUIntModOperand y;
+            for (auto &m : CoeffModulus::Create(1024, { 20, 30, 40, 50, 60 }))
+            {
+                for (uint64_t x : { uint64_t(0), uint64_t(1), m.value() >> 1, m.value() - 2, m.value() - 1 })
+                {
+                    y.set(x, m);
+                    ASSERT_EQ(y.quotient, shoup_quotient(x, m));
+                }
+            }
+        }
+
         TEST(UIntArithSmallMod, MultiplyUIntMod2)
         {
             Modulus mod(2);